@@ -0,0 +1,71 @@
+#ifndef AUDIO_MIXER_H
+#define AUDIO_MIXER_H
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Alignment of the buffers returned by audio_frame_alloc, the widest vector
+ * the mixing kernels load at once.
+ */
+#define AUDIO_FRAME_ALIGNMENT 32
+
+/**
+ * Highest gain accepted for one input.
+ */
+#define AUDIO_MIX_MAX_GAIN 16.0f
+
+/**
+ * @struct AudioMixInput
+ * @brief One decoded stream taking part in a mix.
+ *
+ * @field Samples 16-bit PCM samples, as many as the mixed frame has.
+ * @field Gain Linear gain applied to the stream, 1.0 leaves it unchanged.
+ */
+typedef struct {
+    const int16_t* samples;
+    float gain;
+} AudioMixInput;
+
+/**
+ * @brief Allocates a PCM frame buffer aligned to AUDIO_FRAME_ALIGNMENT.
+ *
+ * Mixing works on buffers at any address, aligned ones are the fastest.
+ *
+ * @param sample_count Number of 16-bit samples.
+ * @return The zeroed buffer, or NULL if memory allocation failed. Release it with audio_frame_free.
+ */
+int16_t* audio_frame_alloc(size_t sample_count);
+
+/**
+ * @brief Releases a buffer returned by audio_frame_alloc.
+ */
+void audio_frame_free(int16_t* frame);
+
+/**
+ * @brief Mixes decoded streams of a group call into one frame.
+ *
+ * When every gain is 1.0 and soft clipping is off, the streams are added
+ * with 16-bit saturation. Otherwise they are summed with their gains and,
+ * with soft clipping, peaks above 80% of full scale are bent smoothly
+ * towards full scale instead of being cut off. Vector kernels are used
+ * where the CPU has them (AVX2 or SSE2 on x86, NEON on 64-bit ARM).
+ *
+ * @param inputs The streams.
+ * @param input_count Number of streams, 0 produces silence.
+ * @param output Buffer receiving the mix, it may be one of the input buffers.
+ * @param sample_count Number of samples in every stream and in the output.
+ * @param soft_clip Whether to soft clip the mix.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode audio_mix(const AudioMixInput inputs[], size_t input_count, int16_t* output, size_t sample_count,
+                    bool soft_clip);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //AUDIO_MIXER_H
@@ -21,6 +21,18 @@ typedef enum {
     CALL_STATE_ENDED
 } CallState;
 
+/**
+ * @enum CallSignal
+ * @brief Events reported by signaling or by the host's timers.
+ */
+typedef enum {
+    CALL_SIGNAL_RINGING,   /**< The callee's device is ringing */
+    CALL_SIGNAL_ANSWERED,  /**< The callee answered */
+    CALL_SIGNAL_REJECTED,  /**< The callee rejected the call */
+    CALL_SIGNAL_ENDED,     /**< The peer hung up */
+    CALL_SIGNAL_TIMEOUT    /**< The call was not answered in time */
+} CallSignal;
+
 typedef struct {
     char call_id[CALL_ID_LENGTH];
     char peer_id[USER_ID_LENGTH];
@@ -31,9 +43,84 @@ typedef struct {
     // Add other relevant fields as needed
 } CallInfo;
 
+typedef uint32_t CallSubscription;
+
+#define CALL_STATE_MASK(state) (1u << (state))
+
+/**
+ * @struct CallStateFilter
+ * @brief Selects the call state changes delivered to a subscriber.
+ *
+ * @field Call_id Only changes of this call, empty for every call.
+ * @field State_mask CALL_STATE_MASK bits of the states to receive, 0 for every state.
+ * @field Coalesce Deliver only the latest matching change of each call per batch.
+ */
+typedef struct {
+    char call_id[CALL_ID_LENGTH];
+    uint32_t state_mask;
+    bool coalesce;
+} CallStateFilter;
+
+/**
+ * @enum CallMetric
+ * @brief Quality measurements sampled during a call.
+ */
+typedef enum {
+    CALL_METRIC_RTT,      /**< Round trip time in milliseconds */
+    CALL_METRIC_JITTER,   /**< Interarrival jitter in milliseconds */
+    CALL_METRIC_LOSS,     /**< Packet loss in basis points, 10000 is all packets */
+    CALL_METRIC_BITRATE,  /**< Received bitrate in kbit/s */
+    CALL_METRIC_COUNT
+} CallMetric;
+
+/**
+ * @struct CallMetricStats
+ * @brief Distribution of one metric of a call.
+ *
+ * Percentiles cover the latest CALL_STATS_WINDOW samples, the count, mean
+ * and extremes cover the whole call.
+ *
+ * @field Sample_count Samples recorded since the call started.
+ * @field Mean Mean of all samples.
+ * @field Min Smallest sample.
+ * @field Max Largest sample.
+ * @field P50 Median of the recent samples.
+ * @field P90 90th percentile of the recent samples.
+ * @field P99 99th percentile of the recent samples.
+ */
+typedef struct {
+    uint64_t sample_count;
+    double mean;
+    uint32_t min;
+    uint32_t max;
+    uint32_t p50;
+    uint32_t p90;
+    uint32_t p99;
+} CallMetricStats;
+
+/**
+ * @struct CallQuality
+ * @brief Quality statistics of a call, indexed by CallMetric.
+ */
+typedef struct {
+    char call_id[CALL_ID_LENGTH];
+    CallMetricStats metrics[CALL_METRIC_COUNT];
+} CallQuality;
+
 // Callback function types
 typedef void (*CallOperationCallback)(const CallInfo* call_info, ErrorCode error);
 typedef void (*CallStateChangeCallback)(const CallInfo* call_info);
+typedef void (*CallStateBatchCallback)(CallSubscription subscription, const CallInfo changes[], size_t count);
+
+/*
+ * Threading: every call function may be used from any thread. The events of
+ * one call are applied one at a time in the order they were queued, without
+ * a global lock. Callbacks run on the thread that applies the event, which
+ * is the caller's thread unless another thread is applying events of the
+ * same call at that moment. call_info is only valid during the callback.
+ * Operations that do not match the call state fail with
+ * CALL_ERROR_INVALID_STATE and leave the call unchanged.
+ */
 
 /**
  * @brief Starts a call with the specified user.
@@ -44,6 +131,25 @@ typedef void (*CallStateChangeCallback)(const CallInfo* call_info);
  */
 void start_call(const char* peer_id, CallType type, CallOperationCallback callback);
 
+/**
+ * @brief Registers a call offered by the network, which starts ringing.
+ *
+ * @param call_id The ID assigned to the call by the caller.
+ * @param peer_id The ID of the calling user.
+ * @param type The type of call (audio or video).
+ * @param callback Function to receive the call information and error code.
+ */
+void receive_call(const char* call_id, const char* peer_id, CallType type, CallOperationCallback callback);
+
+/**
+ * @brief Applies a signaling event or a timeout to a call.
+ *
+ * @param call_id The ID of the call.
+ * @param signal The event.
+ * @param callback Function to receive the call information and error code.
+ */
+void signal_call(const char* call_id, CallSignal signal, CallOperationCallback callback);
+
 /**
  * @brief Answers an incoming call.
  *
@@ -112,10 +218,72 @@ void unmute_call(const char* call_id, CallOperationCallback callback);
 /**
  * @brief Registers a callback for call state changes.
  *
+ * The callback runs synchronously on the thread applying the change, use
+ * subscribe_call_state_changes to observe calls without delaying signaling.
+ *
  * @param callback Function to be called when the call state changes.
  */
 void register_call_state_change_callback(CallStateChangeCallback callback);
 
+/**
+ * @brief Subscribes to call state changes.
+ *
+ * Changes are delivered on the library's call event thread, in the order
+ * they were applied, in batches of everything that matched the filter since
+ * the previous delivery. When a subscriber coalesces, the event thread waits
+ * CALL_DISPATCH_BATCH_WINDOW_MS after a change so a burst of transitions is
+ * delivered at once. Publishing never blocks the thread applying the change;
+ * if the event thread falls CALL_DISPATCH_QUEUE_SIZE changes behind, newer
+ * changes are dropped.
+ *
+ * @param filter The changes to deliver, NULL for all of them.
+ * @param callback Function receiving the batches.
+ * @param subscription Pointer receiving the handle for unsubscribing.
+ * @return ErrorCode indicating success or failure, ERROR_NOT_INITIALIZED before init.
+ */
+ErrorCode subscribe_call_state_changes(const CallStateFilter* filter, CallStateBatchCallback callback,
+                                       CallSubscription* subscription);
+
+/**
+ * @brief Ends a subscription.
+ *
+ * A delivery that is already running on the event thread may still reach
+ * the callback once, unless this is called from the callback itself.
+ *
+ * @param subscription The handle returned by subscribe_call_state_changes.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode unsubscribe_call_state_changes(CallSubscription subscription);
+
+/**
+ * @brief Records a quality sample of an active call.
+ *
+ * Meant for media and network threads: recording takes no lock and
+ * allocates nothing. Samples of a call that is not active fail with
+ * CALL_ERROR_NOT_FOUND.
+ *
+ * @param call_id The ID of the call.
+ * @param metric The metric measured.
+ * @param value The measurement, in the unit of the metric.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode record_call_metric(const char* call_id, CallMetric metric, uint32_t value);
+
+/**
+ * @brief Takes a snapshot of the quality statistics of an active call.
+ *
+ * When a call ends, a summary of its statistics is queued for the
+ * call_quality table of the call history. The next add_call_history_entry,
+ * delete_all_call_history, purge_call_history or deinit stores it on its
+ * own thread; only when CALL_STATS_SUMMARY_QUEUE_SIZE summaries are already
+ * waiting does the thread ending the call store it.
+ *
+ * @param call_id The ID of the call.
+ * @param quality Pointer receiving the statistics.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode get_call_quality(const char* call_id, CallQuality* quality);
+
 #ifdef __cplusplus
 }
 #endif
@@ -13,9 +13,12 @@ typedef enum {
     CALL_TYPE_INCOMING,
     CALL_TYPE_OUTGOING,
     CALL_TYPE_MISSED,
-    CALL_TYPE_REJECTED
+    CALL_TYPE_REJECTED,
+    CALL_TYPE_ANY = -1  // Filter value matching every type
 } CallType;
 
+#define CALL_TYPE_COUNT (CALL_TYPE_REJECTED + 1)
+
 // Call history entry details
 typedef struct {
     char call_id[CALL_ID_LENGTH];
@@ -23,9 +26,20 @@ typedef struct {
     int64_t timestamp;
     CallType type;
     uint32_t duration;  // In seconds
+    bool is_read;
 } CallHistoryEntry;
 
-// Call history filter options
+/**
+ * @struct CallHistoryFilter
+ * @brief Selects call history entries.
+ *
+ * @field Start_date Earliest timestamp, inclusive, 0 for no lower bound.
+ * @field End_date Latest timestamp, inclusive, 0 for no upper bound.
+ * @field Type Type of call, CALL_TYPE_ANY for every type.
+ * @field Include_read Whether read entries match.
+ * @field Include_unread Whether unread entries match.
+ * @field Contact_id Only calls with this contact, empty for every contact.
+ */
 typedef struct {
     int64_t start_date;
     int64_t end_date;
@@ -35,14 +49,70 @@ typedef struct {
     char contact_id[CONTACT_ID_LENGTH];
 } CallHistoryFilter;
 
+/**
+ * @struct CallTypeStats
+ * @brief Number and total duration of calls.
+ */
+typedef struct {
+    uint32_t call_count;
+    uint64_t total_duration;  // In seconds
+} CallTypeStats;
+
+/**
+ * @struct CallStats
+ * @brief Call statistics of a contact or of the whole history.
+ *
+ * @field By_type Statistics per call type, indexed by CallType.
+ * @field Total Statistics of all types together.
+ */
+typedef struct {
+    CallTypeStats by_type[CALL_TYPE_COUNT];
+    CallTypeStats total;
+} CallStats;
+
+/**
+ * @struct CallHistoryCursor
+ * @brief Opaque position in the call history, used for keyset pagination.
+ *
+ * The token encodes the timestamp and row of the last entry of a page, so
+ * entries added or deleted between pages never make a page skip or repeat
+ * entries. Hosts may persist it.
+ */
+typedef struct {
+    char token[CALL_HISTORY_CURSOR_LENGTH];
+} CallHistoryCursor;
+
 // Callback function types
 typedef void (*FetchHistoryCallback)(const CallHistoryEntry* entries, size_t count, ErrorCode error);
 typedef void (*OperationCallback)(ErrorCode error);
 typedef void (*GetCallDetailsCallback)(const CallHistoryEntry* entry, ErrorCode error);
+typedef bool (*ExportProgressCallback)(uint64_t exported_count, uint64_t total_count);
+typedef void (*CallHistoryPageCallback)(const CallHistoryEntry entries[], size_t count,
+                                        const CallHistoryCursor* next_cursor, ErrorCode error);
+
+/**
+ * @brief Adds an entry to the call history.
+ *
+ * @param entry The entry, its call_id must not be in the history yet.
+ * @param callback Function to receive the operation result.
+ */
+void add_call_history_entry(const CallHistoryEntry* entry, OperationCallback callback);
+
+/**
+ * @brief Marks a call history entry as read.
+ *
+ * @param call_id ID of the call.
+ * @param callback Function to receive the operation result.
+ */
+void mark_call_history_read(const char* call_id, OperationCallback callback);
 
 /**
  * @brief Fetches call history based on given filter criteria.
  *
+ * Entries come newest first. Every filter combination is answered from an
+ * index, but skipping entries with an offset still reads them; prefer
+ * fetch_call_history_page for paging through long histories.
+ *
  * @param filter Filter criteria. If NULL, all history is fetched.
  * @param limit Maximum number of entries to fetch. Zero means no limit.
  * @param offset Number of entries to skip (for pagination).
@@ -50,6 +120,21 @@ typedef void (*GetCallDetailsCallback)(const CallHistoryEntry* entry, ErrorCode
  */
 void fetch_call_history(const CallHistoryFilter* filter, size_t limit, size_t offset, FetchHistoryCallback callback);
 
+/**
+ * @brief Fetches a page of call history using a cursor.
+ *
+ * Entries come newest first. The callback receives the cursor of the next
+ * page, or NULL on the last page. A cursor must be used with the filter
+ * of the page it came from.
+ *
+ * @param filter Filter criteria. If NULL, all history is fetched.
+ * @param cursor Cursor returned with the previous page, or NULL for the first page.
+ * @param limit Maximum number of entries in the page, must not be zero.
+ * @param callback Function to receive the page, the next cursor and error code.
+ */
+void fetch_call_history_page(const CallHistoryFilter* filter, const CallHistoryCursor* cursor, size_t limit,
+                             CallHistoryPageCallback callback);
+
 /**
  * @brief Deletes a specific call history entry.
  *
@@ -61,18 +146,70 @@ void delete_call_history_entry(const char* call_id, OperationCallback callback);
 /**
  * @brief Deletes all call history entries.
  *
+ * The history and its statistics are cleared a page at a time rather than
+ * entry by entry, in one short transaction. Free pages are then returned
+ * to the file system.
+ *
  * @param callback Function to receive the operation result.
  */
 void delete_all_call_history(OperationCallback callback);
 
 /**
- * @brief Searches the call history.
+ * @brief Deletes the call history entries older than a timestamp.
+ *
+ * Entries are deleted oldest first in transactions of about
+ * CALL_HISTORY_PURGE_CHUNK entries, so other writers get in between. An
+ * interrupted purge leaves the history and its statistics consistent and
+ * can simply be repeated. Free pages are then returned to the file system.
+ *
+ * @param before Entries with an earlier timestamp are deleted.
+ * @param callback Function to receive the operation result.
+ */
+void purge_call_history(int64_t before, OperationCallback callback);
+
+/**
+ * @brief Retrieves call statistics from the rollups kept with the call history.
+ *
+ * The rollups are updated with every change to the history, reading them
+ * takes one row per call type, per UTC day of the range when one is given.
+ * Ranges are counted in whole UTC days: every call on the days of
+ * start_date and end_date is included.
+ *
+ * @param contact_id Only calls with this contact, NULL or empty for every contact.
+ * @param start_date Earliest timestamp, 0 for no lower bound.
+ * @param end_date Latest timestamp, 0 for no upper bound.
+ * @param stats Pointer receiving the statistics.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode get_call_stats(const char* contact_id, int64_t start_date, int64_t end_date, CallStats* stats);
+
+/**
+ * @brief Searches the call history by contact.
+ *
+ * The query is matched against the names and user IDs of the contacts the
+ * way search_contacts matches it, the calls with the matching contacts come
+ * newest first. Prefer search_call_history_page while the user is typing.
  *
  * @param query Search query string.
  * @param callback Function to receive the search results and error code.
  */
 void search_call_history(const char* query, FetchHistoryCallback callback);
 
+/**
+ * @brief Searches the call history by contact, a page at a time.
+ *
+ * Same matching and order as search_call_history. A page reads about as
+ * many entries as it returns when the query matches many calls, or just
+ * the calls of the matching contacts when it matches few.
+ *
+ * @param query Search query string.
+ * @param cursor Cursor returned with the previous page of the same query, or NULL for the first page.
+ * @param limit Maximum number of entries in the page, must not be zero.
+ * @param callback Function to receive the page, the next cursor and error code.
+ */
+void search_call_history_page(const char* query, const CallHistoryCursor* cursor, size_t limit,
+                              CallHistoryPageCallback callback);
+
 /**
  * @brief Retrieves details of a specific call.
  *
@@ -90,6 +227,24 @@ void get_call_details(const char* call_id, GetCallDetailsCallback callback);
  */
 void export_call_history(const char* format, const char* file_path, OperationCallback callback);
 
+/**
+ * @brief Exports call history to a file, reporting progress.
+ *
+ * Entries are streamed newest first from the database into the file, the
+ * memory used does not depend on the size of the history. The file appears
+ * under file_path only once it is complete; a failed or cancelled export
+ * leaves no file behind.
+ *
+ * @param format "CSV", "JSON" (one array) or "NDJSON" (one object per line), in any case.
+ * @param file_path Path of the file to export to.
+ * @param progress Called every CALL_HISTORY_EXPORT_PROGRESS_INTERVAL entries and once at the end
+ *                 with the entries written and the total; returning false cancels the export
+ *                 with ERROR_CANCELLED. May be NULL.
+ * @param callback Function to receive the operation result.
+ */
+void export_call_history_with_progress(const char* format, const char* file_path, ExportProgressCallback progress,
+                                       OperationCallback callback);
+
 #ifdef __cplusplus
 }
 #endif
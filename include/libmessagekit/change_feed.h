@@ -0,0 +1,129 @@
+#ifndef CHANGE_FEED_H
+#define CHANGE_FEED_H
+
+#include "common.h"
+#include "private/config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @enum ChangeEntity
+ * @brief Kind of record a change refers to.
+ */
+typedef enum {
+    CHANGE_ENTITY_MESSAGE,      /**< Row of the messages table, keyed by message ID */
+    CHANGE_ENTITY_CONVERSATION, /**< Row of the conversations table, keyed by conversation ID */
+    CHANGE_ENTITY_CONTACT,      /**< Row of the contacts table, keyed by contact ID */
+    CHANGE_ENTITY_SETTINGS      /**< The app settings row */
+} ChangeEntity;
+
+/**
+ * @enum ChangeOperation
+ * @brief Kind of mutation recorded in the change feed.
+ */
+typedef enum {
+    CHANGE_OPERATION_INSERT,
+    CHANGE_OPERATION_UPDATE,
+    CHANGE_OPERATION_DELETE
+} ChangeOperation;
+
+/**
+ * @struct ChangeRecord
+ * @brief A single entry of the change feed.
+ *
+ * @field seq Monotonically increasing sequence number of the change.
+ * @field entity Kind of record that changed.
+ * @field operation Kind of mutation.
+ * @field entity_id ID of the record that changed.
+ * @field scope_id Conversation ID of a changed message, empty for other entities.
+ * @field changed_at Time of the change in seconds.
+ */
+typedef struct {
+    int64_t seq;
+    ChangeEntity entity;
+    ChangeOperation operation;
+    char entity_id[MAX_CHANGE_ENTITY_ID_LENGTH];
+    char scope_id[MAX_CONVERSATION_ID_LENGTH];
+    int64_t changed_at;
+} ChangeRecord;
+
+/**
+ * @typedef ChangeFeedCallback
+ * @brief Callback function type for reading the change feed.
+ *
+ * @param changes Array of changes ordered by sequence number.
+ * @param count Number of changes in the array.
+ * @param next_seq Sequence number to pass to the next get_changes_since call.
+ * @param error Error code indicating the result of the operation.
+ */
+typedef void (*ChangeFeedCallback)(const ChangeRecord changes[], size_t count, int64_t next_seq, ErrorCode error);
+
+/**
+ * @function get_changes_since
+ * @brief Retrieves the changes recorded after a sequence number.
+ *
+ * Pass zero to read the feed from the beginning. Because compaction keeps
+ * only the latest change per record, an insert may be reported as an
+ * update; consumers should treat both as an upsert.
+ *
+ * @param seq The last sequence number the caller has already seen.
+ * @param limit Maximum number of changes to retrieve.
+ * @param callback Function to receive the changes and error code.
+ */
+void get_changes_since(int64_t seq, size_t limit, ChangeFeedCallback callback);
+
+/**
+ * @function get_latest_change_seq
+ * @brief Retrieves the sequence number of the most recent change.
+ *
+ * @param seq Pointer receiving the sequence number, zero if nothing changed yet.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode get_latest_change_seq(int64_t* seq);
+
+/**
+ * @function acknowledge_changes
+ * @brief Records that a sync peer has applied the changes up to a sequence number.
+ *
+ * The first acknowledgement registers the peer. A peer's sequence number
+ * never decreases, an older acknowledgement is ignored.
+ *
+ * @param peer_id ID of the peer.
+ * @param seq The last sequence number the peer has applied.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode acknowledge_changes(const char* peer_id, int64_t seq);
+
+/**
+ * @function remove_sync_peer
+ * @brief Stops holding back compaction for a peer that no longer syncs.
+ *
+ * @param peer_id ID of the peer.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode remove_sync_peer(const char* peer_id);
+
+/**
+ * @function compact_change_log
+ * @brief Removes changes superseded by a later change of the same record.
+ *
+ * Compaction never loses the latest state of a record, so readers at any
+ * sequence number still converge. The exception are deletes, which are
+ * removed once every peer registered with acknowledge_changes has
+ * acknowledged them; a reader behind every acknowledged sequence number
+ * must resynchronize from scratch. Only changes up to the given sequence
+ * number are considered.
+ *
+ * @param up_to_seq Highest sequence number eligible for compaction.
+ * @param removed_count Optional pointer receiving the number of removed changes.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode compact_change_log(int64_t up_to_seq, size_t* removed_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CHANGE_FEED_H
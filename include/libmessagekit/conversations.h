@@ -32,17 +32,99 @@ typedef struct {
     uint32_t unread_count;
     bool is_pinned;
     bool is_archived;
+    bool is_muted;
+    char peer_user_id[USER_ID_LENGTH];  // Other participant of an individual conversation, empty for groups
     // Add other relevant fields as needed
 } ConversationSummary;
 
+/**
+ * @struct ConversationCursor
+ * @brief Opaque position in a conversation list, used for keyset pagination.
+ *
+ * The token encodes the pinned state, archived state, last message timestamp
+ * and ID of the last conversation of a page. It stays valid when the list
+ * reorders, so pages never skip or repeat conversations. Hosts may persist it.
+ */
+typedef struct {
+    char token[CONVERSATION_CURSOR_LENGTH];
+} ConversationCursor;
+
+/**
+ * @enum ConversationListOperationType
+ * @brief Kind of change applied to a delivered conversation list.
+ */
+typedef enum {
+    CONVERSATION_LIST_INSERT, /**< Insert conversation at to_index */
+    CONVERSATION_LIST_UPDATE, /**< Replace the conversation at to_index, its position is unchanged */
+    CONVERSATION_LIST_MOVE,   /**< Remove the conversation at from_index, insert the updated one at to_index */
+    CONVERSATION_LIST_REMOVE  /**< Remove the conversation at from_index */
+} ConversationListOperationType;
+
+/**
+ * @struct ConversationListOperation
+ * @brief A single step transforming one list version into the next.
+ *
+ * Operations are applied in order, each index refers to the list as left by
+ * the previous operation.
+ *
+ * @field type Kind of change.
+ * @field from_index Position before the change, for moves and removals.
+ * @field to_index Position after the change, for inserts, updates and moves.
+ * @field conversation The new summary, only the conversation ID is set for removals.
+ */
+typedef struct {
+    ConversationListOperationType type;
+    size_t from_index;
+    size_t to_index;
+    ConversationSummary conversation;
+} ConversationListOperation;
+
+typedef uint32_t ConversationListSubscription;
+
+/**
+ * @enum ConversationBatchOperation
+ * @brief Change applied to every conversation of a batch.
+ */
+typedef enum {
+    CONVERSATION_BATCH_PIN,
+    CONVERSATION_BATCH_UNPIN,
+    CONVERSATION_BATCH_ARCHIVE,
+    CONVERSATION_BATCH_UNARCHIVE,
+    CONVERSATION_BATCH_MARK_READ,
+    CONVERSATION_BATCH_MUTE,
+    CONVERSATION_BATCH_UNMUTE
+} ConversationBatchOperation;
+
+/**
+ * @struct ConversationBatchResult
+ * @brief Aggregated outcome of a batch operation.
+ *
+ * @field updated_count Number of conversations that were changed.
+ * @field failed_count Number of IDs that were invalid or not found.
+ * @field failed_indexes Positions in the submitted ID array of the failed conversations.
+ */
+typedef struct {
+    size_t updated_count;
+    size_t failed_count;
+    const size_t* failed_indexes;
+} ConversationBatchResult;
+
 // Callback function types
 typedef void (*ConversationListCallback)(const ConversationSummary conversations[], size_t count, ErrorCode error);
+typedef void (*ConversationPageCallback)(const ConversationSummary conversations[], size_t count, const ConversationCursor* next_cursor, ErrorCode error);
 typedef void (*ConversationOperationCallback)(const ConversationSummary conversation[], ErrorCode error);
 typedef void (*OperationCallback)(ErrorCode error);
+typedef void (*ConversationBatchCallback)(const ConversationBatchResult* result, ErrorCode error);
+typedef void (*ConversationListDiffCallback)(ConversationListSubscription subscription, uint64_t base_version, uint64_t version,
+                                             const ConversationListOperation operations[], size_t count);
 
 /**
  * @brief Retrieves recent conversations.
  *
+ * Until the first change after init, pages of the non-archived list that
+ * lie within the snapshot saved at the last shutdown are served from the
+ * memory-mapped snapshot instead of the database.
+ *
  * @param limit Maximum number of conversations to retrieve.
  * @param offset Number of conversations to skip (for pagination).
  * @param include_archived Whether to include archived conversations.
@@ -50,6 +132,66 @@ typedef void (*OperationCallback)(ErrorCode error);
  */
 void get_recent_conversations(size_t limit, size_t offset, bool include_archived, ConversationListCallback callback);
 
+/**
+ * @brief Retrieves a page of recent conversations using a cursor.
+ *
+ * Each page is an index seek, independent of how far the user has scrolled.
+ * The callback receives the cursor of the next page, or NULL on the last page.
+ *
+ * @param cursor Cursor returned with the previous page, or NULL for the first page.
+ * @param limit Maximum number of conversations to retrieve, must not be zero.
+ * @param include_archived Whether to include archived conversations.
+ * @param callback Function to receive the page, the next cursor and error code.
+ */
+void get_recent_conversations_page(const ConversationCursor* cursor, size_t limit, bool include_archived, ConversationPageCallback callback);
+
+/**
+ * @brief Retrieves the conversation list saved by the last snapshot.
+ *
+ * Reads the top conversations from a memory-mapped snapshot file without
+ * touching the database, so it may be called before init() completes, for
+ * example while init() runs on another thread. The result can be stale and
+ * should be replaced by get_recent_conversations once the library is ready.
+ *
+ * @param storage_path The storage path later passed to init().
+ * @param callback Function to receive the saved conversations and error code.
+ */
+void get_recent_conversations_snapshot(const char* storage_path, ConversationListCallback callback);
+
+/**
+ * @brief Saves the top of the conversation list for the next cold start.
+ *
+ * Called by deinit(), hosts may also call it periodically, for example when
+ * the app moves to the background.
+ *
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode save_conversation_snapshot();
+
+/**
+ * @brief Subscribes to incremental changes of the conversation list.
+ *
+ * The first delivery inserts the whole list on top of version zero. Each
+ * later delivery transforms base_version into version with insert, update,
+ * move and remove operations, so the host never re-fetches or re-diffs the
+ * full list. The order matches get_recent_conversations.
+ *
+ * @param include_archived Whether the observed list includes archived conversations.
+ * @param callback Function to receive the list operations.
+ * @param subscription Pointer receiving the subscription ID.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode subscribe_conversation_list_changes(bool include_archived, ConversationListDiffCallback callback,
+                                              ConversationListSubscription* subscription);
+
+/**
+ * @brief Cancels a conversation list subscription.
+ *
+ * @param subscription The subscription to cancel.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode unsubscribe_conversation_list_changes(ConversationListSubscription subscription);
+
 /**
  * @brief Searches recent conversations.
  *
@@ -93,11 +235,55 @@ void unarchive_conversation(const char* conversation_id, ConversationOperationCa
 /**
  * @brief Marks all messages in a conversation as read.
  *
+ * Moves the read watermark of the conversation to its latest message, a
+ * single-row update regardless of the number of unread messages.
+ *
  * @param conversation_id The ID of the conversation to mark as read.
  * @param callback Function to receive the operation result and updated conversation summary.
  */
 void mark_conversation_as_read(const char* conversation_id, ConversationOperationCallback callback);
 
+/**
+ * @brief Mutes notifications for a conversation.
+ *
+ * @param conversation_id The ID of the conversation to mute.
+ * @param callback Function to receive the updated conversation summary and error code.
+ */
+void mute_conversation(const char* conversation_id, ConversationOperationCallback callback);
+
+/**
+ * @brief Unmutes notifications for a conversation.
+ *
+ * @param conversation_id The ID of the conversation to unmute.
+ * @param callback Function to receive the updated conversation summary and error code.
+ */
+void unmute_conversation(const char* conversation_id, ConversationOperationCallback callback);
+
+/**
+ * @brief Applies one operation to many conversations at once.
+ *
+ * All changes are written in a single transaction, so observers receive a
+ * single change notification. IDs that are invalid or unknown do not abort
+ * the batch, they are reported in the result instead.
+ *
+ * @param conversation_ids Array of conversation IDs.
+ * @param count Number of IDs in the array.
+ * @param operation The operation to apply.
+ * @param callback Function to receive the aggregated result and error code.
+ */
+void apply_conversation_batch(const char* const conversation_ids[], size_t count, ConversationBatchOperation operation,
+                              ConversationBatchCallback callback);
+
+/**
+ * @brief Retrieves the number of unread messages across all conversations.
+ *
+ * The total is maintained incrementally, reading it is a single-row lookup.
+ *
+ * @param count Pointer receiving the total unread count.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode get_total_unread_count(uint32_t* count);
+
 /**
  * @brief Retrieves pinned conversations.
  *
@@ -114,6 +300,15 @@ void get_pinned_conversations(ConversationListCallback callback);
  */
 void get_archived_conversations(size_t limit, size_t offset, ConversationListCallback callback);
 
+/**
+ * @brief Retrieves a page of archived conversations using a cursor.
+ *
+ * @param cursor Cursor returned with the previous page, or NULL for the first page.
+ * @param limit Maximum number of archived conversations to retrieve, must not be zero.
+ * @param callback Function to receive the page, the next cursor and error code.
+ */
+void get_archived_conversations_page(const ConversationCursor* cursor, size_t limit, ConversationPageCallback callback);
+
  /**
   * @brief Blocks a user.
   *
@@ -71,6 +71,17 @@ typedef enum {
  */
 ErrorCode init(const CoreConfig* config);
 
+/**
+ * @function deinit
+ * @brief Releases the resources acquired by init.
+ *
+ * Saves the conversation list snapshot used for the next cold start, stops
+ * all modules and closes the database.
+ *
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode deinit();
+
 /**
  * @function migrate_data
  * @brief Migrates all library data to a new storage location.
@@ -5,7 +5,8 @@ typedef enum {
     ERROR_CATEGORY_GENERAL = 0,
     ERROR_CATEGORY_NETWORK = 1000,
     ERROR_CATEGORY_DATABASE = 2000,
-    ERROR_CATEGORY_AUTH = 3000
+    ERROR_CATEGORY_AUTH = 3000,
+    ERROR_CATEGORY_CALL = 4000
 } ErrorCategory;
 
 typedef enum {
@@ -15,7 +16,13 @@ typedef enum {
     ERROR_INVALID_PARAMS,
     ERROR_ALREADY_INITIALIZED,
     ERROR_INVALID_STORAGE_PATH,
-    ERROR_INVALID_DATABASE_FILENAME
+    ERROR_INVALID_DATABASE_FILENAME,
+    ERROR_FILE_IO,
+    ERROR_INVALID_FORMAT,
+    ERROR_SENDER_BLOCKED,
+    ERROR_CANCELLED,
+    ERROR_QUEUE_FULL,
+    ERROR_NOT_INITIALIZED
 } GeneralErrorCode;
 
 typedef enum {
@@ -28,7 +35,9 @@ typedef enum {
     DB_ERROR_NONE = ERROR_CATEGORY_DATABASE,
     DB_ERROR_INITIALIZATION,
     DB_ERROR_QUERY,
-    DB_ERROR_SCHEMA
+    DB_ERROR_SCHEMA,
+    DB_ERROR_NOT_FOUND,
+    DB_ERROR_TRANSACTION
 } DatabaseErrorCode;
 
 typedef enum {
@@ -37,6 +46,14 @@ typedef enum {
     AUTH_ERROR_INVALID_TOKEN
 } AuthErrorCode;
 
+typedef enum {
+    CALL_ERROR_NONE = ERROR_CATEGORY_CALL,
+    CALL_ERROR_NOT_FOUND,
+    CALL_ERROR_INVALID_STATE,
+    CALL_ERROR_QUEUE_FULL,
+    CALL_ERROR_TOO_MANY_CALLS
+} CallErrorCode;
+
 typedef int ErrorCode;
 
 #define MAKE_ERROR(category, code) ((category) | (code))
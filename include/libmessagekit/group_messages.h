@@ -0,0 +1,324 @@
+#ifndef GROUP_MESSAGES_H
+#define GROUP_MESSAGES_H
+
+#include "common.h"
+#include "messages.h"
+#include "private/config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @enum GroupRecipientState
+ * @brief Delivery state of one recipient of a group message.
+ */
+typedef enum {
+    GROUP_RECIPIENT_PENDING,
+    GROUP_RECIPIENT_SENT,
+    GROUP_RECIPIENT_FAILED
+} GroupRecipientState;
+
+/**
+ * @enum GroupReceiptType
+ * @brief Kind of receipt a member sends for a group message.
+ */
+typedef enum {
+    GROUP_RECEIPT_DELIVERED,
+    GROUP_RECEIPT_READ
+} GroupReceiptType;
+
+/**
+ * @struct GroupMessage
+ * @brief Structure representing an outgoing group message.
+ *
+ * @field Message_id Unique identifier of the message.
+ * @field Group_id ID of the group, also the ID of its conversation.
+ * @field Sender_id ID of the sending user.
+ * @field Type of the message.
+ * @field Timestamp of when the message was sent.
+ * @field Content of the message.
+ */
+typedef struct {
+    char message_id[MESSAGE_ID_LENGTH];
+    char group_id[GROUP_ID_LENGTH];
+    char sender_id[USER_ID_LENGTH];
+    MessageType type;
+    int64_t timestamp;
+    char content[MAX_CONTENT_LENGTH];
+} GroupMessage;
+
+/**
+ * @struct GroupSendResult
+ * @brief Outcome of a group message fan-out.
+ *
+ * @field Message_id ID of the sent message.
+ * @field Recipient_count Number of recipients the message was addressed to.
+ * @field Sent_count Number of recipients whose envelope was handed to the transport.
+ * @field Failed_count Number of recipients that could not be encoded or sent.
+ * @field Frame_count Number of network frames the recipients were batched into.
+ * @field Recipient_states Packed per-recipient states, read with get_group_recipient_state.
+ */
+typedef struct {
+    char message_id[MESSAGE_ID_LENGTH];
+    size_t recipient_count;
+    size_t sent_count;
+    size_t failed_count;
+    size_t frame_count;
+    const uint8_t* recipient_states;
+} GroupSendResult;
+
+/**
+ * @struct GroupReceipt
+ * @brief Structure representing a receipt of one member for one group message.
+ *
+ * @field Message_id ID of the group message.
+ * @field User_id ID of the member the receipt is from.
+ * @field Type of the receipt, a read receipt also marks the message delivered.
+ */
+typedef struct {
+    char message_id[MESSAGE_ID_LENGTH];
+    char user_id[USER_ID_LENGTH];
+    GroupReceiptType type;
+} GroupReceipt;
+
+/**
+ * @struct GroupReceiptCounts
+ * @brief Aggregate receipt state of a group message.
+ *
+ * @field Delivered_count Number of members the message was delivered to.
+ * @field Read_count Number of members that read the message.
+ */
+typedef struct {
+    size_t delivered_count;
+    size_t read_count;
+} GroupReceiptCounts;
+
+/**
+ * @typedef GroupSendCallback
+ * @brief Callback function type for group message sends.
+ *
+ * @param result The fan-out outcome, valid only during the call.
+ * @param error Error code of the operation.
+ */
+typedef void (*GroupSendCallback)(const GroupSendResult* result, ErrorCode error);
+
+/**
+ * @typedef GroupOperationCallback
+ * @brief Callback function type for membership changes.
+ *
+ * @param error Error code of the operation.
+ */
+typedef void (*GroupOperationCallback)(ErrorCode error);
+
+/**
+ * @typedef GroupIdListCallback
+ * @brief Callback function type for membership queries.
+ *
+ * @param ids Array of user or group IDs, valid only during the call.
+ * @param count Number of IDs in the array.
+ * @param error Error code of the operation.
+ */
+typedef void (*GroupIdListCallback)(const char* const ids[], size_t count, ErrorCode error);
+
+/**
+ * @typedef GroupReceiptCallback
+ * @brief Callback function type for receipt batches.
+ *
+ * @param applied_count Number of receipts that changed the state of a message.
+ * @param error Error code of the operation.
+ */
+typedef void (*GroupReceiptCallback)(size_t applied_count, ErrorCode error);
+
+/**
+ * @typedef GroupRecipientEncoder
+ * @brief Produces the envelope of one recipient, e.g. by encrypting the payload for them.
+ *
+ * Called concurrently from the fan-out worker threads.
+ *
+ * @param recipient_id The ID of the recipient.
+ * @param payload The serialized message.
+ * @param payload_size Size of the payload in bytes.
+ * @param envelope Buffer receiving the envelope.
+ * @param envelope_capacity Size of the buffer, payload_size + GROUP_ENVELOPE_OVERHEAD.
+ * @param envelope_size Pointer receiving the size of the envelope.
+ * @return ErrorCode indicating success or failure, a failure only affects this recipient.
+ */
+typedef ErrorCode (*GroupRecipientEncoder)(const char* recipient_id, const uint8_t* payload, size_t payload_size,
+                                           uint8_t* envelope, size_t envelope_capacity, size_t* envelope_size);
+
+/**
+ * @typedef GroupFrameSink
+ * @brief Transmits one network frame carrying the envelopes of a chunk of recipients.
+ *
+ * Called on the thread that sends the message, in frame order.
+ *
+ * @param frame The encoded frame.
+ * @param frame_size Size of the frame in bytes.
+ * @return ErrorCode indicating success or failure, a failure marks every recipient of the frame as failed.
+ */
+typedef ErrorCode (*GroupFrameSink)(const uint8_t* frame, size_t frame_size);
+
+/**
+ * @function set_group_recipient_encoder
+ * @brief Sets the per-recipient envelope encoder.
+ *
+ * Without an encoder the payload is sent to every recipient as is.
+ *
+ * @param encoder The encoder, or NULL for the default.
+ */
+void set_group_recipient_encoder(GroupRecipientEncoder encoder);
+
+/**
+ * @function set_group_frame_sink
+ * @brief Sets the transport that receives the fan-out frames.
+ *
+ * @param sink The transport, required before sending group messages.
+ */
+void set_group_frame_sink(GroupFrameSink sink);
+
+/**
+ * @function send_group_message
+ * @brief Stores a group message and fans it out to the recipients.
+ *
+ * Recipients are split into chunks of GROUP_FANOUT_CHUNK_SIZE. Their
+ * envelopes are encoded on the worker threads while earlier chunks are
+ * being transmitted, each chunk travels as a single frame.
+ *
+ * @param message The message to send.
+ * @param recipient_ids Array of recipient user IDs.
+ * @param recipient_count Number of recipients in the array.
+ * @param callback Function to be called when the operation is complete.
+ */
+void send_group_message(const GroupMessage* message, const char* const recipient_ids[], size_t recipient_count,
+                        GroupSendCallback callback);
+
+/**
+ * @function send_group_message_to_members
+ * @brief Sends a group message to every member of the group except the sender.
+ *
+ * @param message The message to send.
+ * @param callback Function to be called when the operation is complete.
+ */
+void send_group_message_to_members(const GroupMessage* message, GroupSendCallback callback);
+
+/**
+ * @function add_group_members
+ * @brief Adds users to a group.
+ *
+ * @param group_id The ID of the group.
+ * @param user_ids Array of user IDs to add.
+ * @param count Number of user IDs in the array.
+ * @param callback Function to be called when the operation is complete.
+ */
+void add_group_members(const char* group_id, const char* const user_ids[], size_t count, GroupOperationCallback callback);
+
+/**
+ * @function remove_group_members
+ * @brief Removes users from a group.
+ *
+ * @param group_id The ID of the group.
+ * @param user_ids Array of user IDs to remove.
+ * @param count Number of user IDs in the array.
+ * @param callback Function to be called when the operation is complete.
+ */
+void remove_group_members(const char* group_id, const char* const user_ids[], size_t count, GroupOperationCallback callback);
+
+/**
+ * @function is_group_member
+ * @brief Checks whether a user belongs to a group, without touching the database.
+ *
+ * @param group_id The ID of the group.
+ * @param user_id The ID of the user.
+ * @return True if the user is a member.
+ */
+bool is_group_member(const char* group_id, const char* user_id);
+
+/**
+ * @function get_group_member_count
+ * @brief Retrieves the number of members of a group.
+ *
+ * @param group_id The ID of the group.
+ * @param count Pointer receiving the number of members.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode get_group_member_count(const char* group_id, size_t* count);
+
+/**
+ * @function get_group_members
+ * @brief Retrieves the members of a group.
+ *
+ * @param group_id The ID of the group.
+ * @param callback Function to receive the member IDs.
+ */
+void get_group_members(const char* group_id, GroupIdListCallback callback);
+
+/**
+ * @function get_user_groups
+ * @brief Retrieves the groups a user belongs to.
+ *
+ * @param user_id The ID of the user.
+ * @param callback Function to receive the group IDs.
+ */
+void get_user_groups(const char* user_id, GroupIdListCallback callback);
+
+/**
+ * @function get_common_group_members
+ * @brief Retrieves the users that belong to both groups.
+ *
+ * @param group_id The ID of the first group.
+ * @param other_group_id The ID of the second group.
+ * @param callback Function to receive the member IDs.
+ */
+void get_common_group_members(const char* group_id, const char* other_group_id, GroupIdListCallback callback);
+
+/**
+ * @function apply_group_receipts
+ * @brief Records a batch of delivery and read receipts.
+ *
+ * Receipts are folded per message into the member bitsets of that message,
+ * each message is written once per batch and the whole batch is one
+ * transaction. Duplicates and receipts from users that are not members of
+ * the group are ignored.
+ *
+ * @param receipts Array of receipts.
+ * @param count Number of receipts in the array.
+ * @param callback Function to be called when the operation is complete.
+ */
+void apply_group_receipts(const GroupReceipt receipts[], size_t count, GroupReceiptCallback callback);
+
+/**
+ * @function get_group_receipt_counts
+ * @brief Retrieves how many members a group message was delivered to and read by.
+ *
+ * @param message_id The ID of the group message.
+ * @param counts Pointer receiving the counts, zero for messages without receipts.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode get_group_receipt_counts(const char* message_id, GroupReceiptCounts* counts);
+
+/**
+ * @function get_group_receipt_members
+ * @brief Retrieves the members a group message was delivered to or read by.
+ *
+ * @param message_id The ID of the group message.
+ * @param type GROUP_RECEIPT_DELIVERED or GROUP_RECEIPT_READ.
+ * @param callback Function to receive the member IDs.
+ */
+void get_group_receipt_members(const char* message_id, GroupReceiptType type, GroupIdListCallback callback);
+
+/**
+ * @function get_group_recipient_state
+ * @brief Reads the state of one recipient from a send result.
+ *
+ * @param result The send result.
+ * @param index Position of the recipient in the array passed to send_group_message.
+ * @return The state of the recipient.
+ */
+GroupRecipientState get_group_recipient_state(const GroupSendResult* result, size_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //GROUP_MESSAGES_H
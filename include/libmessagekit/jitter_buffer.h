@@ -0,0 +1,173 @@
+#ifndef JITTER_BUFFER_H
+#define JITTER_BUFFER_H
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Reorders incoming audio frames of a call and times their playout.
+ *
+ * Frames are stored in a fixed pool sized when the buffer is created, so
+ * receiving a packet never allocates memory. The playout delay adapts to
+ * the measured network jitter between a minimum and a maximum. A jitter
+ * buffer is not thread-safe; frames must be put and taken on one thread or
+ * under a lock held by the host.
+ */
+typedef struct JitterBuffer JitterBuffer;
+
+/**
+ * @struct JitterBufferConfig
+ * @brief Parameters of a jitter buffer.
+ *
+ * @field Sample_rate RTP clock rate of the stream, e.g. 48000.
+ * @field Frame_duration_ms Duration of one frame, the interval at which frames are taken.
+ * @field Max_frame_size Largest encoded frame in bytes.
+ * @field Frame_capacity Number of frames the buffer can hold, at most 32768.
+ * @field Min_delay_ms Lowest playout delay.
+ * @field Max_delay_ms Highest playout delay.
+ */
+typedef struct {
+    uint32_t sample_rate;
+    uint32_t frame_duration_ms;
+    size_t max_frame_size;
+    size_t frame_capacity;
+    uint32_t min_delay_ms;
+    uint32_t max_delay_ms;
+} JitterBufferConfig;
+
+/**
+ * @enum JitterFrameKind
+ * @brief What the buffer produced for a playout interval.
+ */
+typedef enum {
+    JITTER_FRAME_AUDIO,      /**< A received frame */
+    JITTER_FRAME_CONCEALED,  /**< A frame was lost or late, data holds the concealment or is empty for silence */
+    JITTER_FRAME_EMPTY       /**< The buffer is filling up, play silence */
+} JitterFrameKind;
+
+/**
+ * @struct JitterFrame
+ * @brief A frame taken from the buffer.
+ *
+ * @field Kind What the frame is.
+ * @field Sequence RTP sequence number of the frame or of the frame it replaces.
+ * @field Timestamp RTP timestamp of the frame, 0 for concealed and empty frames.
+ * @field Data Frame data, valid until the next call to jitter_buffer_get.
+ * @field Size Size of the data in bytes.
+ */
+typedef struct {
+    JitterFrameKind kind;
+    uint16_t sequence;
+    uint32_t timestamp;
+    const uint8_t* data;
+    size_t size;
+} JitterFrame;
+
+/**
+ * @struct JitterBufferStats
+ * @brief Counters and delay figures of a jitter buffer.
+ *
+ * @field Received_count Frames accepted into the buffer.
+ * @field Late_count Frames that arrived after their playout time and were dropped.
+ * @field Duplicate_count Frames that were already buffered.
+ * @field Overflow_count Frames dropped because the pool was exhausted.
+ * @field Lost_count Playout intervals whose frame never arrived.
+ * @field Concealed_count Intervals filled by concealment, lost frames and underruns.
+ * @field Underrun_count Intervals where the buffer ran dry while playing.
+ * @field Accelerated_count Frames skipped to bring the delay back down.
+ * @field Reset_count Times the stream jumped and the buffer started over.
+ * @field Jitter_ms Smoothed interarrival jitter, as defined by RFC 3550.
+ * @field Target_delay_ms Playout delay the buffer currently aims for.
+ * @field Current_delay_ms Audio currently buffered ahead of playout.
+ */
+typedef struct {
+    uint64_t received_count;
+    uint64_t late_count;
+    uint64_t duplicate_count;
+    uint64_t overflow_count;
+    uint64_t lost_count;
+    uint64_t concealed_count;
+    uint64_t underrun_count;
+    uint64_t accelerated_count;
+    uint64_t reset_count;
+    double jitter_ms;
+    uint32_t target_delay_ms;
+    uint32_t current_delay_ms;
+} JitterBufferStats;
+
+/**
+ * @typedef JitterConcealmentHook
+ * @brief Produces a replacement for a missing frame, e.g. with the codec's packet loss concealment.
+ *
+ * @param missing_sequence Sequence number of the missing frame.
+ * @param previous_frame The last frame played, NULL if there is none.
+ * @param previous_size Size of the last frame in bytes.
+ * @param output Buffer receiving the replacement.
+ * @param output_capacity Size of the buffer, the configured max_frame_size.
+ * @return Size of the replacement in bytes, 0 to play silence.
+ */
+typedef size_t (*JitterConcealmentHook)(uint16_t missing_sequence, const uint8_t* previous_frame, size_t previous_size,
+                                        uint8_t* output, size_t output_capacity);
+
+/**
+ * @brief Creates a jitter buffer and its frame pool.
+ *
+ * @param config The parameters.
+ * @return The buffer, or NULL if the parameters are invalid or memory allocation failed.
+ */
+JitterBuffer* jitter_buffer_create(const JitterBufferConfig* config);
+
+/**
+ * @brief Destroys a jitter buffer.
+ */
+void jitter_buffer_destroy(JitterBuffer* buffer);
+
+/**
+ * @brief Sets the concealment used for missing frames.
+ *
+ * Without a hook missing frames are reported with empty data, to be played as silence.
+ *
+ * @param buffer The buffer.
+ * @param hook The hook, or NULL.
+ */
+void jitter_buffer_set_concealment_hook(JitterBuffer* buffer, JitterConcealmentHook hook);
+
+/**
+ * @brief Stores a received frame.
+ *
+ * @param buffer The buffer.
+ * @param sequence RTP sequence number.
+ * @param timestamp RTP timestamp.
+ * @param arrival_ms Local arrival time in milliseconds.
+ * @param data The encoded frame.
+ * @param size Size of the frame, at most max_frame_size.
+ * @return ErrorCode indicating success or failure, dropped late or duplicate frames are not failures.
+ */
+ErrorCode jitter_buffer_put(JitterBuffer* buffer, uint16_t sequence, uint32_t timestamp, int64_t arrival_ms,
+                            const uint8_t* data, size_t size);
+
+/**
+ * @brief Takes the frame to play next, called once per frame duration by the playout clock.
+ *
+ * @param buffer The buffer.
+ * @param frame Pointer receiving the frame.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode jitter_buffer_get(JitterBuffer* buffer, JitterFrame* frame);
+
+/**
+ * @brief Reads the statistics of a jitter buffer.
+ *
+ * @param buffer The buffer.
+ * @param stats Pointer receiving the statistics.
+ */
+void jitter_buffer_get_stats(const JitterBuffer* buffer, JitterBufferStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //JITTER_BUFFER_H
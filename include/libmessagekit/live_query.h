@@ -0,0 +1,92 @@
+#ifndef LIVE_QUERY_H
+#define LIVE_QUERY_H
+
+#include "common.h"
+#include "private/config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @enum LiveQueryDiffOperation
+ * @brief Kind of change reported to a live query subscriber.
+ */
+typedef enum {
+    LIVE_QUERY_DIFF_INSERT,
+    LIVE_QUERY_DIFF_UPDATE,
+    LIVE_QUERY_DIFF_DELETE
+} LiveQueryDiffOperation;
+
+/**
+ * @struct LiveQueryDiff
+ * @brief A single row change of an observed query.
+ *
+ * @field operation Kind of change.
+ * @field id Message ID for message queries, conversation ID for the conversation list.
+ */
+typedef struct {
+    LiveQueryDiffOperation operation;
+    char id[MAX_CHANGE_ENTITY_ID_LENGTH];
+} LiveQueryDiff;
+
+/**
+ * @typedef LiveQueryHandle
+ * @brief Identifier of a live query subscription, never zero.
+ */
+typedef uint32_t LiveQueryHandle;
+
+/**
+ * @typedef LiveQueryCallback
+ * @brief Callback function type for live query diffs.
+ *
+ * Called once per committed transaction that touched the observed query.
+ * Several changes to the same row within a transaction are coalesced into
+ * a single diff.
+ *
+ * @param handle The subscription the diffs belong to.
+ * @param diffs Array of diffs in commit order.
+ * @param count Number of diffs in the array.
+ */
+typedef void (*LiveQueryCallback)(LiveQueryHandle handle, const LiveQueryDiff diffs[], size_t count);
+
+/**
+ * @function subscribe_conversation_messages
+ * @brief Observes the messages of a conversation.
+ *
+ * @param conversation_id The ID of the conversation to observe.
+ * @param callback Function to receive the diffs.
+ * @param handle Pointer receiving the subscription handle.
+ * @return ErrorCode indicating success or failure of the operation,
+ *         DB_ERROR_INITIALIZATION if the database cannot use WAL mode.
+ */
+ErrorCode subscribe_conversation_messages(const char* conversation_id, LiveQueryCallback callback, LiveQueryHandle* handle);
+
+/**
+ * @function subscribe_conversation_list
+ * @brief Observes the conversation list.
+ *
+ * A conversation is reported as updated whenever one of its messages
+ * changes, since its summary changes with it.
+ *
+ * @param callback Function to receive the diffs.
+ * @param handle Pointer receiving the subscription handle.
+ * @return ErrorCode indicating success or failure of the operation,
+ *         DB_ERROR_INITIALIZATION if the database cannot use WAL mode.
+ */
+ErrorCode subscribe_conversation_list(LiveQueryCallback callback, LiveQueryHandle* handle);
+
+/**
+ * @function unsubscribe_live_query
+ * @brief Cancels a live query subscription.
+ *
+ * @param handle The subscription to cancel.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode unsubscribe_live_query(LiveQueryHandle handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //LIVE_QUERY_H
@@ -20,6 +20,15 @@ typedef enum {
     MESSAGE_TYPE_FILE    /**< File message */
 } MessageType;
 
+/**
+ * @enum MessageReceiptType
+ * @brief Kind of receipt the user sends for a received message.
+ */
+typedef enum {
+    MESSAGE_RECEIPT_DELIVERED,
+    MESSAGE_RECEIPT_READ
+} MessageReceiptType;
+
 /**
  * @struct MessageResult
  * @brief Structure containing the result of a message operation.
@@ -98,6 +107,16 @@ typedef struct {
  */
 typedef void (*MessageCallback)(const MessageResult* result);
 
+/**
+ * @typedef ReceiptFrameSink
+ * @brief Transmits one network frame carrying coalesced receipt watermarks.
+ *
+ * @param frame The encoded frame.
+ * @param frame_size Size of the frame in bytes.
+ * @return ErrorCode indicating success or failure, after a failure the watermarks are sent again with the next flush.
+ */
+typedef ErrorCode (*ReceiptFrameSink)(const uint8_t* frame, size_t frame_size);
+
 /**
  * @typedef FetchMessagesCallback
  * @brief Callback function type for fetching messages.
@@ -248,6 +267,94 @@ void forward_message(const char* message_id, const char* target_conversation_id,
  */
 void forward_messages(const BulkMessageOperation* operation, const char* target_conversation_id, ForwardMessagesCallback callback);
 
+/**
+ * @function set_message_expiry
+ * @brief Turns a message into a disappearing message.
+ *
+ * The message is deleted once the expiry time has passed and
+ * process_expired_messages has been called.
+ *
+ * @param message_id The ID of the message to expire.
+ * @param expires_at Time in seconds at which the message is deleted.
+ * @param callback Function to be called when the operation is complete.
+ */
+void set_message_expiry(const char* message_id, int64_t expires_at, MessageCallback callback);
+
+/**
+ * @function process_expired_messages
+ * @brief Deletes every disappearing message whose expiry time has passed.
+ *
+ * Intended to be called periodically by the host, e.g. once per second.
+ * All messages expired by one call are deleted in a single transaction.
+ *
+ * @param now The current time in seconds.
+ * @param expired_count Optional pointer receiving the number of deleted messages.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode process_expired_messages(int64_t now, size_t* expired_count);
+
+/**
+ * @function receive_message
+ * @brief Stores a message received from the network.
+ *
+ * Messages from blocked senders are dropped before they reach the database
+ * and reported with ERROR_SENDER_BLOCKED, so the host can skip the
+ * notification. Redelivered messages are stored once.
+ *
+ * @param message The received message.
+ * @param callback Function to be called when the operation is complete.
+ */
+void receive_message(const Message* message, MessageCallback callback);
+
+/**
+ * @function set_receipt_frame_sink
+ * @brief Sets the transport that receives the coalesced receipt frames.
+ *
+ * Without a sink receipts only move the local watermarks.
+ *
+ * @param sink The sink, or NULL to stop sending receipts.
+ */
+void set_receipt_frame_sink(ReceiptFrameSink sink);
+
+/**
+ * @function queue_message_receipt
+ * @brief Records that a message was delivered to or read by the user.
+ *
+ * Receipts are collapsed per conversation into a watermark, only the
+ * message of each conversation that arrived last is kept. They are written
+ * and sent together once the coalescing window has passed, see
+ * process_pending_receipts. A read receipt also acknowledges delivery.
+ *
+ * @param message The delivered or read message, which must be stored.
+ * @param type MESSAGE_RECEIPT_DELIVERED or MESSAGE_RECEIPT_READ.
+ * @param now The current time in milliseconds.
+ * @return ErrorCode indicating success or failure, DB_ERROR_NOT_FOUND if the message is not stored.
+ */
+ErrorCode queue_message_receipt(const Message* message, MessageReceiptType type, int64_t now);
+
+/**
+ * @function process_pending_receipts
+ * @brief Flushes the queued receipts once the coalescing window has passed.
+ *
+ * Intended to be called periodically by the host, e.g. from its frame or
+ * event loop. A flush moves every watermark in a single transaction and
+ * sends them in one frame.
+ *
+ * @param now The current time in milliseconds.
+ * @param flushed_count Optional pointer receiving the number of flushed watermarks.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode process_pending_receipts(int64_t now, size_t* flushed_count);
+
+/**
+ * @function flush_message_receipts
+ * @brief Flushes the queued receipts immediately, e.g. before the app is suspended.
+ *
+ * @param flushed_count Optional pointer receiving the number of flushed watermarks.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode flush_message_receipts(size_t* flushed_count);
+
 #ifdef __cplusplus
 }
 #endif
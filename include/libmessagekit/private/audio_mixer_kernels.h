@@ -0,0 +1,39 @@
+#ifndef AUDIO_MIXER_KERNELS_H
+#define AUDIO_MIXER_KERNELS_H
+
+#include "libmessagekit/audio_mixer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @enum AudioMixerKernel
+ * @brief Instruction sets audio_mix can run on.
+ */
+typedef enum {
+    AUDIO_MIXER_KERNEL_AUTO,    /**< The best one the CPU supports, detected once */
+    AUDIO_MIXER_KERNEL_SCALAR,
+    AUDIO_MIXER_KERNEL_SSE2,
+    AUDIO_MIXER_KERNEL_AVX2,
+    AUDIO_MIXER_KERNEL_NEON
+} AudioMixerKernel;
+
+/**
+ * @brief Makes audio_mix use one kernel, for tests and benchmarks comparing them.
+ *
+ * @param kernel The kernel, AUDIO_MIXER_KERNEL_AUTO to go back to the detected one.
+ * @return False if the kernel was not built or the CPU does not support it, the kernel in use is kept.
+ */
+bool audio_mixer_set_kernel(AudioMixerKernel kernel);
+
+/**
+ * @brief Returns the kernel audio_mix uses, never AUDIO_MIXER_KERNEL_AUTO.
+ */
+AudioMixerKernel audio_mixer_get_kernel();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //AUDIO_MIXER_KERNELS_H
@@ -0,0 +1,35 @@
+#ifndef BLOCKED_USERS_H
+#define BLOCKED_USERS_H
+
+#include "libmessagekit/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Loads the blocked users into memory and registers the
+ * is_blocked_user() SQL function used by the list queries.
+ *
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode blocked_users_init();
+
+/**
+ * @brief Releases the in-memory block list.
+ */
+void blocked_users_shutdown();
+
+/**
+ * @brief Checks whether a user is blocked, in constant time.
+ *
+ * @param user_id The ID of the user, NULL or empty is never blocked.
+ * @return True if the user is blocked.
+ */
+bool is_user_blocked(const char* user_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //BLOCKED_USERS_H
@@ -0,0 +1,37 @@
+#ifndef CALL_DISPATCH_H
+#define CALL_DISPATCH_H
+
+#include "libmessagekit/call.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Starts the call event thread.
+ *
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode call_dispatch_init();
+
+/**
+ * @brief Waits for publishers in progress, delivers the queued changes, then stops the event thread and drops every
+ * subscription.
+ */
+void call_dispatch_shutdown();
+
+/**
+ * @brief Queues a call state change for the subscribers.
+ *
+ * Lock-free unless the event thread is asleep and has to be woken, and
+ * free when nobody subscribed.
+ *
+ * @param call_info The call after the change.
+ */
+void call_dispatch_publish(const CallInfo* call_info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CALL_DISPATCH_H
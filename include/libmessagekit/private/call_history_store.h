@@ -0,0 +1,24 @@
+#ifndef CALL_HISTORY_STORE_H
+#define CALL_HISTORY_STORE_H
+
+#include "libmessagekit/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Checks that every call history filter combination reads an index range.
+ *
+ * Asks SQLite for the plan of each query shape fetch_call_history can run
+ * and reports the shapes that scan the table or sort their results.
+ *
+ * @return ErrorCode indicating success, or DB_ERROR_SCHEMA if a query would scan.
+ */
+ErrorCode call_history_check_query_plans();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CALL_HISTORY_STORE_H
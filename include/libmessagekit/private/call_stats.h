@@ -0,0 +1,33 @@
+#ifndef CALL_STATS_H
+#define CALL_STATS_H
+
+#include "libmessagekit/call.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Starts collecting quality samples for a new call.
+ *
+ * @param slot_index Index of the call's slot, below CALL_MAX_ACTIVE.
+ * @param call_info The call.
+ */
+void call_stats_open(size_t slot_index, const CallInfo* call_info);
+
+/**
+ * @brief Stops collecting for an ended call and queues its summary for call_stats_store_pending.
+ *
+ * Waits for recorders that are writing a sample of the call. The summary is
+ * stored right away if CALL_STATS_SUMMARY_QUEUE_SIZE summaries are waiting.
+ *
+ * @param slot_index Index of the call's slot, below CALL_MAX_ACTIVE.
+ * @param call_info The call.
+ */
+void call_stats_close(size_t slot_index, const CallInfo* call_info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CALL_STATS_H
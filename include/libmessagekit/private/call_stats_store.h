@@ -0,0 +1,32 @@
+#ifndef CALL_STATS_STORE_H
+#define CALL_STATS_STORE_H
+
+#include "libmessagekit/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Creates the queue of summaries waiting to be stored.
+ *
+ * Calls work without it, their summaries are then stored when they end.
+ *
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode call_stats_init();
+
+/**
+ * @brief Writes the queued summaries of ended calls to call_quality on the calling thread.
+ *
+ * Called from the call history functions the host drives and at shutdown,
+ * so the rows join the host's own use of the connection. Returns at once
+ * if another thread is storing them.
+ */
+void call_stats_store_pending();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CALL_STATS_STORE_H
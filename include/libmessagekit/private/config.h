@@ -2,6 +2,19 @@
 #define CONFIG_H
 
 #define CALL_ID_LENGTH 32
+#define CALL_MAX_ACTIVE 8
+#define CALL_EVENT_QUEUE_SIZE 64
+#define CALL_MAX_SUBSCRIBERS 16
+#define CALL_DISPATCH_QUEUE_SIZE 1024
+#define CALL_DISPATCH_BATCH_WINDOW_MS 20
+#define CALL_STATS_WINDOW 256
+#define CALL_STATS_SUMMARY_QUEUE_SIZE 16
+#define CALL_HISTORY_CURSOR_LENGTH 48
+#define CALL_HISTORY_EXPORT_BUFFER_SIZE (1 << 20)
+#define CALL_HISTORY_EXPORT_PROGRESS_INTERVAL 4096
+#define CALL_HISTORY_PURGE_CHUNK 2048
+#define DB_VACUUM_STEP_PAGES 256
+#define DB_WAL_CHECKPOINT_PAGES 1000
 #define USER_ID_LENGTH 32
 
 #define MAX_STATUS_LENGTH 200
@@ -9,6 +22,8 @@
 #define MESSAGE_ID_LENGTH 32
 #define MAX_CONTENT_LENGTH 1024
 #define MAX_BULK_MESSAGES 100
+#define RECEIPT_COALESCE_WINDOW_MS 300
+#define RECEIPT_COALESCE_MAX_CONVERSATIONS 64
 
 #define CONTACT_ID_LENGTH 32
 
@@ -18,5 +33,15 @@
 #define MAX_CONVERSATION_ID_LENGTH 32
 #define MAX_CONVERSATION_NAME_LENGTH 100
 #define MAX_LAST_MESSAGE_PREVIEW_LENGTH 50
+#define CONVERSATION_CURSOR_LENGTH 96
+#define CONVERSATION_SNAPSHOT_SIZE 50
+
+#define MAX_CHANGE_ENTITY_ID_LENGTH 32
+
+#define GROUP_ID_LENGTH 32
+#define GROUP_FANOUT_CHUNK_SIZE 256
+#define GROUP_FANOUT_WORKERS 4
+#define GROUP_FANOUT_QUEUE_SIZE 64
+#define GROUP_ENVELOPE_OVERHEAD 64
 
 #endif //CONFIG_H
@@ -0,0 +1,68 @@
+#ifndef CONVERSATION_LIST_MODEL_H
+#define CONVERSATION_LIST_MODEL_H
+
+#include "libmessagekit/conversations.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Ordered shadow of a delivered conversation list.
+ *
+ * Keeps only the sort keys and IDs of the list in display order, plus an
+ * ID lookup table, and turns each summary change into one list operation.
+ * Positions are found by binary search.
+ */
+typedef struct ConversationListModel ConversationListModel;
+
+/**
+ * @brief Creates an empty model.
+ *
+ * @param include_archived Whether archived conversations belong to the list.
+ * @return The model, or NULL if memory allocation failed.
+ */
+ConversationListModel* conversation_list_model_create(bool include_archived);
+
+/**
+ * @brief Destroys a model.
+ */
+void conversation_list_model_destroy(ConversationListModel* model);
+
+/**
+ * @brief Applies a new or changed conversation summary.
+ *
+ * @param model The model.
+ * @param summary The current summary of the conversation.
+ * @param operation Receives the resulting list operation.
+ * @return True if the list changed and operation was filled in.
+ */
+bool conversation_list_model_upsert(ConversationListModel* model, const ConversationSummary* summary,
+                                    ConversationListOperation* operation);
+
+/**
+ * @brief Applies the deletion of a conversation.
+ *
+ * @param model The model.
+ * @param conversation_id The ID of the deleted conversation.
+ * @param operation Receives the resulting list operation.
+ * @return True if the list changed and operation was filled in.
+ */
+bool conversation_list_model_remove(ConversationListModel* model, const char* conversation_id,
+                                    ConversationListOperation* operation);
+
+/**
+ * @brief Returns the number of conversations in the list.
+ */
+size_t conversation_list_model_count(const ConversationListModel* model);
+
+/**
+ * @brief Returns the ID of the conversation at a list position.
+ */
+const char* conversation_list_model_id_at(const ConversationListModel* model, size_t position);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CONVERSATION_LIST_MODEL_H
@@ -0,0 +1,62 @@
+#ifndef CONVERSATION_SNAPSHOT_H
+#define CONVERSATION_SNAPSHOT_H
+
+#include "libmessagekit/conversations.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Function receiving a conversation list along with a context pointer.
+ */
+typedef void (*ConversationListVisitor)(const ConversationSummary conversations[], size_t count, ErrorCode error,
+                                        void* context);
+
+/**
+ * @brief Remembers where save_conversation_snapshot writes the snapshot and
+ * maps the snapshot saved last, if there is a valid one.
+ *
+ * @param storage_path The storage path of the library.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode conversation_snapshot_init(const char* storage_path);
+
+/**
+ * @brief Unmaps the snapshot and forgets its location.
+ */
+void conversation_snapshot_shutdown();
+
+/**
+ * @brief Serves a page of the non-archived conversation list from the mapped snapshot.
+ *
+ * Succeeds only while no change was committed since the snapshot was
+ * written, compared by change feed sequence number, and when the page
+ * lies within the snapshot.
+ *
+ * @param limit Maximum number of conversations, zero for all of them.
+ * @param offset Number of conversations to skip.
+ * @param callback Function receiving the page, called only on success.
+ * @return True if the page was served, false if the database has to be read.
+ */
+bool conversation_snapshot_serve(size_t limit, size_t offset, ConversationListCallback callback);
+
+/**
+ * @brief Reads recent conversations from the database, like get_recent_conversations.
+ *
+ * Implemented by the conversations module, never served from the snapshot.
+ *
+ * @param limit Maximum number of conversations, zero for all of them.
+ * @param offset Number of conversations to skip.
+ * @param include_archived Whether to include archived conversations.
+ * @param visitor Function receiving the conversations and error code.
+ * @param context User data passed to the visitor.
+ */
+void visit_recent_conversations(size_t limit, size_t offset, bool include_archived, ConversationListVisitor visitor,
+                                void* context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //CONVERSATION_SNAPSHOT_H
@@ -7,6 +7,11 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Function invoked after a write has been committed.
+ */
+typedef void (*DbCommitListener)();
+
 /**
  * @brief Opens a connection to the SQLite database.
  *
@@ -38,6 +43,63 @@ int db_init_schema(const char* schema_path);
  */
  int execute_query(const char* query);
 
+/**
+ * @brief Returns the handle of the connected database.
+ *
+ * Used by modules that need prepared statements instead of execute_query.
+ *
+ * @return The SQLite handle, or NULL if the database is not opened.
+ */
+sqlite3* db_get_handle();
+
+/**
+ * @brief Begins an immediate transaction on the connected database.
+ *
+ * Inside an open transaction this begins a savepoint instead, which the
+ * matching commit releases and the matching rollback undoes on its own.
+ *
+ * @return Zero on success, or an error code on failure.
+ */
+int db_begin_transaction();
+
+/**
+ * @brief Commits the current transaction.
+ *
+ * @return Zero on success, or an error code on failure.
+ */
+int db_commit_transaction();
+
+/**
+ * @brief Rolls back the current transaction.
+ *
+ * @return Zero on success, or an error code on failure.
+ */
+int db_rollback_transaction();
+
+/**
+ * @brief Returns free pages to the file system.
+ *
+ * Runs incremental vacuum steps of at most pages_per_step pages, each in its
+ * own transaction so writers are never held up for long. Does nothing unless
+ * the database was created with incremental auto-vacuum.
+ *
+ * @param pages_per_step Number of pages released per step.
+ * @return Zero on success, or an error code on failure.
+ */
+int db_incremental_vacuum(int pages_per_step);
+
+/**
+ * @brief Sets the function invoked after every committed write.
+ *
+ * The listener runs from SQLite's WAL hook, after the commit and outside
+ * of any transaction, whichever statement committed. Setting one switches
+ * the database to WAL mode, which fails for in-memory databases.
+ *
+ * @param listener The listener, or NULL to remove it.
+ * @return Zero on success, or an error code on failure.
+ */
+int db_set_commit_listener(DbCommitListener listener);
+
 #ifdef __cplusplus
 }
 #endif
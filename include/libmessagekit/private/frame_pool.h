@@ -0,0 +1,54 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include "libmessagekit/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Fixed set of equally sized media frame buffers.
+ *
+ * All frames are allocated in one block when the pool is created, taking
+ * and returning a frame is a push or pop on a free stack. Media paths use
+ * it so that no packet ever reaches the system allocator.
+ */
+typedef struct FramePool FramePool;
+
+/**
+ * @brief Creates a pool.
+ *
+ * @param frame_count Number of frames.
+ * @param frame_size Size of one frame in bytes.
+ * @return The pool, or NULL if memory allocation failed.
+ */
+FramePool* frame_pool_create(size_t frame_count, size_t frame_size);
+
+/**
+ * @brief Destroys a pool, frames still taken become invalid.
+ */
+void frame_pool_destroy(FramePool* pool);
+
+/**
+ * @brief Takes a frame.
+ *
+ * @return The frame, or NULL if every frame is taken.
+ */
+uint8_t* frame_pool_acquire(FramePool* pool);
+
+/**
+ * @brief Returns a frame taken from the same pool.
+ */
+void frame_pool_release(FramePool* pool, uint8_t* frame);
+
+/**
+ * @brief Returns the number of frames that can still be taken.
+ */
+size_t frame_pool_available(const FramePool* pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //FRAME_POOL_H
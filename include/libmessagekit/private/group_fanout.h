@@ -0,0 +1,36 @@
+#ifndef GROUP_FANOUT_H
+#define GROUP_FANOUT_H
+
+#include "libmessagekit/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GROUP_FRAME_MAGIC 0x46474B4Du // "MKGF" as little-endian bytes
+#define GROUP_FRAME_VERSION 1
+
+/**
+ * @brief Starts the fan-out worker threads.
+ *
+ * Frame layout, all integers little-endian:
+ *   u32 magic, u8 version, u8 id length + group ID, u8 id length + message ID,
+ *   u8 id length + sender ID, u8 message type, i64 timestamp in seconds,
+ *   u32 chunk index, u32 chunk count, u32 entry count, then per entry
+ *   u8 id length + recipient ID, u32 envelope size + envelope.
+ *
+ * @param worker_count Number of encoding threads.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode group_fanout_init(size_t worker_count);
+
+/**
+ * @brief Stops the fan-out worker threads.
+ */
+void group_fanout_shutdown();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //GROUP_FANOUT_H
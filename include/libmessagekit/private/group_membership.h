@@ -0,0 +1,56 @@
+#ifndef GROUP_MEMBERSHIP_H
+#define GROUP_MEMBERSHIP_H
+
+#include "libmessagekit/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Loads the interned member IDs and the membership bitmaps.
+ *
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode group_membership_init();
+
+/**
+ * @brief Releases the in-memory membership.
+ */
+void group_membership_shutdown();
+
+/**
+ * @brief Checks whether a received message may be stored.
+ *
+ * Conversations without recorded membership accept every sender, groups
+ * only accept their members. A group whose members were all removed
+ * accepts nobody.
+ *
+ * @param conversation_id The conversation the message belongs to.
+ * @param sender_id The sender of the message.
+ * @return True if the message is accepted.
+ */
+bool group_accepts_sender(const char* conversation_id, const char* sender_id);
+
+/**
+ * @brief Looks up the number a member of a group is stored under.
+ *
+ * @param group_id The ID of the group.
+ * @param user_id The ID of the user.
+ * @param number Pointer receiving the member number.
+ * @return True if the user is a member of the group.
+ */
+bool group_member_number(const char* group_id, const char* user_id, uint32_t* number);
+
+/**
+ * @brief Returns the user ID of a member number.
+ *
+ * @return The ID, or NULL if the number was never assigned.
+ */
+const char* group_member_id(uint32_t number);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //GROUP_MEMBERSHIP_H
@@ -0,0 +1,73 @@
+#ifndef ID_INTERNER_H
+#define ID_INTERNER_H
+
+#include "libmessagekit/common.h"
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ID_INTERNER_MAX_ID_LENGTH USER_ID_LENGTH
+
+/**
+ * @brief Maps string IDs to dense numbers 0, 1, 2, ... in first-seen order.
+ *
+ * Lookups by string use an open-addressing table, lookups by number index
+ * a flat array of fixed-size names.
+ */
+typedef struct IdInterner IdInterner;
+
+/**
+ * @brief Creates an empty interner.
+ *
+ * @return The interner, or NULL if memory allocation failed.
+ */
+IdInterner* id_interner_create();
+
+/**
+ * @brief Destroys an interner.
+ */
+void id_interner_destroy(IdInterner* interner);
+
+/**
+ * @brief Returns the number of an ID, assigning the next one if it is new.
+ *
+ * @param interner The interner.
+ * @param id The ID, shorter than ID_INTERNER_MAX_ID_LENGTH.
+ * @param number Pointer receiving the number.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode id_interner_intern(IdInterner* interner, const char* id, uint32_t* number);
+
+/**
+ * @brief Looks up the number of an ID without assigning one.
+ *
+ * @return True if the ID is known.
+ */
+bool id_interner_find(const IdInterner* interner, const char* id, uint32_t* number);
+
+/**
+ * @brief Returns the ID of a number.
+ *
+ * The pointer stays valid until the next call to id_interner_intern.
+ *
+ * @return The ID, or NULL if the number was never assigned.
+ */
+const char* id_interner_name(const IdInterner* interner, uint32_t number);
+
+/**
+ * @brief Returns the number of interned IDs.
+ */
+size_t id_interner_count(const IdInterner* interner);
+
+/**
+ * @brief Forgets every ID numbered count or higher, undoing the latest interning.
+ */
+void id_interner_truncate(IdInterner* interner, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //ID_INTERNER_H
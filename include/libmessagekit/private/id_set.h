@@ -0,0 +1,64 @@
+#ifndef ID_SET_H
+#define ID_SET_H
+
+#include "libmessagekit/common.h"
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ID_SET_MAX_ID_LENGTH USER_ID_LENGTH
+
+/**
+ * @brief Open-addressing hash set of short string IDs.
+ *
+ * IDs are stored inline next to their hash in a power-of-two table probed
+ * linearly, so a lookup usually touches a single cache line. Deletion shifts
+ * the following entries back instead of leaving tombstones.
+ */
+typedef struct IdSet IdSet;
+
+/**
+ * @brief Creates an empty set.
+ *
+ * @return The set, or NULL if memory allocation failed.
+ */
+IdSet* id_set_create();
+
+/**
+ * @brief Destroys a set.
+ */
+void id_set_destroy(IdSet* set);
+
+/**
+ * @brief Adds an ID to the set.
+ *
+ * @param set The set.
+ * @param id The ID, shorter than ID_SET_MAX_ID_LENGTH.
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode id_set_add(IdSet* set, const char* id);
+
+/**
+ * @brief Removes an ID from the set.
+ *
+ * @return True if the ID was present.
+ */
+bool id_set_remove(IdSet* set, const char* id);
+
+/**
+ * @brief Checks whether an ID is in the set.
+ */
+bool id_set_contains(const IdSet* set, const char* id);
+
+/**
+ * @brief Returns the number of IDs in the set.
+ */
+size_t id_set_count(const IdSet* set);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //ID_SET_H
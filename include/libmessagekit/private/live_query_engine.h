@@ -0,0 +1,72 @@
+#ifndef LIVE_QUERY_ENGINE_H
+#define LIVE_QUERY_ENGINE_H
+
+#include "libmessagekit/change_feed.h"
+#include "libmessagekit/live_query.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LIVE_QUERY_MAX_OBSERVERS 8
+
+/**
+ * @struct CommittedChange
+ * @brief A coalesced change of one record, as seen by internal observers.
+ *
+ * @field entity Kind of record that changed.
+ * @field operation Net effect of the transaction on the record.
+ * @field entity_id ID of the record.
+ * @field scope_id Conversation of a changed message, empty otherwise.
+ * @field is_derived True for conversation updates implied by a message change.
+ */
+typedef struct {
+    ChangeEntity entity;
+    LiveQueryDiffOperation operation;
+    const char* entity_id;
+    const char* scope_id;
+    bool is_derived;
+} CommittedChange;
+
+/**
+ * @brief Function receiving every committed change, across all entities.
+ */
+typedef void (*CommittedChangeObserver)(const CommittedChange changes[], size_t count);
+
+/**
+ * @brief Installs the SQLite update, commit and rollback hooks.
+ *
+ * The update hook records which change_log rows a transaction wrote, the
+ * commit hook queues them as one batch and the commit listener of the
+ * database layer, run by SQLite after every commit, delivers each batch's
+ * coalesced diffs to the subscribers.
+ *
+ * A database that cannot switch to WAL mode, such as an in-memory one, has
+ * no such listener. Live queries are then left off: subscriptions fail with
+ * DB_ERROR_INITIALIZATION and observers only see what they load at start.
+ *
+ * @return ERROR_NONE on success, or an error code on failure.
+ */
+ErrorCode live_query_init();
+
+/**
+ * @brief Registers an internal observer of committed changes.
+ *
+ * Observers are called before host subscriptions, so in-memory indexes are
+ * up to date when the host reacts to a diff.
+ *
+ * @param observer The observer to register.
+ * @return ERROR_NONE on success, or an error code on failure.
+ */
+ErrorCode live_query_add_observer(CommittedChangeObserver observer);
+
+/**
+ * @brief Removes the hooks and drops every subscription and observer.
+ */
+void live_query_shutdown();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //LIVE_QUERY_ENGINE_H
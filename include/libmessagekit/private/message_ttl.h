@@ -0,0 +1,55 @@
+#ifndef MESSAGE_TTL_H
+#define MESSAGE_TTL_H
+
+#include "libmessagekit/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Builds the in-memory expiry schedule from the messages table.
+ *
+ * Reads every message with an expiry time through the expires_at index and
+ * schedules it on the timer wheel. Must be called after the schema is
+ * initialized.
+ *
+ * @param now The current time in seconds.
+ * @return ERROR_NONE on success, or an error code on failure.
+ */
+ErrorCode ttl_init(int64_t now);
+
+/**
+ * @brief Schedules a message for deletion at the given time.
+ *
+ * The expiry time must already be stored in the messages table. Scheduling
+ * is O(1); a message whose expiry changed may be scheduled again, stale
+ * entries are ignored when they fire.
+ *
+ * @param message_id The ID of the message.
+ * @param expires_at The expiry time in seconds.
+ * @return ERROR_NONE on success, or an error code on failure.
+ */
+ErrorCode ttl_schedule(const char* message_id, int64_t expires_at);
+
+/**
+ * @brief Fires all due timers and deletes the expired messages.
+ *
+ * All messages expired by this tick are deleted in a single transaction.
+ *
+ * @param now The current time in seconds.
+ * @param expired_count Optional pointer receiving the number of deleted messages.
+ * @return ERROR_NONE on success, or an error code on failure.
+ */
+ErrorCode ttl_process(int64_t now, size_t* expired_count);
+
+/**
+ * @brief Releases the expiry schedule.
+ */
+void ttl_shutdown();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MESSAGE_TTL_H
@@ -0,0 +1,60 @@
+#ifndef MPSC_RING_H
+#define MPSC_RING_H
+
+#include "libmessagekit/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Bounded lock-free queue of fixed-size elements.
+ *
+ * Any number of threads may push concurrently, a single thread at a time
+ * pops. The consumer may change between pops when the threads hand the
+ * ring over with acquire and release ordering. Neither side ever blocks: a
+ * push into a full ring fails instead.
+ */
+typedef struct MpscRing MpscRing;
+
+/**
+ * @brief Creates a ring.
+ *
+ * @param capacity Number of elements, a power of two.
+ * @param element_size Size of one element in bytes.
+ * @return The ring, or NULL if the capacity is invalid or memory allocation failed.
+ */
+MpscRing* mpsc_ring_create(size_t capacity, size_t element_size);
+
+/**
+ * @brief Destroys a ring and any elements left in it.
+ */
+void mpsc_ring_destroy(MpscRing* ring);
+
+/**
+ * @brief Copies an element into the ring.
+ *
+ * @return False if the ring is full.
+ */
+bool mpsc_ring_push(MpscRing* ring, const void* element);
+
+/**
+ * @brief Copies the oldest element out of the ring, consumer only.
+ *
+ * @return False if the ring is empty.
+ */
+bool mpsc_ring_pop(MpscRing* ring, void* element);
+
+/**
+ * @brief Checks whether an element is ready to be popped.
+ *
+ * Exact for the consumer. Other threads may call it too, the answer may
+ * then be stale by the time it is returned.
+ */
+bool mpsc_ring_is_empty(MpscRing* ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //MPSC_RING_H
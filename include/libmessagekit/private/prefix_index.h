@@ -0,0 +1,134 @@
+#ifndef PREFIX_INDEX_H
+#define PREFIX_INDEX_H
+
+#include "libmessagekit/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PREFIX_INDEX_MAX_TEXT_LENGTH 256
+
+/**
+ * @brief In-memory search-as-you-type index over short texts such as names.
+ *
+ * Every record is stored with its folded text (see text_fold) and a copy of
+ * a caller defined payload. Each word start of the folded text is a key in
+ * a sorted array, so a prefix lookup is a binary search followed by a scan
+ * of the matching range. Inserting one record shifts the arrays, so large
+ * sets are loaded with prefix_index_load and sorted once.
+ */
+typedef struct PrefixIndex PrefixIndex;
+
+/**
+ * @brief Function receiving the payload of every matching record.
+ *
+ * @return False to stop the search.
+ */
+typedef bool (*PrefixIndexVisitor)(const void* payload, void* context);
+
+/**
+ * @brief Creates an empty index.
+ *
+ * @return The index, or NULL if memory allocation failed.
+ */
+PrefixIndex* prefix_index_create();
+
+/**
+ * @brief Destroys an index and all its records.
+ */
+void prefix_index_destroy(PrefixIndex* index);
+
+/**
+ * @brief Inserts a record or replaces the record with the same ID.
+ *
+ * @param index The index.
+ * @param id Unique ID of the record.
+ * @param text The text to make searchable.
+ * @param payload Data copied into the index and handed to visitors.
+ * @param payload_size Size of the payload in bytes.
+ * @return ERROR_NONE on success, or an error code on failure.
+ */
+ErrorCode prefix_index_put(PrefixIndex* index, const char* id, const char* text, const void* payload, size_t payload_size);
+
+/**
+ * @brief Replaces the payload of a record, keeping its text and keys.
+ *
+ * Cheaper than prefix_index_put when only the cached payload changed.
+ *
+ * @param index The index.
+ * @param id ID of an existing record.
+ * @param payload Data copied into the index and handed to visitors.
+ * @param payload_size Size of the payload in bytes.
+ * @return ERROR_NONE on success, ERROR_INVALID_PARAMS if there is no such record.
+ */
+ErrorCode prefix_index_set_payload(PrefixIndex* index, const char* id, const void* payload, size_t payload_size);
+
+/**
+ * @brief Adds a record to an index being filled from scratch.
+ *
+ * Loading appends without sorting, prefix_index_finish_load sorts every
+ * record and key at once. Until then the index is not searchable and
+ * every other function fails or finds nothing. Only an empty index can
+ * be loaded; a record loaded twice keeps the last text and payload.
+ *
+ * @param index The index.
+ * @param id Unique ID of the record.
+ * @param text The text to make searchable.
+ * @param payload Data copied into the index and handed to visitors.
+ * @param payload_size Size of the payload in bytes.
+ * @return ERROR_NONE on success, or an error code on failure.
+ */
+ErrorCode prefix_index_load(PrefixIndex* index, const char* id, const char* text, const void* payload,
+                            size_t payload_size);
+
+/**
+ * @brief Sorts the loaded records and makes the index searchable.
+ *
+ * Does nothing if no load is in progress.
+ *
+ * @param index The index.
+ * @return ERROR_NONE on success, or an error code on failure.
+ */
+ErrorCode prefix_index_finish_load(PrefixIndex* index);
+
+/**
+ * @brief Removes the record with the given ID, if any.
+ */
+void prefix_index_remove(PrefixIndex* index, const char* id);
+
+/**
+ * @brief Retrieves the payload of the record with the given ID.
+ *
+ * @return The payload owned by the index, or NULL if there is no such record.
+ */
+const void* prefix_index_get(const PrefixIndex* index, const char* id);
+
+/**
+ * @brief Visits every record matching the query.
+ *
+ * A record matches when each word of the folded query is a prefix of some
+ * word of its folded text. Every matching record is visited once.
+ *
+ * @param index The index.
+ * @param query The query as typed by the user.
+ * @param visitor Function receiving the payloads.
+ * @param context User data passed to the visitor.
+ * @return The number of visited records.
+ */
+size_t prefix_index_search(PrefixIndex* index, const char* query, PrefixIndexVisitor visitor, void* context);
+
+/**
+ * @brief Visits every record in ID order.
+ *
+ * @param index The index.
+ * @param visitor Function receiving the payloads, returning false stops the walk.
+ * @param context User data passed to the visitor.
+ */
+void prefix_index_for_each(const PrefixIndex* index, PrefixIndexVisitor visitor, void* context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //PREFIX_INDEX_H
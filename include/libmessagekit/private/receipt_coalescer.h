@@ -0,0 +1,29 @@
+#ifndef RECEIPT_COALESCER_H
+#define RECEIPT_COALESCER_H
+
+#include "libmessagekit/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Receipt frame layout, all integers little-endian:
+ *   u32 magic, u8 version, u32 entry count, then per entry u8 receipt type,
+ *   u8 id length + conversation ID, u8 id length + message ID, i64 timestamp.
+ */
+#define RECEIPT_FRAME_MAGIC 0x43524B4Du // "MKRC" as little-endian bytes
+#define RECEIPT_FRAME_VERSION 1
+
+/**
+ * @brief Flushes the pending receipts and forgets the frame sink.
+ *
+ * Must be called while the database is still open.
+ */
+void receipt_coalescer_shutdown();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RECEIPT_COALESCER_H
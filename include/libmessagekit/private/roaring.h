@@ -0,0 +1,107 @@
+#ifndef ROARING_H
+#define ROARING_H
+
+#include "libmessagekit/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Compressed set of 32-bit integers.
+ *
+ * Values are partitioned by their upper 16 bits into containers kept in key
+ * order. A container holds a sorted array of the lower 16 bits while it has
+ * at most ROARING_ARRAY_MAX values and a 65536-bit bitmap beyond that, so
+ * sparse and dense sets both stay small and intersect quickly.
+ */
+typedef struct Roaring Roaring;
+
+#define ROARING_ARRAY_MAX 4096
+
+/**
+ * @brief Visitor for set iteration, returning false stops the iteration.
+ */
+typedef bool (*RoaringVisitor)(uint32_t value, void* context);
+
+/**
+ * @brief Creates an empty set.
+ *
+ * @return The set, or NULL if memory allocation failed.
+ */
+Roaring* roaring_create();
+
+/**
+ * @brief Destroys a set.
+ */
+void roaring_destroy(Roaring* set);
+
+/**
+ * @brief Copies a set.
+ *
+ * @return The copy, or NULL if memory allocation failed.
+ */
+Roaring* roaring_clone(const Roaring* set);
+
+/**
+ * @brief Adds a value.
+ *
+ * @return ErrorCode indicating success or failure of the operation.
+ */
+ErrorCode roaring_add(Roaring* set, uint32_t value);
+
+/**
+ * @brief Removes a value.
+ *
+ * @return True if the value was present.
+ */
+bool roaring_remove(Roaring* set, uint32_t value);
+
+/**
+ * @brief Checks whether a value is in the set.
+ */
+bool roaring_contains(const Roaring* set, uint32_t value);
+
+/**
+ * @brief Returns the number of values in the set.
+ */
+size_t roaring_cardinality(const Roaring* set);
+
+/**
+ * @brief Visits every value in ascending order.
+ */
+void roaring_for_each(const Roaring* set, RoaringVisitor visitor, void* context);
+
+/**
+ * @brief Visits every value present in both sets in ascending order, without materializing the intersection.
+ *
+ * @return The number of visited values.
+ */
+size_t roaring_for_each_intersection(const Roaring* a, const Roaring* b, RoaringVisitor visitor, void* context);
+
+/**
+ * @brief Returns the size of the serialized form of a set.
+ */
+size_t roaring_serialized_size(const Roaring* set);
+
+/**
+ * @brief Writes the portable little-endian form of a set.
+ *
+ * @param set The set.
+ * @param buffer Buffer of at least roaring_serialized_size bytes.
+ * @return The number of bytes written.
+ */
+size_t roaring_serialize(const Roaring* set, uint8_t* buffer);
+
+/**
+ * @brief Reads a set written by roaring_serialize.
+ *
+ * @return The set, or NULL if the data is malformed or memory allocation failed.
+ */
+Roaring* roaring_deserialize(const uint8_t* buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //ROARING_H
@@ -0,0 +1,55 @@
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+#include "libmessagekit/common.h"
+#include "prefix_index.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Loads conversation names into the in-memory search index.
+ *
+ * The index follows every committed change of the conversations through
+ * the live query engine, which must be initialized first.
+ *
+ * @return ERROR_NONE on success, or an error code on failure.
+ */
+ErrorCode conversation_search_init();
+
+/**
+ * @brief Releases the conversation search index.
+ */
+void conversation_search_shutdown();
+
+/**
+ * @brief Loads contact names and user IDs into the in-memory search index.
+ *
+ * The index follows every committed change of the contacts through the
+ * live query engine, which must be initialized first.
+ *
+ * @return ERROR_NONE on success, or an error code on failure.
+ */
+ErrorCode contact_search_init();
+
+/**
+ * @brief Releases the contact search index.
+ */
+void contact_search_shutdown();
+
+/**
+ * @brief Visits the contacts whose name or user ID matches a query.
+ *
+ * @param query The query as typed by the user.
+ * @param visitor Function receiving each matching Contact.
+ * @param context User data passed to the visitor.
+ * @return ERROR_NONE on success, or DB_ERROR_INITIALIZATION if the index is not loaded.
+ */
+ErrorCode contact_search_visit(const char* query, PrefixIndexVisitor visitor, void* context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //SEARCH_INDEX_H
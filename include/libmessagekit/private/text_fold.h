@@ -0,0 +1,30 @@
+#ifndef TEXT_FOLD_H
+#define TEXT_FOLD_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Folds UTF-8 text for case and diacritic insensitive matching.
+ *
+ * Latin letters lose case and diacritics (including the Turkish dotted and
+ * dotless i), ligatures expand to their letters, Greek and Cyrillic letters
+ * are lowercased and stripped of accents, and combining marks are dropped.
+ * ASCII punctuation and whitespace collapse into single spaces, leading and
+ * trailing separators are removed. Other characters are copied unchanged.
+ *
+ * @param input The NUL-terminated UTF-8 text to fold.
+ * @param output Buffer receiving the folded, NUL-terminated text.
+ * @param output_size Size of the output buffer in bytes.
+ * @return The length of the folded text, truncated to fit the buffer.
+ */
+size_t text_fold(const char* input, char* output, size_t output_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //TEXT_FOLD_H
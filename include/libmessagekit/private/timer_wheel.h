@@ -0,0 +1,115 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+
+/**
+ * @struct TimerNode
+ * @brief Intrusive list node for a timer scheduled on a TimerWheel.
+ *
+ * Embed it as the first member of the owning structure so the expiry
+ * callback can cast the node back to its owner.
+ *
+ * @field next Next node in the slot list.
+ * @field prev Previous node in the slot list.
+ * @field expires Tick at which the timer fires.
+ */
+typedef struct TimerNode {
+    struct TimerNode* next;
+    struct TimerNode* prev;
+    int64_t expires;
+} TimerNode;
+
+/**
+ * @struct TimerWheel
+ * @brief Hierarchical timer wheel with 64 slots per level.
+ *
+ * Level 0 covers the next 64 ticks, each following level covers 64 times
+ * the range of the previous one. Timers beyond the last level are kept in
+ * an overflow list and cascaded down when the top level wraps around.
+ *
+ * @field current The last tick processed by timer_wheel_advance.
+ * @field slots Sentinel heads of the slot lists, per level.
+ * @field overflow Sentinel head of timers beyond the wheel range.
+ * @field count Number of scheduled timers.
+ */
+typedef struct {
+    int64_t current;
+    TimerNode slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    TimerNode overflow;
+    size_t count;
+} TimerWheel;
+
+/**
+ * @brief Callback invoked for every expired timer.
+ *
+ * The node is already unlinked from the wheel and may be freed or
+ * rescheduled by the callback.
+ */
+typedef void (*TimerExpiredCallback)(TimerNode* node, void* context);
+
+/**
+ * @brief Initializes an empty timer wheel.
+ *
+ * @param wheel The wheel to initialize.
+ * @param now The current tick.
+ */
+void timer_wheel_init(TimerWheel* wheel, int64_t now);
+
+/**
+ * @brief Schedules a timer in O(1).
+ *
+ * Timers already in the past fire on the next advance.
+ *
+ * @param wheel The wheel to schedule on.
+ * @param node The timer node, must not be scheduled already.
+ * @param expires The tick at which the timer fires.
+ */
+void timer_wheel_schedule(TimerWheel* wheel, TimerNode* node, int64_t expires);
+
+/**
+ * @brief Cancels a scheduled timer in O(1).
+ *
+ * @param wheel The wheel the timer is scheduled on.
+ * @param node The timer node to cancel.
+ */
+void timer_wheel_cancel(TimerWheel* wheel, TimerNode* node);
+
+/**
+ * @brief Advances the wheel to the given tick and fires all due timers.
+ *
+ * Every timer is moved at most once per level before it fires, so the cost
+ * of firing is amortized O(1) per timer. Ticks at which no slot fires or
+ * cascades are skipped, a long gap costs no more than a short one.
+ *
+ * @param wheel The wheel to advance.
+ * @param now The tick to advance to.
+ * @param callback Function invoked for each expired timer.
+ * @param context User data passed to the callback.
+ * @return The number of timers fired.
+ */
+size_t timer_wheel_advance(TimerWheel* wheel, int64_t now, TimerExpiredCallback callback, void* context);
+
+/**
+ * @brief Removes every scheduled timer without advancing the wheel.
+ *
+ * @param wheel The wheel to drain.
+ * @param callback Function invoked for each removed timer.
+ * @param context User data passed to the callback.
+ */
+void timer_wheel_drain(TimerWheel* wheel, TimerExpiredCallback callback, void* context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //TIMER_WHEEL_H
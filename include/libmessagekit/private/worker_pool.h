@@ -0,0 +1,49 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include "libmessagekit/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Unit of work run on a pool thread.
+ */
+typedef void (*WorkerTask)(void* argument);
+
+/**
+ * @brief Fixed set of threads running tasks in submission order from a
+ * fixed size queue, submitting never allocates.
+ */
+typedef struct WorkerPool WorkerPool;
+
+/**
+ * @brief Starts a pool.
+ *
+ * @param thread_count Number of threads, at least one.
+ * @param queue_capacity Number of tasks that can wait for a thread, at least one.
+ * @return The pool, or NULL if the threads could not be started.
+ */
+WorkerPool* worker_pool_create(size_t thread_count, size_t queue_capacity);
+
+/**
+ * @brief Runs the remaining tasks, then stops and joins the threads.
+ */
+void worker_pool_destroy(WorkerPool* pool);
+
+/**
+ * @brief Queues a task.
+ *
+ * @param pool The pool.
+ * @param task Function to run.
+ * @param argument Argument passed to the task.
+ * @return ERROR_NONE on success, ERROR_QUEUE_FULL if the caller has to run the task itself.
+ */
+ErrorCode worker_pool_submit(WorkerPool* pool, WorkerTask task, void* argument);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //WORKER_POOL_H
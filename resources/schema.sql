@@ -1,3 +1,6 @@
+-- Lets purges return free pages with PRAGMA incremental_vacuum. Only takes effect on a new database.
+PRAGMA auto_vacuum = INCREMENTAL;
+
 CREATE TABLE IF NOT EXISTS user_info (
      user_id TEXT PRIMARY KEY,
      user_number TEXT UNIQUE,
@@ -9,4 +12,426 @@ CREATE TABLE IF NOT EXISTS app_settings (
     notification_token TEXT,
     platform TEXT,
     platform_version TEXT
-);
\ No newline at end of file
+);
+
+-- seq orders messages by arrival and is never reused, read watermarks refer to it.
+CREATE TABLE IF NOT EXISTS messages (
+    seq INTEGER PRIMARY KEY AUTOINCREMENT,
+    id TEXT NOT NULL UNIQUE,
+    conversation_id TEXT NOT NULL,
+    sender_id TEXT NOT NULL,
+    type INTEGER NOT NULL,
+    timestamp INTEGER NOT NULL,
+    content TEXT,
+    is_outgoing INTEGER NOT NULL DEFAULT 0,
+    expires_at INTEGER
+);
+
+CREATE INDEX IF NOT EXISTS idx_messages_conversation ON messages (conversation_id, timestamp);
+
+-- Incoming messages by arrival order, counts what is left unread when the read watermark moves to an earlier message.
+CREATE INDEX IF NOT EXISTS idx_messages_incoming_seq ON messages (conversation_id, seq) WHERE is_outgoing = 0;
+
+-- Only disappearing messages are indexed, the TTL engine rebuilds its timer wheel from it at startup.
+CREATE INDEX IF NOT EXISTS idx_messages_expires_at ON messages (expires_at) WHERE expires_at IS NOT NULL;
+
+CREATE TABLE IF NOT EXISTS conversations (
+    id TEXT PRIMARY KEY,
+    type INTEGER NOT NULL DEFAULT 0,
+    name TEXT,
+    is_pinned INTEGER NOT NULL DEFAULT 0,
+    is_archived INTEGER NOT NULL DEFAULT 0,
+    is_muted INTEGER NOT NULL DEFAULT 0,
+    peer_user_id TEXT,
+    created_at INTEGER NOT NULL DEFAULT (strftime('%s', 'now'))
+);
+
+-- peer_user_id is the other participant of an individual conversation, NULL for groups.
+CREATE INDEX IF NOT EXISTS idx_conversations_peer ON conversations (peer_user_id) WHERE peer_user_id IS NOT NULL;
+
+CREATE TABLE IF NOT EXISTS contacts (
+    contact_id TEXT PRIMARY KEY,
+    name TEXT NOT NULL,
+    user_id TEXT
+);
+
+-- Change feed: every mutation gets a sequence number. AUTOINCREMENT keeps it monotonic across compaction.
+-- entity: 0 = message, 1 = conversation, 2 = contact, 3 = settings. operation: 0 = insert, 1 = update, 2 = delete.
+-- scope_id is the owning conversation of a message, so deletes can still be routed after the row is gone.
+CREATE TABLE IF NOT EXISTS change_log (
+    seq INTEGER PRIMARY KEY AUTOINCREMENT,
+    entity INTEGER NOT NULL,
+    entity_id TEXT NOT NULL,
+    scope_id TEXT,
+    operation INTEGER NOT NULL,
+    changed_at INTEGER NOT NULL DEFAULT (strftime('%s', 'now'))
+);
+
+CREATE INDEX IF NOT EXISTS idx_change_log_entity ON change_log (entity, entity_id, seq);
+
+CREATE TRIGGER IF NOT EXISTS trg_messages_change_insert AFTER INSERT ON messages
+BEGIN
+    INSERT INTO change_log (entity, entity_id, scope_id, operation) VALUES (0, NEW.id, NEW.conversation_id, 0);
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_messages_change_update AFTER UPDATE ON messages
+BEGIN
+    INSERT INTO change_log (entity, entity_id, scope_id, operation) VALUES (0, NEW.id, NEW.conversation_id, 1);
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_messages_change_delete AFTER DELETE ON messages
+BEGIN
+    INSERT INTO change_log (entity, entity_id, scope_id, operation) VALUES (0, OLD.id, OLD.conversation_id, 2);
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_conversations_change_insert AFTER INSERT ON conversations
+BEGIN
+    INSERT INTO change_log (entity, entity_id, operation) VALUES (1, NEW.id, 0);
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_conversations_change_update AFTER UPDATE ON conversations
+BEGIN
+    INSERT INTO change_log (entity, entity_id, operation) VALUES (1, NEW.id, 1);
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_conversations_change_delete AFTER DELETE ON conversations
+BEGIN
+    INSERT INTO change_log (entity, entity_id, operation) VALUES (1, OLD.id, 2);
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_contacts_change_insert AFTER INSERT ON contacts
+BEGIN
+    INSERT INTO change_log (entity, entity_id, operation) VALUES (2, NEW.contact_id, 0);
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_contacts_change_update AFTER UPDATE ON contacts
+BEGIN
+    INSERT INTO change_log (entity, entity_id, operation) VALUES (2, NEW.contact_id, 1);
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_contacts_change_delete AFTER DELETE ON contacts
+BEGIN
+    INSERT INTO change_log (entity, entity_id, operation) VALUES (2, OLD.contact_id, 2);
+END;
+
+-- app_settings has a single row and no key of its own, its rowid stands in for one.
+CREATE TRIGGER IF NOT EXISTS trg_app_settings_change_insert AFTER INSERT ON app_settings
+BEGIN
+    INSERT INTO change_log (entity, entity_id, operation) VALUES (3, CAST(NEW.rowid AS TEXT), 0);
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_app_settings_change_update AFTER UPDATE ON app_settings
+BEGIN
+    INSERT INTO change_log (entity, entity_id, operation) VALUES (3, CAST(NEW.rowid AS TEXT), 1);
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_app_settings_change_delete AFTER DELETE ON app_settings
+BEGIN
+    INSERT INTO change_log (entity, entity_id, operation) VALUES (3, CAST(OLD.rowid AS TEXT), 2);
+END;
+
+-- Highest change sequence number each sync peer has applied. Delete entries only leave the
+-- change log once every peer listed here is past them.
+CREATE TABLE IF NOT EXISTS sync_peers (
+    peer_id TEXT PRIMARY KEY,
+    acked_seq INTEGER NOT NULL DEFAULT 0
+) WITHOUT ROWID;
+
+-- Materialized chat list. Kept in sync by the triggers below so that listing conversations is an index range read.
+CREATE TABLE IF NOT EXISTS conversation_summaries (
+    conversation_id TEXT PRIMARY KEY,
+    type INTEGER NOT NULL DEFAULT 0,
+    name TEXT,
+    last_message_id TEXT,
+    last_message_preview TEXT,
+    last_message_type INTEGER NOT NULL DEFAULT 0,
+    last_message_timestamp INTEGER NOT NULL DEFAULT 0,
+    last_message_seq INTEGER NOT NULL DEFAULT 0,
+    last_read_seq INTEGER NOT NULL DEFAULT 0,
+    last_delivered_seq INTEGER NOT NULL DEFAULT 0,
+    unread_count INTEGER NOT NULL DEFAULT 0,
+    is_pinned INTEGER NOT NULL DEFAULT 0,
+    is_archived INTEGER NOT NULL DEFAULT 0,
+    is_muted INTEGER NOT NULL DEFAULT 0,
+    peer_user_id TEXT
+);
+
+-- Column directions match the list order: pinned first, then active before archived, newest first.
+-- The conversation ID breaks timestamp ties so keyset cursors are stable.
+CREATE INDEX IF NOT EXISTS idx_conversation_summaries_order
+    ON conversation_summaries (is_pinned DESC, is_archived ASC, last_message_timestamp DESC, conversation_id DESC);
+
+CREATE TRIGGER IF NOT EXISTS trg_summary_conversation_insert AFTER INSERT ON conversations
+BEGIN
+    INSERT OR IGNORE INTO conversation_summaries (conversation_id, type, name, is_pinned, is_archived, is_muted, peer_user_id)
+    VALUES (NEW.id, NEW.type, NEW.name, NEW.is_pinned, NEW.is_archived, NEW.is_muted, NEW.peer_user_id);
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_summary_conversation_update AFTER UPDATE ON conversations
+BEGIN
+    UPDATE conversation_summaries
+    SET type = NEW.type, name = NEW.name, is_pinned = NEW.is_pinned, is_archived = NEW.is_archived,
+        is_muted = NEW.is_muted, peer_user_id = NEW.peer_user_id
+    WHERE conversation_id = NEW.id;
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_summary_conversation_delete AFTER DELETE ON conversations
+BEGIN
+    DELETE FROM conversation_summaries WHERE conversation_id = OLD.id;
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_summary_message_insert AFTER INSERT ON messages
+BEGIN
+    UPDATE conversation_summaries
+    SET last_message_id = NEW.id,
+        last_message_preview = substr(NEW.content, 1, 49),
+        last_message_type = NEW.type,
+        last_message_timestamp = NEW.timestamp
+    WHERE conversation_id = NEW.conversation_id AND last_message_timestamp <= NEW.timestamp;
+
+    UPDATE conversation_summaries
+    SET last_message_seq = NEW.seq,
+        unread_count = unread_count + (CASE WHEN NEW.is_outgoing = 0 AND NEW.seq > last_read_seq THEN 1 ELSE 0 END)
+    WHERE conversation_id = NEW.conversation_id;
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_summary_message_delete AFTER DELETE ON messages
+BEGIN
+    UPDATE conversation_summaries SET unread_count = unread_count - 1
+    WHERE conversation_id = OLD.conversation_id AND OLD.is_outgoing = 0 AND OLD.seq > last_read_seq;
+
+    -- Only deleting the last message needs a lookup, served by idx_messages_conversation.
+    UPDATE conversation_summaries
+    SET last_message_id = (SELECT id FROM messages WHERE conversation_id = OLD.conversation_id ORDER BY timestamp DESC LIMIT 1),
+        last_message_preview = (SELECT substr(content, 1, 49) FROM messages WHERE conversation_id = OLD.conversation_id ORDER BY timestamp DESC LIMIT 1),
+        last_message_type = COALESCE((SELECT type FROM messages WHERE conversation_id = OLD.conversation_id ORDER BY timestamp DESC LIMIT 1), 0),
+        last_message_timestamp = COALESCE((SELECT timestamp FROM messages WHERE conversation_id = OLD.conversation_id ORDER BY timestamp DESC LIMIT 1), 0)
+    WHERE conversation_id = OLD.conversation_id AND last_message_id = OLD.id;
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_summary_message_edit AFTER UPDATE OF content, type ON messages
+BEGIN
+    UPDATE conversation_summaries
+    SET last_message_preview = substr(NEW.content, 1, 49), last_message_type = NEW.type
+    WHERE conversation_id = NEW.conversation_id AND last_message_id = NEW.id;
+END;
+
+-- Single row holding the sum of all unread counters, for app badges.
+CREATE TABLE IF NOT EXISTS unread_totals (
+    id INTEGER PRIMARY KEY CHECK (id = 1),
+    total INTEGER NOT NULL DEFAULT 0
+);
+
+INSERT OR IGNORE INTO unread_totals (id, total) VALUES (1, 0);
+
+CREATE TRIGGER IF NOT EXISTS trg_unread_totals_insert AFTER INSERT ON conversation_summaries
+WHEN NEW.unread_count <> 0
+BEGIN
+    UPDATE unread_totals SET total = total + NEW.unread_count WHERE id = 1;
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_unread_totals_update AFTER UPDATE OF unread_count ON conversation_summaries
+WHEN NEW.unread_count <> OLD.unread_count
+BEGIN
+    UPDATE unread_totals SET total = total + NEW.unread_count - OLD.unread_count WHERE id = 1;
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_unread_totals_delete AFTER DELETE ON conversation_summaries
+WHEN OLD.unread_count <> 0
+BEGIN
+    UPDATE unread_totals SET total = total - OLD.unread_count WHERE id = 1;
+END;
+
+-- Read state lives in the summary row, report watermark moves as conversation updates to the change feed.
+CREATE TRIGGER IF NOT EXISTS trg_summary_read_change AFTER UPDATE OF last_read_seq ON conversation_summaries
+WHEN NEW.last_read_seq <> OLD.last_read_seq
+BEGIN
+    INSERT INTO change_log (entity, entity_id, operation) VALUES (1, NEW.conversation_id, 1);
+END;
+
+-- Block list, mirrored in memory. Blocking or unblocking a user reports their conversations as updated
+-- so that list observers re-evaluate them.
+CREATE TABLE IF NOT EXISTS blocked_users (
+    user_id TEXT PRIMARY KEY,
+    blocked_at INTEGER NOT NULL DEFAULT (strftime('%s', 'now'))
+);
+
+CREATE TRIGGER IF NOT EXISTS trg_blocked_users_insert AFTER INSERT ON blocked_users
+BEGIN
+    INSERT INTO change_log (entity, entity_id, operation)
+    SELECT 1, id, 1 FROM conversations WHERE peer_user_id = NEW.user_id;
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_blocked_users_delete AFTER DELETE ON blocked_users
+BEGIN
+    INSERT INTO change_log (entity, entity_id, operation)
+    SELECT 1, id, 1 FROM conversations WHERE peer_user_id = OLD.user_id;
+END;
+
+-- Group membership. Member IDs are interned to dense numbers so that the members of a group persist as one
+-- serialized compressed bitmap. The reverse user -> groups index is rebuilt in memory at startup.
+CREATE TABLE IF NOT EXISTS group_member_ids (
+    number INTEGER PRIMARY KEY,
+    user_id TEXT NOT NULL UNIQUE
+);
+
+-- A group whose members all left keeps its row with an empty bitmap, so it still only accepts members.
+CREATE TABLE IF NOT EXISTS group_memberships (
+    group_id TEXT PRIMARY KEY,
+    members BLOB NOT NULL
+);
+
+-- Group receipts, one row per group message with the delivered and read members as compressed bitmaps over the
+-- member numbers of group_member_ids. The counts are kept alongside so "read by N" needs no decoding.
+CREATE TABLE IF NOT EXISTS group_receipts (
+    message_id TEXT PRIMARY KEY,
+    delivered BLOB NOT NULL,
+    read BLOB NOT NULL,
+    delivered_count INTEGER NOT NULL DEFAULT 0,
+    read_count INTEGER NOT NULL DEFAULT 0
+);
+
+CREATE TRIGGER IF NOT EXISTS trg_group_receipts_message_delete AFTER DELETE ON messages
+BEGIN
+    DELETE FROM group_receipts WHERE message_id = OLD.id;
+END;
+
+-- Quality summary of ended calls, one row per call and CallMetric. Percentiles cover the last samples of the call.
+-- Rows share the call_id of the call's history entry and are deleted with it; the entry may be added after them.
+CREATE TABLE IF NOT EXISTS call_quality (
+    call_id TEXT NOT NULL,
+    metric INTEGER NOT NULL,
+    sample_count INTEGER NOT NULL,
+    mean REAL NOT NULL,
+    min INTEGER NOT NULL,
+    max INTEGER NOT NULL,
+    p50 INTEGER NOT NULL,
+    p90 INTEGER NOT NULL,
+    p99 INTEGER NOT NULL,
+    PRIMARY KEY (call_id, metric)
+) WITHOUT ROWID;
+
+-- Call history. Entries are listed newest first with (timestamp, id) as the keyset, every index ends in timestamp
+-- and carries the rowid, so each CallHistoryFilter combination is one index range read in order:
+-- no filter, contact, contact + type, type, type + read state and read state. Contact + read state and
+-- contact + type + read state narrow the contact's range further.
+CREATE TABLE IF NOT EXISTS call_history (
+    id INTEGER PRIMARY KEY,
+    call_id TEXT NOT NULL UNIQUE,
+    contact_id TEXT NOT NULL,
+    timestamp INTEGER NOT NULL,
+    type INTEGER NOT NULL,
+    duration INTEGER NOT NULL DEFAULT 0,
+    is_read INTEGER NOT NULL DEFAULT 0
+);
+
+CREATE INDEX IF NOT EXISTS idx_call_history_time ON call_history (timestamp);
+CREATE INDEX IF NOT EXISTS idx_call_history_contact ON call_history (contact_id, timestamp);
+CREATE INDEX IF NOT EXISTS idx_call_history_contact_type ON call_history (contact_id, type, timestamp);
+CREATE INDEX IF NOT EXISTS idx_call_history_type ON call_history (type, timestamp);
+CREATE INDEX IF NOT EXISTS idx_call_history_type_read ON call_history (type, is_read, timestamp);
+CREATE INDEX IF NOT EXISTS idx_call_history_read ON call_history (is_read, timestamp);
+
+-- Holds a row while a bulk delete of call history runs, the delete triggers then leave the call quality and rollups
+-- to the bulk statements. The row is removed before the delete commits.
+CREATE TABLE IF NOT EXISTS call_history_bulk_delete (
+    active INTEGER PRIMARY KEY
+);
+
+CREATE TRIGGER IF NOT EXISTS trg_call_quality_history_delete AFTER DELETE ON call_history
+WHEN NOT EXISTS (SELECT 1 FROM call_history_bulk_delete)
+BEGIN
+    DELETE FROM call_quality WHERE call_id = OLD.call_id;
+END;
+
+-- Call statistics rolled up by the triggers below as call history changes: per contact, UTC day and CallType,
+-- per contact and CallType, and per UTC day and CallType. Rows whose count drops to zero are removed.
+CREATE TABLE IF NOT EXISTS call_rollup_contact_day (
+    contact_id TEXT NOT NULL,
+    day INTEGER NOT NULL,
+    type INTEGER NOT NULL,
+    call_count INTEGER NOT NULL,
+    total_duration INTEGER NOT NULL,
+    PRIMARY KEY (contact_id, day, type)
+) WITHOUT ROWID;
+
+CREATE TABLE IF NOT EXISTS call_rollup_contact (
+    contact_id TEXT NOT NULL,
+    type INTEGER NOT NULL,
+    call_count INTEGER NOT NULL,
+    total_duration INTEGER NOT NULL,
+    PRIMARY KEY (contact_id, type)
+) WITHOUT ROWID;
+
+CREATE TABLE IF NOT EXISTS call_rollup_day (
+    day INTEGER NOT NULL,
+    type INTEGER NOT NULL,
+    call_count INTEGER NOT NULL,
+    total_duration INTEGER NOT NULL,
+    PRIMARY KEY (day, type)
+) WITHOUT ROWID;
+
+-- Fills the rollups of a history recorded before they existed. The rollups are only empty with an empty history
+-- afterwards, so this reads nothing on later starts.
+INSERT INTO call_rollup_contact_day (contact_id, day, type, call_count, total_duration)
+SELECT contact_id, timestamp / 86400, type, COUNT(*), SUM(duration) FROM call_history
+WHERE NOT EXISTS (SELECT 1 FROM call_rollup_contact_day) GROUP BY 1, 2, 3;
+INSERT INTO call_rollup_contact (contact_id, type, call_count, total_duration)
+SELECT contact_id, type, COUNT(*), SUM(duration) FROM call_history
+WHERE NOT EXISTS (SELECT 1 FROM call_rollup_contact) GROUP BY 1, 2;
+INSERT INTO call_rollup_day (day, type, call_count, total_duration)
+SELECT timestamp / 86400, type, COUNT(*), SUM(duration) FROM call_history
+WHERE NOT EXISTS (SELECT 1 FROM call_rollup_day) GROUP BY 1, 2;
+
+CREATE TRIGGER IF NOT EXISTS trg_call_rollup_insert AFTER INSERT ON call_history
+BEGIN
+    INSERT INTO call_rollup_contact_day (contact_id, day, type, call_count, total_duration)
+    VALUES (NEW.contact_id, NEW.timestamp / 86400, NEW.type, 1, NEW.duration)
+    ON CONFLICT DO UPDATE SET call_count = call_count + 1, total_duration = total_duration + excluded.total_duration;
+    INSERT INTO call_rollup_contact (contact_id, type, call_count, total_duration)
+    VALUES (NEW.contact_id, NEW.type, 1, NEW.duration)
+    ON CONFLICT DO UPDATE SET call_count = call_count + 1, total_duration = total_duration + excluded.total_duration;
+    INSERT INTO call_rollup_day (day, type, call_count, total_duration)
+    VALUES (NEW.timestamp / 86400, NEW.type, 1, NEW.duration)
+    ON CONFLICT DO UPDATE SET call_count = call_count + 1, total_duration = total_duration + excluded.total_duration;
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_call_rollup_delete AFTER DELETE ON call_history
+WHEN NOT EXISTS (SELECT 1 FROM call_history_bulk_delete)
+BEGIN
+    UPDATE call_rollup_contact_day SET call_count = call_count - 1, total_duration = total_duration - OLD.duration
+    WHERE contact_id = OLD.contact_id AND day = OLD.timestamp / 86400 AND type = OLD.type;
+    DELETE FROM call_rollup_contact_day
+    WHERE contact_id = OLD.contact_id AND day = OLD.timestamp / 86400 AND type = OLD.type AND call_count <= 0;
+    UPDATE call_rollup_contact SET call_count = call_count - 1, total_duration = total_duration - OLD.duration
+    WHERE contact_id = OLD.contact_id AND type = OLD.type;
+    DELETE FROM call_rollup_contact WHERE contact_id = OLD.contact_id AND type = OLD.type AND call_count <= 0;
+    UPDATE call_rollup_day SET call_count = call_count - 1, total_duration = total_duration - OLD.duration
+    WHERE day = OLD.timestamp / 86400 AND type = OLD.type;
+    DELETE FROM call_rollup_day WHERE day = OLD.timestamp / 86400 AND type = OLD.type AND call_count <= 0;
+END;
+
+-- An entry that changes contact, time, type or duration moves out of its old rollup rows and into the new ones.
+CREATE TRIGGER IF NOT EXISTS trg_call_rollup_update AFTER UPDATE OF contact_id, timestamp, type, duration ON call_history
+BEGIN
+    UPDATE call_rollup_contact_day SET call_count = call_count - 1, total_duration = total_duration - OLD.duration
+    WHERE contact_id = OLD.contact_id AND day = OLD.timestamp / 86400 AND type = OLD.type;
+    DELETE FROM call_rollup_contact_day
+    WHERE contact_id = OLD.contact_id AND day = OLD.timestamp / 86400 AND type = OLD.type AND call_count <= 0;
+    UPDATE call_rollup_contact SET call_count = call_count - 1, total_duration = total_duration - OLD.duration
+    WHERE contact_id = OLD.contact_id AND type = OLD.type;
+    DELETE FROM call_rollup_contact WHERE contact_id = OLD.contact_id AND type = OLD.type AND call_count <= 0;
+    UPDATE call_rollup_day SET call_count = call_count - 1, total_duration = total_duration - OLD.duration
+    WHERE day = OLD.timestamp / 86400 AND type = OLD.type;
+    DELETE FROM call_rollup_day WHERE day = OLD.timestamp / 86400 AND type = OLD.type AND call_count <= 0;
+
+    INSERT INTO call_rollup_contact_day (contact_id, day, type, call_count, total_duration)
+    VALUES (NEW.contact_id, NEW.timestamp / 86400, NEW.type, 1, NEW.duration)
+    ON CONFLICT DO UPDATE SET call_count = call_count + 1, total_duration = total_duration + excluded.total_duration;
+    INSERT INTO call_rollup_contact (contact_id, type, call_count, total_duration)
+    VALUES (NEW.contact_id, NEW.type, 1, NEW.duration)
+    ON CONFLICT DO UPDATE SET call_count = call_count + 1, total_duration = total_duration + excluded.total_duration;
+    INSERT INTO call_rollup_day (day, type, call_count, total_duration)
+    VALUES (NEW.timestamp / 86400, NEW.type, 1, NEW.duration)
+    ON CONFLICT DO UPDATE SET call_count = call_count + 1, total_duration = total_duration + excluded.total_duration;
+END;
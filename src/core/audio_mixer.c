@@ -0,0 +1,428 @@
+#include "libmessagekit/audio_mixer.h"
+#include "audio_mixer_kernels.h"
+
+#include <stdatomic.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+#define MIXER_HAVE_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#define MIXER_HAVE_AVX2 1 // Compiled per function and picked at run time
+#include <immintrin.h>
+#endif
+#endif
+
+#if (defined(__aarch64__) && defined(__ARM_NEON)) || defined(_M_ARM64)
+#define MIXER_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#define SAMPLE_MAX 32767.0f
+#define SAMPLE_MIN (-32768.0f)
+#define SOFT_CLIP_KNEE (0.8f * SAMPLE_MAX) // Level above which the mix is bent towards full scale
+#define SOFT_CLIP_RANGE (SAMPLE_MAX - SOFT_CLIP_KNEE)
+
+typedef void (*SaturatingKernel)(const AudioMixInput inputs[], size_t input_count, int16_t* output, size_t start,
+                                 size_t sample_count);
+typedef void (*GainKernel)(const AudioMixInput inputs[], size_t input_count, int16_t* output, size_t start,
+                           size_t sample_count, bool soft_clip);
+
+typedef struct {
+    AudioMixerKernel kernel;
+    SaturatingKernel saturating;
+    GainKernel gain;
+} MixerKernels;
+
+/*
+ * Every kernel mixes whole vectors from start on and leaves the remaining
+ * samples to the scalar kernel. All inputs are read at a position before the
+ * output is written there, so the output may alias an input.
+ */
+
+static void mix_saturating_scalar(const AudioMixInput inputs[], size_t input_count, int16_t* output, size_t start,
+                                  size_t sample_count)
+{
+    for (size_t i = start; i < sample_count; i++)
+    {
+        int32_t sum = inputs[0].samples[i];
+        for (size_t j = 1; j < input_count; j++)
+        {
+            sum += inputs[j].samples[i];
+            sum = sum > INT16_MAX ? INT16_MAX : (sum < INT16_MIN ? INT16_MIN : sum);
+        }
+        output[i] = (int16_t)sum;
+    }
+}
+
+/**
+ * Above the knee the excess e is compressed to e / (1 + e / range), which
+ * has slope 1 at the knee and approaches full scale without reaching it.
+ */
+static float soft_clip_scalar(float sample)
+{
+    const float magnitude = sample < 0 ? -sample : sample;
+    if (magnitude <= SOFT_CLIP_KNEE)
+    {
+        return sample;
+    }
+
+    const float excess = magnitude - SOFT_CLIP_KNEE;
+    const float clipped = SOFT_CLIP_KNEE + excess / (1.0f + excess / SOFT_CLIP_RANGE);
+    return sample < 0 ? -clipped : clipped;
+}
+
+static void mix_gain_scalar(const AudioMixInput inputs[], size_t input_count, int16_t* output, size_t start,
+                            size_t sample_count, bool soft_clip)
+{
+    for (size_t i = start; i < sample_count; i++)
+    {
+        float sum = 0.0f;
+        for (size_t j = 0; j < input_count; j++)
+        {
+            sum += (float)inputs[j].samples[i] * inputs[j].gain;
+        }
+
+        if (soft_clip)
+        {
+            sum = soft_clip_scalar(sum);
+        }
+        sum = sum > SAMPLE_MAX ? SAMPLE_MAX : (sum < SAMPLE_MIN ? SAMPLE_MIN : sum);
+        output[i] = (int16_t)(int32_t)(sum + (sum < 0 ? -0.5f : 0.5f));
+    }
+}
+
+#ifdef MIXER_HAVE_SSE2
+
+static void mix_saturating_sse2(const AudioMixInput inputs[], size_t input_count, int16_t* output, size_t start,
+                                size_t sample_count)
+{
+    size_t i = start;
+    for (; i + 8 <= sample_count; i += 8)
+    {
+        __m128i sum = _mm_loadu_si128((const __m128i*)(inputs[0].samples + i));
+        for (size_t j = 1; j < input_count; j++)
+        {
+            sum = _mm_adds_epi16(sum, _mm_loadu_si128((const __m128i*)(inputs[j].samples + i)));
+        }
+        _mm_storeu_si128((__m128i*)(output + i), sum);
+    }
+    mix_saturating_scalar(inputs, input_count, output, i, sample_count);
+}
+
+static __m128 soft_clip_sse2(__m128 sample)
+{
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    const __m128 knee = _mm_set1_ps(SOFT_CLIP_KNEE);
+    const __m128 magnitude = _mm_andnot_ps(sign_mask, sample);
+    const __m128 excess = _mm_max_ps(_mm_sub_ps(magnitude, knee), _mm_setzero_ps());
+    const __m128 compressed = _mm_div_ps(excess,
+        _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(excess, _mm_set1_ps(1.0f / SOFT_CLIP_RANGE))));
+    const __m128 clipped = _mm_add_ps(_mm_min_ps(magnitude, knee), compressed);
+    return _mm_or_ps(clipped, _mm_and_ps(sign_mask, sample));
+}
+
+static void mix_gain_sse2(const AudioMixInput inputs[], size_t input_count, int16_t* output, size_t start,
+                          size_t sample_count, bool soft_clip)
+{
+    size_t i = start;
+    for (; i + 8 <= sample_count; i += 8)
+    {
+        __m128 low = _mm_setzero_ps();
+        __m128 high = _mm_setzero_ps();
+        for (size_t j = 0; j < input_count; j++)
+        {
+            const __m128i samples = _mm_loadu_si128((const __m128i*)(inputs[j].samples + i));
+            const __m128 gain = _mm_set1_ps(inputs[j].gain);
+            // Sign extends by placing each sample in the upper half of a 32-bit lane.
+            const __m128i low_words = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+            const __m128i high_words = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+            low = _mm_add_ps(low, _mm_mul_ps(_mm_cvtepi32_ps(low_words), gain));
+            high = _mm_add_ps(high, _mm_mul_ps(_mm_cvtepi32_ps(high_words), gain));
+        }
+
+        if (soft_clip)
+        {
+            low = soft_clip_sse2(low);
+            high = soft_clip_sse2(high);
+        }
+
+        // Clamped first, out of range floats would convert to INT32_MIN.
+        const __m128 max = _mm_set1_ps(SAMPLE_MAX);
+        const __m128 min = _mm_set1_ps(SAMPLE_MIN);
+        low = _mm_max_ps(_mm_min_ps(low, max), min);
+        high = _mm_max_ps(_mm_min_ps(high, max), min);
+        _mm_storeu_si128((__m128i*)(output + i), _mm_packs_epi32(_mm_cvtps_epi32(low), _mm_cvtps_epi32(high)));
+    }
+    mix_gain_scalar(inputs, input_count, output, i, sample_count, soft_clip);
+}
+
+#endif
+
+#ifdef MIXER_HAVE_AVX2
+
+__attribute__((target("avx2")))
+static void mix_saturating_avx2(const AudioMixInput inputs[], size_t input_count, int16_t* output, size_t start,
+                                size_t sample_count)
+{
+    size_t i = start;
+    for (; i + 16 <= sample_count; i += 16)
+    {
+        __m256i sum = _mm256_loadu_si256((const __m256i*)(inputs[0].samples + i));
+        for (size_t j = 1; j < input_count; j++)
+        {
+            sum = _mm256_adds_epi16(sum, _mm256_loadu_si256((const __m256i*)(inputs[j].samples + i)));
+        }
+        _mm256_storeu_si256((__m256i*)(output + i), sum);
+    }
+    mix_saturating_sse2(inputs, input_count, output, i, sample_count);
+}
+
+__attribute__((target("avx2")))
+static __m256 soft_clip_avx2(__m256 sample)
+{
+    const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+    const __m256 knee = _mm256_set1_ps(SOFT_CLIP_KNEE);
+    const __m256 magnitude = _mm256_andnot_ps(sign_mask, sample);
+    const __m256 excess = _mm256_max_ps(_mm256_sub_ps(magnitude, knee), _mm256_setzero_ps());
+    const __m256 compressed = _mm256_div_ps(excess,
+        _mm256_add_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(excess, _mm256_set1_ps(1.0f / SOFT_CLIP_RANGE))));
+    const __m256 clipped = _mm256_add_ps(_mm256_min_ps(magnitude, knee), compressed);
+    return _mm256_or_ps(clipped, _mm256_and_ps(sign_mask, sample));
+}
+
+__attribute__((target("avx2")))
+static void mix_gain_avx2(const AudioMixInput inputs[], size_t input_count, int16_t* output, size_t start,
+                          size_t sample_count, bool soft_clip)
+{
+    size_t i = start;
+    for (; i + 8 <= sample_count; i += 8)
+    {
+        __m256 sum = _mm256_setzero_ps();
+        for (size_t j = 0; j < input_count; j++)
+        {
+            const __m256i samples = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(inputs[j].samples + i)));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_cvtepi32_ps(samples), _mm256_set1_ps(inputs[j].gain)));
+        }
+
+        if (soft_clip)
+        {
+            sum = soft_clip_avx2(sum);
+        }
+
+        sum = _mm256_max_ps(_mm256_min_ps(sum, _mm256_set1_ps(SAMPLE_MAX)), _mm256_set1_ps(SAMPLE_MIN));
+        const __m256i words = _mm256_cvtps_epi32(sum);
+        // Packing works per 128-bit lane, the permute joins the two halves.
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(words, words), 0x08);
+        _mm_storeu_si128((__m128i*)(output + i), _mm256_castsi256_si128(packed));
+    }
+    mix_gain_sse2(inputs, input_count, output, i, sample_count, soft_clip);
+}
+
+#endif
+
+#ifdef MIXER_HAVE_NEON
+
+static void mix_saturating_neon(const AudioMixInput inputs[], size_t input_count, int16_t* output, size_t start,
+                                size_t sample_count)
+{
+    size_t i = start;
+    for (; i + 8 <= sample_count; i += 8)
+    {
+        int16x8_t sum = vld1q_s16(inputs[0].samples + i);
+        for (size_t j = 1; j < input_count; j++)
+        {
+            sum = vqaddq_s16(sum, vld1q_s16(inputs[j].samples + i));
+        }
+        vst1q_s16(output + i, sum);
+    }
+    mix_saturating_scalar(inputs, input_count, output, i, sample_count);
+}
+
+static float32x4_t soft_clip_neon(float32x4_t sample)
+{
+    const float32x4_t knee = vdupq_n_f32(SOFT_CLIP_KNEE);
+    const float32x4_t magnitude = vabsq_f32(sample);
+    const float32x4_t excess = vmaxq_f32(vsubq_f32(magnitude, knee), vdupq_n_f32(0.0f));
+    const float32x4_t compressed = vdivq_f32(excess,
+        vaddq_f32(vdupq_n_f32(1.0f), vmulq_n_f32(excess, 1.0f / SOFT_CLIP_RANGE)));
+    const float32x4_t clipped = vaddq_f32(vminq_f32(magnitude, knee), compressed);
+    // Copies the sign bit of the sample onto the clipped magnitude.
+    return vbslq_f32(vdupq_n_u32(0x80000000u), sample, clipped);
+}
+
+static void mix_gain_neon(const AudioMixInput inputs[], size_t input_count, int16_t* output, size_t start,
+                          size_t sample_count, bool soft_clip)
+{
+    size_t i = start;
+    for (; i + 8 <= sample_count; i += 8)
+    {
+        float32x4_t low = vdupq_n_f32(0.0f);
+        float32x4_t high = vdupq_n_f32(0.0f);
+        for (size_t j = 0; j < input_count; j++)
+        {
+            const int16x8_t samples = vld1q_s16(inputs[j].samples + i);
+            low = vmlaq_n_f32(low, vcvtq_f32_s32(vmovl_s16(vget_low_s16(samples))), inputs[j].gain);
+            high = vmlaq_n_f32(high, vcvtq_f32_s32(vmovl_s16(vget_high_s16(samples))), inputs[j].gain);
+        }
+
+        if (soft_clip)
+        {
+            low = soft_clip_neon(low);
+            high = soft_clip_neon(high);
+        }
+
+        // Rounds to nearest and narrows with saturation.
+        vst1q_s16(output + i, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(low)), vqmovn_s32(vcvtnq_s32_f32(high))));
+    }
+    mix_gain_scalar(inputs, input_count, output, i, sample_count, soft_clip);
+}
+
+#endif
+
+static const MixerKernels SCALAR_KERNELS = {AUDIO_MIXER_KERNEL_SCALAR, mix_saturating_scalar, mix_gain_scalar};
+#ifdef MIXER_HAVE_SSE2
+static const MixerKernels SSE2_KERNELS = {AUDIO_MIXER_KERNEL_SSE2, mix_saturating_sse2, mix_gain_sse2};
+#endif
+#ifdef MIXER_HAVE_AVX2
+static const MixerKernels AVX2_KERNELS = {AUDIO_MIXER_KERNEL_AVX2, mix_saturating_avx2, mix_gain_avx2};
+#endif
+#ifdef MIXER_HAVE_NEON
+static const MixerKernels NEON_KERNELS = {AUDIO_MIXER_KERNEL_NEON, mix_saturating_neon, mix_gain_neon};
+#endif
+
+// Chosen on the first mix. Threads racing to choose pick the same kernels.
+static _Atomic(const MixerKernels*) active_kernels = NULL;
+
+// Returns the kernels of an instruction set, NULL if they were not built or the CPU lacks it.
+static const MixerKernels* find_kernels(AudioMixerKernel kernel)
+{
+    switch (kernel)
+    {
+        case AUDIO_MIXER_KERNEL_SCALAR:
+            return &SCALAR_KERNELS;
+#ifdef MIXER_HAVE_SSE2
+        case AUDIO_MIXER_KERNEL_SSE2:
+            return &SSE2_KERNELS;
+#endif
+#ifdef MIXER_HAVE_AVX2
+        case AUDIO_MIXER_KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2") ? &AVX2_KERNELS : NULL;
+#endif
+#ifdef MIXER_HAVE_NEON
+        case AUDIO_MIXER_KERNEL_NEON:
+            return &NEON_KERNELS;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+static const MixerKernels* detect_kernels()
+{
+    static const AudioMixerKernel PREFERENCE[] = {
+        AUDIO_MIXER_KERNEL_AVX2, AUDIO_MIXER_KERNEL_SSE2, AUDIO_MIXER_KERNEL_NEON, AUDIO_MIXER_KERNEL_SCALAR,
+    };
+
+    const MixerKernels* kernels = NULL;
+    for (size_t i = 0; kernels == NULL; i++)
+    {
+        kernels = find_kernels(PREFERENCE[i]);
+    }
+    return kernels;
+}
+
+static const MixerKernels* current_kernels()
+{
+    const MixerKernels* kernels = atomic_load_explicit(&active_kernels, memory_order_acquire);
+    if (kernels == NULL)
+    {
+        kernels = detect_kernels();
+        atomic_store_explicit(&active_kernels, kernels, memory_order_release);
+    }
+    return kernels;
+}
+
+bool audio_mixer_set_kernel(AudioMixerKernel kernel)
+{
+    const MixerKernels* kernels = kernel == AUDIO_MIXER_KERNEL_AUTO ? detect_kernels() : find_kernels(kernel);
+    if (kernels == NULL)
+    {
+        return false;
+    }
+
+    atomic_store_explicit(&active_kernels, kernels, memory_order_release);
+    return true;
+}
+
+AudioMixerKernel audio_mixer_get_kernel()
+{
+    return current_kernels()->kernel;
+}
+
+int16_t* audio_frame_alloc(size_t sample_count)
+{
+    if (sample_count == 0 || sample_count > (SIZE_MAX - AUDIO_FRAME_ALIGNMENT) / sizeof(int16_t))
+    {
+        return NULL;
+    }
+
+    // aligned_alloc wants a multiple of the alignment.
+    const size_t size = (sample_count * sizeof(int16_t) + AUDIO_FRAME_ALIGNMENT - 1)
+        / AUDIO_FRAME_ALIGNMENT * AUDIO_FRAME_ALIGNMENT;
+#ifdef _WIN32
+    int16_t* frame = _aligned_malloc(size, AUDIO_FRAME_ALIGNMENT);
+#else
+    int16_t* frame = aligned_alloc(AUDIO_FRAME_ALIGNMENT, size);
+#endif
+    if (frame != NULL)
+    {
+        memset(frame, 0, size);
+    }
+    return frame;
+}
+
+void audio_frame_free(int16_t* frame)
+{
+#ifdef _WIN32
+    _aligned_free(frame);
+#else
+    free(frame);
+#endif
+}
+
+ErrorCode audio_mix(const AudioMixInput inputs[], size_t input_count, int16_t* output, size_t sample_count,
+                    bool soft_clip)
+{
+    if (output == NULL || (input_count > 0 && inputs == NULL))
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    bool is_unity = !soft_clip;
+    for (size_t j = 0; j < input_count; j++)
+    {
+        if (inputs[j].samples == NULL || !(inputs[j].gain >= 0.0f && inputs[j].gain <= AUDIO_MIX_MAX_GAIN))
+        {
+            return ERROR_INVALID_PARAMS;
+        }
+        is_unity = is_unity && inputs[j].gain == 1.0f;
+    }
+
+    if (input_count == 0)
+    {
+        memset(output, 0, sample_count * sizeof(int16_t));
+    }
+    else if (is_unity)
+    {
+        current_kernels()->saturating(inputs, input_count, output, 0, sample_count);
+    }
+    else
+    {
+        current_kernels()->gain(inputs, input_count, output, 0, sample_count, soft_clip);
+    }
+    return ERROR_NONE;
+}
@@ -0,0 +1,164 @@
+#include "libmessagekit/conversations.h"
+#include "blocked_users.h"
+#include "database.h"
+#include "id_set.h"
+
+static IdSet* blocked_users = NULL;
+
+bool is_user_blocked(const char* user_id)
+{
+    return id_set_contains(blocked_users, user_id);
+}
+
+/**
+ * SQL function is_blocked_user(user_id), lets queries filter on the in-memory set.
+ */
+static void sql_is_blocked_user(sqlite3_context* context, int argc, sqlite3_value** argv)
+{
+    (void)argc;
+    sqlite3_result_int(context, is_user_blocked((const char*)sqlite3_value_text(argv[0])) ? 1 : 0);
+}
+
+/**
+ * Applies a block list change to the table and to the set. The set is
+ * updated before observers are notified, so list subscribers already see
+ * the new state when the affected conversations are reported.
+ */
+static ErrorCode update_block_list(const char* user_id, const char* sql, bool blocked)
+{
+    if (user_id == NULL || strlen(user_id) == 0 || strlen(user_id) >= USER_ID_LENGTH)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL || blocked_users == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    sqlite3_bind_text(stmt, 1, user_id, -1, SQLITE_STATIC);
+
+    const bool was_blocked = is_user_blocked(user_id);
+    ErrorCode error = blocked ? id_set_add(blocked_users, user_id) : ERROR_NONE;
+    if (error == ERROR_NONE && !blocked)
+    {
+        id_set_remove(blocked_users, user_id);
+    }
+
+    if (error == ERROR_NONE && sqlite3_step(stmt) != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+
+        if (was_blocked)
+        {
+            id_set_add(blocked_users, user_id);
+        }
+        else
+        {
+            id_set_remove(blocked_users, user_id);
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    return error;
+}
+
+void block_user(const char* user_id, OperationCallback callback)
+{
+    const ErrorCode error = update_block_list(user_id, "INSERT OR IGNORE INTO blocked_users (user_id) VALUES (?);", true);
+    if (callback != NULL)
+    {
+        callback(error);
+    }
+}
+
+void unblock_user(const char* user_id, OperationCallback callback)
+{
+    const ErrorCode error = update_block_list(user_id, "DELETE FROM blocked_users WHERE user_id = ?;", false);
+    if (callback != NULL)
+    {
+        callback(error);
+    }
+}
+
+ErrorCode blocked_users_init()
+{
+    if (blocked_users != NULL)
+    {
+        return ERROR_ALREADY_INITIALIZED;
+    }
+
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(handle, "SELECT user_id FROM blocked_users;", -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    blocked_users = id_set_create();
+    if (blocked_users == NULL)
+    {
+        sqlite3_finalize(stmt);
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    ErrorCode error = ERROR_NONE;
+    int step = SQLITE_DONE;
+    while (error == ERROR_NONE && (step = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        // Malformed IDs can never match a sender, only allocation failures matter.
+        if (id_set_add(blocked_users, (const char*)sqlite3_column_text(stmt, 0)) == ERROR_MEMORY_ALLOCATION)
+        {
+            error = ERROR_MEMORY_ALLOCATION;
+        }
+    }
+
+    if (error == ERROR_NONE && step != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+    sqlite3_finalize(stmt);
+
+    if (error == ERROR_NONE
+        && sqlite3_create_function_v2(handle, "is_blocked_user", 1, SQLITE_UTF8, NULL,
+                                      sql_is_blocked_user, NULL, NULL, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_INITIALIZATION;
+    }
+
+    if (error != ERROR_NONE)
+    {
+        blocked_users_shutdown();
+    }
+
+    return error;
+}
+
+void blocked_users_shutdown()
+{
+    sqlite3* handle = db_get_handle();
+    if (handle != NULL && blocked_users != NULL)
+    {
+        sqlite3_create_function_v2(handle, "is_blocked_user", 1, SQLITE_UTF8, NULL, NULL, NULL, NULL, NULL);
+    }
+
+    id_set_destroy(blocked_users);
+    blocked_users = NULL;
+}
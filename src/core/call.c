@@ -0,0 +1,492 @@
+#include "libmessagekit/call.h"
+#include "call_dispatch.h"
+#include "call_stats.h"
+#include "mpsc_ring.h"
+
+#include <stdatomic.h>
+#include <time.h>
+
+#define CALL_ID_WORDS (CALL_ID_LENGTH / sizeof(uint64_t))
+
+_Static_assert(CALL_ID_LENGTH % sizeof(uint64_t) == 0, "call IDs are compared as whole words");
+
+#define SLOT_FREE 0u
+#define SLOT_CLAIMED 1u
+#define SLOT_ACTIVE 2u
+#define STATE_INVALID -1
+
+typedef enum {
+    CALL_EVENT_START,
+    CALL_EVENT_INCOMING,
+    CALL_EVENT_ANSWER,
+    CALL_EVENT_REJECT,
+    CALL_EVENT_END,
+    CALL_EVENT_HOLD,
+    CALL_EVENT_RESUME,
+    CALL_EVENT_SWITCH_TYPE,
+    CALL_EVENT_MUTE,
+    CALL_EVENT_UNMUTE,
+    CALL_EVENT_REMOTE_RINGING,
+    CALL_EVENT_REMOTE_ANSWERED,
+    CALL_EVENT_REMOTE_REJECTED,
+    CALL_EVENT_REMOTE_ENDED,
+    CALL_EVENT_TIMEOUT,
+    CALL_EVENT_COUNT
+} CallEventType;
+
+typedef enum {
+    DIRECTION_ANY,
+    DIRECTION_INCOMING,
+    DIRECTION_OUTGOING
+} EventDirection;
+
+typedef struct {
+    CallEventType type;
+    uint32_t generation;
+    CallType call_type;
+    CallOperationCallback callback;
+    char peer_id[USER_ID_LENGTH];
+} CallEvent;
+
+/**
+ * A call slot is reused across calls. The tag packs a generation with the
+ * slot status, events carry the generation they were queued for so events
+ * of a previous call are never applied to the next one. The event queue is
+ * created by the first call of the slot and kept like the slot itself; only
+ * the thread holding the draining flag pops from it.
+ */
+typedef struct {
+    _Atomic uint64_t tag;
+    _Atomic uint64_t id_words[CALL_ID_WORDS];
+    atomic_bool draining;
+    MpscRing* queue;
+    uint32_t info_generation; // Owned by the draining thread, like info
+    CallInfo info;
+} CallSlot;
+
+/*
+ * Next state per event and current state, STATE_INVALID rejects the event.
+ * START and INCOMING create the call and are not looked up here.
+ */
+static const int TRANSITIONS[CALL_EVENT_COUNT][CALL_STATE_ENDED + 1] = {
+    //                            INITIATING              RINGING                 CONNECTED               HOLDING                 ENDED
+    [CALL_EVENT_START]           = {STATE_INVALID,        STATE_INVALID,          STATE_INVALID,          STATE_INVALID,          STATE_INVALID},
+    [CALL_EVENT_INCOMING]        = {STATE_INVALID,        STATE_INVALID,          STATE_INVALID,          STATE_INVALID,          STATE_INVALID},
+    [CALL_EVENT_ANSWER]          = {STATE_INVALID,        CALL_STATE_CONNECTED,   STATE_INVALID,          STATE_INVALID,          STATE_INVALID},
+    [CALL_EVENT_REJECT]          = {STATE_INVALID,        CALL_STATE_ENDED,       STATE_INVALID,          STATE_INVALID,          STATE_INVALID},
+    [CALL_EVENT_END]             = {CALL_STATE_ENDED,     CALL_STATE_ENDED,       CALL_STATE_ENDED,       CALL_STATE_ENDED,       STATE_INVALID},
+    [CALL_EVENT_HOLD]            = {STATE_INVALID,        STATE_INVALID,          CALL_STATE_HOLDING,     STATE_INVALID,          STATE_INVALID},
+    [CALL_EVENT_RESUME]          = {STATE_INVALID,        STATE_INVALID,          STATE_INVALID,          CALL_STATE_CONNECTED,   STATE_INVALID},
+    [CALL_EVENT_SWITCH_TYPE]     = {STATE_INVALID,        STATE_INVALID,          CALL_STATE_CONNECTED,   CALL_STATE_HOLDING,     STATE_INVALID},
+    [CALL_EVENT_MUTE]            = {CALL_STATE_INITIATING, CALL_STATE_RINGING,    CALL_STATE_CONNECTED,   CALL_STATE_HOLDING,     STATE_INVALID},
+    [CALL_EVENT_UNMUTE]          = {CALL_STATE_INITIATING, CALL_STATE_RINGING,    CALL_STATE_CONNECTED,   CALL_STATE_HOLDING,     STATE_INVALID},
+    [CALL_EVENT_REMOTE_RINGING]  = {CALL_STATE_RINGING,   STATE_INVALID,          STATE_INVALID,          STATE_INVALID,          STATE_INVALID},
+    [CALL_EVENT_REMOTE_ANSWERED] = {CALL_STATE_CONNECTED, CALL_STATE_CONNECTED,   STATE_INVALID,          STATE_INVALID,          STATE_INVALID},
+    [CALL_EVENT_REMOTE_REJECTED] = {CALL_STATE_ENDED,     CALL_STATE_ENDED,       STATE_INVALID,          STATE_INVALID,          STATE_INVALID},
+    [CALL_EVENT_REMOTE_ENDED]    = {CALL_STATE_ENDED,     CALL_STATE_ENDED,       CALL_STATE_ENDED,       CALL_STATE_ENDED,       STATE_INVALID},
+    [CALL_EVENT_TIMEOUT]         = {CALL_STATE_ENDED,     CALL_STATE_ENDED,       STATE_INVALID,          STATE_INVALID,          STATE_INVALID},
+};
+
+// Answering and rejecting are decisions of the callee, the remote answer events only concern calls we placed.
+static const EventDirection EVENT_DIRECTIONS[CALL_EVENT_COUNT] = {
+    [CALL_EVENT_ANSWER] = DIRECTION_INCOMING,
+    [CALL_EVENT_REJECT] = DIRECTION_INCOMING,
+    [CALL_EVENT_REMOTE_RINGING] = DIRECTION_OUTGOING,
+    [CALL_EVENT_REMOTE_ANSWERED] = DIRECTION_OUTGOING,
+    [CALL_EVENT_REMOTE_REJECTED] = DIRECTION_OUTGOING,
+};
+
+static const CallEventType SIGNAL_EVENTS[] = {
+    [CALL_SIGNAL_RINGING] = CALL_EVENT_REMOTE_RINGING,
+    [CALL_SIGNAL_ANSWERED] = CALL_EVENT_REMOTE_ANSWERED,
+    [CALL_SIGNAL_REJECTED] = CALL_EVENT_REMOTE_REJECTED,
+    [CALL_SIGNAL_ENDED] = CALL_EVENT_REMOTE_ENDED,
+    [CALL_SIGNAL_TIMEOUT] = CALL_EVENT_TIMEOUT,
+};
+
+static CallSlot call_slots[CALL_MAX_ACTIVE];
+static _Atomic(CallStateChangeCallback) state_change_callback = NULL;
+static atomic_uint call_counter = 0;
+
+static uint64_t make_tag(uint32_t generation, uint32_t status)
+{
+    return ((uint64_t)generation << 2) | status;
+}
+
+static uint32_t tag_generation(uint64_t tag)
+{
+    return (uint32_t)(tag >> 2);
+}
+
+static uint32_t tag_status(uint64_t tag)
+{
+    return (uint32_t)(tag & 0x3u);
+}
+
+static bool is_valid_id(const char* id, size_t size)
+{
+    return id != NULL && id[0] != '\0' && memchr(id, '\0', size) != NULL;
+}
+
+static void encode_id(const char* call_id, uint64_t words[CALL_ID_WORDS])
+{
+    char padded[CALL_ID_LENGTH] = {0};
+    memcpy(padded, call_id, strlen(call_id));
+    memcpy(words, padded, CALL_ID_LENGTH);
+}
+
+static void notify_operation(CallOperationCallback callback, const CallInfo* info, ErrorCode error)
+{
+    if (callback != NULL)
+    {
+        callback(error == ERROR_NONE ? info : NULL, error);
+    }
+}
+
+static void notify_state_change(const CallInfo* info)
+{
+    const CallStateChangeCallback callback = atomic_load_explicit(&state_change_callback, memory_order_acquire);
+    if (callback != NULL)
+    {
+        callback(info);
+    }
+    call_dispatch_publish(info);
+}
+
+static void release_slot(CallSlot* slot, uint32_t generation)
+{
+    atomic_store_explicit(&slot->tag, make_tag(generation, SLOT_FREE), memory_order_release);
+}
+
+static void create_call(CallSlot* slot, const CallEvent* event)
+{
+    memset(&slot->info, 0, sizeof(CallInfo));
+    for (size_t i = 0; i < CALL_ID_WORDS; i++)
+    {
+        const uint64_t word = atomic_load_explicit(&slot->id_words[i], memory_order_relaxed);
+        memcpy(&slot->info.call_id[i * sizeof(uint64_t)], &word, sizeof(uint64_t));
+    }
+    memcpy(slot->info.peer_id, event->peer_id, sizeof(slot->info.peer_id));
+    slot->info.type = event->call_type;
+    slot->info.is_outgoing = event->type == CALL_EVENT_START;
+    slot->info.state = slot->info.is_outgoing ? CALL_STATE_INITIATING : CALL_STATE_RINGING;
+    slot->info_generation = event->generation;
+    call_stats_open((size_t)(slot - call_slots), &slot->info);
+
+    notify_operation(event->callback, &slot->info, ERROR_NONE);
+    notify_state_change(&slot->info);
+}
+
+/**
+ * Applies one event to the call it was queued for. Runs on the thread
+ * holding the slot's draining flag, so the call info needs no locking.
+ */
+static void apply_event(CallSlot* slot, const CallEvent* event)
+{
+    if (event->type == CALL_EVENT_START || event->type == CALL_EVENT_INCOMING)
+    {
+        create_call(slot, event);
+        return;
+    }
+
+    if (event->generation != slot->info_generation)
+    {
+        notify_operation(event->callback, NULL, CALL_ERROR_NOT_FOUND);
+        return;
+    }
+
+    CallInfo* info = &slot->info;
+    const EventDirection direction = EVENT_DIRECTIONS[event->type];
+    const int next_state = TRANSITIONS[event->type][info->state];
+    if (next_state == STATE_INVALID
+        || (direction == DIRECTION_INCOMING && info->is_outgoing)
+        || (direction == DIRECTION_OUTGOING && !info->is_outgoing))
+    {
+        notify_operation(event->callback, NULL, CALL_ERROR_INVALID_STATE);
+        return;
+    }
+
+    const CallInfo previous = *info;
+    info->state = (CallState)next_state;
+    if (event->type == CALL_EVENT_SWITCH_TYPE)
+    {
+        info->type = event->call_type;
+    }
+    else if (event->type == CALL_EVENT_MUTE || event->type == CALL_EVENT_UNMUTE)
+    {
+        info->is_muted = event->type == CALL_EVENT_MUTE;
+    }
+
+    notify_operation(event->callback, info, ERROR_NONE);
+    if (info->state != previous.state || info->type != previous.type || info->is_muted != previous.is_muted)
+    {
+        notify_state_change(info);
+    }
+
+    // An ended call frees its slot, later events for it report CALL_ERROR_NOT_FOUND.
+    if (info->state == CALL_STATE_ENDED)
+    {
+        call_stats_close((size_t)(slot - call_slots), info);
+        slot->info_generation = 0;
+        release_slot(slot, event->generation);
+    }
+}
+
+/**
+ * Applies queued events until the queue is empty. A thread that finds
+ * another one draining leaves its event to that thread. The queue is
+ * checked again after giving up the flag, so an event pushed just before
+ * is not stranded.
+ */
+static void drain_events(CallSlot* slot)
+{
+    while (!atomic_exchange_explicit(&slot->draining, true, memory_order_acquire))
+    {
+        CallEvent event;
+        while (mpsc_ring_pop(slot->queue, &event))
+        {
+            apply_event(slot, &event);
+        }
+
+        atomic_store_explicit(&slot->draining, false, memory_order_release);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (mpsc_ring_is_empty(slot->queue))
+        {
+            break;
+        }
+    }
+}
+
+static ErrorCode queue_event(CallSlot* slot, const CallEvent* event)
+{
+    if (!mpsc_ring_push(slot->queue, event))
+    {
+        return CALL_ERROR_QUEUE_FULL;
+    }
+
+    // Pairs with the fence in drain_events, either the drainer sees the event or this thread drains.
+    atomic_thread_fence(memory_order_seq_cst);
+    drain_events(slot);
+    return ERROR_NONE;
+}
+
+static CallSlot* find_call(const char* call_id, uint32_t* generation)
+{
+    uint64_t words[CALL_ID_WORDS];
+    encode_id(call_id, words);
+
+    for (size_t i = 0; i < CALL_MAX_ACTIVE; i++)
+    {
+        CallSlot* slot = &call_slots[i];
+        const uint64_t tag = atomic_load_explicit(&slot->tag, memory_order_acquire);
+        if (tag_status(tag) != SLOT_ACTIVE)
+        {
+            continue;
+        }
+
+        bool matches = true;
+        for (size_t w = 0; w < CALL_ID_WORDS && matches; w++)
+        {
+            matches = atomic_load_explicit(&slot->id_words[w], memory_order_relaxed) == words[w];
+        }
+
+        // The slot may have been reused while the ID was compared.
+        atomic_thread_fence(memory_order_acquire);
+        if (matches && atomic_load_explicit(&slot->tag, memory_order_relaxed) == tag)
+        {
+            *generation = tag_generation(tag);
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Claims a free slot for a new call. The creating event is queued before
+ * the slot is published, so it is always the first event of the call.
+ */
+static void create_slot(const char* call_id, CallEvent* event)
+{
+    // Offers for one call ID arrive through one signaling channel, so checking before claiming suffices.
+    uint32_t existing_generation;
+    if (find_call(call_id, &existing_generation) != NULL)
+    {
+        notify_operation(event->callback, NULL, CALL_ERROR_INVALID_STATE);
+        return;
+    }
+
+    uint64_t words[CALL_ID_WORDS];
+    encode_id(call_id, words);
+
+    for (size_t i = 0; i < CALL_MAX_ACTIVE; i++)
+    {
+        CallSlot* slot = &call_slots[i];
+        uint64_t tag = atomic_load_explicit(&slot->tag, memory_order_relaxed);
+        const uint32_t generation = tag_generation(tag) + 1;
+        if (tag_status(tag) != SLOT_FREE
+            || !atomic_compare_exchange_strong_explicit(&slot->tag, &tag, make_tag(generation, SLOT_CLAIMED),
+                                                        memory_order_acquire, memory_order_relaxed))
+        {
+            continue;
+        }
+
+        for (size_t w = 0; w < CALL_ID_WORDS; w++)
+        {
+            atomic_store_explicit(&slot->id_words[w], words[w], memory_order_relaxed);
+        }
+
+        // The claim makes this thread the only one touching the queue until the slot is published.
+        if (slot->queue == NULL)
+        {
+            slot->queue = mpsc_ring_create(CALL_EVENT_QUEUE_SIZE, sizeof(CallEvent));
+        }
+        if (slot->queue == NULL)
+        {
+            release_slot(slot, generation);
+            notify_operation(event->callback, NULL, ERROR_MEMORY_ALLOCATION);
+            return;
+        }
+
+        event->generation = generation;
+        if (!mpsc_ring_push(slot->queue, event))
+        {
+            release_slot(slot, generation);
+            notify_operation(event->callback, NULL, CALL_ERROR_QUEUE_FULL);
+            return;
+        }
+
+        atomic_store_explicit(&slot->tag, make_tag(generation, SLOT_ACTIVE), memory_order_release);
+        atomic_thread_fence(memory_order_seq_cst);
+        drain_events(slot);
+        return;
+    }
+
+    notify_operation(event->callback, NULL, CALL_ERROR_TOO_MANY_CALLS);
+}
+
+static void dispatch_event(const char* call_id, CallEventType type, CallType call_type, CallOperationCallback callback)
+{
+    if (!is_valid_id(call_id, CALL_ID_LENGTH))
+    {
+        notify_operation(callback, NULL, ERROR_INVALID_PARAMS);
+        return;
+    }
+
+    uint32_t generation;
+    CallSlot* slot = find_call(call_id, &generation);
+    if (slot == NULL)
+    {
+        notify_operation(callback, NULL, CALL_ERROR_NOT_FOUND);
+        return;
+    }
+
+    CallEvent event;
+    event.type = type;
+    event.generation = generation;
+    event.call_type = call_type;
+    event.callback = callback;
+    event.peer_id[0] = '\0';
+
+    const ErrorCode error = queue_event(slot, &event);
+    if (error != ERROR_NONE)
+    {
+        notify_operation(callback, NULL, error);
+    }
+}
+
+static bool is_valid_call_type(CallType type)
+{
+    return type == CALL_TYPE_AUDIO || type == CALL_TYPE_VIDEO;
+}
+
+static void begin_call(const char* call_id, const char* peer_id, CallType type, CallEventType event_type,
+                       CallOperationCallback callback)
+{
+    if (!is_valid_id(call_id, CALL_ID_LENGTH) || !is_valid_id(peer_id, USER_ID_LENGTH) || !is_valid_call_type(type))
+    {
+        notify_operation(callback, NULL, ERROR_INVALID_PARAMS);
+        return;
+    }
+
+    CallEvent event;
+    event.type = event_type;
+    event.generation = 0;
+    event.call_type = type;
+    event.callback = callback;
+    memset(event.peer_id, 0, sizeof(event.peer_id));
+    memcpy(event.peer_id, peer_id, strlen(peer_id));
+    create_slot(call_id, &event);
+}
+
+void start_call(const char* peer_id, CallType type, CallOperationCallback callback)
+{
+    char call_id[CALL_ID_LENGTH];
+    snprintf(call_id, sizeof(call_id), "call-%llx-%x", (unsigned long long)time(NULL),
+             atomic_fetch_add_explicit(&call_counter, 1, memory_order_relaxed));
+    begin_call(call_id, peer_id, type, CALL_EVENT_START, callback);
+}
+
+void receive_call(const char* call_id, const char* peer_id, CallType type, CallOperationCallback callback)
+{
+    begin_call(call_id, peer_id, type, CALL_EVENT_INCOMING, callback);
+}
+
+void signal_call(const char* call_id, CallSignal signal, CallOperationCallback callback)
+{
+    if (signal < CALL_SIGNAL_RINGING || signal > CALL_SIGNAL_TIMEOUT)
+    {
+        notify_operation(callback, NULL, ERROR_INVALID_PARAMS);
+        return;
+    }
+    dispatch_event(call_id, SIGNAL_EVENTS[signal], CALL_TYPE_AUDIO, callback);
+}
+
+void answer_call(const char* call_id, CallOperationCallback callback)
+{
+    dispatch_event(call_id, CALL_EVENT_ANSWER, CALL_TYPE_AUDIO, callback);
+}
+
+void reject_call(const char* call_id, CallOperationCallback callback)
+{
+    dispatch_event(call_id, CALL_EVENT_REJECT, CALL_TYPE_AUDIO, callback);
+}
+
+void end_call(const char* call_id, CallOperationCallback callback)
+{
+    dispatch_event(call_id, CALL_EVENT_END, CALL_TYPE_AUDIO, callback);
+}
+
+void hold_call(const char* call_id, CallOperationCallback callback)
+{
+    dispatch_event(call_id, CALL_EVENT_HOLD, CALL_TYPE_AUDIO, callback);
+}
+
+void resume_call(const char* call_id, CallOperationCallback callback)
+{
+    dispatch_event(call_id, CALL_EVENT_RESUME, CALL_TYPE_AUDIO, callback);
+}
+
+void switch_call_type(const char* call_id, CallType new_type, CallOperationCallback callback)
+{
+    if (!is_valid_call_type(new_type))
+    {
+        notify_operation(callback, NULL, ERROR_INVALID_PARAMS);
+        return;
+    }
+    dispatch_event(call_id, CALL_EVENT_SWITCH_TYPE, new_type, callback);
+}
+
+void mute_call(const char* call_id, CallOperationCallback callback)
+{
+    dispatch_event(call_id, CALL_EVENT_MUTE, CALL_TYPE_AUDIO, callback);
+}
+
+void unmute_call(const char* call_id, CallOperationCallback callback)
+{
+    dispatch_event(call_id, CALL_EVENT_UNMUTE, CALL_TYPE_AUDIO, callback);
+}
+
+void register_call_state_change_callback(CallStateChangeCallback callback)
+{
+    atomic_store_explicit(&state_change_callback, callback, memory_order_release);
+}
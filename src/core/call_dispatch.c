@@ -0,0 +1,306 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "call_dispatch.h"
+#include "mpsc_ring.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <time.h>
+
+typedef struct {
+    bool in_use;
+    CallSubscription id;
+    CallStateFilter filter;
+    CallStateBatchCallback callback;
+} Subscriber;
+
+static pthread_mutex_t dispatch_lock = PTHREAD_MUTEX_INITIALIZER; // Guards the subscribers and the stopping flag
+static pthread_cond_t dispatch_wakeup = PTHREAD_COND_INITIALIZER;
+static Subscriber subscribers[CALL_MAX_SUBSCRIBERS];
+static CallSubscription next_subscription = 1;
+static bool stopping = false;
+
+static MpscRing* changes = NULL;
+static pthread_t dispatch_thread;
+static atomic_bool is_running = false;
+static atomic_bool is_sleeping = false;
+static atomic_size_t publisher_count = 0; // Publishers that may still touch the ring
+static atomic_size_t subscriber_count = 0;
+static atomic_size_t coalescing_count = 0;
+
+// Owned by the event thread.
+static CallInfo* batch = NULL;
+static CallInfo* matches = NULL;
+
+static bool matches_filter(const CallStateFilter* filter, const CallInfo* info)
+{
+    return (filter->call_id[0] == '\0' || strcmp(filter->call_id, info->call_id) == 0)
+        && (filter->state_mask == 0 || (filter->state_mask & CALL_STATE_MASK(info->state)) != 0);
+}
+
+/**
+ * Selects the changes of one subscriber, coalescing keeps the latest change
+ * of a call in the place of its first one.
+ */
+static size_t select_changes(const Subscriber* subscriber, const CallInfo changes_in[], size_t count)
+{
+    size_t selected = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!matches_filter(&subscriber->filter, &changes_in[i]))
+        {
+            continue;
+        }
+
+        size_t position = selected;
+        if (subscriber->filter.coalesce)
+        {
+            for (size_t j = 0; j < selected; j++)
+            {
+                if (strcmp(matches[j].call_id, changes_in[i].call_id) == 0)
+                {
+                    position = j;
+                    break;
+                }
+            }
+        }
+
+        matches[position] = changes_in[i];
+        selected += position == selected ? 1 : 0;
+    }
+    return selected;
+}
+
+static void deliver(size_t count)
+{
+    Subscriber current[CALL_MAX_SUBSCRIBERS];
+    pthread_mutex_lock(&dispatch_lock);
+    memcpy(current, subscribers, sizeof(current));
+    pthread_mutex_unlock(&dispatch_lock);
+
+    // Callbacks run without the lock, so they may subscribe or unsubscribe.
+    for (size_t i = 0; i < CALL_MAX_SUBSCRIBERS; i++)
+    {
+        if (!current[i].in_use)
+        {
+            continue;
+        }
+
+        const size_t selected = select_changes(&current[i], batch, count);
+        if (selected > 0)
+        {
+            current[i].callback(current[i].id, matches, selected);
+        }
+    }
+}
+
+static size_t collect(size_t count)
+{
+    while (count < CALL_DISPATCH_QUEUE_SIZE && mpsc_ring_pop(changes, &batch[count]))
+    {
+        count++;
+    }
+    return count;
+}
+
+/**
+ * Sleeps until a change is queued. The sleeping flag tells publishers to
+ * signal; it is set before the last look at the ring, so a change pushed
+ * in between is either seen here or followed by a signal.
+ *
+ * @return False once the thread should stop.
+ */
+static bool wait_for_changes()
+{
+    pthread_mutex_lock(&dispatch_lock);
+    for (;;)
+    {
+        atomic_store(&is_sleeping, true);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (!mpsc_ring_is_empty(changes) || stopping)
+        {
+            break;
+        }
+        pthread_cond_wait(&dispatch_wakeup, &dispatch_lock);
+    }
+    atomic_store(&is_sleeping, false);
+
+    const bool keep_running = !stopping || !mpsc_ring_is_empty(changes);
+    pthread_mutex_unlock(&dispatch_lock);
+    return keep_running;
+}
+
+static void linger()
+{
+    struct timespec window;
+    window.tv_sec = CALL_DISPATCH_BATCH_WINDOW_MS / 1000;
+    window.tv_nsec = (long)(CALL_DISPATCH_BATCH_WINDOW_MS % 1000) * 1000000L;
+    nanosleep(&window, NULL);
+}
+
+static void* dispatch_main(void* argument)
+{
+    (void)argument;
+    while (wait_for_changes())
+    {
+        size_t count = collect(0);
+        if (count < CALL_DISPATCH_QUEUE_SIZE && atomic_load(&coalescing_count) > 0)
+        {
+            linger();
+            count = collect(count);
+        }
+        deliver(count);
+    }
+    return NULL;
+}
+
+void call_dispatch_publish(const CallInfo* call_info)
+{
+    if (atomic_load_explicit(&subscriber_count, memory_order_relaxed) == 0)
+    {
+        return;
+    }
+
+    // Registered before looking at is_running, so shutdown either stops this publisher or waits for it.
+    atomic_fetch_add(&publisher_count, 1);
+    if (atomic_load(&is_running) && mpsc_ring_push(changes, call_info))
+    {
+        // Pairs with the fence in wait_for_changes.
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_load_explicit(&is_sleeping, memory_order_relaxed))
+        {
+            pthread_mutex_lock(&dispatch_lock);
+            pthread_cond_signal(&dispatch_wakeup);
+            pthread_mutex_unlock(&dispatch_lock);
+        }
+    }
+    atomic_fetch_sub_explicit(&publisher_count, 1, memory_order_release);
+}
+
+ErrorCode subscribe_call_state_changes(const CallStateFilter* filter, CallStateBatchCallback callback,
+                                       CallSubscription* subscription)
+{
+    if (callback == NULL || subscription == NULL
+        || (filter != NULL && memchr(filter->call_id, '\0', CALL_ID_LENGTH) == NULL))
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    if (!atomic_load(&is_running))
+    {
+        return ERROR_NOT_INITIALIZED;
+    }
+
+    ErrorCode error = ERROR_MEMORY_ALLOCATION;
+    pthread_mutex_lock(&dispatch_lock);
+    for (size_t i = 0; i < CALL_MAX_SUBSCRIBERS; i++)
+    {
+        if (subscribers[i].in_use)
+        {
+            continue;
+        }
+
+        memset(&subscribers[i], 0, sizeof(Subscriber));
+        subscribers[i].in_use = true;
+        subscribers[i].id = next_subscription++;
+        subscribers[i].callback = callback;
+        if (filter != NULL)
+        {
+            subscribers[i].filter = *filter;
+        }
+
+        atomic_fetch_add(&subscriber_count, 1);
+        if (subscribers[i].filter.coalesce)
+        {
+            atomic_fetch_add(&coalescing_count, 1);
+        }
+        *subscription = subscribers[i].id;
+        error = ERROR_NONE;
+        break;
+    }
+    pthread_mutex_unlock(&dispatch_lock);
+    return error;
+}
+
+ErrorCode unsubscribe_call_state_changes(CallSubscription subscription)
+{
+    ErrorCode error = ERROR_INVALID_PARAMS;
+    pthread_mutex_lock(&dispatch_lock);
+    for (size_t i = 0; i < CALL_MAX_SUBSCRIBERS; i++)
+    {
+        if (subscribers[i].in_use && subscribers[i].id == subscription)
+        {
+            atomic_fetch_sub(&subscriber_count, 1);
+            if (subscribers[i].filter.coalesce)
+            {
+                atomic_fetch_sub(&coalescing_count, 1);
+            }
+            subscribers[i].in_use = false;
+            error = ERROR_NONE;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&dispatch_lock);
+    return error;
+}
+
+ErrorCode call_dispatch_init()
+{
+    if (atomic_load(&is_running))
+    {
+        return ERROR_ALREADY_INITIALIZED;
+    }
+
+    changes = mpsc_ring_create(CALL_DISPATCH_QUEUE_SIZE, sizeof(CallInfo));
+    batch = malloc(CALL_DISPATCH_QUEUE_SIZE * sizeof(CallInfo));
+    matches = malloc(CALL_DISPATCH_QUEUE_SIZE * sizeof(CallInfo));
+    if (changes == NULL || batch == NULL || matches == NULL)
+    {
+        call_dispatch_shutdown();
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    stopping = false;
+    if (pthread_create(&dispatch_thread, NULL, dispatch_main, NULL) != 0)
+    {
+        call_dispatch_shutdown();
+        return ERROR_UNKNOWN;
+    }
+
+    atomic_store_explicit(&is_running, true, memory_order_release);
+    return ERROR_NONE;
+}
+
+void call_dispatch_shutdown()
+{
+    if (atomic_exchange(&is_running, false))
+    {
+        // A publisher that saw the dispatcher running finishes its push before the ring goes away.
+        while (atomic_load_explicit(&publisher_count, memory_order_acquire) > 0)
+        {
+            sched_yield();
+        }
+
+        pthread_mutex_lock(&dispatch_lock);
+        stopping = true;
+        pthread_cond_signal(&dispatch_wakeup);
+        pthread_mutex_unlock(&dispatch_lock);
+        pthread_join(dispatch_thread, NULL);
+    }
+
+    pthread_mutex_lock(&dispatch_lock);
+    memset(subscribers, 0, sizeof(subscribers));
+    atomic_store(&subscriber_count, 0);
+    atomic_store(&coalescing_count, 0);
+    pthread_mutex_unlock(&dispatch_lock);
+
+    mpsc_ring_destroy(changes);
+    free(batch);
+    free(matches);
+    changes = NULL;
+    batch = NULL;
+    matches = NULL;
+}
@@ -0,0 +1,826 @@
+#include "libmessagekit/call_history.h"
+#include "libmessagekit/contacts.h"
+#include "call_history_store.h"
+#include "call_stats_store.h"
+#include "database.h"
+#include "search_index.h"
+
+#include <inttypes.h>
+
+#define HISTORY_COLUMNS "id, call_id, contact_id, timestamp, type, duration, is_read"
+#define HISTORY_INITIAL_CAPACITY 32
+#define HISTORY_QUERY_LENGTH 512
+#define CURSOR_VERSION 1
+#define SECONDS_PER_DAY 86400
+
+/*
+ * A query shape is the set of optional conditions a filter needs. Each
+ * shape has one SQL text, the parameters keep fixed numbers across shapes.
+ */
+#define SHAPE_CONTACT 1u
+#define SHAPE_TYPE 2u
+#define SHAPE_READ 4u
+#define SHAPE_CURSOR 8u
+#define SHAPE_COUNT 16u
+
+typedef struct {
+    unsigned shape;
+    bool matches_nothing;
+    int64_t start_date;
+    int64_t end_date;
+    const char* contact_id;
+    CallType type;
+    int is_read;
+} ResolvedFilter;
+
+typedef struct {
+    int64_t timestamp;
+    int64_t id;
+} HistoryPosition;
+
+typedef struct {
+    CallHistoryEntry* items;
+    size_t count;
+    size_t capacity;
+    HistoryPosition last;
+    HistoryPosition before_last;
+} EntryBuffer;
+
+static void notify(OperationCallback callback, ErrorCode error)
+{
+    if (callback != NULL)
+    {
+        callback(error);
+    }
+}
+
+static bool is_valid_id(const char* id, size_t size)
+{
+    return id != NULL && id[0] != '\0' && memchr(id, '\0', size) != NULL;
+}
+
+static bool is_valid_type(CallType type)
+{
+    return type >= CALL_TYPE_INCOMING && type < CALL_TYPE_COUNT;
+}
+
+static sqlite3_int64 sql_limit(size_t limit)
+{
+    // Zero means no limit, which SQLite spells as a negative LIMIT.
+    return limit == 0 || limit > INT64_MAX ? -1 : (sqlite3_int64)limit;
+}
+
+/*
+ * SQLite does not bound an index range by a row value, so a cursor also
+ * lowers the upper timestamp bound ?2 and the row value only sorts out the
+ * entries sharing the cursor's timestamp. A contact narrows more than the
+ * read state, the unary + keeps the planner off idx_call_history_read then.
+ */
+static void build_query(unsigned shape, char* sql, size_t size)
+{
+    snprintf(sql, size,
+             "SELECT " HISTORY_COLUMNS " FROM call_history WHERE timestamp BETWEEN ?1 AND ?2%s%s%s%s "
+             "ORDER BY timestamp DESC, id DESC LIMIT ?8 OFFSET ?9;",
+             (shape & SHAPE_CONTACT) != 0 ? " AND contact_id = ?3" : "",
+             (shape & SHAPE_TYPE) != 0 ? " AND type = ?4" : "",
+             (shape & SHAPE_READ) == 0 ? "" : (shape & SHAPE_CONTACT) != 0 ? " AND +is_read = ?5" : " AND is_read = ?5",
+             (shape & SHAPE_CURSOR) != 0 ? " AND (timestamp, id) < (?6, ?7)" : "");
+}
+
+static ErrorCode resolve_filter(const CallHistoryFilter* filter, ResolvedFilter* resolved)
+{
+    memset(resolved, 0, sizeof(ResolvedFilter));
+    resolved->start_date = INT64_MIN;
+    resolved->end_date = INT64_MAX;
+    if (filter == NULL)
+    {
+        return ERROR_NONE;
+    }
+
+    if (memchr(filter->contact_id, '\0', CONTACT_ID_LENGTH) == NULL
+        || (filter->type != CALL_TYPE_ANY && !is_valid_type(filter->type)))
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    resolved->start_date = filter->start_date != 0 ? filter->start_date : INT64_MIN;
+    resolved->end_date = filter->end_date != 0 ? filter->end_date : INT64_MAX;
+    if (filter->contact_id[0] != '\0')
+    {
+        resolved->shape |= SHAPE_CONTACT;
+        resolved->contact_id = filter->contact_id;
+    }
+    if (filter->type != CALL_TYPE_ANY)
+    {
+        resolved->shape |= SHAPE_TYPE;
+        resolved->type = filter->type;
+    }
+    if (filter->include_read != filter->include_unread)
+    {
+        resolved->shape |= SHAPE_READ;
+        resolved->is_read = filter->include_read ? 1 : 0;
+    }
+
+    resolved->matches_nothing = (!filter->include_read && !filter->include_unread)
+        || resolved->start_date > resolved->end_date;
+    return ERROR_NONE;
+}
+
+static ErrorCode append_entry(EntryBuffer* buffer, sqlite3_stmt* stmt)
+{
+    if (buffer->count == buffer->capacity)
+    {
+        const size_t capacity = buffer->capacity == 0 ? HISTORY_INITIAL_CAPACITY : buffer->capacity * 2;
+        CallHistoryEntry* items = realloc(buffer->items, capacity * sizeof(CallHistoryEntry));
+        if (items == NULL)
+        {
+            return ERROR_MEMORY_ALLOCATION;
+        }
+        buffer->items = items;
+        buffer->capacity = capacity;
+    }
+
+    CallHistoryEntry* entry = &buffer->items[buffer->count++];
+    memset(entry, 0, sizeof(CallHistoryEntry));
+    const char* call_id = (const char*)sqlite3_column_text(stmt, 1);
+    const char* contact_id = (const char*)sqlite3_column_text(stmt, 2);
+    strncpy(entry->call_id, call_id != NULL ? call_id : "", CALL_ID_LENGTH - 1);
+    strncpy(entry->contact_id, contact_id != NULL ? contact_id : "", CONTACT_ID_LENGTH - 1);
+    entry->timestamp = sqlite3_column_int64(stmt, 3);
+    entry->type = (CallType)sqlite3_column_int(stmt, 4);
+    entry->duration = (uint32_t)sqlite3_column_int64(stmt, 5);
+    entry->is_read = sqlite3_column_int(stmt, 6) != 0;
+
+    buffer->before_last = buffer->last;
+    buffer->last.id = sqlite3_column_int64(stmt, 0);
+    buffer->last.timestamp = entry->timestamp;
+    return ERROR_NONE;
+}
+
+/**
+ * Runs the query of the filter's shape. Every shape is one index range read
+ * in (timestamp, id) order, see call_history_check_query_plans.
+ */
+static ErrorCode query_history(const ResolvedFilter* filter, const HistoryPosition* after, size_t limit,
+                               size_t offset, EntryBuffer* buffer)
+{
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    if (filter->matches_nothing)
+    {
+        return ERROR_NONE;
+    }
+
+    const unsigned shape = filter->shape | (after != NULL ? SHAPE_CURSOR : 0u);
+    char sql[HISTORY_QUERY_LENGTH];
+    build_query(shape, sql, sizeof(sql));
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    sqlite3_bind_int64(stmt, 1, filter->start_date);
+    sqlite3_bind_int64(stmt, 2, after != NULL && after->timestamp < filter->end_date ? after->timestamp : filter->end_date);
+    if ((shape & SHAPE_CONTACT) != 0)
+    {
+        sqlite3_bind_text(stmt, 3, filter->contact_id, -1, SQLITE_STATIC);
+    }
+    if ((shape & SHAPE_TYPE) != 0)
+    {
+        sqlite3_bind_int(stmt, 4, filter->type);
+    }
+    if ((shape & SHAPE_READ) != 0)
+    {
+        sqlite3_bind_int(stmt, 5, filter->is_read);
+    }
+    if ((shape & SHAPE_CURSOR) != 0)
+    {
+        sqlite3_bind_int64(stmt, 6, after->timestamp);
+        sqlite3_bind_int64(stmt, 7, after->id);
+    }
+    sqlite3_bind_int64(stmt, 8, sql_limit(limit));
+    sqlite3_bind_int64(stmt, 9, offset > INT64_MAX ? INT64_MAX : (sqlite3_int64)offset);
+
+    ErrorCode error = ERROR_NONE;
+    int step;
+    while (error == ERROR_NONE && (step = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        error = append_entry(buffer, stmt);
+    }
+
+    if (error == ERROR_NONE && step != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+
+    sqlite3_finalize(stmt);
+    return error;
+}
+
+static void encode_cursor(const HistoryPosition* position, CallHistoryCursor* cursor)
+{
+    snprintf(cursor->token, CALL_HISTORY_CURSOR_LENGTH, "%d:%" PRId64 ":%" PRId64, CURSOR_VERSION,
+             position->timestamp, position->id);
+}
+
+// Pages are read with one entry more than they hold, the extra entry only tells that another page follows.
+static size_t page_query_limit(size_t limit)
+{
+    return limit < SIZE_MAX ? limit + 1 : limit;
+}
+
+static void deliver_page(EntryBuffer* buffer, size_t limit, CallHistoryPageCallback callback)
+{
+    CallHistoryCursor next_cursor;
+    const bool has_more = buffer->count > limit;
+    if (has_more)
+    {
+        buffer->count = limit;
+        encode_cursor(&buffer->before_last, &next_cursor);
+    }
+
+    callback(buffer->items, buffer->count, has_more ? &next_cursor : NULL, ERROR_NONE);
+    free(buffer->items);
+}
+
+static bool decode_cursor(const CallHistoryCursor* cursor, HistoryPosition* position)
+{
+    if (memchr(cursor->token, '\0', CALL_HISTORY_CURSOR_LENGTH) == NULL)
+    {
+        return false;
+    }
+
+    int version = 0;
+    int consumed = 0;
+    if (sscanf(cursor->token, "%d:%" SCNd64 ":%" SCNd64 "%n", &version, &position->timestamp, &position->id,
+               &consumed) != 3)
+    {
+        return false;
+    }
+    return version == CURSOR_VERSION && cursor->token[consumed] == '\0';
+}
+
+void fetch_call_history(const CallHistoryFilter* filter, size_t limit, size_t offset, FetchHistoryCallback callback)
+{
+    if (callback == NULL)
+    {
+        return;
+    }
+
+    ResolvedFilter resolved;
+    ErrorCode error = resolve_filter(filter, &resolved);
+    if (error != ERROR_NONE)
+    {
+        callback(NULL, 0, error);
+        return;
+    }
+
+    EntryBuffer buffer = {0};
+    error = query_history(&resolved, NULL, limit, offset, &buffer);
+    if (error == ERROR_NONE)
+    {
+        callback(buffer.items, buffer.count, ERROR_NONE);
+    }
+    else
+    {
+        callback(NULL, 0, error);
+    }
+    free(buffer.items);
+}
+
+void fetch_call_history_page(const CallHistoryFilter* filter, const CallHistoryCursor* cursor, size_t limit,
+                             CallHistoryPageCallback callback)
+{
+    if (callback == NULL)
+    {
+        return;
+    }
+
+    ResolvedFilter resolved;
+    HistoryPosition position;
+    if (limit == 0 || resolve_filter(filter, &resolved) != ERROR_NONE
+        || (cursor != NULL && !decode_cursor(cursor, &position)))
+    {
+        callback(NULL, 0, NULL, ERROR_INVALID_PARAMS);
+        return;
+    }
+
+    EntryBuffer buffer = {0};
+    const ErrorCode error =
+        query_history(&resolved, cursor != NULL ? &position : NULL, page_query_limit(limit), 0, &buffer);
+    if (error != ERROR_NONE)
+    {
+        free(buffer.items);
+        callback(NULL, 0, NULL, error);
+        return;
+    }
+
+    deliver_page(&buffer, limit, callback);
+}
+
+static ErrorCode execute_entry_statement(const char* sql, const char* call_id)
+{
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    sqlite3_bind_text(stmt, 1, call_id, -1, SQLITE_STATIC);
+    ErrorCode error = ERROR_NONE;
+    if (sqlite3_step(stmt) != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+    else if (sqlite3_changes(handle) == 0)
+    {
+        error = DB_ERROR_NOT_FOUND;
+    }
+    sqlite3_finalize(stmt);
+    return error;
+}
+
+void add_call_history_entry(const CallHistoryEntry* entry, OperationCallback callback)
+{
+    if (entry == NULL || !is_valid_id(entry->call_id, CALL_ID_LENGTH)
+        || !is_valid_id(entry->contact_id, CONTACT_ID_LENGTH) || !is_valid_type(entry->type))
+    {
+        notify(callback, ERROR_INVALID_PARAMS);
+        return;
+    }
+
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        notify(callback, DB_ERROR_INITIALIZATION);
+        return;
+    }
+
+    // The entry of a call usually follows its end, its quality summary goes in first.
+    call_stats_store_pending();
+
+    const char* sql = "INSERT INTO call_history (call_id, contact_id, timestamp, type, duration, is_read) "
+                      "VALUES (?, ?, ?, ?, ?, ?);";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        notify(callback, DB_ERROR_QUERY);
+        return;
+    }
+
+    sqlite3_bind_text(stmt, 1, entry->call_id, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, entry->contact_id, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 3, entry->timestamp);
+    sqlite3_bind_int(stmt, 4, entry->type);
+    sqlite3_bind_int64(stmt, 5, entry->duration);
+    sqlite3_bind_int(stmt, 6, entry->is_read ? 1 : 0);
+
+    ErrorCode error = ERROR_NONE;
+    const int step = sqlite3_step(stmt);
+    if ((step & 0xFF) == SQLITE_CONSTRAINT)
+    {
+        error = ERROR_INVALID_PARAMS;
+    }
+    else if (step != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+    sqlite3_finalize(stmt);
+    notify(callback, error);
+}
+
+void mark_call_history_read(const char* call_id, OperationCallback callback)
+{
+    if (!is_valid_id(call_id, CALL_ID_LENGTH))
+    {
+        notify(callback, ERROR_INVALID_PARAMS);
+        return;
+    }
+
+    notify(callback, execute_entry_statement("UPDATE call_history SET is_read = 1 WHERE call_id = ?;", call_id));
+}
+
+void delete_call_history_entry(const char* call_id, OperationCallback callback)
+{
+    if (!is_valid_id(call_id, CALL_ID_LENGTH))
+    {
+        notify(callback, ERROR_INVALID_PARAMS);
+        return;
+    }
+
+    notify(callback, execute_entry_statement("DELETE FROM call_history WHERE call_id = ?;", call_id));
+}
+
+void get_call_details(const char* call_id, GetCallDetailsCallback callback)
+{
+    if (callback == NULL)
+    {
+        return;
+    }
+
+    if (!is_valid_id(call_id, CALL_ID_LENGTH))
+    {
+        callback(NULL, ERROR_INVALID_PARAMS);
+        return;
+    }
+
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        callback(NULL, DB_ERROR_INITIALIZATION);
+        return;
+    }
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(handle, "SELECT " HISTORY_COLUMNS " FROM call_history WHERE call_id = ?;", -1, &stmt,
+                           NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        callback(NULL, DB_ERROR_QUERY);
+        return;
+    }
+
+    sqlite3_bind_text(stmt, 1, call_id, -1, SQLITE_STATIC);
+    EntryBuffer buffer = {0};
+    ErrorCode error = ERROR_NONE;
+    const int step = sqlite3_step(stmt);
+    if (step == SQLITE_ROW)
+    {
+        error = append_entry(&buffer, stmt);
+    }
+    else if (step == SQLITE_DONE)
+    {
+        error = DB_ERROR_NOT_FOUND;
+    }
+    else
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+    sqlite3_finalize(stmt);
+
+    callback(error == ERROR_NONE ? &buffer.items[0] : NULL, error);
+    free(buffer.items);
+}
+
+typedef struct {
+    sqlite3_stmt* insert;
+    ErrorCode error;
+    size_t count;
+} SearchContacts;
+
+static bool add_search_contact(const void* payload, void* context)
+{
+    SearchContacts* contacts = context;
+    const Contact* contact = payload;
+
+    sqlite3_bind_text(contacts->insert, 1, contact->contact_id, -1, SQLITE_STATIC);
+    if (sqlite3_step(contacts->insert) != SQLITE_DONE)
+    {
+        contacts->error = DB_ERROR_QUERY;
+        return false;
+    }
+    sqlite3_reset(contacts->insert);
+    contacts->count++;
+    return true;
+}
+
+// Resolves the query through the contact name index into temp.call_history_search.
+static ErrorCode load_search_contacts(sqlite3* handle, const char* query, size_t* count)
+{
+    const char* setup =
+        "CREATE TEMP TABLE IF NOT EXISTS call_history_search (contact_id TEXT PRIMARY KEY) WITHOUT ROWID;"
+        "DELETE FROM temp.call_history_search;";
+    if (sqlite3_exec(handle, setup, NULL, NULL, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    SearchContacts contacts = {0};
+    const char* sql = "INSERT OR IGNORE INTO temp.call_history_search (contact_id) VALUES (?);";
+    if (sqlite3_prepare_v2(handle, sql, -1, &contacts.insert, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    ErrorCode error = contact_search_visit(query, add_search_contact, &contacts);
+    if (error == ERROR_NONE && contacts.error != ERROR_NONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = contacts.error;
+    }
+    sqlite3_finalize(contacts.insert);
+
+    *count = contacts.count;
+    return error;
+}
+
+/*
+ * Reading the matching contacts' calls through idx_call_history_contact
+ * and sorting them costs about their number. Walking idx_call_history_time
+ * and probing each entry's contact costs about limit * total / matched.
+ * The rollups know the matched calls, the span of row IDs estimates the
+ * total without counting. The cheaper walk wins.
+ */
+static ErrorCode prefer_contact_walk(sqlite3* handle, size_t limit, bool* by_contact)
+{
+    const char* sql = "SELECT "
+                      "(SELECT COALESCE(SUM(call_count), 0) FROM call_rollup_contact "
+                      "WHERE contact_id IN (SELECT contact_id FROM temp.call_history_search)), "
+                      "(SELECT MAX(id) FROM call_history) - (SELECT MIN(id) FROM call_history) + 1;";
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    ErrorCode error = ERROR_NONE;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        const double matched = (double)sqlite3_column_int64(stmt, 0);
+        const double total = (double)sqlite3_column_int64(stmt, 1);
+        *by_contact = limit == 0 || matched * matched <= (double)limit * total;
+    }
+    else
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+    sqlite3_finalize(stmt);
+    return error;
+}
+
+/*
+ * The semi-join keeps the parameter numbers of build_query. The unary +
+ * takes the contact condition off idx_call_history_contact when walking
+ * the time index.
+ */
+static ErrorCode query_search(sqlite3* handle, const HistoryPosition* after, size_t limit, EntryBuffer* buffer)
+{
+    bool by_contact = true;
+    ErrorCode error = prefer_contact_walk(handle, limit, &by_contact);
+    if (error != ERROR_NONE)
+    {
+        return error;
+    }
+
+    char sql[HISTORY_QUERY_LENGTH];
+    snprintf(sql, sizeof(sql),
+             "SELECT " HISTORY_COLUMNS " FROM call_history WHERE timestamp BETWEEN ?1 AND ?2 "
+             "AND %scontact_id IN (SELECT contact_id FROM temp.call_history_search)%s "
+             "ORDER BY timestamp DESC, id DESC LIMIT ?8;",
+             by_contact ? "" : "+", after != NULL ? " AND (timestamp, id) < (?6, ?7)" : "");
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    sqlite3_bind_int64(stmt, 1, INT64_MIN);
+    sqlite3_bind_int64(stmt, 2, after != NULL ? after->timestamp : INT64_MAX);
+    if (after != NULL)
+    {
+        sqlite3_bind_int64(stmt, 6, after->timestamp);
+        sqlite3_bind_int64(stmt, 7, after->id);
+    }
+    sqlite3_bind_int64(stmt, 8, sql_limit(limit));
+
+    int step;
+    while (error == ERROR_NONE && (step = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        error = append_entry(buffer, stmt);
+    }
+
+    if (error == ERROR_NONE && step != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+
+    sqlite3_finalize(stmt);
+    return error;
+}
+
+/*
+ * A savepoint makes the matching contacts, the rollup counts and the page
+ * one snapshot. Only the temp schema is written, other writers go on.
+ */
+static ErrorCode search_history(const char* query, const HistoryPosition* after, size_t limit, EntryBuffer* buffer)
+{
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    if (sqlite3_exec(handle, "SAVEPOINT call_history_search;", NULL, NULL, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_TRANSACTION;
+    }
+
+    size_t contact_count = 0;
+    ErrorCode error = load_search_contacts(handle, query, &contact_count);
+    if (error == ERROR_NONE && contact_count > 0)
+    {
+        error = query_search(handle, after, limit, buffer);
+    }
+
+    if (error != ERROR_NONE)
+    {
+        sqlite3_exec(handle, "ROLLBACK TO call_history_search;", NULL, NULL, NULL);
+    }
+    sqlite3_exec(handle, "RELEASE call_history_search;", NULL, NULL, NULL);
+    return error;
+}
+
+void search_call_history(const char* query, FetchHistoryCallback callback)
+{
+    if (callback == NULL)
+    {
+        return;
+    }
+
+    if (query == NULL)
+    {
+        callback(NULL, 0, ERROR_INVALID_PARAMS);
+        return;
+    }
+
+    EntryBuffer buffer = {0};
+    const ErrorCode error = search_history(query, NULL, 0, &buffer);
+    if (error == ERROR_NONE)
+    {
+        callback(buffer.items, buffer.count, ERROR_NONE);
+    }
+    else
+    {
+        callback(NULL, 0, error);
+    }
+    free(buffer.items);
+}
+
+void search_call_history_page(const char* query, const CallHistoryCursor* cursor, size_t limit,
+                              CallHistoryPageCallback callback)
+{
+    if (callback == NULL)
+    {
+        return;
+    }
+
+    HistoryPosition position;
+    if (query == NULL || limit == 0 || (cursor != NULL && !decode_cursor(cursor, &position)))
+    {
+        callback(NULL, 0, NULL, ERROR_INVALID_PARAMS);
+        return;
+    }
+
+    EntryBuffer buffer = {0};
+    const ErrorCode error = search_history(query, cursor != NULL ? &position : NULL, page_query_limit(limit), &buffer);
+    if (error != ERROR_NONE)
+    {
+        free(buffer.items);
+        callback(NULL, 0, NULL, error);
+        return;
+    }
+
+    deliver_page(&buffer, limit, callback);
+}
+
+/*
+ * Lifetime statistics of a contact are one row per type, any other request
+ * sums the day rollups of its range. The day numbers match the triggers'
+ * timestamp / 86400.
+ */
+ErrorCode get_call_stats(const char* contact_id, int64_t start_date, int64_t end_date, CallStats* stats)
+{
+    const bool by_contact = contact_id != NULL && contact_id[0] != '\0';
+    if (stats == NULL || (by_contact && !is_valid_id(contact_id, CONTACT_ID_LENGTH))
+        || (start_date != 0 && end_date != 0 && start_date > end_date))
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    const char* sql;
+    if (by_contact && start_date == 0 && end_date == 0)
+    {
+        sql = "SELECT type, call_count, total_duration FROM call_rollup_contact WHERE contact_id = ?1;";
+    }
+    else if (by_contact)
+    {
+        sql = "SELECT type, SUM(call_count), SUM(total_duration) FROM call_rollup_contact_day "
+              "WHERE contact_id = ?1 AND day BETWEEN ?2 AND ?3 GROUP BY type;";
+    }
+    else
+    {
+        sql = "SELECT type, SUM(call_count), SUM(total_duration) FROM call_rollup_day "
+              "WHERE day BETWEEN ?2 AND ?3 GROUP BY type;";
+    }
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    if (by_contact)
+    {
+        sqlite3_bind_text(stmt, 1, contact_id, -1, SQLITE_STATIC);
+    }
+    sqlite3_bind_int64(stmt, 2, start_date != 0 ? start_date / SECONDS_PER_DAY : INT64_MIN);
+    sqlite3_bind_int64(stmt, 3, end_date != 0 ? end_date / SECONDS_PER_DAY : INT64_MAX);
+
+    memset(stats, 0, sizeof(CallStats));
+    int step;
+    while ((step = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        const CallType type = (CallType)sqlite3_column_int(stmt, 0);
+        if (!is_valid_type(type))
+        {
+            continue;
+        }
+
+        CallTypeStats* type_stats = &stats->by_type[type];
+        type_stats->call_count = (uint32_t)sqlite3_column_int64(stmt, 1);
+        type_stats->total_duration = (uint64_t)sqlite3_column_int64(stmt, 2);
+        stats->total.call_count += type_stats->call_count;
+        stats->total.total_duration += type_stats->total_duration;
+    }
+
+    ErrorCode error = ERROR_NONE;
+    if (step != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        memset(stats, 0, sizeof(CallStats));
+        error = DB_ERROR_QUERY;
+    }
+    sqlite3_finalize(stmt);
+    return error;
+}
+
+ErrorCode call_history_check_query_plans()
+{
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    ErrorCode error = ERROR_NONE;
+    for (unsigned shape = 0; shape < SHAPE_COUNT; shape++)
+    {
+        char sql[HISTORY_QUERY_LENGTH + 32];
+        memcpy(sql, "EXPLAIN QUERY PLAN ", sizeof("EXPLAIN QUERY PLAN "));
+        build_query(shape, sql + strlen(sql), HISTORY_QUERY_LENGTH);
+
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+        {
+            fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+            return DB_ERROR_QUERY;
+        }
+
+        // Column 3 holds the plan step, e.g. "SEARCH call_history USING INDEX ...".
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            const char* detail = (const char*)sqlite3_column_text(stmt, 3);
+            if (detail != NULL && (strncmp(detail, "SCAN", 4) == 0 || strstr(detail, "TEMP B-TREE") != NULL))
+            {
+                fprintf(stderr, "Call history query shape %u is not indexed: %s\n", shape, detail);
+                error = DB_ERROR_SCHEMA;
+            }
+        }
+        sqlite3_finalize(stmt);
+    }
+    return error;
+}
@@ -0,0 +1,497 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "libmessagekit/call_history.h"
+#include "database.h"
+
+#include <ctype.h>
+#include <pthread.h>
+
+// Room for an entry's numbers, type and punctuation, the IDs come on top.
+#define EXPORT_ROW_FIXED_SIZE 192
+
+typedef enum {
+    EXPORT_FORMAT_CSV,
+    EXPORT_FORMAT_JSON,
+    EXPORT_FORMAT_NDJSON
+} ExportFormat;
+
+static const char* const FORMAT_NAMES[] = {
+    [EXPORT_FORMAT_CSV] = "CSV",
+    [EXPORT_FORMAT_JSON] = "JSON",
+    [EXPORT_FORMAT_NDJSON] = "NDJSON",
+};
+
+static const char* const TYPE_NAMES[] = {
+    [CALL_TYPE_INCOMING] = "incoming",
+    [CALL_TYPE_OUTGOING] = "outgoing",
+    [CALL_TYPE_MISSED] = "missed",
+    [CALL_TYPE_REJECTED] = "rejected",
+};
+
+/**
+ * Writes filled buffers on a background thread while the next one is
+ * encoded. At most one buffer is pending, so two buffers are enough. If the
+ * thread cannot be started, buffers are written on the calling thread.
+ */
+typedef struct {
+    FILE* stream;
+    pthread_t thread;
+    bool has_thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    const char* pending;
+    size_t pending_size;
+    bool stopping;
+    bool failed;
+} BufferedWriter;
+
+typedef struct {
+    ExportFormat format;
+    BufferedWriter writer;
+    char* buffers[2];
+    int current;
+    size_t used;
+} Exporter;
+
+static void notify(OperationCallback callback, ErrorCode error)
+{
+    if (callback != NULL)
+    {
+        callback(error);
+    }
+}
+
+static bool parse_format(const char* name, ExportFormat* format)
+{
+    for (size_t i = 0; i < sizeof(FORMAT_NAMES) / sizeof(FORMAT_NAMES[0]); i++)
+    {
+        size_t c = 0;
+        while (name[c] != '\0' && toupper((unsigned char)name[c]) == FORMAT_NAMES[i][c])
+        {
+            c++;
+        }
+        if (name[c] == '\0' && FORMAT_NAMES[i][c] == '\0')
+        {
+            *format = (ExportFormat)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void* writer_main(void* argument)
+{
+    BufferedWriter* writer = argument;
+    pthread_mutex_lock(&writer->lock);
+    for (;;)
+    {
+        while (writer->pending == NULL && !writer->stopping)
+        {
+            pthread_cond_wait(&writer->changed, &writer->lock);
+        }
+        if (writer->pending == NULL)
+        {
+            break;
+        }
+
+        const char* data = writer->pending;
+        const size_t size = writer->pending_size;
+        pthread_mutex_unlock(&writer->lock);
+        const bool written = fwrite(data, 1, size, writer->stream) == size;
+        pthread_mutex_lock(&writer->lock);
+
+        writer->failed = writer->failed || !written;
+        writer->pending = NULL;
+        pthread_cond_broadcast(&writer->changed);
+    }
+    pthread_mutex_unlock(&writer->lock);
+    return NULL;
+}
+
+static void writer_start(BufferedWriter* writer, FILE* stream)
+{
+    memset(writer, 0, sizeof(BufferedWriter));
+    writer->stream = stream;
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->changed, NULL);
+    writer->has_thread = pthread_create(&writer->thread, NULL, writer_main, writer) == 0;
+}
+
+/**
+ * Hands a buffer to the writer. Returns once the previous buffer is written,
+ * so the caller may reuse that one.
+ */
+static bool writer_submit(BufferedWriter* writer, const char* data, size_t size)
+{
+    if (!writer->has_thread)
+    {
+        writer->failed = writer->failed || fwrite(data, 1, size, writer->stream) != size;
+        return !writer->failed;
+    }
+
+    pthread_mutex_lock(&writer->lock);
+    while (writer->pending != NULL)
+    {
+        pthread_cond_wait(&writer->changed, &writer->lock);
+    }
+    if (!writer->failed)
+    {
+        writer->pending = data;
+        writer->pending_size = size;
+        pthread_cond_broadcast(&writer->changed);
+    }
+    const bool ok = !writer->failed;
+    pthread_mutex_unlock(&writer->lock);
+    return ok;
+}
+
+// Waits for the last buffer and stops the thread.
+static bool writer_finish(BufferedWriter* writer)
+{
+    if (writer->has_thread)
+    {
+        pthread_mutex_lock(&writer->lock);
+        writer->stopping = true;
+        pthread_cond_broadcast(&writer->changed);
+        pthread_mutex_unlock(&writer->lock);
+        pthread_join(writer->thread, NULL);
+    }
+
+    pthread_mutex_destroy(&writer->lock);
+    pthread_cond_destroy(&writer->changed);
+    return !writer->failed;
+}
+
+static bool exporter_flush(Exporter* exporter)
+{
+    if (exporter->used == 0)
+    {
+        return true;
+    }
+
+    const bool ok = writer_submit(&exporter->writer, exporter->buffers[exporter->current], exporter->used);
+    exporter->current ^= 1;
+    exporter->used = 0;
+    return ok;
+}
+
+static char* put_text(char* cursor, const char* text)
+{
+    const size_t length = strlen(text);
+    memcpy(cursor, text, length);
+    return cursor + length;
+}
+
+static char* put_int(char* cursor, int64_t value)
+{
+    char digits[20];
+    size_t count = 0;
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    do
+    {
+        digits[count++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+
+    if (value < 0)
+    {
+        *cursor++ = '-';
+    }
+    while (count > 0)
+    {
+        *cursor++ = digits[--count];
+    }
+    return cursor;
+}
+
+static char* put_json_string(char* cursor, const char* text)
+{
+    static const char HEX[] = "0123456789abcdef";
+    *cursor++ = '"';
+    for (const unsigned char* c = (const unsigned char*)text; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            *cursor++ = '\\';
+            *cursor++ = (char)*c;
+        }
+        else if (*c < 0x20)
+        {
+            cursor = put_text(cursor, "\\u00");
+            *cursor++ = HEX[*c >> 4];
+            *cursor++ = HEX[*c & 0xF];
+        }
+        else
+        {
+            *cursor++ = (char)*c;
+        }
+    }
+    *cursor++ = '"';
+    return cursor;
+}
+
+// RFC 4180, fields with separators, quotes or line breaks are quoted and quotes doubled.
+static char* put_csv_field(char* cursor, const char* text)
+{
+    if (strpbrk(text, ",\"\r\n") == NULL)
+    {
+        return put_text(cursor, text);
+    }
+
+    *cursor++ = '"';
+    for (const char* c = text; *c != '\0'; c++)
+    {
+        if (*c == '"')
+        {
+            *cursor++ = '"';
+        }
+        *cursor++ = *c;
+    }
+    *cursor++ = '"';
+    return cursor;
+}
+
+static const char* column_text(sqlite3_stmt* stmt, int column)
+{
+    const char* text = (const char*)sqlite3_column_text(stmt, column);
+    return text != NULL ? text : "";
+}
+
+static void encode_row(Exporter* exporter, sqlite3_stmt* stmt, bool is_first)
+{
+    const int type = sqlite3_column_int(stmt, 3);
+    const char* type_name = type >= CALL_TYPE_INCOMING && type <= CALL_TYPE_REJECTED ? TYPE_NAMES[type] : "unknown";
+    char* cursor = exporter->buffers[exporter->current] + exporter->used;
+
+    if (exporter->format == EXPORT_FORMAT_CSV)
+    {
+        cursor = put_csv_field(cursor, column_text(stmt, 0));
+        *cursor++ = ',';
+        cursor = put_csv_field(cursor, column_text(stmt, 1));
+        *cursor++ = ',';
+        cursor = put_int(cursor, sqlite3_column_int64(stmt, 2));
+        *cursor++ = ',';
+        cursor = put_text(cursor, type_name);
+        *cursor++ = ',';
+        cursor = put_int(cursor, sqlite3_column_int64(stmt, 4));
+        *cursor++ = ',';
+        cursor = put_text(cursor, sqlite3_column_int(stmt, 5) != 0 ? "true" : "false");
+        *cursor++ = '\n';
+    }
+    else
+    {
+        if (exporter->format == EXPORT_FORMAT_JSON)
+        {
+            cursor = put_text(cursor, is_first ? "\n  " : ",\n  ");
+        }
+        cursor = put_text(cursor, "{\"call_id\":");
+        cursor = put_json_string(cursor, column_text(stmt, 0));
+        cursor = put_text(cursor, ",\"contact_id\":");
+        cursor = put_json_string(cursor, column_text(stmt, 1));
+        cursor = put_text(cursor, ",\"timestamp\":");
+        cursor = put_int(cursor, sqlite3_column_int64(stmt, 2));
+        cursor = put_text(cursor, ",\"type\":\"");
+        cursor = put_text(cursor, type_name);
+        cursor = put_text(cursor, "\",\"duration\":");
+        cursor = put_int(cursor, sqlite3_column_int64(stmt, 4));
+        cursor = put_text(cursor, sqlite3_column_int(stmt, 5) != 0 ? ",\"is_read\":true}" : ",\"is_read\":false}");
+        if (exporter->format == EXPORT_FORMAT_NDJSON)
+        {
+            *cursor++ = '\n';
+        }
+    }
+
+    exporter->used = (size_t)(cursor - exporter->buffers[exporter->current]);
+}
+
+static bool exporter_append(Exporter* exporter, const char* text)
+{
+    const size_t length = strlen(text);
+    if (CALL_HISTORY_EXPORT_BUFFER_SIZE - exporter->used < length && !exporter_flush(exporter))
+    {
+        return false;
+    }
+    memcpy(exporter->buffers[exporter->current] + exporter->used, text, length);
+    exporter->used += length;
+    return true;
+}
+
+static ErrorCode count_entries(sqlite3* handle, uint64_t* total)
+{
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(handle, "SELECT COUNT(*) FROM call_history;", -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    ErrorCode error = ERROR_NONE;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        *total = (uint64_t)sqlite3_column_int64(stmt, 0);
+    }
+    else
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+    sqlite3_finalize(stmt);
+    return error;
+}
+
+/**
+ * Steps through the history with one statement and encodes each row into
+ * the current buffer, handing it to the writer once another row might not
+ * fit. Memory stays at two buffers however long the history is.
+ */
+static ErrorCode stream_entries(sqlite3* handle, Exporter* exporter, ExportProgressCallback progress)
+{
+    uint64_t total = 0;
+    ErrorCode error = progress != NULL ? count_entries(handle, &total) : ERROR_NONE;
+    if (error != ERROR_NONE)
+    {
+        return error;
+    }
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(handle,
+                           "SELECT call_id, contact_id, timestamp, type, duration, is_read FROM call_history "
+                           "ORDER BY timestamp DESC, id DESC;",
+                           -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    const char* header = exporter->format == EXPORT_FORMAT_CSV ? "call_id,contact_id,timestamp,type,duration,is_read\n"
+        : exporter->format == EXPORT_FORMAT_JSON ? "[" : "";
+    if (!exporter_append(exporter, header))
+    {
+        error = ERROR_FILE_IO;
+    }
+
+    uint64_t exported = 0;
+    int step = SQLITE_DONE;
+    while (error == ERROR_NONE && (step = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        // An escaped character takes up to six bytes.
+        const size_t row_size = EXPORT_ROW_FIXED_SIZE
+            + 6 * (size_t)(sqlite3_column_bytes(stmt, 0) + sqlite3_column_bytes(stmt, 1));
+        if (row_size > CALL_HISTORY_EXPORT_BUFFER_SIZE)
+        {
+            error = ERROR_INVALID_FORMAT;
+            break;
+        }
+        if (CALL_HISTORY_EXPORT_BUFFER_SIZE - exporter->used < row_size && !exporter_flush(exporter))
+        {
+            error = ERROR_FILE_IO;
+            break;
+        }
+
+        encode_row(exporter, stmt, exported == 0);
+        exported++;
+        if (progress != NULL && exported % CALL_HISTORY_EXPORT_PROGRESS_INTERVAL == 0
+            && !progress(exported, total > exported ? total : exported))
+        {
+            error = ERROR_CANCELLED;
+        }
+    }
+
+    if (error == ERROR_NONE && step != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+    sqlite3_finalize(stmt);
+
+    if (error == ERROR_NONE && exporter->format == EXPORT_FORMAT_JSON
+        && !exporter_append(exporter, exported > 0 ? "\n]\n" : "]\n"))
+    {
+        error = ERROR_FILE_IO;
+    }
+    if (error == ERROR_NONE && !exporter_flush(exporter))
+    {
+        error = ERROR_FILE_IO;
+    }
+    if (error == ERROR_NONE && progress != NULL && !progress(exported, exported))
+    {
+        error = ERROR_CANCELLED;
+    }
+    return error;
+}
+
+void export_call_history_with_progress(const char* format, const char* file_path, ExportProgressCallback progress,
+                                       OperationCallback callback)
+{
+    Exporter exporter = {0};
+    if (format == NULL || file_path == NULL || file_path[0] == '\0')
+    {
+        notify(callback, ERROR_INVALID_PARAMS);
+        return;
+    }
+    if (!parse_format(format, &exporter.format))
+    {
+        notify(callback, ERROR_INVALID_FORMAT);
+        return;
+    }
+
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        notify(callback, DB_ERROR_INITIALIZATION);
+        return;
+    }
+
+    // Written next to the target and renamed over it, a failed export leaves no partial file.
+    char* temporary_path = malloc(strlen(file_path) + sizeof(".tmp"));
+    exporter.buffers[0] = malloc(CALL_HISTORY_EXPORT_BUFFER_SIZE);
+    exporter.buffers[1] = malloc(CALL_HISTORY_EXPORT_BUFFER_SIZE);
+    if (temporary_path == NULL || exporter.buffers[0] == NULL || exporter.buffers[1] == NULL)
+    {
+        free(temporary_path);
+        free(exporter.buffers[0]);
+        free(exporter.buffers[1]);
+        notify(callback, ERROR_MEMORY_ALLOCATION);
+        return;
+    }
+    sprintf(temporary_path, "%s.tmp", file_path);
+
+    ErrorCode error = ERROR_FILE_IO;
+    FILE* stream = fopen(temporary_path, "wb");
+    if (stream != NULL)
+    {
+        // Writes are a buffer each already, stdio would only copy them once more.
+        setvbuf(stream, NULL, _IONBF, 0);
+        writer_start(&exporter.writer, stream);
+        error = stream_entries(handle, &exporter, progress);
+        const bool written = writer_finish(&exporter.writer);
+        if (fclose(stream) != 0 || !written)
+        {
+            error = error == ERROR_NONE ? ERROR_FILE_IO : error;
+        }
+
+        if (error == ERROR_NONE)
+        {
+#ifdef _WIN32
+            remove(file_path);
+#endif
+            error = rename(temporary_path, file_path) == 0 ? ERROR_NONE : ERROR_FILE_IO;
+        }
+        if (error != ERROR_NONE)
+        {
+            remove(temporary_path);
+        }
+    }
+
+    free(temporary_path);
+    free(exporter.buffers[0]);
+    free(exporter.buffers[1]);
+    notify(callback, error);
+}
+
+void export_call_history(const char* format, const char* file_path, OperationCallback callback)
+{
+    export_call_history_with_progress(format, file_path, NULL, callback);
+}
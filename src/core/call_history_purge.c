@@ -0,0 +1,359 @@
+#include "libmessagekit/call_history.h"
+#include "call_stats_store.h"
+#include "database.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SECONDS_PER_DAY 86400
+
+// Entries of the UTC days ?1 to ?2, the days match the rollup triggers' timestamp / 86400.
+#define PURGED_DAYS "timestamp BETWEEN ?1 * 86400 AND ?2 * 86400 + 86399"
+
+// Triggers are dropped for the wipe and created again from their SQL before it commits.
+#define MAX_WIPE_TRIGGERS 16
+
+static const char* const WIPE_STATEMENTS[] = {
+    "DELETE FROM call_quality;",
+    "DELETE FROM call_history;",
+    "DELETE FROM call_rollup_contact_day;",
+    "DELETE FROM call_rollup_contact;",
+    "DELETE FROM call_rollup_day;",
+};
+
+/*
+ * Takes whole days out of the rollups at once: the per contact totals lose
+ * the days' sums, the day rows go entirely. The entries go last, the
+ * statements before read them.
+ */
+static const char* const PURGE_DAYS_STATEMENTS[] = {
+    "UPDATE call_rollup_contact AS rollup "
+    "SET call_count = rollup.call_count - purged.call_count, "
+    "total_duration = rollup.total_duration - purged.total_duration "
+    "FROM (SELECT contact_id, type, COUNT(*) AS call_count, SUM(duration) AS total_duration "
+    "FROM call_history WHERE " PURGED_DAYS " GROUP BY contact_id, type) AS purged "
+    "WHERE rollup.contact_id = purged.contact_id AND rollup.type = purged.type;",
+    "DELETE FROM call_rollup_contact WHERE call_count <= 0 "
+    "AND contact_id IN (SELECT contact_id FROM call_history WHERE " PURGED_DAYS ");",
+    "DELETE FROM call_rollup_contact_day WHERE day BETWEEN ?1 AND ?2 "
+    "AND contact_id IN (SELECT contact_id FROM call_history WHERE " PURGED_DAYS ");",
+    "DELETE FROM call_rollup_day WHERE day BETWEEN ?1 AND ?2;",
+    "DELETE FROM call_quality WHERE call_id IN (SELECT call_id FROM call_history WHERE " PURGED_DAYS ");",
+    "DELETE FROM call_history WHERE " PURGED_DAYS ";",
+};
+
+static const char* const BULK_DELETE_BEGIN = "INSERT INTO call_history_bulk_delete (active) VALUES (1);";
+static const char* const BULK_DELETE_END = "DELETE FROM call_history_bulk_delete;";
+
+static void notify(OperationCallback callback, ErrorCode error)
+{
+    if (callback != NULL)
+    {
+        callback(error);
+    }
+}
+
+static bool run_statement(sqlite3* handle, const char* sql, int64_t first_day, int64_t last_day)
+{
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return false;
+    }
+
+    if (sqlite3_bind_parameter_count(stmt) == 2)
+    {
+        sqlite3_bind_int64(stmt, 1, first_day);
+        sqlite3_bind_int64(stmt, 2, last_day);
+    }
+
+    const bool done = sqlite3_step(stmt) == SQLITE_DONE;
+    if (!done)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+    }
+    sqlite3_finalize(stmt);
+    return done;
+}
+
+/*
+ * The delete triggers of call_history keep the call quality and rollups
+ * right one entry at a time. A bulk delete marks itself in
+ * call_history_bulk_delete, which the triggers check, and its statements
+ * adjust those tables themselves. The mark never outlives the transaction,
+ * and the schema stays as it is, so no prepared statement has to be
+ * prepared again.
+ */
+static ErrorCode run_bulk_delete(sqlite3* handle, const char* const statements[], size_t count, int64_t first_day,
+                                 int64_t last_day)
+{
+    if (db_begin_transaction() != SQLITE_OK)
+    {
+        return DB_ERROR_TRANSACTION;
+    }
+
+    bool done = run_statement(handle, BULK_DELETE_BEGIN, 0, 0);
+    for (size_t i = 0; i < count && done; i++)
+    {
+        done = run_statement(handle, statements[i], first_day, last_day);
+    }
+    done = done && run_statement(handle, BULK_DELETE_END, 0, 0);
+
+    if (!done)
+    {
+        db_rollback_transaction();
+        return DB_ERROR_QUERY;
+    }
+
+    if (db_commit_transaction() != SQLITE_OK)
+    {
+        db_rollback_transaction();
+        return DB_ERROR_TRANSACTION;
+    }
+    return ERROR_NONE;
+}
+
+/*
+ * Picks the oldest whole UTC days before before_day whose entries fit in
+ * one chunk, at least one day however many entries it has. The day
+ * rollups have the counts, no entry is read.
+ */
+static ErrorCode next_purge_days(sqlite3* handle, int64_t before_day, int64_t* first_day, int64_t* last_day,
+                                 bool* found)
+{
+    sqlite3_stmt* stmt;
+    const char* sql = "SELECT day, SUM(call_count) FROM call_rollup_day WHERE day >= 0 AND day < ? "
+                      "GROUP BY day ORDER BY day;";
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    sqlite3_bind_int64(stmt, 1, before_day);
+    *found = false;
+    sqlite3_int64 total = 0;
+    int step;
+    while ((step = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        const sqlite3_int64 count = sqlite3_column_int64(stmt, 1);
+        if (*found && total + count > CALL_HISTORY_PURGE_CHUNK)
+        {
+            break;
+        }
+
+        *last_day = sqlite3_column_int64(stmt, 0);
+        if (!*found)
+        {
+            *first_day = *last_day;
+            *found = true;
+        }
+        total += count;
+    }
+
+    const ErrorCode error = step == SQLITE_ROW || step == SQLITE_DONE ? ERROR_NONE : DB_ERROR_QUERY;
+    if (error != ERROR_NONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+    }
+    sqlite3_finalize(stmt);
+    return error;
+}
+
+// Deletes the remaining entries before the cutoff in chunks, the trigger keeps the rollups right.
+static ErrorCode purge_remaining(sqlite3* handle, int64_t before)
+{
+    sqlite3_stmt* stmt;
+    const char* sql = "DELETE FROM call_history WHERE id IN "
+                      "(SELECT id FROM call_history WHERE timestamp < ? ORDER BY timestamp LIMIT ?);";
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    sqlite3_bind_int64(stmt, 1, before);
+    sqlite3_bind_int(stmt, 2, CALL_HISTORY_PURGE_CHUNK);
+
+    ErrorCode error = ERROR_NONE;
+    for (;;)
+    {
+        if (sqlite3_step(stmt) != SQLITE_DONE)
+        {
+            fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+            error = DB_ERROR_QUERY;
+            break;
+        }
+        sqlite3_reset(stmt);
+
+        if (sqlite3_changes(handle) == 0)
+        {
+            break;
+        }
+    }
+
+    sqlite3_finalize(stmt);
+    return error;
+}
+
+/*
+ * Stores the SQL of every trigger on call_history and drops them. Even a
+ * trigger whose WHEN clause is false makes SQLite delete one row at a time
+ * and run the clause for each, without any DELETE FROM call_history empties
+ * the table at once.
+ */
+static bool drop_history_triggers(sqlite3* handle, char* trigger_sql[], size_t* count)
+{
+    sqlite3_stmt* stmt;
+    const char* sql = "SELECT name, sql FROM sqlite_schema WHERE type = 'trigger' AND tbl_name = 'call_history';";
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return false;
+    }
+
+    bool done = true;
+    int step;
+    while (done && (step = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        const char* trigger = (const char*)sqlite3_column_text(stmt, 1);
+        if (*count == MAX_WIPE_TRIGGERS || trigger == NULL)
+        {
+            fprintf(stderr, "Cannot keep the triggers of call_history\n");
+            done = false;
+            break;
+        }
+
+        const size_t length = strlen(trigger) + 1;
+        char* drop_sql = sqlite3_mprintf("DROP TRIGGER \"%w\";", (const char*)sqlite3_column_text(stmt, 0));
+        trigger_sql[*count] = malloc(length);
+        if (trigger_sql[*count] == NULL || drop_sql == NULL)
+        {
+            free(trigger_sql[*count]);
+            sqlite3_free(drop_sql);
+            done = false;
+            break;
+        }
+
+        memcpy(trigger_sql[(*count)++], trigger, length);
+        done = run_statement(handle, drop_sql, 0, 0);
+        sqlite3_free(drop_sql);
+    }
+
+    if (done && step != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        done = false;
+    }
+    sqlite3_finalize(stmt);
+    return done;
+}
+
+/*
+ * Empties the call history and everything derived from it. Unlike a purge
+ * it drops the triggers of call_history for the time of the transaction,
+ * so the table is emptied at once rather than row by row. Other readers
+ * never see the schema without them, their statements are prepared again
+ * once, on their next step.
+ */
+static ErrorCode wipe_call_history(sqlite3* handle)
+{
+    if (db_begin_transaction() != SQLITE_OK)
+    {
+        return DB_ERROR_TRANSACTION;
+    }
+
+    char* trigger_sql[MAX_WIPE_TRIGGERS];
+    size_t trigger_count = 0;
+    bool done = drop_history_triggers(handle, trigger_sql, &trigger_count);
+    for (size_t i = 0; i < sizeof(WIPE_STATEMENTS) / sizeof(WIPE_STATEMENTS[0]) && done; i++)
+    {
+        done = run_statement(handle, WIPE_STATEMENTS[i], 0, 0);
+    }
+    for (size_t i = 0; i < trigger_count; i++)
+    {
+        done = done && run_statement(handle, trigger_sql[i], 0, 0);
+        free(trigger_sql[i]);
+    }
+
+    if (!done)
+    {
+        db_rollback_transaction();
+        return DB_ERROR_QUERY;
+    }
+
+    if (db_commit_transaction() != SQLITE_OK)
+    {
+        db_rollback_transaction();
+        return DB_ERROR_TRANSACTION;
+    }
+    return ERROR_NONE;
+}
+
+void delete_all_call_history(OperationCallback callback)
+{
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        notify(callback, DB_ERROR_INITIALIZATION);
+        return;
+    }
+
+    // Summaries of calls that already ended are deleted with the rest.
+    call_stats_store_pending();
+
+    const ErrorCode error = wipe_call_history(handle);
+    if (error == ERROR_NONE)
+    {
+        db_incremental_vacuum(DB_VACUUM_STEP_PAGES);
+    }
+    notify(callback, error);
+}
+
+/*
+ * Whole UTC days before the cutoff go in bulk, a chunk of days per
+ * transaction. The day of the cutoff and entries before 1970 are left to
+ * purge_remaining.
+ */
+void purge_call_history(int64_t before, OperationCallback callback)
+{
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        notify(callback, DB_ERROR_INITIALIZATION);
+        return;
+    }
+
+    // Summaries of calls that already ended are deleted with the rest.
+    call_stats_store_pending();
+
+    const int64_t before_day = before > 0 ? before / SECONDS_PER_DAY : 0;
+    ErrorCode error = ERROR_NONE;
+    for (;;)
+    {
+        int64_t first_day = 0;
+        int64_t last_day = 0;
+        bool found = false;
+        error = next_purge_days(handle, before_day, &first_day, &last_day, &found);
+        if (error != ERROR_NONE || !found)
+        {
+            break;
+        }
+
+        error = run_bulk_delete(handle, PURGE_DAYS_STATEMENTS,
+                                sizeof(PURGE_DAYS_STATEMENTS) / sizeof(PURGE_DAYS_STATEMENTS[0]), first_day, last_day);
+        if (error != ERROR_NONE)
+        {
+            break;
+        }
+    }
+
+    if (error == ERROR_NONE)
+    {
+        error = purge_remaining(handle, before);
+    }
+
+    db_incremental_vacuum(DB_VACUUM_STEP_PAGES);
+    notify(callback, error);
+}
@@ -0,0 +1,380 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "call_stats.h"
+#include "call_stats_store.h"
+#include "database.h"
+#include "mpsc_ring.h"
+
+#include <sched.h>
+#include <stdatomic.h>
+
+#define STATS_ID_WORDS (CALL_ID_LENGTH / sizeof(uint64_t))
+#define STATS_WINDOW_MASK (CALL_STATS_WINDOW - 1)
+
+_Static_assert((CALL_STATS_WINDOW & STATS_WINDOW_MASK) == 0, "the stats window must be a power of two");
+
+/**
+ * Ring of the latest samples of one metric. Writers claim a position with
+ * one fetch-add and overwrite the oldest sample, the totals are kept with
+ * atomic adds and compare-exchange loops, so several threads may record the
+ * same metric without a lock.
+ */
+typedef struct {
+    _Atomic uint64_t head;
+    _Atomic uint32_t samples[CALL_STATS_WINDOW];
+    _Atomic uint64_t sum;
+    _Atomic uint32_t min;
+    _Atomic uint32_t max;
+} MetricRing;
+
+/**
+ * Statistics of the call in the call slot with the same index. The tag
+ * holds a generation and the active bit, a reader that finds the same tag
+ * before and after comparing the ID has found the right call. Recorders
+ * and readers count themselves in users while they touch the rings, and
+ * closing waits for them, so a sample of an ended call never lands in the
+ * rings of the next one.
+ */
+typedef struct {
+    _Atomic uint64_t tag;
+    _Atomic uint64_t id_words[STATS_ID_WORDS];
+    _Atomic uint32_t users;
+    MetricRing rings[CALL_METRIC_COUNT];
+} StatsSlot;
+
+static StatsSlot stats_slots[CALL_MAX_ACTIVE];
+
+/*
+ * Summaries of ended calls wait here for a thread of the host to store
+ * them, so ending a call does no I/O and the database is only written from
+ * threads the host already uses for it. Created once and kept, like the
+ * call slots, so a call ending during shutdown never pushes into a freed
+ * ring.
+ */
+static _Atomic(MpscRing*) pending_summaries = NULL;
+static atomic_bool is_storing = false; // Held by the one thread popping pending_summaries
+
+static bool is_active(uint64_t tag)
+{
+    return (tag & 1u) != 0;
+}
+
+static bool is_valid_id(const char* id)
+{
+    return id != NULL && id[0] != '\0' && memchr(id, '\0', CALL_ID_LENGTH) != NULL;
+}
+
+static void encode_id(const char* call_id, uint64_t words[STATS_ID_WORDS])
+{
+    char padded[CALL_ID_LENGTH] = {0};
+    memcpy(padded, call_id, strlen(call_id));
+    memcpy(words, padded, CALL_ID_LENGTH);
+}
+
+static StatsSlot* find_stats(const char* call_id, uint64_t* found_tag)
+{
+    uint64_t words[STATS_ID_WORDS];
+    encode_id(call_id, words);
+
+    for (size_t i = 0; i < CALL_MAX_ACTIVE; i++)
+    {
+        StatsSlot* slot = &stats_slots[i];
+        const uint64_t tag = atomic_load_explicit(&slot->tag, memory_order_acquire);
+        if (!is_active(tag))
+        {
+            continue;
+        }
+
+        bool matches = true;
+        for (size_t w = 0; w < STATS_ID_WORDS && matches; w++)
+        {
+            matches = atomic_load_explicit(&slot->id_words[w], memory_order_relaxed) == words[w];
+        }
+
+        atomic_thread_fence(memory_order_acquire);
+        if (matches && atomic_load_explicit(&slot->tag, memory_order_relaxed) == tag)
+        {
+            *found_tag = tag;
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Finds the slot of an active call and counts the caller as its user.
+ * The tag is checked again once counted: either the call is still the
+ * same, or it was closed and the caller backs off.
+ */
+static StatsSlot* enter_stats(const char* call_id)
+{
+    uint64_t tag;
+    StatsSlot* slot = find_stats(call_id, &tag);
+    if (slot == NULL)
+    {
+        return NULL;
+    }
+
+    // Pairs with the tag store and users load in call_stats_close.
+    atomic_fetch_add(&slot->users, 1);
+    if (atomic_load(&slot->tag) != tag)
+    {
+        atomic_fetch_sub_explicit(&slot->users, 1, memory_order_release);
+        return NULL;
+    }
+    return slot;
+}
+
+static void leave_stats(StatsSlot* slot)
+{
+    atomic_fetch_sub_explicit(&slot->users, 1, memory_order_release);
+}
+
+static int compare_samples(const void* a, const void* b)
+{
+    const uint32_t left = *(const uint32_t*)a;
+    const uint32_t right = *(const uint32_t*)b;
+    return (left > right) - (left < right);
+}
+
+// Nearest-rank percentile of sorted samples.
+static uint32_t percentile(const uint32_t sorted[], size_t count, unsigned percent)
+{
+    const size_t rank = (count * percent + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void summarize(MetricRing* ring, CallMetricStats* stats)
+{
+    memset(stats, 0, sizeof(CallMetricStats));
+
+    const uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (head == 0)
+    {
+        return;
+    }
+
+    // Recorders may overwrite the oldest samples while they are copied, the window stays representative.
+    const size_t count = head < CALL_STATS_WINDOW ? (size_t)head : CALL_STATS_WINDOW;
+    uint32_t window[CALL_STATS_WINDOW];
+    for (size_t i = 0; i < count; i++)
+    {
+        window[i] = atomic_load_explicit(&ring->samples[(head - count + i) & STATS_WINDOW_MASK], memory_order_relaxed);
+    }
+    qsort(window, count, sizeof(uint32_t), compare_samples);
+
+    stats->sample_count = head;
+    stats->mean = (double)atomic_load_explicit(&ring->sum, memory_order_relaxed) / (double)head;
+    stats->min = atomic_load_explicit(&ring->min, memory_order_relaxed);
+    stats->max = atomic_load_explicit(&ring->max, memory_order_relaxed);
+    stats->p50 = percentile(window, count, 50);
+    stats->p90 = percentile(window, count, 90);
+    stats->p99 = percentile(window, count, 99);
+}
+
+static void store_summary(const CallQuality* quality)
+{
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        return;
+    }
+
+    // One statement is atomic by itself, so no transaction is opened on a thread the host is not using.
+    char sql[512] = "INSERT OR REPLACE INTO call_quality (call_id, metric, sample_count, mean, min, max, p50, p90, p99) "
+                    "VALUES ";
+    size_t row_count = 0;
+    for (int metric = 0; metric < CALL_METRIC_COUNT; metric++)
+    {
+        if (quality->metrics[metric].sample_count > 0)
+        {
+            strcat(sql, row_count++ == 0 ? "(?, ?, ?, ?, ?, ?, ?, ?, ?)" : ", (?, ?, ?, ?, ?, ?, ?, ?, ?)");
+        }
+    }
+    if (row_count == 0)
+    {
+        return;
+    }
+
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return;
+    }
+
+    int column = 0;
+    for (int metric = 0; metric < CALL_METRIC_COUNT; metric++)
+    {
+        const CallMetricStats* stats = &quality->metrics[metric];
+        if (stats->sample_count == 0)
+        {
+            continue;
+        }
+
+        sqlite3_bind_text(stmt, ++column, quality->call_id, -1, SQLITE_STATIC);
+        sqlite3_bind_int(stmt, ++column, metric);
+        sqlite3_bind_int64(stmt, ++column, (sqlite3_int64)stats->sample_count);
+        sqlite3_bind_double(stmt, ++column, stats->mean);
+        sqlite3_bind_int64(stmt, ++column, stats->min);
+        sqlite3_bind_int64(stmt, ++column, stats->max);
+        sqlite3_bind_int64(stmt, ++column, stats->p50);
+        sqlite3_bind_int64(stmt, ++column, stats->p90);
+        sqlite3_bind_int64(stmt, ++column, stats->p99);
+    }
+
+    if (sqlite3_step(stmt) != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+    }
+    sqlite3_finalize(stmt);
+}
+
+void call_stats_open(size_t slot_index, const CallInfo* call_info)
+{
+    StatsSlot* slot = &stats_slots[slot_index];
+    const uint64_t tag = atomic_load_explicit(&slot->tag, memory_order_relaxed);
+
+    for (int metric = 0; metric < CALL_METRIC_COUNT; metric++)
+    {
+        MetricRing* ring = &slot->rings[metric];
+        atomic_store_explicit(&ring->head, 0, memory_order_relaxed);
+        atomic_store_explicit(&ring->sum, 0, memory_order_relaxed);
+        atomic_store_explicit(&ring->min, UINT32_MAX, memory_order_relaxed);
+        atomic_store_explicit(&ring->max, 0, memory_order_relaxed);
+    }
+
+    uint64_t words[STATS_ID_WORDS];
+    encode_id(call_info->call_id, words);
+    for (size_t w = 0; w < STATS_ID_WORDS; w++)
+    {
+        atomic_store_explicit(&slot->id_words[w], words[w], memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&slot->tag, ((tag >> 1) + 1) << 1 | 1u, memory_order_release);
+}
+
+void call_stats_close(size_t slot_index, const CallInfo* call_info)
+{
+    StatsSlot* slot = &stats_slots[slot_index];
+    const uint64_t tag = atomic_load_explicit(&slot->tag, memory_order_relaxed);
+    if (!is_active(tag))
+    {
+        return;
+    }
+
+    // New users miss the slot from here on, the ones already counted finish their sample first.
+    atomic_store(&slot->tag, tag & ~(uint64_t)1u);
+    while (atomic_load_explicit(&slot->users, memory_order_acquire) > 0)
+    {
+        sched_yield();
+    }
+
+    CallQuality quality;
+    memcpy(quality.call_id, call_info->call_id, sizeof(quality.call_id));
+    for (int metric = 0; metric < CALL_METRIC_COUNT; metric++)
+    {
+        summarize(&slot->rings[metric], &quality.metrics[metric]);
+    }
+
+    // Stored right away only when the host has let CALL_STATS_SUMMARY_QUEUE_SIZE summaries pile up.
+    MpscRing* pending = atomic_load_explicit(&pending_summaries, memory_order_acquire);
+    if (pending == NULL || !mpsc_ring_push(pending, &quality))
+    {
+        store_summary(&quality);
+    }
+}
+
+ErrorCode call_stats_init()
+{
+    if (atomic_load(&pending_summaries) != NULL)
+    {
+        return ERROR_NONE;
+    }
+
+    MpscRing* pending = mpsc_ring_create(CALL_STATS_SUMMARY_QUEUE_SIZE, sizeof(CallQuality));
+    if (pending == NULL)
+    {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+    atomic_store_explicit(&pending_summaries, pending, memory_order_release);
+    return ERROR_NONE;
+}
+
+void call_stats_store_pending()
+{
+    MpscRing* pending = atomic_load_explicit(&pending_summaries, memory_order_acquire);
+    if (pending == NULL || atomic_exchange_explicit(&is_storing, true, memory_order_acquire))
+    {
+        return;
+    }
+
+    CallQuality quality;
+    while (mpsc_ring_pop(pending, &quality))
+    {
+        store_summary(&quality);
+    }
+    atomic_store_explicit(&is_storing, false, memory_order_release);
+}
+
+ErrorCode record_call_metric(const char* call_id, CallMetric metric, uint32_t value)
+{
+    if (!is_valid_id(call_id) || (int)metric < 0 || metric >= CALL_METRIC_COUNT)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    StatsSlot* slot = enter_stats(call_id);
+    if (slot == NULL)
+    {
+        return CALL_ERROR_NOT_FOUND;
+    }
+
+    MetricRing* ring = &slot->rings[metric];
+    const uint64_t position = atomic_fetch_add_explicit(&ring->head, 1, memory_order_relaxed);
+    atomic_store_explicit(&ring->samples[position & STATS_WINDOW_MASK], value, memory_order_relaxed);
+    atomic_fetch_add_explicit(&ring->sum, value, memory_order_relaxed);
+
+    uint32_t current = atomic_load_explicit(&ring->min, memory_order_relaxed);
+    while (value < current
+           && !atomic_compare_exchange_weak_explicit(&ring->min, &current, value, memory_order_relaxed,
+                                                     memory_order_relaxed))
+    {
+    }
+
+    current = atomic_load_explicit(&ring->max, memory_order_relaxed);
+    while (value > current
+           && !atomic_compare_exchange_weak_explicit(&ring->max, &current, value, memory_order_relaxed,
+                                                     memory_order_relaxed))
+    {
+    }
+
+    leave_stats(slot);
+    return ERROR_NONE;
+}
+
+ErrorCode get_call_quality(const char* call_id, CallQuality* quality)
+{
+    if (!is_valid_id(call_id) || quality == NULL)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    StatsSlot* slot = enter_stats(call_id);
+    if (slot == NULL)
+    {
+        return CALL_ERROR_NOT_FOUND;
+    }
+
+    memset(quality, 0, sizeof(CallQuality));
+    memcpy(quality->call_id, call_id, strlen(call_id) + 1);
+    for (int metric = 0; metric < CALL_METRIC_COUNT; metric++)
+    {
+        summarize(&slot->rings[metric], &quality->metrics[metric]);
+    }
+
+    leave_stats(slot);
+    return ERROR_NONE;
+}
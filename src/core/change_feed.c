@@ -0,0 +1,244 @@
+#include "libmessagekit/change_feed.h"
+#include "database.h"
+
+#define CHANGE_FEED_INITIAL_CAPACITY 256
+
+void get_changes_since(int64_t seq, size_t limit, ChangeFeedCallback callback)
+{
+    if (callback == NULL)
+    {
+        return;
+    }
+
+    if (seq < 0 || limit == 0)
+    {
+        callback(NULL, 0, seq, ERROR_INVALID_PARAMS);
+        return;
+    }
+
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        callback(NULL, 0, seq, DB_ERROR_INITIALIZATION);
+        return;
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    const char* sql = "SELECT seq, entity, operation, entity_id, scope_id, changed_at FROM change_log "
+                      "WHERE seq > ? ORDER BY seq LIMIT ?;";
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        callback(NULL, 0, seq, DB_ERROR_QUERY);
+        return;
+    }
+
+    sqlite3_bind_int64(stmt, 1, seq);
+    sqlite3_bind_int64(stmt, 2, limit > INT64_MAX ? INT64_MAX : (int64_t)limit);
+
+    size_t capacity = limit < CHANGE_FEED_INITIAL_CAPACITY ? limit : CHANGE_FEED_INITIAL_CAPACITY;
+    ChangeRecord* changes = malloc(capacity * sizeof(ChangeRecord));
+    if (changes == NULL)
+    {
+        sqlite3_finalize(stmt);
+        callback(NULL, 0, seq, ERROR_MEMORY_ALLOCATION);
+        return;
+    }
+
+    ErrorCode error = ERROR_NONE;
+    size_t count = 0;
+    int step;
+    while ((step = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        if (count == capacity)
+        {
+            ChangeRecord* grown = realloc(changes, capacity * 2 * sizeof(ChangeRecord));
+            if (grown == NULL)
+            {
+                error = ERROR_MEMORY_ALLOCATION;
+                break;
+            }
+            changes = grown;
+            capacity *= 2;
+        }
+
+        ChangeRecord* change = &changes[count++];
+        memset(change, 0, sizeof(ChangeRecord));
+        change->seq = sqlite3_column_int64(stmt, 0);
+        change->entity = (ChangeEntity)sqlite3_column_int(stmt, 1);
+        change->operation = (ChangeOperation)sqlite3_column_int(stmt, 2);
+        strncpy(change->entity_id, (const char*)sqlite3_column_text(stmt, 3), MAX_CHANGE_ENTITY_ID_LENGTH - 1);
+        if (sqlite3_column_type(stmt, 4) != SQLITE_NULL)
+        {
+            strncpy(change->scope_id, (const char*)sqlite3_column_text(stmt, 4), MAX_CONVERSATION_ID_LENGTH - 1);
+        }
+        change->changed_at = sqlite3_column_int64(stmt, 5);
+    }
+
+    if (error == ERROR_NONE && step != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+    sqlite3_finalize(stmt);
+
+    if (error != ERROR_NONE)
+    {
+        free(changes);
+        callback(NULL, 0, seq, error);
+        return;
+    }
+
+    callback(changes, count, count > 0 ? changes[count - 1].seq : seq, ERROR_NONE);
+    free(changes);
+}
+
+ErrorCode get_latest_change_seq(int64_t* seq)
+{
+    if (seq == NULL)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    // sqlite_sequence survives compaction, unlike MAX(seq) over the log itself.
+    sqlite3_stmt* stmt = NULL;
+    const char* sql = "SELECT seq FROM sqlite_sequence WHERE name = 'change_log';";
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    ErrorCode error = ERROR_NONE;
+    const int step = sqlite3_step(stmt);
+    if (step == SQLITE_ROW)
+    {
+        *seq = sqlite3_column_int64(stmt, 0);
+    }
+    else if (step == SQLITE_DONE)
+    {
+        *seq = 0;
+    }
+    else
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+
+    sqlite3_finalize(stmt);
+    return error;
+}
+
+static ErrorCode run_peer_statement(sqlite3* handle, const char* sql, const char* peer_id, int64_t seq)
+{
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    sqlite3_bind_text(stmt, 1, peer_id, -1, SQLITE_STATIC);
+    if (sqlite3_bind_parameter_count(stmt) == 2)
+    {
+        sqlite3_bind_int64(stmt, 2, seq);
+    }
+
+    ErrorCode error = ERROR_NONE;
+    if (sqlite3_step(stmt) != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+
+    sqlite3_finalize(stmt);
+    return error;
+}
+
+ErrorCode acknowledge_changes(const char* peer_id, int64_t seq)
+{
+    if (peer_id == NULL || strlen(peer_id) == 0 || seq < 0)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    // Acknowledgements can arrive out of order, the watermark never moves back.
+    const char* sql = "INSERT INTO sync_peers (peer_id, acked_seq) VALUES (?, ?) "
+                      "ON CONFLICT (peer_id) DO UPDATE SET acked_seq = MAX(acked_seq, excluded.acked_seq);";
+    return run_peer_statement(handle, sql, peer_id, seq);
+}
+
+ErrorCode remove_sync_peer(const char* peer_id)
+{
+    if (peer_id == NULL || strlen(peer_id) == 0)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    return run_peer_statement(handle, "DELETE FROM sync_peers WHERE peer_id = ?;", peer_id, 0);
+}
+
+ErrorCode compact_change_log(int64_t up_to_seq, size_t* removed_count)
+{
+    if (removed_count != NULL)
+    {
+        *removed_count = 0;
+    }
+
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    /*
+     * A delete is the latest change of its record until the record comes
+     * back, so it would never be superseded. It goes once every known peer
+     * has applied it; with no peer known, MIN() is NULL and it stays.
+     */
+    const char* sql = "DELETE FROM change_log WHERE seq <= ?1 AND (EXISTS ("
+                      "SELECT 1 FROM change_log AS newer "
+                      "WHERE newer.entity = change_log.entity AND newer.entity_id = change_log.entity_id "
+                      "AND newer.seq > change_log.seq) "
+                      "OR (operation = 2 AND seq <= (SELECT MIN(acked_seq) FROM sync_peers)));";
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    sqlite3_bind_int64(stmt, 1, up_to_seq);
+
+    ErrorCode error = ERROR_NONE;
+    if (sqlite3_step(stmt) != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+    else if (removed_count != NULL)
+    {
+        *removed_count = (size_t)sqlite3_changes(handle);
+    }
+
+    sqlite3_finalize(stmt);
+    return error;
+}
@@ -0,0 +1,249 @@
+#include "libmessagekit/contacts.h"
+#include "database.h"
+#include "live_query_engine.h"
+#include "prefix_index.h"
+#include "search_index.h"
+
+#define CONTACT_INITIAL_CAPACITY 32
+
+typedef struct {
+    Contact* items;
+    size_t count;
+    size_t capacity;
+} ContactBuffer;
+
+static PrefixIndex* contact_index = NULL;
+
+static void read_contact(sqlite3_stmt* stmt, Contact* contact)
+{
+    memset(contact, 0, sizeof(Contact));
+
+    const unsigned char* contact_id = sqlite3_column_text(stmt, 0);
+    const unsigned char* name = sqlite3_column_text(stmt, 1);
+    const unsigned char* user_id = sqlite3_column_text(stmt, 2);
+
+    if (contact_id != NULL)
+    {
+        strncpy(contact->contact_id, (const char*)contact_id, MAX_CONTACT_ID_LENGTH - 1);
+    }
+    if (name != NULL)
+    {
+        strncpy(contact->name, (const char*)name, MAX_CONTACT_NAME_LENGTH - 1);
+    }
+    if (user_id != NULL)
+    {
+        strncpy(contact->user_id, (const char*)user_id, MAX_CONTACT_ID_LENGTH - 1);
+    }
+}
+
+#define CONTACT_SEARCH_TEXT_LENGTH (MAX_CONTACT_NAME_LENGTH + MAX_CONTACT_ID_LENGTH + 1)
+
+static void contact_search_text(const Contact* contact, char text[CONTACT_SEARCH_TEXT_LENGTH])
+{
+    // Both the name and the messaging user ID are searchable.
+    snprintf(text, CONTACT_SEARCH_TEXT_LENGTH, "%s %s", contact->name, contact->user_id);
+}
+
+static ErrorCode index_contact(const Contact* contact)
+{
+    char text[CONTACT_SEARCH_TEXT_LENGTH];
+    contact_search_text(contact, text);
+    return prefix_index_put(contact_index, contact->contact_id, text, contact, sizeof(Contact));
+}
+
+static void reload_contact(const char* contact_id)
+{
+    sqlite3* handle = db_get_handle();
+    sqlite3_stmt* stmt = NULL;
+
+    const char* sql = "SELECT contact_id, name, user_id FROM contacts WHERE contact_id = ?;";
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return;
+    }
+
+    sqlite3_bind_text(stmt, 1, contact_id, -1, SQLITE_STATIC);
+
+    const int step = sqlite3_step(stmt);
+    if (step == SQLITE_ROW)
+    {
+        Contact contact;
+        read_contact(stmt, &contact);
+        index_contact(&contact);
+    }
+    else if (step == SQLITE_DONE)
+    {
+        prefix_index_remove(contact_index, contact_id);
+    }
+    else
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+    }
+
+    sqlite3_finalize(stmt);
+}
+
+static void on_contact_changes(const CommittedChange changes[], size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (changes[i].entity != CHANGE_ENTITY_CONTACT)
+        {
+            continue;
+        }
+
+        if (changes[i].operation == LIVE_QUERY_DIFF_DELETE)
+        {
+            prefix_index_remove(contact_index, changes[i].entity_id);
+        }
+        else
+        {
+            reload_contact(changes[i].entity_id);
+        }
+    }
+}
+
+static bool collect_contact_match(const void* payload, void* context)
+{
+    ContactBuffer* buffer = context;
+
+    if (buffer->count == buffer->capacity)
+    {
+        const size_t capacity = buffer->capacity == 0 ? CONTACT_INITIAL_CAPACITY : buffer->capacity * 2;
+        Contact* grown = realloc(buffer->items, capacity * sizeof(Contact));
+        if (grown == NULL)
+        {
+            return false;
+        }
+        buffer->items = grown;
+        buffer->capacity = capacity;
+    }
+
+    buffer->items[buffer->count++] = *(const Contact*)payload;
+    return true;
+}
+
+static int compare_by_name(const void* lhs, const void* rhs)
+{
+    const Contact* a = lhs;
+    const Contact* b = rhs;
+
+    const int by_name = strcmp(a->name, b->name);
+    return by_name != 0 ? by_name : strcmp(a->contact_id, b->contact_id);
+}
+
+void search_contacts(const char* query, ContactListCallback callback)
+{
+    if (callback == NULL)
+    {
+        return;
+    }
+
+    if (query == NULL)
+    {
+        callback(NULL, 0, ERROR_INVALID_PARAMS);
+        return;
+    }
+
+    if (contact_index == NULL)
+    {
+        callback(NULL, 0, DB_ERROR_INITIALIZATION);
+        return;
+    }
+
+    ContactBuffer buffer = {0};
+    prefix_index_search(contact_index, query, collect_contact_match, &buffer);
+    if (buffer.count > 1)
+    {
+        qsort(buffer.items, buffer.count, sizeof(Contact), compare_by_name);
+    }
+
+    callback(buffer.items, buffer.count, ERROR_NONE);
+    free(buffer.items);
+}
+
+ErrorCode contact_search_init()
+{
+    if (contact_index != NULL)
+    {
+        return ERROR_ALREADY_INITIALIZED;
+    }
+
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    const char* sql = "SELECT contact_id, name, user_id FROM contacts;";
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    contact_index = prefix_index_create();
+    if (contact_index == NULL)
+    {
+        sqlite3_finalize(stmt);
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    ErrorCode error = ERROR_NONE;
+    int step = SQLITE_DONE;
+    while (error == ERROR_NONE && (step = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        Contact contact;
+        char text[CONTACT_SEARCH_TEXT_LENGTH];
+        read_contact(stmt, &contact);
+        contact_search_text(&contact, text);
+        error = prefix_index_load(contact_index, contact.contact_id, text, &contact, sizeof(Contact));
+    }
+
+    if (error == ERROR_NONE && step != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+    sqlite3_finalize(stmt);
+
+    if (error == ERROR_NONE)
+    {
+        error = prefix_index_finish_load(contact_index);
+    }
+    if (error == ERROR_NONE)
+    {
+        error = live_query_add_observer(on_contact_changes);
+    }
+
+    if (error != ERROR_NONE)
+    {
+        contact_search_shutdown();
+    }
+
+    return error;
+}
+
+void contact_search_shutdown()
+{
+    prefix_index_destroy(contact_index);
+    contact_index = NULL;
+}
+
+ErrorCode contact_search_visit(const char* query, PrefixIndexVisitor visitor, void* context)
+{
+    if (query == NULL || visitor == NULL)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    if (contact_index == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    prefix_index_search(contact_index, query, visitor, context);
+    return ERROR_NONE;
+}
@@ -0,0 +1,243 @@
+#include "conversation_list_model.h"
+
+#define LIST_MODEL_INITIAL_CAPACITY 64
+
+typedef struct {
+    bool is_pinned;
+    bool is_archived;
+    int64_t timestamp;
+    char conversation_id[MAX_CONVERSATION_ID_LENGTH];
+} ListKey;
+
+struct ConversationListModel {
+    bool include_archived;
+    ListKey* ordered;   // Display order
+    ListKey* by_id;     // Sorted by conversation ID, holds the key each conversation is ordered by
+    size_t count;
+    size_t capacity;
+};
+
+static int compare_list_keys(const ListKey* a, const ListKey* b)
+{
+    if (a->is_pinned != b->is_pinned)
+    {
+        return a->is_pinned ? -1 : 1;
+    }
+    if (a->is_archived != b->is_archived)
+    {
+        return a->is_archived ? 1 : -1;
+    }
+    if (a->timestamp != b->timestamp)
+    {
+        return a->timestamp > b->timestamp ? -1 : 1;
+    }
+    return strcmp(b->conversation_id, a->conversation_id);
+}
+
+static size_t find_ordered_position(const ConversationListModel* model, const ListKey* key)
+{
+    size_t low = 0;
+    size_t high = model->count;
+    while (low < high)
+    {
+        const size_t middle = low + (high - low) / 2;
+        if (compare_list_keys(key, &model->ordered[middle]) > 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static size_t find_id_position(const ConversationListModel* model, const char* conversation_id, bool* found)
+{
+    size_t low = 0;
+    size_t high = model->count;
+    while (low < high)
+    {
+        const size_t middle = low + (high - low) / 2;
+        const int order = strcmp(conversation_id, model->by_id[middle].conversation_id);
+        if (order == 0)
+        {
+            *found = true;
+            return middle;
+        }
+        if (order > 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    *found = false;
+    return low;
+}
+
+static bool reserve_entry(ConversationListModel* model)
+{
+    if (model->count < model->capacity)
+    {
+        return true;
+    }
+
+    const size_t capacity = model->capacity == 0 ? LIST_MODEL_INITIAL_CAPACITY : model->capacity * 2;
+    ListKey* ordered = realloc(model->ordered, capacity * sizeof(ListKey));
+    if (ordered == NULL)
+    {
+        return false;
+    }
+    model->ordered = ordered;
+
+    ListKey* by_id = realloc(model->by_id, capacity * sizeof(ListKey));
+    if (by_id == NULL)
+    {
+        return false;
+    }
+    model->by_id = by_id;
+    model->capacity = capacity;
+    return true;
+}
+
+static void remove_ordered(ConversationListModel* model, size_t position)
+{
+    memmove(&model->ordered[position], &model->ordered[position + 1],
+            (model->count - position - 1) * sizeof(ListKey));
+}
+
+static void insert_ordered(ConversationListModel* model, size_t position, const ListKey* key)
+{
+    memmove(&model->ordered[position + 1], &model->ordered[position],
+            (model->count - position - 1) * sizeof(ListKey));
+    model->ordered[position] = *key;
+}
+
+ConversationListModel* conversation_list_model_create(bool include_archived)
+{
+    ConversationListModel* model = calloc(1, sizeof(ConversationListModel));
+    if (model != NULL)
+    {
+        model->include_archived = include_archived;
+    }
+    return model;
+}
+
+void conversation_list_model_destroy(ConversationListModel* model)
+{
+    if (model == NULL)
+    {
+        return;
+    }
+
+    free(model->ordered);
+    free(model->by_id);
+    free(model);
+}
+
+bool conversation_list_model_upsert(ConversationListModel* model, const ConversationSummary* summary,
+                                    ConversationListOperation* operation)
+{
+    if (model == NULL || summary == NULL || operation == NULL)
+    {
+        return false;
+    }
+
+    if (!model->include_archived && summary->is_archived)
+    {
+        return conversation_list_model_remove(model, summary->conversation_id, operation);
+    }
+
+    ListKey key = {0};
+    key.is_pinned = summary->is_pinned;
+    key.is_archived = summary->is_archived;
+    key.timestamp = summary->last_message_timestamp;
+    memcpy(key.conversation_id, summary->conversation_id, sizeof(key.conversation_id));
+
+    bool found;
+    const size_t id_position = find_id_position(model, key.conversation_id, &found);
+    if (!found)
+    {
+        if (!reserve_entry(model))
+        {
+            return false;
+        }
+
+        memmove(&model->by_id[id_position + 1], &model->by_id[id_position],
+                (model->count - id_position) * sizeof(ListKey));
+        model->by_id[id_position] = key;
+
+        const size_t to = find_ordered_position(model, &key);
+        model->count++;
+        insert_ordered(model, to, &key);
+
+        operation->type = CONVERSATION_LIST_INSERT;
+        operation->from_index = 0;
+        operation->to_index = to;
+        operation->conversation = *summary;
+        return true;
+    }
+
+    // Moves are reported as removal followed by insertion, so the target is
+    // located with the conversation taken out of the list.
+    const size_t from = find_ordered_position(model, &model->by_id[id_position]);
+    remove_ordered(model, from);
+    model->count--;
+    const size_t to = find_ordered_position(model, &key);
+    model->count++;
+    insert_ordered(model, to, &key);
+    model->by_id[id_position] = key;
+
+    operation->type = from == to ? CONVERSATION_LIST_UPDATE : CONVERSATION_LIST_MOVE;
+    operation->from_index = from;
+    operation->to_index = to;
+    operation->conversation = *summary;
+    return true;
+}
+
+bool conversation_list_model_remove(ConversationListModel* model, const char* conversation_id,
+                                    ConversationListOperation* operation)
+{
+    if (model == NULL || conversation_id == NULL || operation == NULL)
+    {
+        return false;
+    }
+
+    bool found;
+    const size_t id_position = find_id_position(model, conversation_id, &found);
+    if (!found)
+    {
+        return false;
+    }
+
+    const size_t from = find_ordered_position(model, &model->by_id[id_position]);
+    remove_ordered(model, from);
+    memmove(&model->by_id[id_position], &model->by_id[id_position + 1],
+            (model->count - id_position - 1) * sizeof(ListKey));
+    model->count--;
+
+    memset(operation, 0, sizeof(ConversationListOperation));
+    operation->type = CONVERSATION_LIST_REMOVE;
+    operation->from_index = from;
+    strncpy(operation->conversation.conversation_id, conversation_id, MAX_CONVERSATION_ID_LENGTH - 1);
+    return true;
+}
+
+size_t conversation_list_model_count(const ConversationListModel* model)
+{
+    return model == NULL ? 0 : model->count;
+}
+
+const char* conversation_list_model_id_at(const ConversationListModel* model, size_t position)
+{
+    if (model == NULL || position >= model->count)
+    {
+        return NULL;
+    }
+    return model->ordered[position].conversation_id;
+}
@@ -0,0 +1,396 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "libmessagekit/conversations.h"
+#include "libmessagekit/change_feed.h"
+#include "conversation_snapshot.h"
+
+#include <time.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define SNAPSHOT_FILENAME "conversations.snapshot"
+#define SNAPSHOT_MAGIC "MKCS"
+#define SNAPSHOT_VERSION 1
+
+/**
+ * File layout: this header followed by count ConversationSummary records in
+ * list order, exactly as they are laid out in memory. The header size keeps
+ * the records aligned so they are served straight from the mapping.
+ * record_size rejects snapshots written by a build with a different layout.
+ * change_seq is the latest change feed sequence number when the snapshot
+ * was written; while it is still the latest, the snapshot is current.
+ */
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t count;
+    int64_t written_at;
+    int64_t change_seq;
+    uint32_t checksum;
+    uint32_t reserved;
+} SnapshotHeader;
+
+typedef struct {
+    void* data;
+    size_t size;
+} MappedFile;
+
+static char* snapshot_path = NULL;
+
+// The snapshot found at init, mapped for as long as no change was committed since it was written.
+static MappedFile current_file = {0};
+static const ConversationSummary* current_records = NULL;
+static size_t current_count = 0;
+static int64_t current_change_seq = 0;
+
+static char* build_snapshot_path(const char* storage_path, const char* suffix)
+{
+    const size_t length = strlen(storage_path) + strlen("/" SNAPSHOT_FILENAME) + strlen(suffix) + 1;
+    char* path = malloc(length);
+    if (path != NULL)
+    {
+        snprintf(path, length, "%s/" SNAPSHOT_FILENAME "%s", storage_path, suffix);
+    }
+    return path;
+}
+
+/**
+ * FNV-1a over the record bytes, catches torn or truncated writes.
+ */
+static uint32_t snapshot_checksum(const unsigned char* data, size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static ErrorCode map_file(const char* path, MappedFile* file)
+{
+#ifdef _WIN32
+    FILE* stream = fopen(path, "rb");
+    if (stream == NULL)
+    {
+        return ERROR_FILE_IO;
+    }
+
+    fseek(stream, 0, SEEK_END);
+    const long size = ftell(stream);
+    fseek(stream, 0, SEEK_SET);
+    if (size <= 0)
+    {
+        fclose(stream);
+        return ERROR_INVALID_FORMAT;
+    }
+
+    file->data = malloc((size_t)size);
+    file->size = (size_t)size;
+    if (file->data == NULL)
+    {
+        fclose(stream);
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    const size_t read_size = fread(file->data, 1, file->size, stream);
+    fclose(stream);
+    if (read_size != file->size)
+    {
+        free(file->data);
+        return ERROR_FILE_IO;
+    }
+    return ERROR_NONE;
+#else
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return ERROR_FILE_IO;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0)
+    {
+        close(fd);
+        return ERROR_INVALID_FORMAT;
+    }
+
+    file->size = (size_t)info.st_size;
+    file->data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    return file->data == MAP_FAILED ? ERROR_FILE_IO : ERROR_NONE;
+#endif
+}
+
+static void unmap_file(MappedFile* file)
+{
+#ifdef _WIN32
+    free(file->data);
+#else
+    munmap(file->data, file->size);
+#endif
+}
+
+static bool is_terminated(const char* text, size_t size)
+{
+    return memchr(text, '\0', size) != NULL;
+}
+
+static ErrorCode validate_snapshot(const MappedFile* file, const ConversationSummary** records, size_t* count)
+{
+    if (file->size < sizeof(SnapshotHeader))
+    {
+        return ERROR_INVALID_FORMAT;
+    }
+
+    const SnapshotHeader* header = file->data;
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0
+        || header->version != SNAPSHOT_VERSION
+        || header->record_size != sizeof(ConversationSummary)
+        || header->count > CONVERSATION_SNAPSHOT_SIZE
+        || file->size != sizeof(SnapshotHeader) + (size_t)header->count * sizeof(ConversationSummary))
+    {
+        return ERROR_INVALID_FORMAT;
+    }
+
+    const unsigned char* body = (const unsigned char*)file->data + sizeof(SnapshotHeader);
+    if (snapshot_checksum(body, file->size - sizeof(SnapshotHeader)) != header->checksum)
+    {
+        return ERROR_INVALID_FORMAT;
+    }
+
+    const ConversationSummary* summaries = (const ConversationSummary*)body;
+    for (uint32_t i = 0; i < header->count; i++)
+    {
+        if (!is_terminated(summaries[i].conversation_id, MAX_CONVERSATION_ID_LENGTH)
+            || !is_terminated(summaries[i].name, MAX_CONVERSATION_NAME_LENGTH)
+            || !is_terminated(summaries[i].last_message_preview, MAX_LAST_MESSAGE_PREVIEW_LENGTH)
+            || !is_terminated(summaries[i].peer_user_id, USER_ID_LENGTH))
+        {
+            return ERROR_INVALID_FORMAT;
+        }
+    }
+
+    *records = summaries;
+    *count = header->count;
+    return ERROR_NONE;
+}
+
+void get_recent_conversations_snapshot(const char* storage_path, ConversationListCallback callback)
+{
+    if (callback == NULL)
+    {
+        return;
+    }
+
+    if (storage_path == NULL)
+    {
+        callback(NULL, 0, ERROR_INVALID_PARAMS);
+        return;
+    }
+
+    char* path = build_snapshot_path(storage_path, "");
+    if (path == NULL)
+    {
+        callback(NULL, 0, ERROR_MEMORY_ALLOCATION);
+        return;
+    }
+
+    MappedFile file;
+    ErrorCode error = map_file(path, &file);
+    free(path);
+    if (error != ERROR_NONE)
+    {
+        callback(NULL, 0, error);
+        return;
+    }
+
+    const ConversationSummary* records = NULL;
+    size_t count = 0;
+    error = validate_snapshot(&file, &records, &count);
+
+    // Records are delivered straight from the mapping, which lives until the callback returns.
+    callback(error == ERROR_NONE ? records : NULL, error == ERROR_NONE ? count : 0, error);
+    unmap_file(&file);
+}
+
+typedef struct {
+    int64_t change_seq;
+    ErrorCode result;
+} SaveContext;
+
+static ErrorCode write_snapshot_file(const ConversationSummary conversations[], size_t count, int64_t change_seq)
+{
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.record_size = sizeof(ConversationSummary);
+    header.count = (uint32_t)count;
+    header.written_at = (int64_t)time(NULL);
+    header.change_seq = change_seq;
+    header.checksum = snapshot_checksum((const unsigned char*)conversations, count * sizeof(ConversationSummary));
+
+    // Written next to the snapshot and renamed over it, readers never see a partial file.
+    char* temporary_path = build_snapshot_path(snapshot_path, ".tmp");
+    if (temporary_path == NULL)
+    {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    FILE* stream = fopen(temporary_path, "wb");
+    if (stream == NULL)
+    {
+        free(temporary_path);
+        return ERROR_FILE_IO;
+    }
+
+    bool written = fwrite(&header, sizeof(header), 1, stream) == 1
+        && (count == 0 || fwrite(conversations, sizeof(ConversationSummary), count, stream) == count);
+    written = fclose(stream) == 0 && written;
+
+    ErrorCode result = ERROR_FILE_IO;
+    if (written)
+    {
+        char* final_path = build_snapshot_path(snapshot_path, "");
+        if (final_path == NULL)
+        {
+            result = ERROR_MEMORY_ALLOCATION;
+        }
+        else
+        {
+#ifdef _WIN32
+            remove(final_path);
+#endif
+            if (rename(temporary_path, final_path) == 0)
+            {
+                result = ERROR_NONE;
+            }
+            free(final_path);
+        }
+    }
+
+    if (result != ERROR_NONE)
+    {
+        remove(temporary_path);
+    }
+    free(temporary_path);
+    return result;
+}
+
+static void write_snapshot(const ConversationSummary conversations[], size_t count, ErrorCode error, void* context)
+{
+    SaveContext* save = context;
+    save->result = error != ERROR_NONE ? error : write_snapshot_file(conversations, count, save->change_seq);
+}
+
+static void release_current_snapshot()
+{
+    if (current_records != NULL)
+    {
+        unmap_file(&current_file);
+    }
+    current_records = NULL;
+    current_count = 0;
+}
+
+ErrorCode save_conversation_snapshot()
+{
+    if (snapshot_path == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    SaveContext save = {0, ERROR_UNKNOWN};
+    const ErrorCode error = get_latest_change_seq(&save.change_seq);
+    if (error != ERROR_NONE)
+    {
+        return error;
+    }
+
+    // Renaming over the mapped snapshot is safe, the mapping keeps the old file.
+    visit_recent_conversations(CONVERSATION_SNAPSHOT_SIZE, 0, false, write_snapshot, &save);
+    return save.result;
+}
+
+bool conversation_snapshot_serve(size_t limit, size_t offset, ConversationListCallback callback)
+{
+    if (current_records == NULL)
+    {
+        return false;
+    }
+
+    // A full snapshot holds only the top of the list, a shorter one holds all of it.
+    const bool is_complete = current_count < CONVERSATION_SNAPSHOT_SIZE;
+    if (!is_complete && (limit == 0 || offset > current_count || limit > current_count - offset))
+    {
+        return false;
+    }
+
+    int64_t change_seq = 0;
+    if (get_latest_change_seq(&change_seq) != ERROR_NONE || change_seq != current_change_seq)
+    {
+        release_current_snapshot();
+        return false;
+    }
+
+    const size_t first = offset < current_count ? offset : current_count;
+    const size_t available = current_count - first;
+    const size_t count = limit == 0 || limit > available ? available : limit;
+    callback(count > 0 ? current_records + first : NULL, count, ERROR_NONE);
+    return true;
+}
+
+ErrorCode conversation_snapshot_init(const char* storage_path)
+{
+    if (snapshot_path != NULL)
+    {
+        return ERROR_ALREADY_INITIALIZED;
+    }
+
+    if (storage_path == NULL)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    const size_t length = strlen(storage_path);
+    snapshot_path = malloc(length + 1);
+    if (snapshot_path == NULL)
+    {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+    memcpy(snapshot_path, storage_path, length + 1);
+
+    // Any problem with the file just means the list is read from the database.
+    char* path = build_snapshot_path(storage_path, "");
+    if (path != NULL && map_file(path, &current_file) == ERROR_NONE)
+    {
+        const SnapshotHeader* header = current_file.data;
+        if (validate_snapshot(&current_file, &current_records, &current_count) == ERROR_NONE)
+        {
+            current_change_seq = header->change_seq;
+        }
+        else
+        {
+            unmap_file(&current_file);
+        }
+    }
+    free(path);
+    return ERROR_NONE;
+}
+
+void conversation_snapshot_shutdown()
+{
+    release_current_snapshot();
+    free(snapshot_path);
+    snapshot_path = NULL;
+}
@@ -0,0 +1,1068 @@
+#include "libmessagekit/conversations.h"
+#include "conversation_list_model.h"
+#include "conversation_snapshot.h"
+#include "blocked_users.h"
+#include "database.h"
+#include "live_query_engine.h"
+#include "prefix_index.h"
+#include "search_index.h"
+
+#include <inttypes.h>
+
+#define SUMMARY_COLUMNS "conversation_id, type, name, last_message_preview, last_message_type, " \
+                        "last_message_timestamp, unread_count, is_pinned, is_archived, is_muted, peer_user_id"
+
+// Hides individual conversations with blocked users, evaluated against the in-memory block list.
+#define VISIBLE_FILTER "NOT is_blocked_user(peer_user_id)"
+
+#define SUMMARY_INITIAL_CAPACITY 32
+#define CURSOR_VERSION 1
+#define MAX_LIST_SUBSCRIPTIONS 16
+
+typedef struct {
+    ConversationSummary* items;
+    size_t count;
+    size_t capacity;
+} SummaryBuffer;
+
+/**
+ * A run of the conversation list sharing the same pinned and archived state.
+ * Within a group rows are ordered by (last_message_timestamp, conversation_id) descending.
+ */
+typedef struct {
+    int is_pinned;
+    int is_archived;
+} ListGroup;
+
+typedef struct {
+    ListGroup group;
+    int64_t timestamp;
+    char conversation_id[MAX_CONVERSATION_ID_LENGTH];
+} CursorPosition;
+
+static const ListGroup RECENT_GROUPS[] = {{1, 0}, {0, 0}};
+static const ListGroup RECENT_WITH_ARCHIVED_GROUPS[] = {{1, 0}, {1, 1}, {0, 0}, {0, 1}};
+static const ListGroup ARCHIVED_GROUPS[] = {{1, 1}, {0, 1}};
+
+/**
+ * Subscribers of the same list variant share one model and one version sequence.
+ */
+typedef struct {
+    ConversationListModel* model;
+    uint64_t version;
+} ListVariant;
+
+typedef struct {
+    ConversationListSubscription id;
+    ConversationListDiffCallback callback;
+    bool include_archived;
+} ListSubscription;
+
+// Indexed by ConversationBatchOperation, every statement binds the conversation ID as its only parameter.
+static const char* const OPERATION_SQL[] = {
+    "UPDATE conversations SET is_pinned = 1 WHERE id = ?;",
+    "UPDATE conversations SET is_pinned = 0 WHERE id = ?;",
+    "UPDATE conversations SET is_archived = 1 WHERE id = ?;",
+    "UPDATE conversations SET is_archived = 0 WHERE id = ?;",
+    "UPDATE conversation_summaries SET last_read_seq = last_message_seq, unread_count = 0 WHERE conversation_id = ?;",
+    "UPDATE conversations SET is_muted = 1 WHERE id = ?;",
+    "UPDATE conversations SET is_muted = 0 WHERE id = ?;"
+};
+
+static PrefixIndex* conversation_index = NULL;
+static ListVariant list_variants[2];
+static ListSubscription list_subscriptions[MAX_LIST_SUBSCRIPTIONS];
+static ConversationListSubscription next_list_subscription = 1;
+
+/**
+ * Copies at most size - 1 bytes without splitting a UTF-8 sequence.
+ */
+static void copy_utf8_truncated(char* destination, const unsigned char* source, size_t size)
+{
+    if (source == NULL)
+    {
+        destination[0] = '\0';
+        return;
+    }
+
+    size_t length = strlen((const char*)source);
+    if (length >= size)
+    {
+        length = size - 1;
+        while (length > 0 && (source[length] & 0xC0) == 0x80)
+        {
+            length--;
+        }
+    }
+
+    memcpy(destination, source, length);
+    destination[length] = '\0';
+}
+
+static void read_summary(sqlite3_stmt* stmt, ConversationSummary* summary)
+{
+    memset(summary, 0, sizeof(ConversationSummary));
+    copy_utf8_truncated(summary->conversation_id, sqlite3_column_text(stmt, 0), MAX_CONVERSATION_ID_LENGTH);
+    summary->type = (ConversationType)sqlite3_column_int(stmt, 1);
+    copy_utf8_truncated(summary->name, sqlite3_column_text(stmt, 2), MAX_CONVERSATION_NAME_LENGTH);
+    copy_utf8_truncated(summary->last_message_preview, sqlite3_column_text(stmt, 3), MAX_LAST_MESSAGE_PREVIEW_LENGTH);
+    summary->last_message_type = (MessageType)sqlite3_column_int(stmt, 4);
+    summary->last_message_timestamp = sqlite3_column_int64(stmt, 5);
+    summary->unread_count = (uint32_t)sqlite3_column_int64(stmt, 6);
+    summary->is_pinned = sqlite3_column_int(stmt, 7) != 0;
+    summary->is_archived = sqlite3_column_int(stmt, 8) != 0;
+    summary->is_muted = sqlite3_column_int(stmt, 9) != 0;
+    copy_utf8_truncated(summary->peer_user_id, sqlite3_column_text(stmt, 10), USER_ID_LENGTH);
+}
+
+/**
+ * Appends every row of a prepared summary query to the buffer.
+ */
+static ErrorCode collect_summaries(sqlite3_stmt* stmt, SummaryBuffer* buffer)
+{
+    int step;
+    while ((step = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        if (buffer->count == buffer->capacity)
+        {
+            const size_t capacity = buffer->capacity == 0 ? SUMMARY_INITIAL_CAPACITY : buffer->capacity * 2;
+            ConversationSummary* grown = realloc(buffer->items, capacity * sizeof(ConversationSummary));
+            if (grown == NULL)
+            {
+                return ERROR_MEMORY_ALLOCATION;
+            }
+            buffer->items = grown;
+            buffer->capacity = capacity;
+        }
+
+        read_summary(stmt, &buffer->items[buffer->count++]);
+    }
+
+    if (step != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db_get_handle()));
+        return DB_ERROR_QUERY;
+    }
+
+    return ERROR_NONE;
+}
+
+/**
+ * Steps a prepared summary query, delivers the rows and finalizes the statement.
+ */
+static void deliver_summaries(sqlite3_stmt* stmt, ConversationListCallback callback)
+{
+    SummaryBuffer buffer = {0};
+    const ErrorCode error = collect_summaries(stmt, &buffer);
+    sqlite3_finalize(stmt);
+
+    if (error != ERROR_NONE)
+    {
+        callback(NULL, 0, error);
+    }
+    else
+    {
+        callback(buffer.items, buffer.count, ERROR_NONE);
+    }
+
+    free(buffer.items);
+}
+
+static sqlite3_stmt* prepare_summary_query(const char* sql)
+{
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        return NULL;
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return NULL;
+    }
+
+    return stmt;
+}
+
+static sqlite3_int64 sql_limit(size_t limit)
+{
+    // Zero means no limit, which SQLite spells as a negative LIMIT.
+    return limit == 0 || limit > INT64_MAX ? -1 : (sqlite3_int64)limit;
+}
+
+static ErrorCode load_summary(const char* conversation_id, ConversationSummary* summary)
+{
+    sqlite3_stmt* stmt = prepare_summary_query(
+        "SELECT " SUMMARY_COLUMNS " FROM conversation_summaries WHERE conversation_id = ?;");
+    if (stmt == NULL)
+    {
+        return DB_ERROR_QUERY;
+    }
+
+    sqlite3_bind_text(stmt, 1, conversation_id, -1, SQLITE_STATIC);
+
+    ErrorCode error = ERROR_NONE;
+    const int step = sqlite3_step(stmt);
+    if (step == SQLITE_ROW)
+    {
+        read_summary(stmt, summary);
+    }
+    else if (step == SQLITE_DONE)
+    {
+        error = DB_ERROR_NOT_FOUND;
+    }
+    else
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db_get_handle()));
+        error = DB_ERROR_QUERY;
+    }
+
+    sqlite3_finalize(stmt);
+    return error;
+}
+
+static void update_conversation(const char* conversation_id, const char* sql, ConversationOperationCallback callback)
+{
+    if (conversation_id == NULL || strlen(conversation_id) == 0 || strlen(conversation_id) >= MAX_CONVERSATION_ID_LENGTH)
+    {
+        if (callback != NULL)
+        {
+            callback(NULL, ERROR_INVALID_PARAMS);
+        }
+        return;
+    }
+
+    sqlite3* handle = db_get_handle();
+    sqlite3_stmt* stmt = prepare_summary_query(sql);
+    if (stmt == NULL)
+    {
+        if (callback != NULL)
+        {
+            callback(NULL, handle == NULL ? DB_ERROR_INITIALIZATION : DB_ERROR_QUERY);
+        }
+        return;
+    }
+
+    sqlite3_bind_text(stmt, 1, conversation_id, -1, SQLITE_STATIC);
+
+    ErrorCode error = ERROR_NONE;
+    if (sqlite3_step(stmt) != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+    else if (sqlite3_changes(handle) == 0)
+    {
+        error = DB_ERROR_NOT_FOUND;
+    }
+    sqlite3_finalize(stmt);
+
+    if (callback == NULL)
+    {
+        return;
+    }
+
+    ConversationSummary summary;
+    if (error == ERROR_NONE)
+    {
+        error = load_summary(conversation_id, &summary);
+    }
+
+    callback(error == ERROR_NONE ? &summary : NULL, error);
+}
+
+static ErrorCode query_recent_conversations(size_t limit, size_t offset, bool include_archived, SummaryBuffer* buffer)
+{
+    // Both statements are range reads of idx_conversation_summaries_order in index order.
+    sqlite3_stmt* stmt = prepare_summary_query(include_archived
+        ? "SELECT " SUMMARY_COLUMNS " FROM conversation_summaries WHERE " VISIBLE_FILTER " "
+          "ORDER BY is_pinned DESC, is_archived ASC, last_message_timestamp DESC LIMIT ? OFFSET ?;"
+        : "SELECT " SUMMARY_COLUMNS " FROM conversation_summaries "
+          "WHERE is_pinned IN (1, 0) AND is_archived = 0 AND " VISIBLE_FILTER " "
+          "ORDER BY is_pinned DESC, last_message_timestamp DESC LIMIT ? OFFSET ?;");
+    if (stmt == NULL)
+    {
+        return DB_ERROR_QUERY;
+    }
+
+    sqlite3_bind_int64(stmt, 1, sql_limit(limit));
+    sqlite3_bind_int64(stmt, 2, offset > INT64_MAX ? INT64_MAX : (sqlite3_int64)offset);
+    const ErrorCode error = collect_summaries(stmt, buffer);
+    sqlite3_finalize(stmt);
+    return error;
+}
+
+void visit_recent_conversations(size_t limit, size_t offset, bool include_archived, ConversationListVisitor visitor,
+                                void* context)
+{
+    SummaryBuffer buffer = {0};
+    const ErrorCode error = query_recent_conversations(limit, offset, include_archived, &buffer);
+    if (error != ERROR_NONE)
+    {
+        visitor(NULL, 0, error, context);
+    }
+    else
+    {
+        visitor(buffer.items, buffer.count, ERROR_NONE, context);
+    }
+    free(buffer.items);
+}
+
+void get_recent_conversations(size_t limit, size_t offset, bool include_archived, ConversationListCallback callback)
+{
+    if (callback == NULL)
+    {
+        return;
+    }
+
+    // Until something changes, the list saved at the last shutdown is the list.
+    if (!include_archived && conversation_snapshot_serve(limit, offset, callback))
+    {
+        return;
+    }
+
+    SummaryBuffer buffer = {0};
+    const ErrorCode error = query_recent_conversations(limit, offset, include_archived, &buffer);
+    if (error != ERROR_NONE)
+    {
+        callback(NULL, 0, error);
+    }
+    else
+    {
+        callback(buffer.items, buffer.count, ERROR_NONE);
+    }
+    free(buffer.items);
+}
+
+void get_pinned_conversations(ConversationListCallback callback)
+{
+    if (callback == NULL)
+    {
+        return;
+    }
+
+    sqlite3_stmt* stmt = prepare_summary_query(
+        "SELECT " SUMMARY_COLUMNS " FROM conversation_summaries "
+        "WHERE is_pinned = 1 AND " VISIBLE_FILTER " ORDER BY is_archived ASC, last_message_timestamp DESC;");
+    if (stmt == NULL)
+    {
+        callback(NULL, 0, DB_ERROR_QUERY);
+        return;
+    }
+
+    deliver_summaries(stmt, callback);
+}
+
+void get_archived_conversations(size_t limit, size_t offset, ConversationListCallback callback)
+{
+    if (callback == NULL)
+    {
+        return;
+    }
+
+    sqlite3_stmt* stmt = prepare_summary_query(
+        "SELECT " SUMMARY_COLUMNS " FROM conversation_summaries "
+        "WHERE is_pinned IN (1, 0) AND is_archived = 1 AND " VISIBLE_FILTER " "
+        "ORDER BY is_pinned DESC, last_message_timestamp DESC LIMIT ? OFFSET ?;");
+    if (stmt == NULL)
+    {
+        callback(NULL, 0, DB_ERROR_QUERY);
+        return;
+    }
+
+    sqlite3_bind_int64(stmt, 1, sql_limit(limit));
+    sqlite3_bind_int64(stmt, 2, offset > INT64_MAX ? INT64_MAX : (sqlite3_int64)offset);
+    deliver_summaries(stmt, callback);
+}
+
+void pin_conversation(const char* conversation_id, ConversationOperationCallback callback)
+{
+    update_conversation(conversation_id, OPERATION_SQL[CONVERSATION_BATCH_PIN], callback);
+}
+
+void unpin_conversation(const char* conversation_id, ConversationOperationCallback callback)
+{
+    update_conversation(conversation_id, OPERATION_SQL[CONVERSATION_BATCH_UNPIN], callback);
+}
+
+void archive_conversation(const char* conversation_id, ConversationOperationCallback callback)
+{
+    update_conversation(conversation_id, OPERATION_SQL[CONVERSATION_BATCH_ARCHIVE], callback);
+}
+
+void unarchive_conversation(const char* conversation_id, ConversationOperationCallback callback)
+{
+    update_conversation(conversation_id, OPERATION_SQL[CONVERSATION_BATCH_UNARCHIVE], callback);
+}
+
+void mark_conversation_as_read(const char* conversation_id, ConversationOperationCallback callback)
+{
+    update_conversation(conversation_id, OPERATION_SQL[CONVERSATION_BATCH_MARK_READ], callback);
+}
+
+void mute_conversation(const char* conversation_id, ConversationOperationCallback callback)
+{
+    update_conversation(conversation_id, OPERATION_SQL[CONVERSATION_BATCH_MUTE], callback);
+}
+
+void unmute_conversation(const char* conversation_id, ConversationOperationCallback callback)
+{
+    update_conversation(conversation_id, OPERATION_SQL[CONVERSATION_BATCH_UNMUTE], callback);
+}
+
+/**
+ * Runs one statement per conversation inside a single transaction, so the
+ * commit hook publishes every change of the batch at once.
+ */
+static ErrorCode run_conversation_batch(const char* const conversation_ids[], size_t count, const char* sql,
+                                        ConversationBatchResult* result, size_t* failed_indexes)
+{
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    sqlite3_stmt* stmt = prepare_summary_query(sql);
+    if (stmt == NULL)
+    {
+        return DB_ERROR_QUERY;
+    }
+
+    if (db_begin_transaction() != SQLITE_OK)
+    {
+        sqlite3_finalize(stmt);
+        return DB_ERROR_TRANSACTION;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const char* conversation_id = conversation_ids[i];
+        if (conversation_id == NULL || strlen(conversation_id) == 0 || strlen(conversation_id) >= MAX_CONVERSATION_ID_LENGTH)
+        {
+            failed_indexes[result->failed_count++] = i;
+            continue;
+        }
+
+        sqlite3_bind_text(stmt, 1, conversation_id, -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) != SQLITE_DONE)
+        {
+            fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+            sqlite3_finalize(stmt);
+            db_rollback_transaction();
+            return DB_ERROR_QUERY;
+        }
+
+        if (sqlite3_changes(handle) == 0)
+        {
+            failed_indexes[result->failed_count++] = i;
+        }
+        else
+        {
+            result->updated_count++;
+        }
+        sqlite3_reset(stmt);
+    }
+
+    sqlite3_finalize(stmt);
+
+    if (db_commit_transaction() != SQLITE_OK)
+    {
+        db_rollback_transaction();
+        return DB_ERROR_TRANSACTION;
+    }
+
+    return ERROR_NONE;
+}
+
+void apply_conversation_batch(const char* const conversation_ids[], size_t count, ConversationBatchOperation operation,
+                              ConversationBatchCallback callback)
+{
+    if (conversation_ids == NULL || count == 0
+        || (size_t)operation >= sizeof(OPERATION_SQL) / sizeof(OPERATION_SQL[0]))
+    {
+        if (callback != NULL)
+        {
+            callback(NULL, ERROR_INVALID_PARAMS);
+        }
+        return;
+    }
+
+    size_t* failed_indexes = malloc(count * sizeof(size_t));
+    if (failed_indexes == NULL)
+    {
+        if (callback != NULL)
+        {
+            callback(NULL, ERROR_MEMORY_ALLOCATION);
+        }
+        return;
+    }
+
+    ConversationBatchResult result = {0};
+    const ErrorCode error = run_conversation_batch(conversation_ids, count, OPERATION_SQL[operation], &result, failed_indexes);
+    result.failed_indexes = failed_indexes;
+
+    if (callback != NULL)
+    {
+        callback(error == ERROR_NONE ? &result : NULL, error);
+    }
+    free(failed_indexes);
+}
+
+ErrorCode get_total_unread_count(uint32_t* count)
+{
+    if (count == NULL)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(handle, "SELECT total FROM unread_totals WHERE id = 1;", -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    ErrorCode error = ERROR_NONE;
+    const int step = sqlite3_step(stmt);
+    if (step == SQLITE_ROW)
+    {
+        const sqlite3_int64 total = sqlite3_column_int64(stmt, 0);
+        *count = total > 0 ? (uint32_t)total : 0;
+    }
+    else if (step == SQLITE_DONE)
+    {
+        *count = 0;
+    }
+    else
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+
+    sqlite3_finalize(stmt);
+    return error;
+}
+
+static void encode_cursor(const ConversationSummary* last, ConversationCursor* cursor)
+{
+    snprintf(cursor->token, CONVERSATION_CURSOR_LENGTH, "%d:%d:%d:%" PRId64 ":%s", CURSOR_VERSION,
+             last->is_pinned ? 1 : 0, last->is_archived ? 1 : 0, last->last_message_timestamp, last->conversation_id);
+}
+
+static bool decode_cursor(const ConversationCursor* cursor, CursorPosition* position)
+{
+    if (memchr(cursor->token, '\0', CONVERSATION_CURSOR_LENGTH) == NULL)
+    {
+        return false;
+    }
+
+    int version = 0;
+    int consumed = 0;
+    if (sscanf(cursor->token, "%d:%d:%d:%" SCNd64 ":%n", &version, &position->group.is_pinned,
+               &position->group.is_archived, &position->timestamp, &consumed) != 4 || consumed == 0)
+    {
+        return false;
+    }
+
+    const char* conversation_id = cursor->token + consumed;
+    const size_t length = strlen(conversation_id);
+    if (version != CURSOR_VERSION || length == 0 || length >= MAX_CONVERSATION_ID_LENGTH)
+    {
+        return false;
+    }
+
+    memcpy(position->conversation_id, conversation_id, length);
+    position->conversation_id[length] = '\0';
+    return true;
+}
+
+/**
+ * Reads one page by seeking into each list group in order, starting at the
+ * group of the cursor. Every group is a single range of idx_conversation_summaries_order.
+ */
+static void get_conversation_page(const ListGroup* groups, size_t group_count, const ConversationCursor* cursor,
+                                  size_t limit, ConversationPageCallback callback)
+{
+    if (callback == NULL)
+    {
+        return;
+    }
+
+    CursorPosition position = {0};
+    size_t first_group = 0;
+    if (cursor != NULL)
+    {
+        if (!decode_cursor(cursor, &position))
+        {
+            callback(NULL, 0, NULL, ERROR_INVALID_PARAMS);
+            return;
+        }
+
+        while (first_group < group_count
+               && (groups[first_group].is_pinned != position.group.is_pinned
+                   || groups[first_group].is_archived != position.group.is_archived))
+        {
+            first_group++;
+        }
+    }
+
+    if (limit == 0 || first_group == group_count)
+    {
+        callback(NULL, 0, NULL, ERROR_INVALID_PARAMS);
+        return;
+    }
+
+    sqlite3_stmt* stmt = prepare_summary_query(
+        "SELECT " SUMMARY_COLUMNS " FROM conversation_summaries "
+        "WHERE is_pinned = ? AND is_archived = ? AND (last_message_timestamp, conversation_id) < (?, ?) "
+        "AND " VISIBLE_FILTER " ORDER BY last_message_timestamp DESC, conversation_id DESC LIMIT ?;");
+    if (stmt == NULL)
+    {
+        callback(NULL, 0, NULL, DB_ERROR_QUERY);
+        return;
+    }
+
+    // One conversation more than the page holds tells whether another page follows.
+    const size_t read_limit = limit < SIZE_MAX ? limit + 1 : limit;
+    SummaryBuffer buffer = {0};
+    ErrorCode error = ERROR_NONE;
+    for (size_t g = first_group; g < group_count && buffer.count < read_limit && error == ERROR_NONE; g++)
+    {
+        sqlite3_bind_int(stmt, 1, groups[g].is_pinned);
+        sqlite3_bind_int(stmt, 2, groups[g].is_archived);
+
+        if (cursor != NULL && g == first_group)
+        {
+            sqlite3_bind_int64(stmt, 3, position.timestamp);
+            sqlite3_bind_text(stmt, 4, position.conversation_id, -1, SQLITE_STATIC);
+        }
+        else
+        {
+            // SQLite sorts every BLOB after every TEXT, so this bound admits the whole group.
+            sqlite3_bind_int64(stmt, 3, INT64_MAX);
+            sqlite3_bind_zeroblob(stmt, 4, 0);
+        }
+
+        sqlite3_bind_int64(stmt, 5, sql_limit(read_limit - buffer.count));
+        error = collect_summaries(stmt, &buffer);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+
+    if (error != ERROR_NONE)
+    {
+        free(buffer.items);
+        callback(NULL, 0, NULL, error);
+        return;
+    }
+
+    ConversationCursor next_cursor;
+    const bool has_more = buffer.count > limit;
+    if (has_more)
+    {
+        buffer.count = limit;
+        encode_cursor(&buffer.items[buffer.count - 1], &next_cursor);
+    }
+
+    callback(buffer.items, buffer.count, has_more ? &next_cursor : NULL, ERROR_NONE);
+    free(buffer.items);
+}
+
+void get_recent_conversations_page(const ConversationCursor* cursor, size_t limit, bool include_archived, ConversationPageCallback callback)
+{
+    if (include_archived)
+    {
+        get_conversation_page(RECENT_WITH_ARCHIVED_GROUPS,
+                              sizeof(RECENT_WITH_ARCHIVED_GROUPS) / sizeof(RECENT_WITH_ARCHIVED_GROUPS[0]),
+                              cursor, limit, callback);
+    }
+    else
+    {
+        get_conversation_page(RECENT_GROUPS, sizeof(RECENT_GROUPS) / sizeof(RECENT_GROUPS[0]), cursor, limit, callback);
+    }
+}
+
+void get_archived_conversations_page(const ConversationCursor* cursor, size_t limit, ConversationPageCallback callback)
+{
+    get_conversation_page(ARCHIVED_GROUPS, sizeof(ARCHIVED_GROUPS) / sizeof(ARCHIVED_GROUPS[0]), cursor, limit, callback);
+}
+
+static void index_conversation(const char* conversation_id)
+{
+    ConversationSummary summary;
+    const ErrorCode error = load_summary(conversation_id, &summary);
+    if (error != ERROR_NONE)
+    {
+        if (error == DB_ERROR_NOT_FOUND)
+        {
+            prefix_index_remove(conversation_index, conversation_id);
+        }
+        return;
+    }
+
+    // Most updates come from new messages; only a new name needs the text folded and the keys moved.
+    const ConversationSummary* cached = prefix_index_get(conversation_index, conversation_id);
+    if (cached != NULL && strcmp(cached->name, summary.name) == 0)
+    {
+        prefix_index_set_payload(conversation_index, conversation_id, &summary, sizeof(summary));
+    }
+    else
+    {
+        prefix_index_put(conversation_index, summary.conversation_id, summary.name, &summary, sizeof(summary));
+    }
+}
+
+static void publish_list_operations(bool include_archived, const ConversationListOperation operations[], size_t count)
+{
+    ListVariant* variant = &list_variants[include_archived ? 1 : 0];
+    const uint64_t base_version = variant->version++;
+
+    for (size_t i = 0; i < MAX_LIST_SUBSCRIPTIONS; i++)
+    {
+        // Subscribers may unsubscribe from within the callback.
+        const ListSubscription subscription = list_subscriptions[i];
+        if (subscription.id != 0 && subscription.include_archived == include_archived)
+        {
+            subscription.callback(subscription.id, base_version, variant->version, operations, count);
+        }
+    }
+}
+
+/**
+ * Applies the changed conversations to a list model and publishes the
+ * resulting operations as one new version.
+ */
+static void update_list_variant(bool include_archived, const CommittedChange changes[], size_t count)
+{
+    ListVariant* variant = &list_variants[include_archived ? 1 : 0];
+    if (variant->model == NULL)
+    {
+        return;
+    }
+
+    ConversationListOperation* operations = malloc(count * sizeof(ConversationListOperation));
+    if (operations == NULL)
+    {
+        return;
+    }
+
+    size_t operation_count = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (changes[i].entity != CHANGE_ENTITY_CONVERSATION)
+        {
+            continue;
+        }
+
+        const ConversationSummary* summary = prefix_index_get(conversation_index, changes[i].entity_id);
+        const bool changed = summary != NULL && !is_user_blocked(summary->peer_user_id)
+            ? conversation_list_model_upsert(variant->model, summary, &operations[operation_count])
+            : conversation_list_model_remove(variant->model, changes[i].entity_id, &operations[operation_count]);
+        if (changed)
+        {
+            operation_count++;
+        }
+    }
+
+    if (operation_count > 0)
+    {
+        publish_list_operations(include_archived, operations, operation_count);
+    }
+    free(operations);
+}
+
+static void on_conversation_changes(const CommittedChange changes[], size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (changes[i].entity != CHANGE_ENTITY_CONVERSATION)
+        {
+            continue;
+        }
+
+        if (changes[i].operation == LIVE_QUERY_DIFF_DELETE)
+        {
+            prefix_index_remove(conversation_index, changes[i].entity_id);
+        }
+        else
+        {
+            // Message changes arrive as derived updates, keeping the cached summary current.
+            index_conversation(changes[i].entity_id);
+        }
+    }
+
+    update_list_variant(false, changes, count);
+    update_list_variant(true, changes, count);
+}
+
+static bool add_to_list_model(const void* payload, void* context)
+{
+    const ConversationSummary* summary = payload;
+    ConversationListOperation ignored;
+    if (!is_user_blocked(summary->peer_user_id))
+    {
+        conversation_list_model_upsert(context, summary, &ignored);
+    }
+    return true;
+}
+
+/**
+ * Builds the model of a list variant from the cached summaries the first time it is observed.
+ */
+static ErrorCode open_list_variant(bool include_archived)
+{
+    ListVariant* variant = &list_variants[include_archived ? 1 : 0];
+    if (variant->model != NULL)
+    {
+        return ERROR_NONE;
+    }
+
+    variant->model = conversation_list_model_create(include_archived);
+    if (variant->model == NULL)
+    {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    // Version zero is the empty list every subscriber starts from.
+    prefix_index_for_each(conversation_index, add_to_list_model, variant->model);
+    variant->version = 1;
+    return ERROR_NONE;
+}
+
+ErrorCode subscribe_conversation_list_changes(bool include_archived, ConversationListDiffCallback callback,
+                                              ConversationListSubscription* subscription)
+{
+    if (callback == NULL || subscription == NULL)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    if (conversation_index == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    ListSubscription* slot = NULL;
+    for (size_t i = 0; i < MAX_LIST_SUBSCRIPTIONS && slot == NULL; i++)
+    {
+        if (list_subscriptions[i].id == 0)
+        {
+            slot = &list_subscriptions[i];
+        }
+    }
+
+    if (slot == NULL)
+    {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    ErrorCode error = open_list_variant(include_archived);
+    if (error != ERROR_NONE)
+    {
+        return error;
+    }
+
+    // The initial delivery inserts the current list on top of the empty version zero.
+    const ListVariant* variant = &list_variants[include_archived ? 1 : 0];
+    const size_t count = conversation_list_model_count(variant->model);
+    ConversationListOperation* operations = NULL;
+    if (count > 0)
+    {
+        operations = malloc(count * sizeof(ConversationListOperation));
+        if (operations == NULL)
+        {
+            return ERROR_MEMORY_ALLOCATION;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        memset(&operations[i], 0, sizeof(ConversationListOperation));
+        operations[i].type = CONVERSATION_LIST_INSERT;
+        operations[i].to_index = i;
+        operations[i].conversation = *(const ConversationSummary*)prefix_index_get(
+            conversation_index, conversation_list_model_id_at(variant->model, i));
+    }
+
+    slot->id = next_list_subscription++;
+    if (next_list_subscription == 0)
+    {
+        next_list_subscription = 1;
+    }
+    slot->callback = callback;
+    slot->include_archived = include_archived;
+    *subscription = slot->id;
+
+    callback(slot->id, 0, variant->version, operations, count);
+    free(operations);
+    return ERROR_NONE;
+}
+
+ErrorCode unsubscribe_conversation_list_changes(ConversationListSubscription subscription)
+{
+    if (subscription == 0)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    for (size_t i = 0; i < MAX_LIST_SUBSCRIPTIONS; i++)
+    {
+        if (list_subscriptions[i].id == subscription)
+        {
+            memset(&list_subscriptions[i], 0, sizeof(ListSubscription));
+            return ERROR_NONE;
+        }
+    }
+
+    return ERROR_INVALID_PARAMS;
+}
+
+static bool collect_conversation_match(const void* payload, void* context)
+{
+    SummaryBuffer* buffer = context;
+    const ConversationSummary* summary = payload;
+    if (is_user_blocked(summary->peer_user_id))
+    {
+        return true;
+    }
+
+    if (buffer->count == buffer->capacity)
+    {
+        const size_t capacity = buffer->capacity == 0 ? SUMMARY_INITIAL_CAPACITY : buffer->capacity * 2;
+        ConversationSummary* grown = realloc(buffer->items, capacity * sizeof(ConversationSummary));
+        if (grown == NULL)
+        {
+            return false;
+        }
+        buffer->items = grown;
+        buffer->capacity = capacity;
+    }
+
+    buffer->items[buffer->count++] = *summary;
+    return true;
+}
+
+static int compare_by_list_order(const void* lhs, const void* rhs)
+{
+    const ConversationSummary* a = lhs;
+    const ConversationSummary* b = rhs;
+
+    if (a->is_pinned != b->is_pinned)
+    {
+        return a->is_pinned ? -1 : 1;
+    }
+    if (a->is_archived != b->is_archived)
+    {
+        return a->is_archived ? 1 : -1;
+    }
+    if (a->last_message_timestamp != b->last_message_timestamp)
+    {
+        return a->last_message_timestamp > b->last_message_timestamp ? -1 : 1;
+    }
+    return strcmp(b->conversation_id, a->conversation_id);
+}
+
+void search_recent_conversations(const char* query, ConversationListCallback callback)
+{
+    if (callback == NULL)
+    {
+        return;
+    }
+
+    if (query == NULL)
+    {
+        callback(NULL, 0, ERROR_INVALID_PARAMS);
+        return;
+    }
+
+    if (conversation_index == NULL)
+    {
+        callback(NULL, 0, DB_ERROR_INITIALIZATION);
+        return;
+    }
+
+    SummaryBuffer buffer = {0};
+    prefix_index_search(conversation_index, query, collect_conversation_match, &buffer);
+    if (buffer.count > 1)
+    {
+        qsort(buffer.items, buffer.count, sizeof(ConversationSummary), compare_by_list_order);
+    }
+
+    callback(buffer.items, buffer.count, ERROR_NONE);
+    free(buffer.items);
+}
+
+ErrorCode conversation_search_init()
+{
+    if (conversation_index != NULL)
+    {
+        return ERROR_ALREADY_INITIALIZED;
+    }
+
+    sqlite3_stmt* stmt = prepare_summary_query("SELECT " SUMMARY_COLUMNS " FROM conversation_summaries;");
+    if (stmt == NULL)
+    {
+        return DB_ERROR_QUERY;
+    }
+
+    conversation_index = prefix_index_create();
+    if (conversation_index == NULL)
+    {
+        sqlite3_finalize(stmt);
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    ErrorCode error = ERROR_NONE;
+    int step = SQLITE_DONE;
+    while (error == ERROR_NONE && (step = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        ConversationSummary summary;
+        read_summary(stmt, &summary);
+        error = prefix_index_load(conversation_index, summary.conversation_id, summary.name, &summary, sizeof(summary));
+    }
+
+    if (error == ERROR_NONE && step != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db_get_handle()));
+        error = DB_ERROR_QUERY;
+    }
+    sqlite3_finalize(stmt);
+
+    if (error == ERROR_NONE)
+    {
+        error = prefix_index_finish_load(conversation_index);
+    }
+    if (error == ERROR_NONE)
+    {
+        error = live_query_add_observer(on_conversation_changes);
+    }
+
+    if (error != ERROR_NONE)
+    {
+        conversation_search_shutdown();
+    }
+
+    return error;
+}
+
+void conversation_search_shutdown()
+{
+    prefix_index_destroy(conversation_index);
+    conversation_index = NULL;
+
+    for (size_t i = 0; i < 2; i++)
+    {
+        conversation_list_model_destroy(list_variants[i].model);
+    }
+    memset(list_variants, 0, sizeof(list_variants));
+    memset(list_subscriptions, 0, sizeof(list_subscriptions));
+}
@@ -1,10 +1,39 @@
 #include "libmessagekit/core.h"
 #include "libmessagekit/common.h"
+#include "libmessagekit/conversations.h"
+#include "blocked_users.h"
+#include "call_dispatch.h"
+#include "call_history_store.h"
+#include "call_stats_store.h"
+#include "conversation_snapshot.h"
 #include "database.h"
+#include "group_fanout.h"
+#include "group_membership.h"
+#include "live_query_engine.h"
+#include "message_ttl.h"
+#include "receipt_coalescer.h"
+#include "search_index.h"
+
+#include <time.h>
 
 static CoreConfig global_config;
 static bool is_initialized = false;
 
+static void shutdown_modules()
+{
+    receipt_coalescer_shutdown();
+    contact_search_shutdown();
+    conversation_search_shutdown();
+    group_membership_shutdown();
+    blocked_users_shutdown();
+    live_query_shutdown();
+    ttl_shutdown();
+    group_fanout_shutdown();
+    call_dispatch_shutdown();
+    call_stats_store_pending();
+    conversation_snapshot_shutdown();
+}
+
 ErrorCode init(const CoreConfig* config) {
     if (is_initialized) {
         return ERROR_ALREADY_INITIALIZED;
@@ -12,7 +41,7 @@ ErrorCode init(const CoreConfig* config) {
 
     if (config == NULL)
     {
-        return ERROR_INVALID_PARAMETERS;
+        return ERROR_INVALID_PARAMS;
     }
 
     if (config->storage_path == NULL)
@@ -29,7 +58,7 @@ ErrorCode init(const CoreConfig* config) {
 
     int db_result = db_open(config->storage_path, config->database_filename);
     if (db_result != SQLITE_OK) {
-        return ERROR_DATABASE_INITIALIZATION;
+        return DB_ERROR_INITIALIZATION;
     }
 
     char* schema_path = malloc(strlen(config->storage_path) + strlen("/schema.sql") + 1);
@@ -44,13 +73,74 @@ ErrorCode init(const CoreConfig* config) {
 
     if (db_result != SQLITE_OK) {
         db_close();
-        return ERROR_SCHEMA_INITIALIZATION;
+        return DB_ERROR_SCHEMA;
+    }
+
+    ErrorCode module_result = conversation_snapshot_init(config->storage_path);
+    if (module_result == ERROR_NONE) {
+        module_result = ttl_init((int64_t)time(NULL));
+    }
+    if (module_result == ERROR_NONE) {
+        module_result = live_query_init();
+    }
+    if (module_result == ERROR_NONE) {
+        module_result = blocked_users_init();
+    }
+    if (module_result == ERROR_NONE) {
+        module_result = group_membership_init();
+    }
+    if (module_result == ERROR_NONE) {
+        module_result = conversation_search_init();
+    }
+    if (module_result == ERROR_NONE) {
+        module_result = contact_search_init();
+    }
+    if (module_result == ERROR_NONE) {
+        module_result = group_fanout_init(GROUP_FANOUT_WORKERS);
+    }
+    if (module_result == ERROR_NONE) {
+        module_result = call_stats_init();
+    }
+    if (module_result == ERROR_NONE) {
+        module_result = call_dispatch_init();
+    }
+#ifndef NDEBUG
+    // A schema change that leaves a call history filter without an index fails debug builds right away.
+    if (module_result == ERROR_NONE) {
+        module_result = call_history_check_query_plans();
+    }
+#endif
+
+    if (module_result != ERROR_NONE) {
+        shutdown_modules();
+        db_close();
+        return module_result;
     }
 
     is_initialized = true;
     return ERROR_NONE;
 }
 
+ErrorCode deinit()
+{
+    if (!is_initialized)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    // A failed snapshot only costs the next cold start its instant list.
+    const ErrorCode snapshot_result = save_conversation_snapshot();
+    if (snapshot_result != ERROR_NONE)
+    {
+        fprintf(stderr, "Conversation snapshot not saved: %d\n", snapshot_result);
+    }
+
+    shutdown_modules();
+    db_close();
+    is_initialized = false;
+    return ERROR_NONE;
+}
+
 ErrorCode set_notification_token(const char* token)
 {
     if (token == NULL || strlen(token) == 0)
@@ -62,7 +152,7 @@ ErrorCode set_notification_token(const char* token)
 
     if (execute_query(sql) != 0)
     {
-        return ERROR_DATABASE;
+        return DB_ERROR_QUERY;
     }
 
     return ERROR_NONE;
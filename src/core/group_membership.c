@@ -0,0 +1,619 @@
+#include "libmessagekit/group_messages.h"
+#include "database.h"
+#include "group_membership.h"
+#include "id_interner.h"
+#include "roaring.h"
+
+#define MEMBERSHIP_INITIAL_CAPACITY 64
+
+/**
+ * A table of sets indexed by interned number, grown on demand.
+ */
+typedef struct {
+    Roaring** sets;
+    size_t capacity;
+} SetTable;
+
+typedef struct {
+    const char** ids;
+    size_t count;
+    const IdInterner* names;
+    const char* skip_id;
+} IdList;
+
+static IdInterner* member_ids = NULL; // Numbering persisted in group_member_ids
+static IdInterner* group_ids = NULL;  // Numbering local to this process
+static SetTable group_members = {0};  // Group number -> member numbers
+static SetTable user_groups = {0};    // Member number -> group numbers
+
+static ErrorCode reserve_sets(SetTable* table, size_t count)
+{
+    if (count <= table->capacity)
+    {
+        return ERROR_NONE;
+    }
+
+    size_t capacity = table->capacity == 0 ? MEMBERSHIP_INITIAL_CAPACITY : table->capacity;
+    while (capacity < count)
+    {
+        capacity *= 2;
+    }
+
+    Roaring** grown = realloc(table->sets, capacity * sizeof(Roaring*));
+    if (grown == NULL)
+    {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    memset(&grown[table->capacity], 0, (capacity - table->capacity) * sizeof(Roaring*));
+    table->sets = grown;
+    table->capacity = capacity;
+    return ERROR_NONE;
+}
+
+static void clear_sets(SetTable* table)
+{
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        roaring_destroy(table->sets[i]);
+    }
+    free(table->sets);
+    table->sets = NULL;
+    table->capacity = 0;
+}
+
+static const Roaring* find_set(const SetTable* table, const IdInterner* interner, const char* id)
+{
+    uint32_t number;
+    if (!id_interner_find(interner, id, &number) || number >= table->capacity)
+    {
+        return NULL;
+    }
+    return table->sets[number];
+}
+
+static ErrorCode add_user_group(uint32_t user, uint32_t group)
+{
+    ErrorCode error = reserve_sets(&user_groups, (size_t)user + 1);
+    if (error == ERROR_NONE && user_groups.sets[user] == NULL)
+    {
+        user_groups.sets[user] = roaring_create();
+        error = user_groups.sets[user] == NULL ? ERROR_MEMORY_ALLOCATION : ERROR_NONE;
+    }
+    return error == ERROR_NONE ? roaring_add(user_groups.sets[user], group) : error;
+}
+
+static bool is_valid_id(const char* id, size_t size)
+{
+    return id != NULL && id[0] != '\0' && memchr(id, '\0', size) != NULL;
+}
+
+/**
+ * Stores the bitmap of a group. A group whose members all left keeps its
+ * row with an empty bitmap, the row records that its membership is known.
+ */
+static ErrorCode persist_members(sqlite3* handle, const char* group_id, const Roaring* members)
+{
+    const size_t size = roaring_serialized_size(members);
+    uint8_t* blob = malloc(size);
+    if (blob == NULL)
+    {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    const char* sql = "INSERT OR REPLACE INTO group_memberships (group_id, members) VALUES (?, ?);";
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        free(blob);
+        return DB_ERROR_QUERY;
+    }
+
+    sqlite3_bind_text(stmt, 1, group_id, -1, SQLITE_STATIC);
+    roaring_serialize(members, blob);
+    sqlite3_bind_blob(stmt, 2, blob, (int)size, SQLITE_STATIC);
+
+    ErrorCode error = ERROR_NONE;
+    if (sqlite3_step(stmt) != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+    sqlite3_finalize(stmt);
+    free(blob);
+    return error;
+}
+
+/**
+ * Applies the changes to a copy of the group bitmap and writes new member
+ * numbers along with it. The in-memory state is only replaced once the
+ * transaction has committed, a failure also forgets the new numbers.
+ */
+static ErrorCode write_members(sqlite3* handle, const char* group_id, Roaring* members,
+                               const char* const user_ids[], size_t count, bool add)
+{
+    sqlite3_stmt* stmt = NULL;
+    if (add && sqlite3_prepare_v2(handle, "INSERT INTO group_member_ids (number, user_id) VALUES (?, ?);",
+                                  -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    const size_t known_members = id_interner_count(member_ids);
+    ErrorCode error = ERROR_NONE;
+    for (size_t i = 0; i < count && error == ERROR_NONE; i++)
+    {
+        uint32_t number;
+        if (!add)
+        {
+            if (id_interner_find(member_ids, user_ids[i], &number))
+            {
+                roaring_remove(members, number);
+            }
+            continue;
+        }
+
+        error = id_interner_intern(member_ids, user_ids[i], &number);
+        if (error == ERROR_NONE && number >= known_members && !roaring_contains(members, number))
+        {
+            sqlite3_bind_int64(stmt, 1, number);
+            sqlite3_bind_text(stmt, 2, user_ids[i], -1, SQLITE_STATIC);
+            if (sqlite3_step(stmt) != SQLITE_DONE)
+            {
+                fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+                error = DB_ERROR_QUERY;
+            }
+            sqlite3_reset(stmt);
+        }
+
+        if (error == ERROR_NONE)
+        {
+            error = roaring_add(members, number);
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    if (error == ERROR_NONE)
+    {
+        error = persist_members(handle, group_id, members);
+    }
+
+    if (error != ERROR_NONE)
+    {
+        id_interner_truncate(member_ids, known_members);
+    }
+    return error;
+}
+
+static ErrorCode update_group_members(const char* group_id, const char* const user_ids[], size_t count, bool add)
+{
+    if (!is_valid_id(group_id, GROUP_ID_LENGTH) || user_ids == NULL || count == 0)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!is_valid_id(user_ids[i], USER_ID_LENGTH))
+        {
+            return ERROR_INVALID_PARAMS;
+        }
+    }
+
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL || member_ids == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    // A new group is only numbered once its membership is committed, a failed write leaves no trace.
+    uint32_t group;
+    const bool is_known = id_interner_find(group_ids, group_id, &group) && group < group_members.capacity;
+    const Roaring* previous = is_known ? group_members.sets[group] : NULL;
+    Roaring* members = previous != NULL ? roaring_clone(previous) : roaring_create();
+    if (members == NULL)
+    {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    if (db_begin_transaction() != SQLITE_OK)
+    {
+        roaring_destroy(members);
+        return DB_ERROR_TRANSACTION;
+    }
+
+    const size_t known_members = id_interner_count(member_ids);
+    ErrorCode error = write_members(handle, group_id, members, user_ids, count, add);
+    if (error == ERROR_NONE && db_commit_transaction() != SQLITE_OK)
+    {
+        error = DB_ERROR_TRANSACTION;
+    }
+
+    if (error != ERROR_NONE)
+    {
+        db_rollback_transaction();
+        id_interner_truncate(member_ids, known_members);
+        roaring_destroy(members);
+        return error;
+    }
+
+    if (!is_known)
+    {
+        error = id_interner_intern(group_ids, group_id, &group);
+    }
+    if (error == ERROR_NONE)
+    {
+        error = reserve_sets(&group_members, (size_t)group + 1);
+    }
+    if (error != ERROR_NONE)
+    {
+        // Committed but not mirrored, the next init loads it.
+        roaring_destroy(members);
+        return error;
+    }
+
+    // Mirror the committed change into the reverse index.
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t user;
+        if (!id_interner_find(member_ids, user_ids[i], &user))
+        {
+            continue;
+        }
+
+        if (add)
+        {
+            const ErrorCode added = add_user_group(user, group);
+            error = error == ERROR_NONE ? added : error;
+        }
+        else if (user < user_groups.capacity)
+        {
+            roaring_remove(user_groups.sets[user], group);
+        }
+    }
+
+    roaring_destroy(group_members.sets[group]);
+    group_members.sets[group] = members;
+    return error;
+}
+
+static bool collect_id(uint32_t number, void* context)
+{
+    IdList* list = context;
+    const char* id = id_interner_name(list->names, number);
+    if (id != NULL && (list->skip_id == NULL || strcmp(id, list->skip_id) != 0))
+    {
+        list->ids[list->count++] = id;
+    }
+    return true;
+}
+
+/**
+ * Resolves a set of numbers to IDs and delivers them.
+ */
+static void deliver_ids(const Roaring* set, const IdInterner* names, GroupIdListCallback callback)
+{
+    const size_t cardinality = roaring_cardinality(set);
+    IdList list = {0};
+    list.names = names;
+    if (cardinality > 0)
+    {
+        list.ids = malloc(cardinality * sizeof(const char*));
+        if (list.ids == NULL)
+        {
+            callback(NULL, 0, ERROR_MEMORY_ALLOCATION);
+            return;
+        }
+        roaring_for_each(set, collect_id, &list);
+    }
+
+    callback(list.ids, list.count, ERROR_NONE);
+    free(list.ids);
+}
+
+void add_group_members(const char* group_id, const char* const user_ids[], size_t count, GroupOperationCallback callback)
+{
+    const ErrorCode error = update_group_members(group_id, user_ids, count, true);
+    if (callback != NULL)
+    {
+        callback(error);
+    }
+}
+
+void remove_group_members(const char* group_id, const char* const user_ids[], size_t count, GroupOperationCallback callback)
+{
+    const ErrorCode error = update_group_members(group_id, user_ids, count, false);
+    if (callback != NULL)
+    {
+        callback(error);
+    }
+}
+
+bool is_group_member(const char* group_id, const char* user_id)
+{
+    uint32_t user;
+    return id_interner_find(member_ids, user_id, &user)
+        && roaring_contains(find_set(&group_members, group_ids, group_id), user);
+}
+
+bool group_member_number(const char* group_id, const char* user_id, uint32_t* number)
+{
+    uint32_t user;
+    if (number == NULL || !id_interner_find(member_ids, user_id, &user)
+        || !roaring_contains(find_set(&group_members, group_ids, group_id), user))
+    {
+        return false;
+    }
+
+    *number = user;
+    return true;
+}
+
+const char* group_member_id(uint32_t number)
+{
+    return id_interner_name(member_ids, number);
+}
+
+bool group_accepts_sender(const char* conversation_id, const char* sender_id)
+{
+    // A set exists for every group with recorded membership, even once all members are gone.
+    const Roaring* members = find_set(&group_members, group_ids, conversation_id);
+    if (members == NULL)
+    {
+        return true;
+    }
+
+    uint32_t user;
+    return id_interner_find(member_ids, sender_id, &user) && roaring_contains(members, user);
+}
+
+ErrorCode get_group_member_count(const char* group_id, size_t* count)
+{
+    if (group_id == NULL || count == NULL)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    *count = roaring_cardinality(find_set(&group_members, group_ids, group_id));
+    return ERROR_NONE;
+}
+
+void get_group_members(const char* group_id, GroupIdListCallback callback)
+{
+    if (callback == NULL)
+    {
+        return;
+    }
+
+    if (group_id == NULL)
+    {
+        callback(NULL, 0, ERROR_INVALID_PARAMS);
+        return;
+    }
+
+    deliver_ids(find_set(&group_members, group_ids, group_id), member_ids, callback);
+}
+
+void get_user_groups(const char* user_id, GroupIdListCallback callback)
+{
+    if (callback == NULL)
+    {
+        return;
+    }
+
+    if (user_id == NULL)
+    {
+        callback(NULL, 0, ERROR_INVALID_PARAMS);
+        return;
+    }
+
+    deliver_ids(find_set(&user_groups, member_ids, user_id), group_ids, callback);
+}
+
+void get_common_group_members(const char* group_id, const char* other_group_id, GroupIdListCallback callback)
+{
+    if (callback == NULL)
+    {
+        return;
+    }
+
+    if (group_id == NULL || other_group_id == NULL)
+    {
+        callback(NULL, 0, ERROR_INVALID_PARAMS);
+        return;
+    }
+
+    const Roaring* members = find_set(&group_members, group_ids, group_id);
+    const Roaring* other_members = find_set(&group_members, group_ids, other_group_id);
+    const size_t smaller = roaring_cardinality(members) < roaring_cardinality(other_members)
+        ? roaring_cardinality(members)
+        : roaring_cardinality(other_members);
+
+    IdList list = {0};
+    list.names = member_ids;
+    if (smaller > 0)
+    {
+        list.ids = malloc(smaller * sizeof(const char*));
+        if (list.ids == NULL)
+        {
+            callback(NULL, 0, ERROR_MEMORY_ALLOCATION);
+            return;
+        }
+        roaring_for_each_intersection(members, other_members, collect_id, &list);
+    }
+
+    callback(list.ids, list.count, ERROR_NONE);
+    free(list.ids);
+}
+
+void send_group_message_to_members(const GroupMessage* message, GroupSendCallback callback)
+{
+    if (message == NULL)
+    {
+        if (callback != NULL)
+        {
+            callback(NULL, ERROR_INVALID_PARAMS);
+        }
+        return;
+    }
+
+    const Roaring* members = find_set(&group_members, group_ids, message->group_id);
+    const size_t cardinality = roaring_cardinality(members);
+    IdList list = {0};
+    list.names = member_ids;
+    list.skip_id = message->sender_id;
+    if (cardinality > 0)
+    {
+        list.ids = malloc(cardinality * sizeof(const char*));
+        if (list.ids == NULL)
+        {
+            if (callback != NULL)
+            {
+                callback(NULL, ERROR_MEMORY_ALLOCATION);
+            }
+            return;
+        }
+        roaring_for_each(members, collect_id, &list);
+    }
+
+    // An empty recipient list is rejected by send_group_message.
+    send_group_message(message, list.ids, list.count, callback);
+    free(list.ids);
+}
+
+static ErrorCode load_member_ids(sqlite3* handle)
+{
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(handle, "SELECT number, user_id FROM group_member_ids ORDER BY number;",
+                           -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    ErrorCode error = ERROR_NONE;
+    int step = SQLITE_DONE;
+    while (error == ERROR_NONE && (step = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        // Numbers are assigned densely, so interning in order reproduces them.
+        uint32_t number;
+        error = id_interner_intern(member_ids, (const char*)sqlite3_column_text(stmt, 1), &number);
+        if (error == ERROR_NONE && number != (uint32_t)sqlite3_column_int64(stmt, 0))
+        {
+            error = DB_ERROR_SCHEMA;
+        }
+    }
+
+    if (error == ERROR_NONE && step != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+    sqlite3_finalize(stmt);
+    return error;
+}
+
+typedef struct {
+    uint32_t group;
+    ErrorCode error;
+} IndexContext;
+
+static bool index_user_group(uint32_t user, void* context)
+{
+    IndexContext* index = context;
+
+    // Every member number has to be known, otherwise the bitmap refers to a lost ID.
+    index->error = user < id_interner_count(member_ids) ? add_user_group(user, index->group) : DB_ERROR_SCHEMA;
+    return index->error == ERROR_NONE;
+}
+
+static ErrorCode load_memberships(sqlite3* handle)
+{
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(handle, "SELECT group_id, members FROM group_memberships;", -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    ErrorCode error = ERROR_NONE;
+    int step = SQLITE_DONE;
+    while (error == ERROR_NONE && (step = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        Roaring* members = roaring_deserialize(sqlite3_column_blob(stmt, 1), (size_t)sqlite3_column_bytes(stmt, 1));
+        if (members == NULL)
+        {
+            error = DB_ERROR_SCHEMA;
+            break;
+        }
+
+        uint32_t group;
+        error = id_interner_intern(group_ids, (const char*)sqlite3_column_text(stmt, 0), &group);
+        if (error == ERROR_NONE)
+        {
+            error = reserve_sets(&group_members, (size_t)group + 1);
+        }
+        if (error != ERROR_NONE)
+        {
+            roaring_destroy(members);
+            break;
+        }
+
+        group_members.sets[group] = members;
+        IndexContext index = {group, ERROR_NONE};
+        roaring_for_each(members, index_user_group, &index);
+        error = index.error;
+    }
+
+    if (error == ERROR_NONE && step != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+    sqlite3_finalize(stmt);
+    return error;
+}
+
+ErrorCode group_membership_init()
+{
+    if (member_ids != NULL)
+    {
+        return ERROR_ALREADY_INITIALIZED;
+    }
+
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    member_ids = id_interner_create();
+    group_ids = id_interner_create();
+    ErrorCode error = member_ids == NULL || group_ids == NULL ? ERROR_MEMORY_ALLOCATION : ERROR_NONE;
+    if (error == ERROR_NONE)
+    {
+        error = load_member_ids(handle);
+    }
+    if (error == ERROR_NONE)
+    {
+        error = load_memberships(handle);
+    }
+
+    if (error != ERROR_NONE)
+    {
+        group_membership_shutdown();
+    }
+    return error;
+}
+
+void group_membership_shutdown()
+{
+    clear_sets(&group_members);
+    clear_sets(&user_groups);
+    id_interner_destroy(member_ids);
+    id_interner_destroy(group_ids);
+    member_ids = NULL;
+    group_ids = NULL;
+}
@@ -0,0 +1,399 @@
+#include "libmessagekit/group_messages.h"
+#include "database.h"
+#include "group_fanout.h"
+#include "worker_pool.h"
+
+#include <pthread.h>
+
+// Recipient states are packed four to a byte, chunks own whole bytes so workers never share one.
+#define STATES_PER_BYTE 4
+_Static_assert(GROUP_FANOUT_CHUNK_SIZE % STATES_PER_BYTE == 0, "chunks must cover whole state bytes");
+
+// Chunks being encoded ahead of the one being transmitted, per worker.
+#define FANOUT_WINDOW_PER_WORKER 2
+
+typedef struct FanoutJob FanoutJob;
+
+typedef struct {
+    FanoutJob* job;
+    size_t index;
+    size_t begin;
+    size_t end;
+    uint8_t* frame;
+    size_t frame_size;
+    size_t entry_count;
+    bool done;
+} FanoutChunk;
+
+struct FanoutJob {
+    const GroupMessage* message;
+    const char* const* recipient_ids;
+    const uint8_t* payload;
+    size_t payload_size;
+    GroupRecipientEncoder encoder;
+    uint8_t* states;
+    FanoutChunk* chunks;
+    size_t chunk_count;
+    pthread_mutex_t lock;
+    pthread_cond_t chunk_done;
+};
+
+static WorkerPool* fanout_pool = NULL;
+static size_t fanout_workers = 0;
+static GroupRecipientEncoder recipient_encoder = NULL;
+static GroupFrameSink frame_sink = NULL;
+
+static GroupRecipientState read_state(const uint8_t* states, size_t index)
+{
+    return (GroupRecipientState)((states[index / STATES_PER_BYTE] >> ((index % STATES_PER_BYTE) * 2)) & 0x3);
+}
+
+static void write_state(uint8_t* states, size_t index, GroupRecipientState state)
+{
+    const unsigned shift = (unsigned)(index % STATES_PER_BYTE) * 2;
+    uint8_t* byte = &states[index / STATES_PER_BYTE];
+    *byte = (uint8_t)((*byte & ~(0x3u << shift)) | ((unsigned)state << shift));
+}
+
+static uint8_t* put_u32(uint8_t* cursor, uint32_t value)
+{
+    cursor[0] = (uint8_t)value;
+    cursor[1] = (uint8_t)(value >> 8);
+    cursor[2] = (uint8_t)(value >> 16);
+    cursor[3] = (uint8_t)(value >> 24);
+    return cursor + 4;
+}
+
+static uint8_t* put_u64(uint8_t* cursor, uint64_t value)
+{
+    return put_u32(put_u32(cursor, (uint32_t)value), (uint32_t)(value >> 32));
+}
+
+static uint8_t* put_id(uint8_t* cursor, const char* id, size_t length)
+{
+    *cursor++ = (uint8_t)length;
+    memcpy(cursor, id, length);
+    return cursor + length;
+}
+
+static size_t valid_id_length(const char* id, size_t size)
+{
+    if (id == NULL || memchr(id, '\0', size) == NULL)
+    {
+        return 0;
+    }
+    return strlen(id);
+}
+
+static ErrorCode copy_payload(const char* recipient_id, const uint8_t* payload, size_t payload_size,
+                              uint8_t* envelope, size_t envelope_capacity, size_t* envelope_size)
+{
+    (void)recipient_id;
+    if (payload_size > envelope_capacity)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    memcpy(envelope, payload, payload_size);
+    *envelope_size = payload_size;
+    return ERROR_NONE;
+}
+
+/**
+ * Builds the frame of one chunk. Runs on a worker thread, recipients that
+ * cannot be encoded are marked failed and left out of the frame.
+ */
+static void encode_chunk(void* argument)
+{
+    FanoutChunk* chunk = argument;
+    FanoutJob* job = chunk->job;
+    const GroupMessage* message = job->message;
+    const size_t envelope_capacity = job->payload_size + GROUP_ENVELOPE_OVERHEAD;
+    const size_t group_length = strlen(message->group_id);
+    const size_t message_length = strlen(message->message_id);
+    const size_t sender_length = strlen(message->sender_id);
+
+    const size_t header_size = 4 + 1 + (1 + group_length) + (1 + message_length) + (1 + sender_length) + 1 + 8
+        + 4 + 4 + 4;
+    const size_t entry_capacity = 1 + USER_ID_LENGTH + 4 + envelope_capacity;
+    chunk->frame = malloc(header_size + (chunk->end - chunk->begin) * entry_capacity);
+
+    if (chunk->frame == NULL)
+    {
+        for (size_t i = chunk->begin; i < chunk->end; i++)
+        {
+            write_state(job->states, i, GROUP_RECIPIENT_FAILED);
+        }
+    }
+    else
+    {
+        uint8_t* cursor = put_u32(chunk->frame, GROUP_FRAME_MAGIC);
+        *cursor++ = GROUP_FRAME_VERSION;
+        cursor = put_id(cursor, message->group_id, group_length);
+        cursor = put_id(cursor, message->message_id, message_length);
+        cursor = put_id(cursor, message->sender_id, sender_length);
+        *cursor++ = (uint8_t)message->type;
+        cursor = put_u64(cursor, (uint64_t)message->timestamp);
+        cursor = put_u32(cursor, (uint32_t)chunk->index);
+        cursor = put_u32(cursor, (uint32_t)job->chunk_count);
+        uint8_t* entry_count_field = cursor;
+        cursor += 4;
+
+        for (size_t i = chunk->begin; i < chunk->end; i++)
+        {
+            const char* recipient_id = job->recipient_ids[i];
+            const size_t id_length = valid_id_length(recipient_id, USER_ID_LENGTH);
+            if (id_length == 0)
+            {
+                write_state(job->states, i, GROUP_RECIPIENT_FAILED);
+                continue;
+            }
+
+            uint8_t* envelope = put_id(cursor, recipient_id, id_length) + 4;
+            size_t envelope_size = 0;
+            if (job->encoder(recipient_id, job->payload, job->payload_size, envelope, envelope_capacity,
+                             &envelope_size) != ERROR_NONE
+                || envelope_size > envelope_capacity)
+            {
+                write_state(job->states, i, GROUP_RECIPIENT_FAILED);
+                continue;
+            }
+
+            put_u32(envelope - 4, (uint32_t)envelope_size);
+            cursor = envelope + envelope_size;
+            chunk->entry_count++;
+        }
+
+        put_u32(entry_count_field, (uint32_t)chunk->entry_count);
+        chunk->frame_size = (size_t)(cursor - chunk->frame);
+    }
+
+    pthread_mutex_lock(&job->lock);
+    chunk->done = true;
+    pthread_cond_broadcast(&job->chunk_done);
+    pthread_mutex_unlock(&job->lock);
+}
+
+static void schedule_chunk(FanoutChunk* chunk)
+{
+    // Without a pool, or when its queue is full, the sender encodes the chunk itself.
+    if (fanout_pool == NULL || worker_pool_submit(fanout_pool, encode_chunk, chunk) != ERROR_NONE)
+    {
+        encode_chunk(chunk);
+    }
+}
+
+/**
+ * Transmits the chunks in order while the workers encode the ones after
+ * them, keeping at most a window of encoded frames in memory.
+ */
+static void run_fanout(FanoutJob* job, GroupSendResult* result)
+{
+    const size_t window = (fanout_workers == 0 ? 1 : fanout_workers) * FANOUT_WINDOW_PER_WORKER;
+    size_t scheduled = 0;
+    while (scheduled < job->chunk_count && scheduled < window)
+    {
+        schedule_chunk(&job->chunks[scheduled++]);
+    }
+
+    for (size_t c = 0; c < job->chunk_count; c++)
+    {
+        FanoutChunk* chunk = &job->chunks[c];
+
+        pthread_mutex_lock(&job->lock);
+        while (!chunk->done)
+        {
+            pthread_cond_wait(&job->chunk_done, &job->lock);
+        }
+        pthread_mutex_unlock(&job->lock);
+
+        bool sent = false;
+        if (chunk->entry_count > 0)
+        {
+            sent = frame_sink(chunk->frame, chunk->frame_size) == ERROR_NONE;
+            result->frame_count++;
+        }
+
+        for (size_t i = chunk->begin; i < chunk->end; i++)
+        {
+            if (read_state(job->states, i) == GROUP_RECIPIENT_PENDING)
+            {
+                write_state(job->states, i, sent ? GROUP_RECIPIENT_SENT : GROUP_RECIPIENT_FAILED);
+            }
+
+            if (read_state(job->states, i) == GROUP_RECIPIENT_SENT)
+            {
+                result->sent_count++;
+            }
+            else
+            {
+                result->failed_count++;
+            }
+        }
+
+        free(chunk->frame);
+        chunk->frame = NULL;
+
+        if (scheduled < job->chunk_count)
+        {
+            schedule_chunk(&job->chunks[scheduled++]);
+        }
+    }
+}
+
+static ErrorCode store_group_message(const GroupMessage* message)
+{
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    const char* sql = "INSERT OR IGNORE INTO messages (id, conversation_id, sender_id, type, timestamp, content, is_outgoing) "
+                      "VALUES (?, ?, ?, ?, ?, ?, 1);";
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    sqlite3_bind_text(stmt, 1, message->message_id, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, message->group_id, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, message->sender_id, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 4, (int)message->type);
+    sqlite3_bind_int64(stmt, 5, message->timestamp);
+    sqlite3_bind_text(stmt, 6, message->content, -1, SQLITE_STATIC);
+
+    ErrorCode error = ERROR_NONE;
+    if (sqlite3_step(stmt) != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+    sqlite3_finalize(stmt);
+
+    return error;
+}
+
+static void notify_send_result(GroupSendCallback callback, const GroupSendResult* result, ErrorCode error)
+{
+    if (callback != NULL)
+    {
+        callback(error == ERROR_NONE ? result : NULL, error);
+    }
+}
+
+void set_group_recipient_encoder(GroupRecipientEncoder encoder)
+{
+    recipient_encoder = encoder;
+}
+
+void set_group_frame_sink(GroupFrameSink sink)
+{
+    frame_sink = sink;
+}
+
+void send_group_message(const GroupMessage* message, const char* const recipient_ids[], size_t recipient_count,
+                        GroupSendCallback callback)
+{
+    GroupSendResult result = {0};
+
+    if (message == NULL || recipient_ids == NULL || recipient_count == 0 || recipient_count > UINT32_MAX
+        || valid_id_length(message->message_id, MESSAGE_ID_LENGTH) == 0
+        || valid_id_length(message->group_id, GROUP_ID_LENGTH) == 0
+        || valid_id_length(message->sender_id, USER_ID_LENGTH) == 0
+        || memchr(message->content, '\0', MAX_CONTENT_LENGTH) == NULL)
+    {
+        notify_send_result(callback, &result, ERROR_INVALID_PARAMS);
+        return;
+    }
+
+    if (frame_sink == NULL)
+    {
+        notify_send_result(callback, &result, NETWORK_ERROR_CONNECTION_FAILED);
+        return;
+    }
+
+    ErrorCode error = store_group_message(message);
+    if (error != ERROR_NONE)
+    {
+        notify_send_result(callback, &result, error);
+        return;
+    }
+
+    FanoutJob job = {0};
+    job.message = message;
+    job.recipient_ids = recipient_ids;
+    job.payload = (const uint8_t*)message->content;
+    job.payload_size = strlen(message->content);
+    job.encoder = recipient_encoder != NULL ? recipient_encoder : copy_payload;
+    job.chunk_count = (recipient_count + GROUP_FANOUT_CHUNK_SIZE - 1) / GROUP_FANOUT_CHUNK_SIZE;
+    job.states = calloc((recipient_count + STATES_PER_BYTE - 1) / STATES_PER_BYTE, 1);
+    job.chunks = calloc(job.chunk_count, sizeof(FanoutChunk));
+    if (job.states == NULL || job.chunks == NULL)
+    {
+        free(job.states);
+        free(job.chunks);
+        notify_send_result(callback, &result, ERROR_MEMORY_ALLOCATION);
+        return;
+    }
+
+    for (size_t c = 0; c < job.chunk_count; c++)
+    {
+        job.chunks[c].job = &job;
+        job.chunks[c].index = c;
+        job.chunks[c].begin = c * GROUP_FANOUT_CHUNK_SIZE;
+        job.chunks[c].end = job.chunks[c].begin + GROUP_FANOUT_CHUNK_SIZE < recipient_count
+            ? job.chunks[c].begin + GROUP_FANOUT_CHUNK_SIZE
+            : recipient_count;
+    }
+
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.chunk_done, NULL);
+
+    memcpy(result.message_id, message->message_id, strlen(message->message_id) + 1);
+    result.recipient_count = recipient_count;
+    run_fanout(&job, &result);
+    result.recipient_states = job.states;
+
+    pthread_cond_destroy(&job.chunk_done);
+    pthread_mutex_destroy(&job.lock);
+
+    notify_send_result(callback, &result, ERROR_NONE);
+    free(job.chunks);
+    free(job.states);
+}
+
+GroupRecipientState get_group_recipient_state(const GroupSendResult* result, size_t index)
+{
+    if (result == NULL || result->recipient_states == NULL || index >= result->recipient_count)
+    {
+        return GROUP_RECIPIENT_FAILED;
+    }
+    return read_state(result->recipient_states, index);
+}
+
+ErrorCode group_fanout_init(size_t worker_count)
+{
+    if (fanout_pool != NULL)
+    {
+        return ERROR_ALREADY_INITIALIZED;
+    }
+
+    fanout_pool = worker_pool_create(worker_count, GROUP_FANOUT_QUEUE_SIZE);
+    if (fanout_pool == NULL)
+    {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    fanout_workers = worker_count;
+    return ERROR_NONE;
+}
+
+void group_fanout_shutdown()
+{
+    worker_pool_destroy(fanout_pool);
+    fanout_pool = NULL;
+    fanout_workers = 0;
+}
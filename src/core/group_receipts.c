@@ -0,0 +1,405 @@
+#include "libmessagekit/group_messages.h"
+#include "database.h"
+#include "group_membership.h"
+#include "roaring.h"
+
+/**
+ * Receipt state of one message while a batch is folded into it.
+ */
+typedef struct {
+    char group_id[GROUP_ID_LENGTH];
+    Roaring* delivered;
+    Roaring* read;
+} ReceiptState;
+
+typedef struct {
+    const char** ids;
+    size_t count;
+} MemberList;
+
+static int compare_receipts(const void* a, const void* b)
+{
+    const GroupReceipt* const* first = a;
+    const GroupReceipt* const* second = b;
+    return strcmp((*first)->message_id, (*second)->message_id);
+}
+
+static bool is_valid_receipt(const GroupReceipt* receipt)
+{
+    return memchr(receipt->message_id, '\0', MESSAGE_ID_LENGTH) != NULL
+        && memchr(receipt->user_id, '\0', USER_ID_LENGTH) != NULL
+        && (receipt->type == GROUP_RECEIPT_DELIVERED || receipt->type == GROUP_RECEIPT_READ);
+}
+
+static Roaring* load_bitmap(sqlite3_stmt* stmt, int column)
+{
+    if (sqlite3_column_type(stmt, column) == SQLITE_NULL)
+    {
+        return roaring_create();
+    }
+    return roaring_deserialize(sqlite3_column_blob(stmt, column), (size_t)sqlite3_column_bytes(stmt, column));
+}
+
+/**
+ * Loads the stored bitmaps of a message, a message without receipts yet starts empty.
+ */
+static ErrorCode load_state(sqlite3* handle, sqlite3_stmt* stmt, const char* message_id, ReceiptState* state)
+{
+    sqlite3_bind_text(stmt, 1, message_id, -1, SQLITE_STATIC);
+    const int step = sqlite3_step(stmt);
+
+    ErrorCode error = ERROR_NONE;
+    if (step == SQLITE_ROW)
+    {
+        const char* group_id = (const char*)sqlite3_column_text(stmt, 0);
+        strncpy(state->group_id, group_id != NULL ? group_id : "", GROUP_ID_LENGTH - 1);
+        state->group_id[GROUP_ID_LENGTH - 1] = '\0';
+        state->delivered = load_bitmap(stmt, 1);
+        state->read = load_bitmap(stmt, 2);
+        if (state->delivered == NULL || state->read == NULL)
+        {
+            error = DB_ERROR_SCHEMA;
+        }
+    }
+    else if (step == SQLITE_DONE)
+    {
+        error = DB_ERROR_NOT_FOUND;
+    }
+    else
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+
+    sqlite3_reset(stmt);
+    return error;
+}
+
+static ErrorCode store_state(sqlite3* handle, sqlite3_stmt* stmt, const char* message_id, const ReceiptState* state)
+{
+    const size_t delivered_size = roaring_serialized_size(state->delivered);
+    const size_t read_size = roaring_serialized_size(state->read);
+    uint8_t* buffer = malloc(delivered_size + read_size);
+    if (buffer == NULL)
+    {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    roaring_serialize(state->delivered, buffer);
+    roaring_serialize(state->read, buffer + delivered_size);
+
+    sqlite3_bind_text(stmt, 1, message_id, -1, SQLITE_STATIC);
+    sqlite3_bind_blob(stmt, 2, buffer, (int)delivered_size, SQLITE_STATIC);
+    sqlite3_bind_blob(stmt, 3, buffer + delivered_size, (int)read_size, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 4, (sqlite3_int64)roaring_cardinality(state->delivered));
+    sqlite3_bind_int64(stmt, 5, (sqlite3_int64)roaring_cardinality(state->read));
+
+    ErrorCode error = ERROR_NONE;
+    if (sqlite3_step(stmt) != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+    sqlite3_reset(stmt);
+    free(buffer);
+    return error;
+}
+
+/**
+ * Sets the member bits of one receipt, a read receipt sets both bitsets.
+ *
+ * @return ErrorCode of the update, changed is set when a bit was new.
+ */
+static ErrorCode fold_receipt(ReceiptState* state, const GroupReceipt* receipt, bool* changed)
+{
+    uint32_t member;
+    *changed = false;
+    if (!group_member_number(state->group_id, receipt->user_id, &member))
+    {
+        return ERROR_NONE;
+    }
+
+    ErrorCode error = ERROR_NONE;
+    if (!roaring_contains(state->delivered, member))
+    {
+        error = roaring_add(state->delivered, member);
+        *changed = true;
+    }
+
+    if (error == ERROR_NONE && receipt->type == GROUP_RECEIPT_READ && !roaring_contains(state->read, member))
+    {
+        error = roaring_add(state->read, member);
+        *changed = true;
+    }
+    return error;
+}
+
+/**
+ * Folds one run of receipts for the same message into its bitsets and
+ * writes the message once, receipts for unknown messages are skipped.
+ */
+static ErrorCode apply_message_receipts(sqlite3* handle, sqlite3_stmt* select_stmt, sqlite3_stmt* upsert_stmt,
+                                        const GroupReceipt* const receipts[], size_t count, size_t* applied_count)
+{
+    ReceiptState state = {0};
+    ErrorCode error = load_state(handle, select_stmt, receipts[0]->message_id, &state);
+    if (error == DB_ERROR_NOT_FOUND)
+    {
+        return ERROR_NONE;
+    }
+
+    size_t applied = 0;
+    for (size_t i = 0; i < count && error == ERROR_NONE; i++)
+    {
+        bool changed;
+        error = fold_receipt(&state, receipts[i], &changed);
+        applied += changed ? 1 : 0;
+    }
+
+    if (error == ERROR_NONE && applied > 0)
+    {
+        error = store_state(handle, upsert_stmt, receipts[0]->message_id, &state);
+    }
+
+    if (error == ERROR_NONE)
+    {
+        *applied_count += applied;
+    }
+
+    roaring_destroy(state.delivered);
+    roaring_destroy(state.read);
+    return error;
+}
+
+static ErrorCode apply_sorted_receipts(sqlite3* handle, const GroupReceipt* const receipts[], size_t count,
+                                       size_t* applied_count)
+{
+    sqlite3_stmt* select_stmt = NULL;
+    sqlite3_stmt* upsert_stmt = NULL;
+    const char* select_sql = "SELECT m.conversation_id, r.delivered, r.read FROM messages m "
+                             "LEFT JOIN group_receipts r ON r.message_id = m.id WHERE m.id = ?;";
+    const char* upsert_sql = "INSERT OR REPLACE INTO group_receipts (message_id, delivered, read, delivered_count, read_count) "
+                             "VALUES (?, ?, ?, ?, ?);";
+    if (sqlite3_prepare_v2(handle, select_sql, -1, &select_stmt, NULL) != SQLITE_OK
+        || sqlite3_prepare_v2(handle, upsert_sql, -1, &upsert_stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        sqlite3_finalize(select_stmt);
+        return DB_ERROR_QUERY;
+    }
+
+    ErrorCode error = ERROR_NONE;
+    size_t start = 0;
+    while (start < count && error == ERROR_NONE)
+    {
+        size_t end = start + 1;
+        while (end < count && strcmp(receipts[end]->message_id, receipts[start]->message_id) == 0)
+        {
+            end++;
+        }
+
+        error = apply_message_receipts(handle, select_stmt, upsert_stmt, &receipts[start], end - start, applied_count);
+        start = end;
+    }
+
+    sqlite3_finalize(select_stmt);
+    sqlite3_finalize(upsert_stmt);
+    return error;
+}
+
+void apply_group_receipts(const GroupReceipt receipts[], size_t count, GroupReceiptCallback callback)
+{
+    if (receipts == NULL || count == 0)
+    {
+        if (callback != NULL)
+        {
+            callback(0, ERROR_INVALID_PARAMS);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!is_valid_receipt(&receipts[i]))
+        {
+            if (callback != NULL)
+            {
+                callback(0, ERROR_INVALID_PARAMS);
+            }
+            return;
+        }
+    }
+
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        if (callback != NULL)
+        {
+            callback(0, DB_ERROR_INITIALIZATION);
+        }
+        return;
+    }
+
+    // Grouping by message lets each message be decoded and written once per batch.
+    const GroupReceipt** sorted = malloc(count * sizeof(const GroupReceipt*));
+    if (sorted == NULL)
+    {
+        if (callback != NULL)
+        {
+            callback(0, ERROR_MEMORY_ALLOCATION);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        sorted[i] = &receipts[i];
+    }
+    qsort(sorted, count, sizeof(const GroupReceipt*), compare_receipts);
+
+    size_t applied_count = 0;
+    ErrorCode error = db_begin_transaction() == SQLITE_OK ? ERROR_NONE : DB_ERROR_TRANSACTION;
+    if (error == ERROR_NONE)
+    {
+        error = apply_sorted_receipts(handle, sorted, count, &applied_count);
+        if (error == ERROR_NONE && db_commit_transaction() != SQLITE_OK)
+        {
+            error = DB_ERROR_TRANSACTION;
+        }
+
+        if (error != ERROR_NONE)
+        {
+            db_rollback_transaction();
+            applied_count = 0;
+        }
+    }
+    free(sorted);
+
+    if (callback != NULL)
+    {
+        callback(applied_count, error);
+    }
+}
+
+ErrorCode get_group_receipt_counts(const char* message_id, GroupReceiptCounts* counts)
+{
+    if (message_id == NULL || counts == NULL)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    const char* sql = "SELECT delivered_count, read_count FROM group_receipts WHERE message_id = ?;";
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    sqlite3_bind_text(stmt, 1, message_id, -1, SQLITE_STATIC);
+    memset(counts, 0, sizeof(GroupReceiptCounts));
+
+    ErrorCode error = ERROR_NONE;
+    const int step = sqlite3_step(stmt);
+    if (step == SQLITE_ROW)
+    {
+        counts->delivered_count = (size_t)sqlite3_column_int64(stmt, 0);
+        counts->read_count = (size_t)sqlite3_column_int64(stmt, 1);
+    }
+    else if (step != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+
+    sqlite3_finalize(stmt);
+    return error;
+}
+
+static bool collect_member(uint32_t number, void* context)
+{
+    MemberList* list = context;
+    const char* id = group_member_id(number);
+    if (id != NULL)
+    {
+        list->ids[list->count++] = id;
+    }
+    return true;
+}
+
+void get_group_receipt_members(const char* message_id, GroupReceiptType type, GroupIdListCallback callback)
+{
+    if (callback == NULL)
+    {
+        return;
+    }
+
+    if (message_id == NULL || (type != GROUP_RECEIPT_DELIVERED && type != GROUP_RECEIPT_READ))
+    {
+        callback(NULL, 0, ERROR_INVALID_PARAMS);
+        return;
+    }
+
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        callback(NULL, 0, DB_ERROR_INITIALIZATION);
+        return;
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    const char* sql = type == GROUP_RECEIPT_READ
+        ? "SELECT read FROM group_receipts WHERE message_id = ?;"
+        : "SELECT delivered FROM group_receipts WHERE message_id = ?;";
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        callback(NULL, 0, DB_ERROR_QUERY);
+        return;
+    }
+
+    sqlite3_bind_text(stmt, 1, message_id, -1, SQLITE_STATIC);
+    const int step = sqlite3_step(stmt);
+    if (step != SQLITE_ROW)
+    {
+        if (step != SQLITE_DONE)
+        {
+            fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        }
+        sqlite3_finalize(stmt);
+        callback(NULL, 0, step == SQLITE_DONE ? ERROR_NONE : DB_ERROR_QUERY);
+        return;
+    }
+
+    Roaring* members = load_bitmap(stmt, 0);
+    sqlite3_finalize(stmt);
+    if (members == NULL)
+    {
+        callback(NULL, 0, DB_ERROR_SCHEMA);
+        return;
+    }
+
+    MemberList list = {0};
+    const size_t cardinality = roaring_cardinality(members);
+    if (cardinality > 0)
+    {
+        list.ids = malloc(cardinality * sizeof(const char*));
+        if (list.ids == NULL)
+        {
+            roaring_destroy(members);
+            callback(NULL, 0, ERROR_MEMORY_ALLOCATION);
+            return;
+        }
+        roaring_for_each(members, collect_member, &list);
+    }
+
+    callback(list.ids, list.count, ERROR_NONE);
+    free(list.ids);
+    roaring_destroy(members);
+}
@@ -0,0 +1,355 @@
+#include "libmessagekit/jitter_buffer.h"
+#include "frame_pool.h"
+
+#define JITTER_MAX_CAPACITY 32768
+#define JITTER_DELAY_FACTOR 3.0 // Target delay in multiples of the jitter, on top of one frame
+#define JITTER_ACCELERATE_MARGIN 2 // Frames above the target before frames are skipped
+
+typedef struct {
+    bool is_used;
+    uint16_t sequence;
+    uint32_t timestamp;
+    uint8_t* data;
+    size_t size;
+} BufferSlot;
+
+struct JitterBuffer {
+    JitterBufferConfig config;
+    FramePool* pool;
+    BufferSlot* slots;        // Indexed by sequence number modulo the window
+    size_t window;
+    uint8_t* concealment;
+    JitterConcealmentHook concealment_hook;
+
+    bool has_stream;
+    bool is_playing;
+    uint16_t next_sequence;
+    uint16_t highest_sequence;
+    size_t buffered_count;
+    uint32_t underrun_run;    // Consecutive intervals without a frame
+
+    uint8_t* previous_frame;  // Last frame played, kept for concealment
+    size_t previous_size;
+
+    bool has_transit;
+    int64_t last_arrival_ms;
+    uint32_t last_timestamp;
+
+    JitterBufferStats stats;
+};
+
+static uint16_t sequence_distance(uint16_t from, uint16_t to)
+{
+    return (uint16_t)(to - from);
+}
+
+static bool is_before(uint16_t sequence, uint16_t reference)
+{
+    return (int16_t)(uint16_t)(sequence - reference) < 0;
+}
+
+static size_t buffered_span(const JitterBuffer* buffer)
+{
+    return buffer->buffered_count == 0 ? 0 : (size_t)sequence_distance(buffer->next_sequence, buffer->highest_sequence) + 1;
+}
+
+static size_t target_frames(const JitterBuffer* buffer)
+{
+    return (buffer->stats.target_delay_ms + buffer->config.frame_duration_ms - 1) / buffer->config.frame_duration_ms;
+}
+
+static void release_slot(JitterBuffer* buffer, BufferSlot* slot)
+{
+    frame_pool_release(buffer->pool, slot->data);
+    slot->is_used = false;
+    slot->data = NULL;
+    buffer->buffered_count--;
+}
+
+static void clear_slots(JitterBuffer* buffer)
+{
+    for (size_t i = 0; i < buffer->window && buffer->buffered_count > 0; i++)
+    {
+        if (buffer->slots[i].is_used)
+        {
+            release_slot(buffer, &buffer->slots[i]);
+        }
+    }
+}
+
+/**
+ * RFC 3550 interarrival jitter, the difference in transit time of
+ * consecutive packets smoothed with a gain of 1/16. The target delay
+ * follows it, rounded up to whole frames.
+ */
+static void update_jitter(JitterBuffer* buffer, uint32_t timestamp, int64_t arrival_ms)
+{
+    if (buffer->has_transit)
+    {
+        const double media_ms = (double)(int32_t)(timestamp - buffer->last_timestamp) * 1000.0 / buffer->config.sample_rate;
+        double difference = (double)(arrival_ms - buffer->last_arrival_ms) - media_ms;
+        difference = difference < 0 ? -difference : difference;
+        buffer->stats.jitter_ms += (difference - buffer->stats.jitter_ms) / 16.0;
+    }
+
+    buffer->has_transit = true;
+    buffer->last_arrival_ms = arrival_ms;
+    buffer->last_timestamp = timestamp;
+
+    const uint32_t frame_ms = buffer->config.frame_duration_ms;
+    const double wanted = frame_ms + JITTER_DELAY_FACTOR * buffer->stats.jitter_ms;
+    uint32_t target = (uint32_t)(wanted / frame_ms) * frame_ms;
+    target += target < wanted ? frame_ms : 0;
+    if (target < buffer->config.min_delay_ms)
+    {
+        target = buffer->config.min_delay_ms;
+    }
+    if (target > buffer->config.max_delay_ms)
+    {
+        target = buffer->config.max_delay_ms;
+    }
+    buffer->stats.target_delay_ms = target;
+}
+
+JitterBuffer* jitter_buffer_create(const JitterBufferConfig* config)
+{
+    if (config == NULL || config->sample_rate == 0 || config->frame_duration_ms == 0 || config->max_frame_size == 0
+        || config->frame_capacity == 0 || config->frame_capacity > JITTER_MAX_CAPACITY
+        || config->min_delay_ms > config->max_delay_ms)
+    {
+        return NULL;
+    }
+
+    JitterBuffer* buffer = calloc(1, sizeof(JitterBuffer));
+    if (buffer == NULL)
+    {
+        return NULL;
+    }
+
+    buffer->config = *config;
+    buffer->window = 1;
+    while (buffer->window < config->frame_capacity)
+    {
+        buffer->window *= 2;
+    }
+
+    // One frame more than the capacity, the previous frame stays taken for concealment.
+    buffer->pool = frame_pool_create(config->frame_capacity + 1, config->max_frame_size);
+    buffer->slots = calloc(buffer->window, sizeof(BufferSlot));
+    buffer->concealment = malloc(config->max_frame_size);
+    if (buffer->pool == NULL || buffer->slots == NULL || buffer->concealment == NULL)
+    {
+        jitter_buffer_destroy(buffer);
+        return NULL;
+    }
+
+    buffer->stats.target_delay_ms = config->min_delay_ms > config->frame_duration_ms
+        ? config->min_delay_ms
+        : config->frame_duration_ms;
+    if (buffer->stats.target_delay_ms > config->max_delay_ms)
+    {
+        buffer->stats.target_delay_ms = config->max_delay_ms;
+    }
+    return buffer;
+}
+
+void jitter_buffer_destroy(JitterBuffer* buffer)
+{
+    if (buffer == NULL)
+    {
+        return;
+    }
+
+    frame_pool_destroy(buffer->pool);
+    free(buffer->slots);
+    free(buffer->concealment);
+    free(buffer);
+}
+
+void jitter_buffer_set_concealment_hook(JitterBuffer* buffer, JitterConcealmentHook hook)
+{
+    if (buffer != NULL)
+    {
+        buffer->concealment_hook = hook;
+    }
+}
+
+ErrorCode jitter_buffer_put(JitterBuffer* buffer, uint16_t sequence, uint32_t timestamp, int64_t arrival_ms,
+                            const uint8_t* data, size_t size)
+{
+    if (buffer == NULL || data == NULL || size == 0 || size > buffer->config.max_frame_size)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    update_jitter(buffer, timestamp, arrival_ms);
+
+    if (!buffer->has_stream)
+    {
+        buffer->has_stream = true;
+        buffer->next_sequence = sequence;
+        buffer->highest_sequence = sequence;
+    }
+
+    if (is_before(sequence, buffer->next_sequence))
+    {
+        // Before playout starts an earlier frame simply becomes the first one.
+        const bool fits = buffer->buffered_count == 0
+            || sequence_distance(sequence, buffer->highest_sequence) < buffer->window;
+        if (!buffer->is_playing && fits)
+        {
+            buffer->next_sequence = sequence;
+        }
+        else if (sequence_distance(sequence, buffer->next_sequence) <= buffer->window)
+        {
+            buffer->stats.late_count++;
+            return ERROR_NONE;
+        }
+    }
+
+    if (sequence_distance(buffer->next_sequence, sequence) >= buffer->window)
+    {
+        // The sender restarted or skipped far ahead, start over from this frame.
+        clear_slots(buffer);
+        buffer->is_playing = false;
+        buffer->next_sequence = sequence;
+        buffer->highest_sequence = sequence;
+        buffer->underrun_run = 0;
+        buffer->stats.reset_count++;
+    }
+
+    BufferSlot* slot = &buffer->slots[sequence & (buffer->window - 1)];
+    if (slot->is_used)
+    {
+        buffer->stats.duplicate_count++;
+        return ERROR_NONE;
+    }
+
+    uint8_t* frame = frame_pool_acquire(buffer->pool);
+    if (frame == NULL)
+    {
+        buffer->stats.overflow_count++;
+        return ERROR_NONE;
+    }
+
+    memcpy(frame, data, size);
+    slot->is_used = true;
+    slot->sequence = sequence;
+    slot->timestamp = timestamp;
+    slot->data = frame;
+    slot->size = size;
+    buffer->buffered_count++;
+    buffer->stats.received_count++;
+
+    if (buffer->buffered_count == 1 || is_before(buffer->highest_sequence, sequence))
+    {
+        buffer->highest_sequence = sequence;
+    }
+    return ERROR_NONE;
+}
+
+static void conceal(JitterBuffer* buffer, JitterFrame* frame)
+{
+    frame->kind = JITTER_FRAME_CONCEALED;
+    frame->data = NULL;
+    frame->size = 0;
+    buffer->stats.concealed_count++;
+
+    if (buffer->concealment_hook != NULL)
+    {
+        const size_t size = buffer->concealment_hook(frame->sequence, buffer->previous_frame, buffer->previous_size,
+                                                     buffer->concealment, buffer->config.max_frame_size);
+        if (size > 0 && size <= buffer->config.max_frame_size)
+        {
+            frame->data = buffer->concealment;
+            frame->size = size;
+        }
+    }
+}
+
+ErrorCode jitter_buffer_get(JitterBuffer* buffer, JitterFrame* frame)
+{
+    if (buffer == NULL || frame == NULL)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    memset(frame, 0, sizeof(JitterFrame));
+    frame->sequence = buffer->next_sequence;
+
+    if (!buffer->is_playing)
+    {
+        if (buffer->buffered_count == 0
+            || buffered_span(buffer) * buffer->config.frame_duration_ms < buffer->stats.target_delay_ms)
+        {
+            frame->kind = JITTER_FRAME_EMPTY;
+            return ERROR_NONE;
+        }
+        buffer->is_playing = true;
+    }
+
+    // Skip one frame per interval while the delay is well above the target.
+    if (buffered_span(buffer) > target_frames(buffer) + JITTER_ACCELERATE_MARGIN)
+    {
+        BufferSlot* skipped = &buffer->slots[buffer->next_sequence & (buffer->window - 1)];
+        if (skipped->is_used)
+        {
+            release_slot(buffer, skipped);
+        }
+        buffer->next_sequence++;
+        buffer->stats.accelerated_count++;
+        frame->sequence = buffer->next_sequence;
+    }
+
+    BufferSlot* slot = &buffer->slots[buffer->next_sequence & (buffer->window - 1)];
+    if (slot->is_used)
+    {
+        frame_pool_release(buffer->pool, buffer->previous_frame);
+        buffer->previous_frame = slot->data;
+        buffer->previous_size = slot->size;
+
+        frame->kind = JITTER_FRAME_AUDIO;
+        frame->timestamp = slot->timestamp;
+        frame->data = slot->data;
+        frame->size = slot->size;
+
+        // The pool frame now belongs to previous_frame.
+        slot->is_used = false;
+        slot->data = NULL;
+        buffer->buffered_count--;
+        buffer->next_sequence++;
+        buffer->underrun_run = 0;
+        return ERROR_NONE;
+    }
+
+    if (buffer->buffered_count > 0)
+    {
+        // Later frames are here, this one is lost.
+        buffer->stats.lost_count++;
+        conceal(buffer, frame);
+        buffer->next_sequence++;
+        return ERROR_NONE;
+    }
+
+    // Ran dry. The position is kept, so a frame that is merely late still
+    // plays and the delay grows by what it was late.
+    buffer->stats.underrun_count++;
+    conceal(buffer, frame);
+    if (++buffer->underrun_run * buffer->config.frame_duration_ms >= buffer->config.max_delay_ms)
+    {
+        buffer->is_playing = false;
+        buffer->underrun_run = 0;
+    }
+    return ERROR_NONE;
+}
+
+void jitter_buffer_get_stats(const JitterBuffer* buffer, JitterBufferStats* stats)
+{
+    if (buffer == NULL || stats == NULL)
+    {
+        return;
+    }
+
+    *stats = buffer->stats;
+    stats->current_delay_ms = (uint32_t)(buffered_span(buffer) * buffer->config.frame_duration_ms);
+}
@@ -0,0 +1,553 @@
+#include "libmessagekit/live_query.h"
+#include "database.h"
+#include "live_query_engine.h"
+
+typedef struct {
+    LiveQueryHandle handle;
+    bool is_conversation_list;
+    char conversation_id[MAX_CONVERSATION_ID_LENGTH];
+    LiveQueryCallback callback;
+} Subscription;
+
+typedef struct {
+    int64_t seq;
+    int entity;
+    int operation;
+    bool is_derived;
+    char entity_id[MAX_CHANGE_ENTITY_ID_LENGTH];
+    char scope_id[MAX_CONVERSATION_ID_LENGTH];
+} PendingChange;
+
+static Subscription* subscriptions = NULL;
+static size_t subscription_count = 0;
+static size_t subscription_capacity = 0;
+static LiveQueryHandle next_handle = 1;
+
+static CommittedChangeObserver observers[LIVE_QUERY_MAX_OBSERVERS];
+static size_t observer_count = 0;
+
+typedef struct {
+    int64_t first_seq;
+    int64_t last_seq;
+} CommittedBatch;
+
+// change_log sequence range written by the open transaction.
+static int64_t pending_first_seq = 0;
+static int64_t pending_last_seq = 0;
+
+// One range per committed transaction, in commit order, until dispatched.
+static CommittedBatch* committed_batches = NULL;
+static size_t committed_head = 0;
+static size_t committed_count = 0;
+static size_t committed_capacity = 0;
+
+static bool hooks_installed = false;
+static bool dispatching = false;
+
+static void on_update(void* context, int operation, const char* database, const char* table, sqlite3_int64 rowid)
+{
+    (void)context;
+    (void)database;
+
+    if (operation != SQLITE_INSERT || strcmp(table, "change_log") != 0)
+    {
+        return;
+    }
+
+    if (pending_first_seq == 0)
+    {
+        pending_first_seq = rowid;
+    }
+    pending_last_seq = rowid;
+}
+
+static int on_commit(void* context)
+{
+    (void)context;
+
+    if (pending_first_seq == 0)
+    {
+        return 0;
+    }
+
+    if (committed_count == committed_capacity)
+    {
+        const size_t capacity = committed_capacity == 0 ? 8 : committed_capacity * 2;
+        CommittedBatch* grown = realloc(committed_batches, capacity * sizeof(CommittedBatch));
+        if (grown != NULL)
+        {
+            committed_batches = grown;
+            committed_capacity = capacity;
+        }
+    }
+
+    if (committed_count < committed_capacity)
+    {
+        committed_batches[committed_count].first_seq = pending_first_seq;
+        committed_batches[committed_count].last_seq = pending_last_seq;
+        committed_count++;
+    }
+    else if (committed_count > committed_head)
+    {
+        // Out of memory: rather than lose the changes, they join the previous commit's batch.
+        committed_batches[committed_count - 1].last_seq = pending_last_seq;
+    }
+
+    pending_first_seq = 0;
+    pending_last_seq = 0;
+    return 0;
+}
+
+static void on_rollback(void* context)
+{
+    (void)context;
+    pending_first_seq = 0;
+    pending_last_seq = 0;
+}
+
+static int compare_by_entity(const void* lhs, const void* rhs)
+{
+    const PendingChange* a = lhs;
+    const PendingChange* b = rhs;
+
+    if (a->entity != b->entity)
+    {
+        return a->entity < b->entity ? -1 : 1;
+    }
+
+    const int by_id = strcmp(a->entity_id, b->entity_id);
+    if (by_id != 0)
+    {
+        return by_id;
+    }
+
+    return a->seq < b->seq ? -1 : (a->seq > b->seq ? 1 : 0);
+}
+
+static int compare_by_seq(const void* lhs, const void* rhs)
+{
+    const PendingChange* a = lhs;
+    const PendingChange* b = rhs;
+    return a->seq < b->seq ? -1 : (a->seq > b->seq ? 1 : 0);
+}
+
+static bool append_change(PendingChange** changes, size_t* count, size_t* capacity, const PendingChange* change)
+{
+    if (*count == *capacity)
+    {
+        const size_t grown_capacity = *capacity == 0 ? 64 : *capacity * 2;
+        PendingChange* grown = realloc(*changes, grown_capacity * sizeof(PendingChange));
+        if (grown == NULL)
+        {
+            return false;
+        }
+        *changes = grown;
+        *capacity = grown_capacity;
+    }
+
+    (*changes)[(*count)++] = *change;
+    return true;
+}
+
+static ErrorCode load_changes(int64_t first_seq, int64_t last_seq, PendingChange** changes, size_t* count)
+{
+    sqlite3* handle = db_get_handle();
+    sqlite3_stmt* stmt = NULL;
+
+    const char* sql = "SELECT seq, entity, operation, entity_id, scope_id FROM change_log "
+                      "WHERE seq BETWEEN ? AND ? ORDER BY seq;";
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    sqlite3_bind_int64(stmt, 1, first_seq);
+    sqlite3_bind_int64(stmt, 2, last_seq);
+
+    size_t capacity = 0;
+    ErrorCode error = ERROR_NONE;
+    int step;
+    while ((step = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        PendingChange change = {0};
+        change.seq = sqlite3_column_int64(stmt, 0);
+        change.entity = sqlite3_column_int(stmt, 1);
+        change.operation = sqlite3_column_int(stmt, 2);
+        strncpy(change.entity_id, (const char*)sqlite3_column_text(stmt, 3), MAX_CHANGE_ENTITY_ID_LENGTH - 1);
+        if (sqlite3_column_type(stmt, 4) != SQLITE_NULL)
+        {
+            strncpy(change.scope_id, (const char*)sqlite3_column_text(stmt, 4), MAX_CONVERSATION_ID_LENGTH - 1);
+        }
+
+        if (!append_change(changes, count, &capacity, &change))
+        {
+            error = ERROR_MEMORY_ALLOCATION;
+            break;
+        }
+
+        // A message change also changes the summary of its conversation.
+        if (change.entity == CHANGE_ENTITY_MESSAGE && change.scope_id[0] != '\0')
+        {
+            PendingChange derived = {0};
+            derived.seq = change.seq;
+            derived.entity = CHANGE_ENTITY_CONVERSATION;
+            derived.operation = LIVE_QUERY_DIFF_UPDATE;
+            derived.is_derived = true;
+            strncpy(derived.entity_id, change.scope_id, MAX_CHANGE_ENTITY_ID_LENGTH - 1);
+
+            if (!append_change(changes, count, &capacity, &derived))
+            {
+                error = ERROR_MEMORY_ALLOCATION;
+                break;
+            }
+        }
+    }
+
+    if (error == ERROR_NONE && step != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+
+    sqlite3_finalize(stmt);
+    return error;
+}
+
+/**
+ * Folds all changes of the same row into one, keeping the position of the
+ * first change. Insert then delete cancels out, anything else ending in a
+ * delete is a delete, anything starting with an insert is an insert.
+ */
+static size_t coalesce_changes(PendingChange* changes, size_t count)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    qsort(changes, count, sizeof(PendingChange), compare_by_entity);
+
+    size_t folded = 0;
+    size_t group_start = 0;
+    while (group_start < count)
+    {
+        size_t group_end = group_start + 1;
+        while (group_end < count
+               && changes[group_end].entity == changes[group_start].entity
+               && strcmp(changes[group_end].entity_id, changes[group_start].entity_id) == 0)
+        {
+            group_end++;
+        }
+
+        int first_operation = -1;
+        int last_operation = -1;
+        for (size_t i = group_start; i < group_end; i++)
+        {
+            if (!changes[i].is_derived)
+            {
+                if (first_operation < 0)
+                {
+                    first_operation = changes[i].operation;
+                }
+                last_operation = changes[i].operation;
+            }
+        }
+
+        int operation = LIVE_QUERY_DIFF_UPDATE;
+        if (first_operation == LIVE_QUERY_DIFF_INSERT && last_operation == LIVE_QUERY_DIFF_DELETE)
+        {
+            operation = -1;
+        }
+        else if (last_operation == LIVE_QUERY_DIFF_DELETE)
+        {
+            operation = LIVE_QUERY_DIFF_DELETE;
+        }
+        else if (first_operation == LIVE_QUERY_DIFF_INSERT)
+        {
+            operation = LIVE_QUERY_DIFF_INSERT;
+        }
+
+        if (operation >= 0)
+        {
+            PendingChange merged = changes[group_start];
+            merged.operation = operation;
+            merged.is_derived = first_operation < 0;
+            merged.scope_id[0] = '\0';
+            for (size_t i = group_start; i < group_end; i++)
+            {
+                if (changes[i].scope_id[0] != '\0')
+                {
+                    strcpy(merged.scope_id, changes[i].scope_id);
+                }
+            }
+            changes[folded++] = merged;
+        }
+
+        group_start = group_end;
+    }
+
+    qsort(changes, folded, sizeof(PendingChange), compare_by_seq);
+    return folded;
+}
+
+static void notify_observers(const PendingChange* changes, size_t count)
+{
+    if (observer_count == 0)
+    {
+        return;
+    }
+
+    CommittedChange* committed = malloc(count * sizeof(CommittedChange));
+    if (committed == NULL)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        committed[i].entity = (ChangeEntity)changes[i].entity;
+        committed[i].operation = (LiveQueryDiffOperation)changes[i].operation;
+        committed[i].entity_id = changes[i].entity_id;
+        committed[i].scope_id = changes[i].scope_id;
+        committed[i].is_derived = changes[i].is_derived;
+    }
+
+    for (size_t i = 0; i < observer_count; i++)
+    {
+        observers[i](committed, count);
+    }
+
+    free(committed);
+}
+
+static void deliver(const PendingChange* changes, size_t count, LiveQueryDiff* diffs)
+{
+    for (size_t s = 0; s < subscription_count; s++)
+    {
+        // Callbacks may subscribe, so the array is re-read on every iteration.
+        const Subscription subscription = subscriptions[s];
+        if (subscription.callback == NULL)
+        {
+            continue;
+        }
+
+        size_t diff_count = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            const bool matches = subscription.is_conversation_list
+                ? changes[i].entity == CHANGE_ENTITY_CONVERSATION
+                : changes[i].entity == CHANGE_ENTITY_MESSAGE
+                  && strcmp(changes[i].scope_id, subscription.conversation_id) == 0;
+
+            if (matches)
+            {
+                diffs[diff_count].operation = (LiveQueryDiffOperation)changes[i].operation;
+                strcpy(diffs[diff_count].id, changes[i].entity_id);
+                diff_count++;
+            }
+        }
+
+        if (diff_count > 0)
+        {
+            subscription.callback(subscription.handle, diffs, diff_count);
+        }
+    }
+}
+
+static void remove_cancelled_subscriptions()
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < subscription_count; i++)
+    {
+        if (subscriptions[i].callback != NULL)
+        {
+            subscriptions[kept++] = subscriptions[i];
+        }
+    }
+    subscription_count = kept;
+}
+
+static void dispatch_committed_changes()
+{
+    if (dispatching)
+    {
+        // The outer dispatch loop picks up changes committed by callbacks.
+        return;
+    }
+
+    dispatching = true;
+    while (committed_head < committed_count)
+    {
+        const int64_t first_seq = committed_batches[committed_head].first_seq;
+        const int64_t last_seq = committed_batches[committed_head].last_seq;
+        committed_head++;
+
+        if (subscription_count == 0 && observer_count == 0)
+        {
+            continue;
+        }
+
+        PendingChange* changes = NULL;
+        size_t count = 0;
+        if (load_changes(first_seq, last_seq, &changes, &count) != ERROR_NONE)
+        {
+            free(changes);
+            continue;
+        }
+
+        count = coalesce_changes(changes, count);
+        notify_observers(changes, count);
+
+        LiveQueryDiff* diffs = count > 0 ? malloc(count * sizeof(LiveQueryDiff)) : NULL;
+        if (diffs != NULL)
+        {
+            deliver(changes, count, diffs);
+        }
+
+        free(diffs);
+        free(changes);
+    }
+    committed_head = 0;
+    committed_count = 0;
+
+    remove_cancelled_subscriptions();
+    dispatching = false;
+}
+
+static ErrorCode add_subscription(bool is_conversation_list, const char* conversation_id,
+                                  LiveQueryCallback callback, LiveQueryHandle* handle)
+{
+    if (callback == NULL || handle == NULL)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    if (!hooks_installed)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    if (subscription_count == subscription_capacity)
+    {
+        const size_t capacity = subscription_capacity == 0 ? 8 : subscription_capacity * 2;
+        Subscription* grown = realloc(subscriptions, capacity * sizeof(Subscription));
+        if (grown == NULL)
+        {
+            return ERROR_MEMORY_ALLOCATION;
+        }
+        subscriptions = grown;
+        subscription_capacity = capacity;
+    }
+
+    Subscription* subscription = &subscriptions[subscription_count++];
+    memset(subscription, 0, sizeof(Subscription));
+    subscription->handle = next_handle++;
+    subscription->is_conversation_list = is_conversation_list;
+    subscription->callback = callback;
+    if (conversation_id != NULL)
+    {
+        strcpy(subscription->conversation_id, conversation_id);
+    }
+
+    *handle = subscription->handle;
+    return ERROR_NONE;
+}
+
+ErrorCode subscribe_conversation_messages(const char* conversation_id, LiveQueryCallback callback, LiveQueryHandle* handle)
+{
+    if (conversation_id == NULL || strlen(conversation_id) == 0 || strlen(conversation_id) >= MAX_CONVERSATION_ID_LENGTH)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    return add_subscription(false, conversation_id, callback, handle);
+}
+
+ErrorCode subscribe_conversation_list(LiveQueryCallback callback, LiveQueryHandle* handle)
+{
+    return add_subscription(true, NULL, callback, handle);
+}
+
+ErrorCode unsubscribe_live_query(LiveQueryHandle handle)
+{
+    for (size_t i = 0; i < subscription_count; i++)
+    {
+        if (subscriptions[i].handle == handle && subscriptions[i].callback != NULL)
+        {
+            // Removal is deferred while dispatching so delivery indexes stay valid.
+            subscriptions[i].callback = NULL;
+            if (!dispatching)
+            {
+                remove_cancelled_subscriptions();
+            }
+            return ERROR_NONE;
+        }
+    }
+
+    return ERROR_INVALID_PARAMS;
+}
+
+ErrorCode live_query_add_observer(CommittedChangeObserver observer)
+{
+    if (observer == NULL)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    if (observer_count == LIVE_QUERY_MAX_OBSERVERS)
+    {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    observers[observer_count++] = observer;
+    return ERROR_NONE;
+}
+
+ErrorCode live_query_init()
+{
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    // Without WAL there is no hook after the commit to read the changes from, the library runs without live queries.
+    if (db_set_commit_listener(dispatch_committed_changes) != SQLITE_OK)
+    {
+        fprintf(stderr, "Live queries disabled, the database cannot use WAL mode\n");
+        return ERROR_NONE;
+    }
+
+    sqlite3_update_hook(handle, on_update, NULL);
+    sqlite3_commit_hook(handle, on_commit, NULL);
+    sqlite3_rollback_hook(handle, on_rollback, NULL);
+    hooks_installed = true;
+    return ERROR_NONE;
+}
+
+void live_query_shutdown()
+{
+    sqlite3* handle = db_get_handle();
+    if (handle != NULL && hooks_installed)
+    {
+        sqlite3_update_hook(handle, NULL, NULL);
+        sqlite3_commit_hook(handle, NULL, NULL);
+        sqlite3_rollback_hook(handle, NULL, NULL);
+    }
+    db_set_commit_listener(NULL);
+
+    observer_count = 0;
+    free(subscriptions);
+    subscriptions = NULL;
+    subscription_count = 0;
+    subscription_capacity = 0;
+    pending_first_seq = 0;
+    pending_last_seq = 0;
+    free(committed_batches);
+    committed_batches = NULL;
+    committed_head = 0;
+    committed_count = 0;
+    committed_capacity = 0;
+    hooks_installed = false;
+}
@@ -0,0 +1,221 @@
+#include "message_ttl.h"
+#include "config.h"
+#include "database.h"
+#include "timer_wheel.h"
+
+typedef struct {
+    TimerNode node;
+    char message_id[MESSAGE_ID_LENGTH];
+} ExpiringMessage;
+
+typedef struct {
+    ExpiringMessage** items;
+    size_t count;
+    size_t capacity;
+    bool failed;
+} ExpiredBatch;
+
+static TimerWheel ttl_wheel;
+static bool ttl_initialized = false;
+
+static void collect_expired(TimerNode* node, void* context)
+{
+    ExpiredBatch* batch = context;
+    ExpiringMessage* message = (ExpiringMessage*)node;
+
+    if (batch->count == batch->capacity)
+    {
+        const size_t capacity = batch->capacity == 0 ? 64 : batch->capacity * 2;
+        ExpiringMessage** items = realloc(batch->items, capacity * sizeof(ExpiringMessage*));
+        if (items == NULL)
+        {
+            // Keep the message scheduled, it is retried on the next tick.
+            batch->failed = true;
+            timer_wheel_schedule(&ttl_wheel, node, node->expires);
+            return;
+        }
+        batch->items = items;
+        batch->capacity = capacity;
+    }
+
+    batch->items[batch->count++] = message;
+}
+
+static void free_scheduled(TimerNode* node, void* context)
+{
+    (void)context;
+    free(node);
+}
+
+static ErrorCode delete_expired_batch(const ExpiredBatch* batch, int64_t now, size_t* deleted)
+{
+    sqlite3* handle = db_get_handle();
+    sqlite3_stmt* stmt = NULL;
+
+    const char* sql = "DELETE FROM messages WHERE id = ? AND expires_at IS NOT NULL AND expires_at <= ?;";
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    if (db_begin_transaction() != SQLITE_OK)
+    {
+        sqlite3_finalize(stmt);
+        return DB_ERROR_TRANSACTION;
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i < batch->count; i++)
+    {
+        sqlite3_bind_text(stmt, 1, batch->items[i]->message_id, -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 2, now);
+
+        if (sqlite3_step(stmt) != SQLITE_DONE)
+        {
+            fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+            sqlite3_finalize(stmt);
+            db_rollback_transaction();
+            return DB_ERROR_QUERY;
+        }
+
+        total += (size_t)sqlite3_changes(handle);
+        sqlite3_reset(stmt);
+    }
+
+    sqlite3_finalize(stmt);
+
+    if (db_commit_transaction() != SQLITE_OK)
+    {
+        db_rollback_transaction();
+        return DB_ERROR_TRANSACTION;
+    }
+
+    *deleted = total;
+    return ERROR_NONE;
+}
+
+ErrorCode ttl_init(int64_t now)
+{
+    if (ttl_initialized)
+    {
+        return ERROR_ALREADY_INITIALIZED;
+    }
+
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    timer_wheel_init(&ttl_wheel, now);
+    ttl_initialized = true;
+
+    sqlite3_stmt* stmt = NULL;
+    const char* sql = "SELECT id, expires_at FROM messages WHERE expires_at IS NOT NULL ORDER BY expires_at;";
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    ErrorCode error = ERROR_NONE;
+    int step;
+    while ((step = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        error = ttl_schedule((const char*)sqlite3_column_text(stmt, 0), sqlite3_column_int64(stmt, 1));
+        if (error != ERROR_NONE)
+        {
+            break;
+        }
+    }
+
+    if (error == ERROR_NONE && step != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+
+    sqlite3_finalize(stmt);
+    return error;
+}
+
+ErrorCode ttl_schedule(const char* message_id, int64_t expires_at)
+{
+    if (!ttl_initialized)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    if (message_id == NULL || strlen(message_id) >= MESSAGE_ID_LENGTH)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    ExpiringMessage* message = malloc(sizeof(ExpiringMessage));
+    if (message == NULL)
+    {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    strcpy(message->message_id, message_id);
+    timer_wheel_schedule(&ttl_wheel, &message->node, expires_at);
+    return ERROR_NONE;
+}
+
+ErrorCode ttl_process(int64_t now, size_t* expired_count)
+{
+    if (expired_count != NULL)
+    {
+        *expired_count = 0;
+    }
+
+    if (!ttl_initialized)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    ExpiredBatch batch = {0};
+    timer_wheel_advance(&ttl_wheel, now, collect_expired, &batch);
+
+    if (batch.count == 0)
+    {
+        free(batch.items);
+        return batch.failed ? ERROR_MEMORY_ALLOCATION : ERROR_NONE;
+    }
+
+    size_t deleted = 0;
+    const ErrorCode error = delete_expired_batch(&batch, now, &deleted);
+
+    for (size_t i = 0; i < batch.count; i++)
+    {
+        if (error != ERROR_NONE)
+        {
+            // Retry the whole batch on the next tick.
+            timer_wheel_schedule(&ttl_wheel, &batch.items[i]->node, batch.items[i]->node.expires);
+        }
+        else
+        {
+            free(batch.items[i]);
+        }
+    }
+    free(batch.items);
+
+    if (error == ERROR_NONE && expired_count != NULL)
+    {
+        *expired_count = deleted;
+    }
+
+    return error != ERROR_NONE ? error : (batch.failed ? ERROR_MEMORY_ALLOCATION : ERROR_NONE);
+}
+
+void ttl_shutdown()
+{
+    if (!ttl_initialized)
+    {
+        return;
+    }
+
+    timer_wheel_drain(&ttl_wheel, free_scheduled, NULL);
+    ttl_initialized = false;
+}
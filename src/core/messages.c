@@ -0,0 +1,137 @@
+#include "libmessagekit/messages.h"
+#include "blocked_users.h"
+#include "database.h"
+#include "group_membership.h"
+#include "message_ttl.h"
+
+static void notify_message_result(MessageCallback callback, const char* message_id, ErrorCode error)
+{
+    if (callback == NULL)
+    {
+        return;
+    }
+
+    MessageResult result = {0};
+    if (message_id != NULL)
+    {
+        strncpy(result.message_id, message_id, MESSAGE_ID_LENGTH - 1);
+    }
+    result.error = error;
+    callback(&result);
+}
+
+void set_message_expiry(const char* message_id, int64_t expires_at, MessageCallback callback)
+{
+    if (message_id == NULL || strlen(message_id) == 0 || strlen(message_id) >= MESSAGE_ID_LENGTH)
+    {
+        notify_message_result(callback, message_id, ERROR_INVALID_PARAMS);
+        return;
+    }
+
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        notify_message_result(callback, message_id, DB_ERROR_INITIALIZATION);
+        return;
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    const char* sql = "UPDATE messages SET expires_at = ? WHERE id = ?;";
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        notify_message_result(callback, message_id, DB_ERROR_QUERY);
+        return;
+    }
+
+    sqlite3_bind_int64(stmt, 1, expires_at);
+    sqlite3_bind_text(stmt, 2, message_id, -1, SQLITE_STATIC);
+
+    ErrorCode error = ERROR_NONE;
+    if (sqlite3_step(stmt) != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+    else if (sqlite3_changes(handle) == 0)
+    {
+        error = DB_ERROR_NOT_FOUND;
+    }
+    sqlite3_finalize(stmt);
+
+    if (error == ERROR_NONE)
+    {
+        error = ttl_schedule(message_id, expires_at);
+    }
+
+    notify_message_result(callback, message_id, error);
+}
+
+ErrorCode process_expired_messages(int64_t now, size_t* expired_count)
+{
+    return ttl_process(now, expired_count);
+}
+
+static bool is_valid_id_field(const char* text, size_t size)
+{
+    return memchr(text, '\0', size) != NULL && text[0] != '\0';
+}
+
+void receive_message(const Message* message, MessageCallback callback)
+{
+    if (message == NULL || !is_valid_id_field(message->id, MESSAGE_ID_LENGTH)
+        || !is_valid_id_field(message->conversation_id, MESSAGE_ID_LENGTH)
+        || !is_valid_id_field(message->sender_id, MESSAGE_ID_LENGTH)
+        || memchr(message->content, '\0', MAX_CONTENT_LENGTH) == NULL)
+    {
+        notify_message_result(callback, message != NULL ? message->id : NULL, ERROR_INVALID_PARAMS);
+        return;
+    }
+
+    // Checked before any database work, this is the hottest path of the library.
+    if (is_user_blocked(message->sender_id))
+    {
+        notify_message_result(callback, message->id, ERROR_SENDER_BLOCKED);
+        return;
+    }
+
+    if (!group_accepts_sender(message->conversation_id, message->sender_id))
+    {
+        notify_message_result(callback, message->id, AUTH_ERROR_UNAUTHORIZED);
+        return;
+    }
+
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        notify_message_result(callback, message->id, DB_ERROR_INITIALIZATION);
+        return;
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    const char* sql = "INSERT OR IGNORE INTO messages (id, conversation_id, sender_id, type, timestamp, content, is_outgoing) "
+                      "VALUES (?, ?, ?, ?, ?, ?, 0);";
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        notify_message_result(callback, message->id, DB_ERROR_QUERY);
+        return;
+    }
+
+    sqlite3_bind_text(stmt, 1, message->id, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, message->conversation_id, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, message->sender_id, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 4, (int)message->type);
+    sqlite3_bind_int64(stmt, 5, message->timestamp);
+    sqlite3_bind_text(stmt, 6, message->content, -1, SQLITE_STATIC);
+
+    ErrorCode error = ERROR_NONE;
+    if (sqlite3_step(stmt) != SQLITE_DONE)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+    sqlite3_finalize(stmt);
+
+    notify_message_result(callback, message->id, error);
+}
@@ -0,0 +1,350 @@
+#include "libmessagekit/messages.h"
+#include "database.h"
+#include "receipt_coalescer.h"
+
+#define RECEIPT_TYPE_COUNT 2
+#define RECEIPT_FRAME_HEADER_SIZE 9
+#define RECEIPT_FRAME_ENTRY_SIZE (1 + 1 + MAX_CONVERSATION_ID_LENGTH + 1 + MESSAGE_ID_LENGTH + 8)
+
+/**
+ * Latest message of a conversation a receipt is pending for, by arrival
+ * order. The timestamp only goes out with the frame.
+ */
+typedef struct {
+    bool is_set;
+    int64_t seq;
+    int64_t timestamp;
+    char message_id[MESSAGE_ID_LENGTH];
+} Watermark;
+
+typedef struct {
+    char conversation_id[MAX_CONVERSATION_ID_LENGTH];
+    Watermark marks[RECEIPT_TYPE_COUNT]; // Indexed by MessageReceiptType
+} PendingReceipts;
+
+/*
+ * Moving a watermark only ever advances it, so the statements are safe to
+ * repeat after a failed send.
+ */
+static const char* const WATERMARK_SQL[RECEIPT_TYPE_COUNT] = {
+    [MESSAGE_RECEIPT_DELIVERED] =
+        "UPDATE conversation_summaries SET last_delivered_seq = ?2 "
+        "WHERE conversation_id = ?1 AND last_delivered_seq < ?2;",
+    [MESSAGE_RECEIPT_READ] =
+        "UPDATE conversation_summaries SET last_read_seq = ?2, "
+        "unread_count = (SELECT COUNT(*) FROM messages WHERE conversation_id = ?1 AND is_outgoing = 0 AND seq > ?2) "
+        "WHERE conversation_id = ?1 AND last_read_seq < ?2;",
+};
+
+static PendingReceipts pending[RECEIPT_COALESCE_MAX_CONVERSATIONS];
+static size_t pending_count = 0;
+static int64_t window_start = 0;
+static ReceiptFrameSink frame_sink = NULL;
+
+static uint8_t* put_u32(uint8_t* cursor, uint32_t value)
+{
+    cursor[0] = (uint8_t)value;
+    cursor[1] = (uint8_t)(value >> 8);
+    cursor[2] = (uint8_t)(value >> 16);
+    cursor[3] = (uint8_t)(value >> 24);
+    return cursor + 4;
+}
+
+static uint8_t* put_id(uint8_t* cursor, const char* id)
+{
+    const size_t length = strlen(id);
+    *cursor++ = (uint8_t)length;
+    memcpy(cursor, id, length);
+    return cursor + length;
+}
+
+static bool is_valid_id_field(const char* text, size_t size)
+{
+    return memchr(text, '\0', size) != NULL && text[0] != '\0';
+}
+
+/**
+ * Looks up the arrival sequence number of a stored message. Sender clocks
+ * disagree, so watermarks are ordered by arrival rather than by timestamp.
+ */
+static ErrorCode find_message_seq(const Message* message, int64_t* seq)
+{
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    sqlite3_stmt* stmt = NULL;
+    const char* sql = "SELECT seq FROM messages WHERE id = ? AND conversation_id = ?;";
+    if (sqlite3_prepare_v2(handle, sql, -1, &stmt, NULL) != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        return DB_ERROR_QUERY;
+    }
+
+    sqlite3_bind_text(stmt, 1, message->id, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, message->conversation_id, -1, SQLITE_STATIC);
+
+    ErrorCode error = ERROR_NONE;
+    const int step = sqlite3_step(stmt);
+    if (step == SQLITE_ROW)
+    {
+        *seq = sqlite3_column_int64(stmt, 0);
+    }
+    else if (step == SQLITE_DONE)
+    {
+        error = DB_ERROR_NOT_FOUND;
+    }
+    else
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+        error = DB_ERROR_QUERY;
+    }
+
+    sqlite3_finalize(stmt);
+    return error;
+}
+
+static void advance_watermark(Watermark* mark, const Message* message, int64_t seq)
+{
+    if (!mark->is_set || seq > mark->seq)
+    {
+        mark->is_set = true;
+        mark->seq = seq;
+        mark->timestamp = message->timestamp;
+        memcpy(mark->message_id, message->id, strlen(message->id) + 1);
+    }
+}
+
+static ErrorCode write_watermarks()
+{
+    sqlite3* handle = db_get_handle();
+    if (handle == NULL)
+    {
+        return DB_ERROR_INITIALIZATION;
+    }
+
+    sqlite3_stmt* stmts[RECEIPT_TYPE_COUNT] = {NULL};
+    for (int type = 0; type < RECEIPT_TYPE_COUNT; type++)
+    {
+        if (sqlite3_prepare_v2(handle, WATERMARK_SQL[type], -1, &stmts[type], NULL) != SQLITE_OK)
+        {
+            fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+            sqlite3_finalize(stmts[0]);
+            return DB_ERROR_QUERY;
+        }
+    }
+
+    if (db_begin_transaction() != SQLITE_OK)
+    {
+        sqlite3_finalize(stmts[0]);
+        sqlite3_finalize(stmts[1]);
+        return DB_ERROR_TRANSACTION;
+    }
+
+    ErrorCode error = ERROR_NONE;
+    for (size_t i = 0; i < pending_count && error == ERROR_NONE; i++)
+    {
+        for (int type = 0; type < RECEIPT_TYPE_COUNT && error == ERROR_NONE; type++)
+        {
+            const Watermark* mark = &pending[i].marks[type];
+            if (!mark->is_set)
+            {
+                continue;
+            }
+
+            sqlite3_bind_text(stmts[type], 1, pending[i].conversation_id, -1, SQLITE_STATIC);
+            sqlite3_bind_int64(stmts[type], 2, mark->seq);
+            if (sqlite3_step(stmts[type]) != SQLITE_DONE)
+            {
+                fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(handle));
+                error = DB_ERROR_QUERY;
+            }
+            sqlite3_reset(stmts[type]);
+        }
+    }
+
+    sqlite3_finalize(stmts[0]);
+    sqlite3_finalize(stmts[1]);
+
+    if (error == ERROR_NONE && db_commit_transaction() != SQLITE_OK)
+    {
+        error = DB_ERROR_TRANSACTION;
+    }
+
+    if (error != ERROR_NONE)
+    {
+        db_rollback_transaction();
+    }
+    return error;
+}
+
+static ErrorCode send_watermarks()
+{
+    if (frame_sink == NULL)
+    {
+        return ERROR_NONE;
+    }
+
+    uint8_t* frame = malloc(RECEIPT_FRAME_HEADER_SIZE + pending_count * RECEIPT_TYPE_COUNT * RECEIPT_FRAME_ENTRY_SIZE);
+    if (frame == NULL)
+    {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    uint8_t* cursor = put_u32(frame, RECEIPT_FRAME_MAGIC);
+    *cursor++ = RECEIPT_FRAME_VERSION;
+    uint8_t* entry_count_field = cursor;
+    cursor += 4;
+
+    uint32_t entry_count = 0;
+    for (size_t i = 0; i < pending_count; i++)
+    {
+        for (int type = 0; type < RECEIPT_TYPE_COUNT; type++)
+        {
+            const Watermark* mark = &pending[i].marks[type];
+            if (!mark->is_set)
+            {
+                continue;
+            }
+
+            *cursor++ = (uint8_t)type;
+            cursor = put_id(cursor, pending[i].conversation_id);
+            cursor = put_id(cursor, mark->message_id);
+            cursor = put_u32(cursor, (uint32_t)((uint64_t)mark->timestamp & 0xFFFFFFFFu));
+            cursor = put_u32(cursor, (uint32_t)((uint64_t)mark->timestamp >> 32));
+            entry_count++;
+        }
+    }
+    put_u32(entry_count_field, entry_count);
+
+    const ErrorCode error = frame_sink(frame, (size_t)(cursor - frame));
+    free(frame);
+    return error;
+}
+
+/**
+ * Writes every pending watermark in one transaction and sends them in one
+ * frame. On failure the receipts stay queued and go out with the next flush.
+ */
+static ErrorCode flush_pending(size_t* flushed_count)
+{
+    size_t flushed = 0;
+    ErrorCode error = ERROR_NONE;
+    if (pending_count > 0)
+    {
+        error = write_watermarks();
+        if (error == ERROR_NONE)
+        {
+            error = send_watermarks();
+        }
+
+        if (error == ERROR_NONE)
+        {
+            for (size_t i = 0; i < pending_count; i++)
+            {
+                flushed += pending[i].marks[MESSAGE_RECEIPT_DELIVERED].is_set ? 1 : 0;
+                flushed += pending[i].marks[MESSAGE_RECEIPT_READ].is_set ? 1 : 0;
+            }
+            pending_count = 0;
+        }
+    }
+
+    if (flushed_count != NULL)
+    {
+        *flushed_count = flushed;
+    }
+    return error;
+}
+
+void set_receipt_frame_sink(ReceiptFrameSink sink)
+{
+    frame_sink = sink;
+}
+
+ErrorCode queue_message_receipt(const Message* message, MessageReceiptType type, int64_t now)
+{
+    if (message == NULL || (type != MESSAGE_RECEIPT_DELIVERED && type != MESSAGE_RECEIPT_READ)
+        || !is_valid_id_field(message->id, MESSAGE_ID_LENGTH)
+        || !is_valid_id_field(message->conversation_id, MAX_CONVERSATION_ID_LENGTH))
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    int64_t seq = 0;
+    const ErrorCode lookup = find_message_seq(message, &seq);
+    if (lookup != ERROR_NONE)
+    {
+        return lookup;
+    }
+
+    PendingReceipts* entry = NULL;
+    for (size_t i = 0; i < pending_count && entry == NULL; i++)
+    {
+        if (strcmp(pending[i].conversation_id, message->conversation_id) == 0)
+        {
+            entry = &pending[i];
+        }
+    }
+
+    if (entry == NULL)
+    {
+        // A full queue is flushed early rather than dropping receipts.
+        if (pending_count == RECEIPT_COALESCE_MAX_CONVERSATIONS)
+        {
+            const ErrorCode error = flush_pending(NULL);
+            if (error != ERROR_NONE)
+            {
+                return error;
+            }
+        }
+
+        if (pending_count == 0)
+        {
+            window_start = now;
+        }
+
+        entry = &pending[pending_count++];
+        memset(entry, 0, sizeof(PendingReceipts));
+        memcpy(entry->conversation_id, message->conversation_id, strlen(message->conversation_id) + 1);
+    }
+
+    advance_watermark(&entry->marks[MESSAGE_RECEIPT_DELIVERED], message, seq);
+    if (type == MESSAGE_RECEIPT_READ)
+    {
+        advance_watermark(&entry->marks[MESSAGE_RECEIPT_READ], message, seq);
+    }
+    return ERROR_NONE;
+}
+
+ErrorCode process_pending_receipts(int64_t now, size_t* flushed_count)
+{
+    if (pending_count == 0 || now - window_start < RECEIPT_COALESCE_WINDOW_MS)
+    {
+        if (flushed_count != NULL)
+        {
+            *flushed_count = 0;
+        }
+        return ERROR_NONE;
+    }
+
+    return flush_pending(flushed_count);
+}
+
+ErrorCode flush_message_receipts(size_t* flushed_count)
+{
+    return flush_pending(flushed_count);
+}
+
+void receipt_coalescer_shutdown()
+{
+    const ErrorCode error = flush_pending(NULL);
+    if (error != ERROR_NONE)
+    {
+        fprintf(stderr, "Pending receipts not flushed: %d\n", error);
+    }
+
+    pending_count = 0;
+    frame_sink = NULL;
+}
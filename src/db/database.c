@@ -1,6 +1,8 @@
 #include "database.h"
+#include "config.h"
 
 #include <sqlite3.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,9 +18,11 @@
 typedef struct
 {
     sqlite3* handle;
+    int savepoint_depth;
 } Database;
 
 static Database* db = NULL;
+static DbCommitListener commit_listener = NULL;
 
 void print_error_and_free(const char* message, char* to_free)
 {
@@ -68,6 +72,7 @@ int db_open(const char* directory, const char* file_name)
         return SQLITE_NOMEM;
     }
 
+    db->savepoint_depth = 0;
     const int result_code = sqlite3_open(full_path, &db->handle);
     if (result_code != SQLITE_OK)
     {
@@ -189,5 +194,190 @@ int execute_query(const char* query)
         fprintf(stderr, "Query executed successfully\n");
     }
 
+    return result_code;
+}
+
+sqlite3* db_get_handle()
+{
+    return db != NULL ? db->handle : NULL;
+}
+
+static int exec_transaction_statement(const char* statement)
+{
+    if (db == NULL)
+    {
+        fprintf(stderr, "Database not opened\n");
+        return SQLITE_ERROR;
+    }
+
+    char* err_msg = NULL;
+    const int result_code = sqlite3_exec(db->handle, statement, 0, 0, &err_msg);
+
+    if (result_code != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", err_msg);
+        sqlite3_free(err_msg);
+    }
+
+    return result_code;
+}
+
+// BEGIN cannot nest, a transaction begun inside another one is a savepoint of it.
+int db_begin_transaction()
+{
+    if (db != NULL && !sqlite3_get_autocommit(db->handle))
+    {
+        const int result_code = exec_transaction_statement("SAVEPOINT db_nested;");
+        if (result_code == SQLITE_OK)
+        {
+            db->savepoint_depth++;
+        }
+        return result_code;
+    }
+
+    return exec_transaction_statement("BEGIN IMMEDIATE;");
+}
+
+int db_commit_transaction()
+{
+    if (db != NULL && db->savepoint_depth > 0)
+    {
+        db->savepoint_depth--;
+        return exec_transaction_statement("RELEASE db_nested;");
+    }
+
+    return exec_transaction_statement("COMMIT;");
+}
+
+int db_rollback_transaction()
+{
+    if (db != NULL && db->savepoint_depth > 0)
+    {
+        db->savepoint_depth--;
+        return exec_transaction_statement("ROLLBACK TO db_nested; RELEASE db_nested;");
+    }
+
+    return exec_transaction_statement("ROLLBACK;");
+}
+
+static int query_pragma(const char* pragma, sqlite3_int64* value)
+{
+    sqlite3_stmt* stmt;
+    int result_code = sqlite3_prepare_v2(db->handle, pragma, -1, &stmt, NULL);
+    if (result_code != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db->handle));
+        return result_code;
+    }
+
+    result_code = sqlite3_step(stmt);
+    if (result_code == SQLITE_ROW)
+    {
+        *value = sqlite3_column_int64(stmt, 0);
+        result_code = SQLITE_OK;
+    }
+    else
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db->handle));
+    }
+
+    sqlite3_finalize(stmt);
+    return result_code;
+}
+
+int db_incremental_vacuum(int pages_per_step)
+{
+    if (db == NULL || pages_per_step <= 0)
+    {
+        fprintf(stderr, "Invalid page count or database not opened\n");
+        return SQLITE_ERROR;
+    }
+
+    // Mode 2 is INCREMENTAL, otherwise incremental_vacuum would leave the free pages where they are.
+    sqlite3_int64 mode = 0;
+    int result_code = query_pragma("PRAGMA auto_vacuum;", &mode);
+    if (result_code != SQLITE_OK || mode != 2)
+    {
+        return result_code;
+    }
+
+    char step[64];
+    snprintf(step, sizeof(step), "PRAGMA incremental_vacuum(%d);", pages_per_step);
+
+    sqlite3_int64 free_pages = 0;
+    sqlite3_int64 previous = INT64_MAX;
+    while ((result_code = query_pragma("PRAGMA freelist_count;", &free_pages)) == SQLITE_OK && free_pages > 0
+           && free_pages < previous)
+    {
+        previous = free_pages;
+        result_code = exec_transaction_statement(step);
+        if (result_code != SQLITE_OK)
+        {
+            break;
+        }
+    }
+
+    return result_code;
+}
+
+/*
+ * SQLite calls the WAL hook after every commit, once the write lock is
+ * released, so the listener may read and write again. Installing it takes
+ * over automatic checkpoints, which it runs itself.
+ */
+static int on_wal_commit(void* context, sqlite3* handle, const char* database, int pages)
+{
+    (void)context;
+
+    if (pages >= DB_WAL_CHECKPOINT_PAGES)
+    {
+        sqlite3_wal_checkpoint_v2(handle, database, SQLITE_CHECKPOINT_PASSIVE, NULL, NULL);
+    }
+
+    if (commit_listener != NULL)
+    {
+        commit_listener();
+    }
+
+    return SQLITE_OK;
+}
+
+int db_set_commit_listener(DbCommitListener listener)
+{
+    if (db == NULL)
+    {
+        fprintf(stderr, "Database not opened\n");
+        return SQLITE_ERROR;
+    }
+
+    if (listener == NULL)
+    {
+        commit_listener = NULL;
+        sqlite3_wal_autocheckpoint(db->handle, DB_WAL_CHECKPOINT_PAGES);
+        return SQLITE_OK;
+    }
+
+    sqlite3_stmt* stmt;
+    int result_code = sqlite3_prepare_v2(db->handle, "PRAGMA journal_mode = WAL;", -1, &stmt, NULL);
+    if (result_code != SQLITE_OK)
+    {
+        fprintf(stderr, "SQL error: %s\n", sqlite3_errmsg(db->handle));
+        return result_code;
+    }
+
+    // The pragma answers with the mode in effect, in-memory databases stay out of WAL.
+    result_code = sqlite3_step(stmt) == SQLITE_ROW
+        && sqlite3_stricmp((const char*)sqlite3_column_text(stmt, 0), "wal") == 0 ? SQLITE_OK : SQLITE_ERROR;
+    if (result_code != SQLITE_OK)
+    {
+        fprintf(stderr, "Cannot switch the database to WAL mode\n");
+    }
+    sqlite3_finalize(stmt);
+
+    if (result_code == SQLITE_OK)
+    {
+        commit_listener = listener;
+        sqlite3_wal_hook(db->handle, on_wal_commit, NULL);
+    }
     return result_code;
 }
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "frame_pool.h"
+
+struct FramePool {
+    uint8_t* frames;
+    uint8_t** free_frames; // Stack, the most recently released frame is reused first while it is still cached
+    size_t free_count;
+    size_t frame_count;
+    size_t frame_size;
+};
+
+FramePool* frame_pool_create(size_t frame_count, size_t frame_size)
+{
+    if (frame_count == 0 || frame_size == 0 || frame_count > SIZE_MAX / frame_size)
+    {
+        return NULL;
+    }
+
+    FramePool* pool = calloc(1, sizeof(FramePool));
+    if (pool == NULL)
+    {
+        return NULL;
+    }
+
+    // Frames start on max_align_t boundaries so they can hold samples as well as bytes.
+    const size_t alignment = sizeof(max_align_t);
+    pool->frame_size = (frame_size + alignment - 1) / alignment * alignment;
+    pool->frame_count = frame_count;
+    pool->frames = malloc(frame_count * pool->frame_size);
+    pool->free_frames = malloc(frame_count * sizeof(uint8_t*));
+    if (pool->frames == NULL || pool->free_frames == NULL)
+    {
+        frame_pool_destroy(pool);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < frame_count; i++)
+    {
+        pool->free_frames[i] = pool->frames + (frame_count - 1 - i) * pool->frame_size;
+    }
+    pool->free_count = frame_count;
+    return pool;
+}
+
+void frame_pool_destroy(FramePool* pool)
+{
+    if (pool == NULL)
+    {
+        return;
+    }
+
+    free(pool->frames);
+    free(pool->free_frames);
+    free(pool);
+}
+
+uint8_t* frame_pool_acquire(FramePool* pool)
+{
+    if (pool == NULL || pool->free_count == 0)
+    {
+        return NULL;
+    }
+    return pool->free_frames[--pool->free_count];
+}
+
+void frame_pool_release(FramePool* pool, uint8_t* frame)
+{
+    if (pool == NULL || frame == NULL || pool->free_count == pool->frame_count)
+    {
+        return;
+    }
+    pool->free_frames[pool->free_count++] = frame;
+}
+
+size_t frame_pool_available(const FramePool* pool)
+{
+    return pool == NULL ? 0 : pool->free_count;
+}
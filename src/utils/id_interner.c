@@ -0,0 +1,211 @@
+#include "id_interner.h"
+
+#define INTERNER_INITIAL_CAPACITY 64
+
+typedef struct {
+    uint32_t hash; // Zero marks an empty slot
+    uint32_t number;
+} InternSlot;
+
+typedef struct {
+    char id[ID_INTERNER_MAX_ID_LENGTH];
+} InternName;
+
+struct IdInterner {
+    InternSlot* slots;
+    size_t slot_capacity;
+    InternName* names;
+    size_t count;
+    size_t name_capacity;
+};
+
+static uint32_t hash_id(const char* id)
+{
+    // FNV-1a, with zero reserved for empty slots.
+    uint32_t hash = 2166136261u;
+    for (const char* cursor = id; *cursor != '\0'; cursor++)
+    {
+        hash ^= (unsigned char)*cursor;
+        hash *= 16777619u;
+    }
+    return hash == 0 ? 1 : hash;
+}
+
+static bool is_valid_id(const char* id)
+{
+    return id != NULL && id[0] != '\0' && memchr(id, '\0', ID_INTERNER_MAX_ID_LENGTH) != NULL;
+}
+
+static size_t find_slot(const IdInterner* interner, const char* id, uint32_t hash)
+{
+    const size_t mask = interner->slot_capacity - 1;
+    size_t position = hash & mask;
+    while (interner->slots[position].hash != 0
+           && (interner->slots[position].hash != hash
+               || strcmp(interner->names[interner->slots[position].number].id, id) != 0))
+    {
+        position = (position + 1) & mask;
+    }
+    return position;
+}
+
+static ErrorCode grow_slots(IdInterner* interner)
+{
+    const size_t capacity = interner->slot_capacity == 0 ? INTERNER_INITIAL_CAPACITY : interner->slot_capacity * 2;
+    InternSlot* slots = calloc(capacity, sizeof(InternSlot));
+    if (slots == NULL)
+    {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    const size_t mask = capacity - 1;
+    for (size_t i = 0; i < interner->slot_capacity; i++)
+    {
+        if (interner->slots[i].hash != 0)
+        {
+            size_t position = interner->slots[i].hash & mask;
+            while (slots[position].hash != 0)
+            {
+                position = (position + 1) & mask;
+            }
+            slots[position] = interner->slots[i];
+        }
+    }
+
+    free(interner->slots);
+    interner->slots = slots;
+    interner->slot_capacity = capacity;
+    return ERROR_NONE;
+}
+
+static void remove_slot(IdInterner* interner, size_t hole)
+{
+    // Backward shift deletion, see id_set.c.
+    const size_t mask = interner->slot_capacity - 1;
+    size_t position = (hole + 1) & mask;
+    while (interner->slots[position].hash != 0)
+    {
+        const size_t home = interner->slots[position].hash & mask;
+        if (((position - home) & mask) >= ((position - hole) & mask))
+        {
+            interner->slots[hole] = interner->slots[position];
+            hole = position;
+        }
+        position = (position + 1) & mask;
+    }
+    interner->slots[hole].hash = 0;
+}
+
+IdInterner* id_interner_create()
+{
+    return calloc(1, sizeof(IdInterner));
+}
+
+void id_interner_destroy(IdInterner* interner)
+{
+    if (interner == NULL)
+    {
+        return;
+    }
+
+    free(interner->slots);
+    free(interner->names);
+    free(interner);
+}
+
+ErrorCode id_interner_intern(IdInterner* interner, const char* id, uint32_t* number)
+{
+    if (interner == NULL || number == NULL || !is_valid_id(id))
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    if (id_interner_find(interner, id, number))
+    {
+        return ERROR_NONE;
+    }
+
+    if (interner->count == UINT32_MAX)
+    {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    if ((interner->count + 1) * 2 > interner->slot_capacity)
+    {
+        const ErrorCode error = grow_slots(interner);
+        if (error != ERROR_NONE)
+        {
+            return error;
+        }
+    }
+
+    if (interner->count == interner->name_capacity)
+    {
+        const size_t capacity = interner->name_capacity == 0 ? INTERNER_INITIAL_CAPACITY : interner->name_capacity * 2;
+        InternName* grown = realloc(interner->names, capacity * sizeof(InternName));
+        if (grown == NULL)
+        {
+            return ERROR_MEMORY_ALLOCATION;
+        }
+        interner->names = grown;
+        interner->name_capacity = capacity;
+    }
+
+    const uint32_t hash = hash_id(id);
+    InternSlot* slot = &interner->slots[find_slot(interner, id, hash)];
+    slot->hash = hash;
+    slot->number = (uint32_t)interner->count;
+    memcpy(interner->names[interner->count].id, id, strlen(id) + 1);
+
+    *number = (uint32_t)interner->count++;
+    return ERROR_NONE;
+}
+
+bool id_interner_find(const IdInterner* interner, const char* id, uint32_t* number)
+{
+    if (interner == NULL || interner->count == 0 || !is_valid_id(id))
+    {
+        return false;
+    }
+
+    const InternSlot* slot = &interner->slots[find_slot(interner, id, hash_id(id))];
+    if (slot->hash == 0)
+    {
+        return false;
+    }
+
+    if (number != NULL)
+    {
+        *number = slot->number;
+    }
+    return true;
+}
+
+const char* id_interner_name(const IdInterner* interner, uint32_t number)
+{
+    if (interner == NULL || number >= interner->count)
+    {
+        return NULL;
+    }
+    return interner->names[number].id;
+}
+
+size_t id_interner_count(const IdInterner* interner)
+{
+    return interner == NULL ? 0 : interner->count;
+}
+
+void id_interner_truncate(IdInterner* interner, size_t count)
+{
+    if (interner == NULL)
+    {
+        return;
+    }
+
+    while (interner->count > count)
+    {
+        const char* id = interner->names[interner->count - 1].id;
+        remove_slot(interner, find_slot(interner, id, hash_id(id)));
+        interner->count--;
+    }
+}
@@ -0,0 +1,170 @@
+#include "id_set.h"
+
+#define ID_SET_INITIAL_CAPACITY 64
+
+typedef struct {
+    uint32_t hash; // Zero marks an empty slot
+    char id[ID_SET_MAX_ID_LENGTH];
+} IdSlot;
+
+struct IdSet {
+    IdSlot* slots;
+    size_t capacity;
+    size_t count;
+};
+
+static uint32_t hash_id(const char* id, size_t* length)
+{
+    // FNV-1a, with zero reserved for empty slots.
+    uint32_t hash = 2166136261u;
+    const char* cursor = id;
+    for (; *cursor != '\0'; cursor++)
+    {
+        hash ^= (unsigned char)*cursor;
+        hash *= 16777619u;
+    }
+
+    *length = (size_t)(cursor - id);
+    return hash == 0 ? 1 : hash;
+}
+
+static bool is_valid_id(const char* id)
+{
+    return id != NULL && id[0] != '\0' && memchr(id, '\0', ID_SET_MAX_ID_LENGTH) != NULL;
+}
+
+/**
+ * Returns the slot holding the ID, or the empty slot ending its probe sequence.
+ */
+static size_t find_slot(const IdSlot* slots, size_t capacity, const char* id, uint32_t hash)
+{
+    const size_t mask = capacity - 1;
+    size_t position = hash & mask;
+    while (slots[position].hash != 0
+           && (slots[position].hash != hash || strcmp(slots[position].id, id) != 0))
+    {
+        position = (position + 1) & mask;
+    }
+    return position;
+}
+
+static ErrorCode grow(IdSet* set)
+{
+    const size_t capacity = set->capacity == 0 ? ID_SET_INITIAL_CAPACITY : set->capacity * 2;
+    IdSlot* slots = calloc(capacity, sizeof(IdSlot));
+    if (slots == NULL)
+    {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    for (size_t i = 0; i < set->capacity; i++)
+    {
+        if (set->slots[i].hash != 0)
+        {
+            slots[find_slot(slots, capacity, set->slots[i].id, set->slots[i].hash)] = set->slots[i];
+        }
+    }
+
+    free(set->slots);
+    set->slots = slots;
+    set->capacity = capacity;
+    return ERROR_NONE;
+}
+
+IdSet* id_set_create()
+{
+    return calloc(1, sizeof(IdSet));
+}
+
+void id_set_destroy(IdSet* set)
+{
+    if (set == NULL)
+    {
+        return;
+    }
+
+    free(set->slots);
+    free(set);
+}
+
+ErrorCode id_set_add(IdSet* set, const char* id)
+{
+    if (set == NULL || !is_valid_id(id))
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    // Keep the load factor at or below one half so probe sequences stay short.
+    if ((set->count + 1) * 2 > set->capacity)
+    {
+        const ErrorCode error = grow(set);
+        if (error != ERROR_NONE)
+        {
+            return error;
+        }
+    }
+
+    size_t length;
+    const uint32_t hash = hash_id(id, &length);
+    IdSlot* slot = &set->slots[find_slot(set->slots, set->capacity, id, hash)];
+    if (slot->hash == 0)
+    {
+        slot->hash = hash;
+        memcpy(slot->id, id, length + 1);
+        set->count++;
+    }
+
+    return ERROR_NONE;
+}
+
+bool id_set_remove(IdSet* set, const char* id)
+{
+    if (set == NULL || set->count == 0 || !is_valid_id(id))
+    {
+        return false;
+    }
+
+    size_t length;
+    const uint32_t hash = hash_id(id, &length);
+    size_t hole = find_slot(set->slots, set->capacity, id, hash);
+    if (set->slots[hole].hash == 0)
+    {
+        return false;
+    }
+
+    // Backward shift: move later entries of the cluster into the hole when
+    // their home slot does not lie between the hole and their position.
+    const size_t mask = set->capacity - 1;
+    size_t position = (hole + 1) & mask;
+    while (set->slots[position].hash != 0)
+    {
+        const size_t home = set->slots[position].hash & mask;
+        if (((position - home) & mask) >= ((position - hole) & mask))
+        {
+            set->slots[hole] = set->slots[position];
+            hole = position;
+        }
+        position = (position + 1) & mask;
+    }
+
+    set->slots[hole].hash = 0;
+    set->count--;
+    return true;
+}
+
+bool id_set_contains(const IdSet* set, const char* id)
+{
+    if (set == NULL || set->count == 0 || !is_valid_id(id))
+    {
+        return false;
+    }
+
+    size_t length;
+    const uint32_t hash = hash_id(id, &length);
+    return set->slots[find_slot(set->slots, set->capacity, id, hash)].hash != 0;
+}
+
+size_t id_set_count(const IdSet* set)
+{
+    return set == NULL ? 0 : set->count;
+}
@@ -0,0 +1,128 @@
+#include "mpsc_ring.h"
+
+#include <stdatomic.h>
+
+/**
+ * Every cell carries the sequence number of the position it may be written
+ * at (equal to the position) or read at (position + 1) next.
+ */
+typedef struct {
+    _Atomic size_t sequence;
+} RingCell;
+
+struct MpscRing {
+    _Atomic size_t enqueue_position;
+    _Atomic size_t dequeue_position; // Atomic so that any thread may ask whether the ring is empty
+    size_t mask;
+    size_t element_size;
+    size_t cell_size;
+    unsigned char* cells;
+};
+
+static RingCell* cell_at(MpscRing* ring, size_t position)
+{
+    return (RingCell*)(ring->cells + (position & ring->mask) * ring->cell_size);
+}
+
+static void* cell_data(RingCell* cell)
+{
+    return (unsigned char*)cell + sizeof(RingCell);
+}
+
+MpscRing* mpsc_ring_create(size_t capacity, size_t element_size)
+{
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0 || element_size == 0)
+    {
+        return NULL;
+    }
+
+    MpscRing* ring = calloc(1, sizeof(MpscRing));
+    if (ring == NULL)
+    {
+        return NULL;
+    }
+
+    // Cells stay aligned for the sequence counter and for the element.
+    const size_t alignment = sizeof(max_align_t);
+    ring->cell_size = (sizeof(RingCell) + element_size + alignment - 1) / alignment * alignment;
+    ring->cells = malloc(capacity * ring->cell_size);
+    if (ring->cells == NULL)
+    {
+        free(ring);
+        return NULL;
+    }
+
+    ring->mask = capacity - 1;
+    ring->element_size = element_size;
+    for (size_t i = 0; i < capacity; i++)
+    {
+        atomic_init(&cell_at(ring, i)->sequence, i);
+    }
+    atomic_init(&ring->enqueue_position, 0);
+    atomic_init(&ring->dequeue_position, 0);
+    return ring;
+}
+
+void mpsc_ring_destroy(MpscRing* ring)
+{
+    if (ring == NULL)
+    {
+        return;
+    }
+
+    free(ring->cells);
+    free(ring);
+}
+
+bool mpsc_ring_push(MpscRing* ring, const void* element)
+{
+    size_t position = atomic_load_explicit(&ring->enqueue_position, memory_order_relaxed);
+    RingCell* cell;
+    for (;;)
+    {
+        cell = cell_at(ring, position);
+        const size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        const intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+        if (difference == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&ring->enqueue_position, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (difference < 0)
+        {
+            return false;
+        }
+        else
+        {
+            position = atomic_load_explicit(&ring->enqueue_position, memory_order_relaxed);
+        }
+    }
+
+    memcpy(cell_data(cell), element, ring->element_size);
+    atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+    return true;
+}
+
+bool mpsc_ring_pop(MpscRing* ring, void* element)
+{
+    const size_t position = atomic_load_explicit(&ring->dequeue_position, memory_order_relaxed);
+    RingCell* cell = cell_at(ring, position);
+    if (atomic_load_explicit(&cell->sequence, memory_order_acquire) != position + 1)
+    {
+        return false;
+    }
+
+    memcpy(element, cell_data(cell), ring->element_size);
+    atomic_store_explicit(&cell->sequence, position + ring->mask + 1, memory_order_release);
+    atomic_store_explicit(&ring->dequeue_position, position + 1, memory_order_relaxed);
+    return true;
+}
+
+bool mpsc_ring_is_empty(MpscRing* ring)
+{
+    const size_t position = atomic_load_explicit(&ring->dequeue_position, memory_order_relaxed);
+    return atomic_load_explicit(&cell_at(ring, position)->sequence, memory_order_acquire) != position + 1;
+}
@@ -0,0 +1,557 @@
+#include "prefix_index.h"
+#include "text_fold.h"
+
+#define PREFIX_INDEX_MAX_QUERY_WORDS 16
+
+typedef struct {
+    char* id;
+    char* folded;
+    void* payload;
+    size_t payload_size;
+    uint32_t visit_mark;
+} IndexRecord;
+
+typedef struct {
+    const char* key;
+    IndexRecord* record;
+} IndexKey;
+
+struct PrefixIndex {
+    IndexRecord** records;
+    size_t record_count;
+    size_t record_capacity;
+    IndexKey* keys;
+    size_t key_count;
+    size_t key_capacity;
+    uint32_t visit_generation;
+    bool is_loading;
+};
+
+static char* duplicate_string(const char* text)
+{
+    const size_t length = strlen(text);
+    char* copy = malloc(length + 1);
+    if (copy != NULL)
+    {
+        memcpy(copy, text, length + 1);
+    }
+    return copy;
+}
+
+static int compare_keys(const char* key, const IndexRecord* record, const IndexKey* other)
+{
+    const int by_text = strcmp(key, other->key);
+    if (by_text != 0)
+    {
+        return by_text;
+    }
+
+    const uintptr_t lhs = (uintptr_t)record;
+    const uintptr_t rhs = (uintptr_t)other->record;
+    return lhs < rhs ? -1 : (lhs > rhs ? 1 : 0);
+}
+
+static size_t find_key_position(const PrefixIndex* index, const char* key, const IndexRecord* record)
+{
+    size_t low = 0;
+    size_t high = index->key_count;
+    while (low < high)
+    {
+        const size_t middle = low + (high - low) / 2;
+        if (compare_keys(key, record, &index->keys[middle]) > 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static size_t find_record_position(const PrefixIndex* index, const char* id, bool* found)
+{
+    size_t low = 0;
+    size_t high = index->record_count;
+    while (low < high)
+    {
+        const size_t middle = low + (high - low) / 2;
+        const int order = strcmp(id, index->records[middle]->id);
+        if (order == 0)
+        {
+            *found = true;
+            return middle;
+        }
+        if (order > 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    *found = false;
+    return low;
+}
+
+static bool is_word_start(const char* text, const char* position)
+{
+    return position == text || position[-1] == ' ';
+}
+
+static void remove_keys(PrefixIndex* index, IndexRecord* record)
+{
+    for (const char* cursor = record->folded; *cursor != '\0'; cursor++)
+    {
+        if (!is_word_start(record->folded, cursor))
+        {
+            continue;
+        }
+
+        const size_t position = find_key_position(index, cursor, record);
+        if (position < index->key_count && index->keys[position].record == record)
+        {
+            memmove(&index->keys[position], &index->keys[position + 1],
+                    (index->key_count - position - 1) * sizeof(IndexKey));
+            index->key_count--;
+        }
+    }
+}
+
+static ErrorCode insert_keys(PrefixIndex* index, IndexRecord* record)
+{
+    for (const char* cursor = record->folded; *cursor != '\0'; cursor++)
+    {
+        if (!is_word_start(record->folded, cursor))
+        {
+            continue;
+        }
+
+        if (index->key_count == index->key_capacity)
+        {
+            const size_t capacity = index->key_capacity == 0 ? 64 : index->key_capacity * 2;
+            IndexKey* grown = realloc(index->keys, capacity * sizeof(IndexKey));
+            if (grown == NULL)
+            {
+                remove_keys(index, record);
+                return ERROR_MEMORY_ALLOCATION;
+            }
+            index->keys = grown;
+            index->key_capacity = capacity;
+        }
+
+        const size_t position = find_key_position(index, cursor, record);
+        memmove(&index->keys[position + 1], &index->keys[position],
+                (index->key_count - position) * sizeof(IndexKey));
+        index->keys[position].key = cursor;
+        index->keys[position].record = record;
+        index->key_count++;
+    }
+
+    return ERROR_NONE;
+}
+
+static IndexRecord* create_record(const char* id, const char* text, const void* payload, size_t payload_size)
+{
+    char folded[PREFIX_INDEX_MAX_TEXT_LENGTH];
+    text_fold(text, folded, sizeof(folded));
+
+    IndexRecord* record = calloc(1, sizeof(IndexRecord));
+    if (record == NULL)
+    {
+        return NULL;
+    }
+
+    record->id = duplicate_string(id);
+    record->folded = duplicate_string(folded);
+    record->payload = malloc(payload_size);
+    if (record->id == NULL || record->folded == NULL || record->payload == NULL)
+    {
+        free(record->id);
+        free(record->folded);
+        free(record->payload);
+        free(record);
+        return NULL;
+    }
+
+    memcpy(record->payload, payload, payload_size);
+    record->payload_size = payload_size;
+    return record;
+}
+
+static void free_record(IndexRecord* record)
+{
+    free(record->id);
+    free(record->folded);
+    free(record->payload);
+    free(record);
+}
+
+static bool has_word_with_prefix(const char* folded, const char* prefix, size_t prefix_length)
+{
+    for (const char* cursor = folded; *cursor != '\0'; cursor++)
+    {
+        if (is_word_start(folded, cursor) && strncmp(cursor, prefix, prefix_length) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+PrefixIndex* prefix_index_create()
+{
+    return calloc(1, sizeof(PrefixIndex));
+}
+
+void prefix_index_destroy(PrefixIndex* index)
+{
+    if (index == NULL)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < index->record_count; i++)
+    {
+        free_record(index->records[i]);
+    }
+
+    free(index->records);
+    free(index->keys);
+    free(index);
+}
+
+ErrorCode prefix_index_put(PrefixIndex* index, const char* id, const char* text, const void* payload, size_t payload_size)
+{
+    if (index == NULL || id == NULL || payload == NULL || payload_size == 0)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    if (index->is_loading)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    IndexRecord* record = create_record(id, text, payload, payload_size);
+    if (record == NULL)
+    {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    bool found;
+    const size_t position = find_record_position(index, id, &found);
+    if (!found && index->record_count == index->record_capacity)
+    {
+        const size_t capacity = index->record_capacity == 0 ? 64 : index->record_capacity * 2;
+        IndexRecord** grown = realloc(index->records, capacity * sizeof(IndexRecord*));
+        if (grown == NULL)
+        {
+            free_record(record);
+            return ERROR_MEMORY_ALLOCATION;
+        }
+        index->records = grown;
+        index->record_capacity = capacity;
+    }
+
+    const ErrorCode error = insert_keys(index, record);
+    if (error != ERROR_NONE)
+    {
+        free_record(record);
+        return error;
+    }
+
+    if (found)
+    {
+        remove_keys(index, index->records[position]);
+        free_record(index->records[position]);
+    }
+    else
+    {
+        memmove(&index->records[position + 1], &index->records[position],
+                (index->record_count - position) * sizeof(IndexRecord*));
+        index->record_count++;
+    }
+
+    index->records[position] = record;
+    return ERROR_NONE;
+}
+
+ErrorCode prefix_index_set_payload(PrefixIndex* index, const char* id, const void* payload, size_t payload_size)
+{
+    if (index == NULL || id == NULL || payload == NULL || payload_size == 0 || index->is_loading)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    bool found;
+    const size_t position = find_record_position(index, id, &found);
+    if (!found)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    IndexRecord* record = index->records[position];
+    if (record->payload_size != payload_size)
+    {
+        void* resized = realloc(record->payload, payload_size);
+        if (resized == NULL)
+        {
+            return ERROR_MEMORY_ALLOCATION;
+        }
+        record->payload = resized;
+        record->payload_size = payload_size;
+    }
+
+    memcpy(record->payload, payload, payload_size);
+    return ERROR_NONE;
+}
+
+ErrorCode prefix_index_load(PrefixIndex* index, const char* id, const char* text, const void* payload,
+                            size_t payload_size)
+{
+    if (index == NULL || id == NULL || payload == NULL || payload_size == 0
+        || (!index->is_loading && index->record_count > 0))
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    if (index->record_count == index->record_capacity)
+    {
+        const size_t capacity = index->record_capacity == 0 ? 64 : index->record_capacity * 2;
+        IndexRecord** grown = realloc(index->records, capacity * sizeof(IndexRecord*));
+        if (grown == NULL)
+        {
+            return ERROR_MEMORY_ALLOCATION;
+        }
+        index->records = grown;
+        index->record_capacity = capacity;
+    }
+
+    IndexRecord* record = create_record(id, text, payload, payload_size);
+    if (record == NULL)
+    {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    // Searches are not allowed while loading, the visit mark holds the load order until the load finishes.
+    index->is_loading = true;
+    index->records[index->record_count++] = record;
+    record->visit_mark = (uint32_t)index->record_count;
+    return ERROR_NONE;
+}
+
+static int compare_loaded_records(const void* lhs, const void* rhs)
+{
+    const IndexRecord* a = *(IndexRecord* const*)lhs;
+    const IndexRecord* b = *(IndexRecord* const*)rhs;
+
+    const int by_id = strcmp(a->id, b->id);
+    if (by_id != 0)
+    {
+        return by_id;
+    }
+    return a->visit_mark < b->visit_mark ? -1 : (a->visit_mark > b->visit_mark ? 1 : 0);
+}
+
+static int compare_index_keys(const void* lhs, const void* rhs)
+{
+    const IndexKey* a = lhs;
+    return compare_keys(a->key, a->record, rhs);
+}
+
+ErrorCode prefix_index_finish_load(PrefixIndex* index)
+{
+    if (index == NULL)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    if (!index->is_loading)
+    {
+        return ERROR_NONE;
+    }
+
+    qsort(index->records, index->record_count, sizeof(IndexRecord*), compare_loaded_records);
+
+    // A record loaded twice keeps its last text and payload, like a second put would.
+    size_t kept = 0;
+    size_t key_count = 0;
+    for (size_t i = 0; i < index->record_count; i++)
+    {
+        IndexRecord* record = index->records[i];
+        if (i + 1 < index->record_count && strcmp(record->id, index->records[i + 1]->id) == 0)
+        {
+            free_record(record);
+            continue;
+        }
+
+        record->visit_mark = 0;
+        for (const char* cursor = record->folded; *cursor != '\0'; cursor++)
+        {
+            key_count += is_word_start(record->folded, cursor) ? 1 : 0;
+        }
+        index->records[kept++] = record;
+    }
+    index->record_count = kept;
+    index->visit_generation = 0;
+
+    IndexKey* keys = key_count > 0 ? malloc(key_count * sizeof(IndexKey)) : NULL;
+    if (key_count > 0 && keys == NULL)
+    {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    size_t position = 0;
+    for (size_t i = 0; i < index->record_count; i++)
+    {
+        IndexRecord* record = index->records[i];
+        for (const char* cursor = record->folded; *cursor != '\0'; cursor++)
+        {
+            if (is_word_start(record->folded, cursor))
+            {
+                keys[position].key = cursor;
+                keys[position].record = record;
+                position++;
+            }
+        }
+    }
+    qsort(keys, key_count, sizeof(IndexKey), compare_index_keys);
+
+    free(index->keys);
+    index->keys = keys;
+    index->key_count = key_count;
+    index->key_capacity = key_count;
+    index->is_loading = false;
+    return ERROR_NONE;
+}
+
+void prefix_index_remove(PrefixIndex* index, const char* id)
+{
+    if (index == NULL || id == NULL || index->is_loading)
+    {
+        return;
+    }
+
+    bool found;
+    const size_t position = find_record_position(index, id, &found);
+    if (!found)
+    {
+        return;
+    }
+
+    IndexRecord* record = index->records[position];
+    remove_keys(index, record);
+    free_record(record);
+
+    memmove(&index->records[position], &index->records[position + 1],
+            (index->record_count - position - 1) * sizeof(IndexRecord*));
+    index->record_count--;
+}
+
+const void* prefix_index_get(const PrefixIndex* index, const char* id)
+{
+    if (index == NULL || id == NULL || index->is_loading)
+    {
+        return NULL;
+    }
+
+    bool found;
+    const size_t position = find_record_position(index, id, &found);
+    return found ? index->records[position]->payload : NULL;
+}
+
+void prefix_index_for_each(const PrefixIndex* index, PrefixIndexVisitor visitor, void* context)
+{
+    if (index == NULL || visitor == NULL || index->is_loading)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < index->record_count; i++)
+    {
+        if (!visitor(index->records[i]->payload, context))
+        {
+            return;
+        }
+    }
+}
+
+size_t prefix_index_search(PrefixIndex* index, const char* query, PrefixIndexVisitor visitor, void* context)
+{
+    if (index == NULL || query == NULL || visitor == NULL || index->is_loading)
+    {
+        return 0;
+    }
+
+    char folded[PREFIX_INDEX_MAX_TEXT_LENGTH];
+    if (text_fold(query, folded, sizeof(folded)) == 0)
+    {
+        return 0;
+    }
+
+    const char* words[PREFIX_INDEX_MAX_QUERY_WORDS];
+    size_t lengths[PREFIX_INDEX_MAX_QUERY_WORDS];
+    size_t word_count = 0;
+    size_t longest = 0;
+    for (char* cursor = folded; *cursor != '\0' && word_count < PREFIX_INDEX_MAX_QUERY_WORDS; cursor++)
+    {
+        if (is_word_start(folded, cursor))
+        {
+            words[word_count] = cursor;
+            lengths[word_count] = strcspn(cursor, " ");
+            if (lengths[word_count] > lengths[longest])
+            {
+                longest = word_count;
+            }
+            word_count++;
+        }
+    }
+
+    // The longest word selects the narrowest key range, the others filter it.
+    char anchor[PREFIX_INDEX_MAX_TEXT_LENGTH];
+    memcpy(anchor, words[longest], lengths[longest]);
+    anchor[lengths[longest]] = '\0';
+
+    if (++index->visit_generation == 0)
+    {
+        for (size_t i = 0; i < index->record_count; i++)
+        {
+            index->records[i]->visit_mark = 0;
+        }
+        index->visit_generation = 1;
+    }
+
+    size_t visited = 0;
+    for (size_t i = find_key_position(index, anchor, NULL);
+         i < index->key_count && strncmp(index->keys[i].key, anchor, lengths[longest]) == 0;
+         i++)
+    {
+        IndexRecord* record = index->keys[i].record;
+        if (record->visit_mark == index->visit_generation)
+        {
+            continue;
+        }
+        record->visit_mark = index->visit_generation;
+
+        bool matches = true;
+        for (size_t w = 0; w < word_count && matches; w++)
+        {
+            matches = w == longest || has_word_with_prefix(record->folded, words[w], lengths[w]);
+        }
+
+        if (matches)
+        {
+            visited++;
+            if (!visitor(record->payload, context))
+            {
+                break;
+            }
+        }
+    }
+
+    return visited;
+}
@@ -0,0 +1,744 @@
+#include "roaring.h"
+
+#define BITMAP_WORDS 1024 // 65536 bits
+
+typedef enum {
+    CONTAINER_ARRAY,
+    CONTAINER_BITMAP
+} ContainerType;
+
+typedef struct {
+    uint16_t key;
+    uint16_t type;
+    uint32_t cardinality;
+    uint32_t capacity; // Array containers only
+    union {
+        uint16_t* array;
+        uint64_t* bits;
+    } data;
+} Container;
+
+struct Roaring {
+    Container* containers;
+    size_t count;
+    size_t capacity;
+};
+
+static unsigned count_trailing_zeros(uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctzll(word);
+#else
+    unsigned count = 0;
+    while ((word & 1) == 0)
+    {
+        word >>= 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+static unsigned count_bits(uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_popcountll(word);
+#else
+    unsigned count = 0;
+    for (; word != 0; word &= word - 1)
+    {
+        count++;
+    }
+    return count;
+#endif
+}
+
+static void free_container(Container* container)
+{
+    if (container->type == CONTAINER_ARRAY)
+    {
+        free(container->data.array);
+    }
+    else
+    {
+        free(container->data.bits);
+    }
+}
+
+static size_t find_container(const Roaring* set, uint16_t key, bool* found)
+{
+    size_t low = 0;
+    size_t high = set->count;
+    while (low < high)
+    {
+        const size_t middle = low + (high - low) / 2;
+        if (set->containers[middle].key == key)
+        {
+            *found = true;
+            return middle;
+        }
+        if (set->containers[middle].key < key)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    *found = false;
+    return low;
+}
+
+static size_t find_in_array(const uint16_t* array, size_t count, uint16_t value, bool* found)
+{
+    size_t low = 0;
+    size_t high = count;
+    while (low < high)
+    {
+        const size_t middle = low + (high - low) / 2;
+        if (array[middle] == value)
+        {
+            *found = true;
+            return middle;
+        }
+        if (array[middle] < value)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    *found = false;
+    return low;
+}
+
+static bool container_contains(const Container* container, uint16_t low)
+{
+    if (container->type == CONTAINER_BITMAP)
+    {
+        return (container->data.bits[low >> 6] >> (low & 63)) & 1;
+    }
+
+    bool found;
+    find_in_array(container->data.array, container->cardinality, low, &found);
+    return found;
+}
+
+static ErrorCode array_to_bitmap(Container* container)
+{
+    uint64_t* bits = calloc(BITMAP_WORDS, sizeof(uint64_t));
+    if (bits == NULL)
+    {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    for (uint32_t i = 0; i < container->cardinality; i++)
+    {
+        const uint16_t value = container->data.array[i];
+        bits[value >> 6] |= UINT64_C(1) << (value & 63);
+    }
+
+    free(container->data.array);
+    container->data.bits = bits;
+    container->type = CONTAINER_BITMAP;
+    container->capacity = 0;
+    return ERROR_NONE;
+}
+
+static void bitmap_to_array(Container* container)
+{
+    uint16_t* array = malloc((container->cardinality == 0 ? 1 : container->cardinality) * sizeof(uint16_t));
+    if (array == NULL)
+    {
+        // Staying a bitmap is correct, only larger.
+        return;
+    }
+
+    uint32_t count = 0;
+    for (uint32_t w = 0; w < BITMAP_WORDS; w++)
+    {
+        for (uint64_t word = container->data.bits[w]; word != 0; word &= word - 1)
+        {
+            array[count++] = (uint16_t)(w * 64 + count_trailing_zeros(word));
+        }
+    }
+
+    free(container->data.bits);
+    container->data.array = array;
+    container->type = CONTAINER_ARRAY;
+    container->capacity = container->cardinality;
+}
+
+static ErrorCode container_add(Container* container, uint16_t low)
+{
+    if (container->type == CONTAINER_BITMAP)
+    {
+        uint64_t* word = &container->data.bits[low >> 6];
+        const uint64_t mask = UINT64_C(1) << (low & 63);
+        if ((*word & mask) == 0)
+        {
+            *word |= mask;
+            container->cardinality++;
+        }
+        return ERROR_NONE;
+    }
+
+    bool found;
+    const size_t position = find_in_array(container->data.array, container->cardinality, low, &found);
+    if (found)
+    {
+        return ERROR_NONE;
+    }
+
+    if (container->cardinality == ROARING_ARRAY_MAX)
+    {
+        const ErrorCode error = array_to_bitmap(container);
+        return error != ERROR_NONE ? error : container_add(container, low);
+    }
+
+    if (container->cardinality == container->capacity)
+    {
+        uint32_t capacity = container->capacity == 0 ? 4 : container->capacity * 2;
+        if (capacity > ROARING_ARRAY_MAX)
+        {
+            capacity = ROARING_ARRAY_MAX;
+        }
+        uint16_t* grown = realloc(container->data.array, capacity * sizeof(uint16_t));
+        if (grown == NULL)
+        {
+            return ERROR_MEMORY_ALLOCATION;
+        }
+        container->data.array = grown;
+        container->capacity = capacity;
+    }
+
+    memmove(&container->data.array[position + 1], &container->data.array[position],
+            (container->cardinality - position) * sizeof(uint16_t));
+    container->data.array[position] = low;
+    container->cardinality++;
+    return ERROR_NONE;
+}
+
+static bool container_remove(Container* container, uint16_t low)
+{
+    if (container->type == CONTAINER_BITMAP)
+    {
+        uint64_t* word = &container->data.bits[low >> 6];
+        const uint64_t mask = UINT64_C(1) << (low & 63);
+        if ((*word & mask) == 0)
+        {
+            return false;
+        }
+
+        *word &= ~mask;
+        container->cardinality--;
+        if (container->cardinality <= ROARING_ARRAY_MAX / 2)
+        {
+            bitmap_to_array(container);
+        }
+        return true;
+    }
+
+    bool found;
+    const size_t position = find_in_array(container->data.array, container->cardinality, low, &found);
+    if (!found)
+    {
+        return false;
+    }
+
+    memmove(&container->data.array[position], &container->data.array[position + 1],
+            (container->cardinality - position - 1) * sizeof(uint16_t));
+    container->cardinality--;
+    return true;
+}
+
+static bool visit_container(const Container* container, RoaringVisitor visitor, void* context)
+{
+    const uint32_t high = (uint32_t)container->key << 16;
+    if (container->type == CONTAINER_ARRAY)
+    {
+        for (uint32_t i = 0; i < container->cardinality; i++)
+        {
+            if (!visitor(high | container->data.array[i], context))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    for (uint32_t w = 0; w < BITMAP_WORDS; w++)
+    {
+        for (uint64_t word = container->data.bits[w]; word != 0; word &= word - 1)
+        {
+            if (!visitor(high | (w * 64 + count_trailing_zeros(word)), context))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Visits the common values of two containers with the same key. Returns
+ * false once the visitor asks to stop.
+ */
+static bool intersect_containers(const Container* a, const Container* b, RoaringVisitor visitor, void* context,
+                                 size_t* visited)
+{
+    const uint32_t high = (uint32_t)a->key << 16;
+
+    if (a->type == CONTAINER_BITMAP && b->type == CONTAINER_BITMAP)
+    {
+        for (uint32_t w = 0; w < BITMAP_WORDS; w++)
+        {
+            for (uint64_t word = a->data.bits[w] & b->data.bits[w]; word != 0; word &= word - 1)
+            {
+                (*visited)++;
+                if (!visitor(high | (w * 64 + count_trailing_zeros(word)), context))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    if (a->type == CONTAINER_ARRAY && b->type == CONTAINER_ARRAY)
+    {
+        uint32_t i = 0;
+        uint32_t j = 0;
+        while (i < a->cardinality && j < b->cardinality)
+        {
+            const uint16_t left = a->data.array[i];
+            const uint16_t right = b->data.array[j];
+            if (left < right)
+            {
+                i++;
+            }
+            else if (right < left)
+            {
+                j++;
+            }
+            else
+            {
+                (*visited)++;
+                if (!visitor(high | left, context))
+                {
+                    return false;
+                }
+                i++;
+                j++;
+            }
+        }
+        return true;
+    }
+
+    // Mixed: probe the bitmap with every value of the array.
+    const Container* array = a->type == CONTAINER_ARRAY ? a : b;
+    const Container* bitmap = a->type == CONTAINER_ARRAY ? b : a;
+    for (uint32_t i = 0; i < array->cardinality; i++)
+    {
+        const uint16_t value = array->data.array[i];
+        if (container_contains(bitmap, value))
+        {
+            (*visited)++;
+            if (!visitor(high | value, context))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void put_u16(uint8_t* cursor, uint16_t value)
+{
+    cursor[0] = (uint8_t)value;
+    cursor[1] = (uint8_t)(value >> 8);
+}
+
+static void put_u32(uint8_t* cursor, uint32_t value)
+{
+    put_u16(cursor, (uint16_t)value);
+    put_u16(cursor + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t get_u16(const uint8_t* cursor)
+{
+    return (uint16_t)(cursor[0] | (cursor[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t* cursor)
+{
+    return (uint32_t)get_u16(cursor) | ((uint32_t)get_u16(cursor + 2) << 16);
+}
+
+static size_t container_payload_size(const Container* container)
+{
+    return container->type == CONTAINER_BITMAP
+        ? BITMAP_WORDS * sizeof(uint64_t)
+        : container->cardinality * sizeof(uint16_t);
+}
+
+Roaring* roaring_create()
+{
+    return calloc(1, sizeof(Roaring));
+}
+
+void roaring_destroy(Roaring* set)
+{
+    if (set == NULL)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < set->count; i++)
+    {
+        free_container(&set->containers[i]);
+    }
+    free(set->containers);
+    free(set);
+}
+
+Roaring* roaring_clone(const Roaring* set)
+{
+    if (set == NULL)
+    {
+        return NULL;
+    }
+
+    Roaring* copy = roaring_create();
+    if (copy == NULL)
+    {
+        return NULL;
+    }
+
+    if (set->count > 0)
+    {
+        copy->containers = malloc(set->count * sizeof(Container));
+        if (copy->containers == NULL)
+        {
+            free(copy);
+            return NULL;
+        }
+        copy->capacity = set->count;
+    }
+
+    for (size_t i = 0; i < set->count; i++)
+    {
+        Container container = set->containers[i];
+        const size_t size = container_payload_size(&container);
+        void* data = malloc(size == 0 ? 1 : size);
+        if (data == NULL)
+        {
+            roaring_destroy(copy);
+            return NULL;
+        }
+
+        memcpy(data, set->containers[i].data.array, size);
+        if (container.type == CONTAINER_ARRAY)
+        {
+            container.data.array = data;
+            container.capacity = container.cardinality;
+        }
+        else
+        {
+            container.data.bits = data;
+        }
+        copy->containers[copy->count++] = container;
+    }
+
+    return copy;
+}
+
+ErrorCode roaring_add(Roaring* set, uint32_t value)
+{
+    if (set == NULL)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    const uint16_t key = (uint16_t)(value >> 16);
+    bool found;
+    const size_t position = find_container(set, key, &found);
+    if (!found)
+    {
+        if (set->count == set->capacity)
+        {
+            const size_t capacity = set->capacity == 0 ? 4 : set->capacity * 2;
+            Container* grown = realloc(set->containers, capacity * sizeof(Container));
+            if (grown == NULL)
+            {
+                return ERROR_MEMORY_ALLOCATION;
+            }
+            set->containers = grown;
+            set->capacity = capacity;
+        }
+
+        memmove(&set->containers[position + 1], &set->containers[position],
+                (set->count - position) * sizeof(Container));
+        memset(&set->containers[position], 0, sizeof(Container));
+        set->containers[position].key = key;
+        set->containers[position].type = CONTAINER_ARRAY;
+        set->count++;
+    }
+
+    const ErrorCode error = container_add(&set->containers[position], (uint16_t)value);
+    if (error != ERROR_NONE && set->containers[position].cardinality == 0)
+    {
+        free_container(&set->containers[position]);
+        memmove(&set->containers[position], &set->containers[position + 1],
+                (set->count - position - 1) * sizeof(Container));
+        set->count--;
+    }
+    return error;
+}
+
+bool roaring_remove(Roaring* set, uint32_t value)
+{
+    if (set == NULL)
+    {
+        return false;
+    }
+
+    bool found;
+    const size_t position = find_container(set, (uint16_t)(value >> 16), &found);
+    if (!found || !container_remove(&set->containers[position], (uint16_t)value))
+    {
+        return false;
+    }
+
+    if (set->containers[position].cardinality == 0)
+    {
+        free_container(&set->containers[position]);
+        memmove(&set->containers[position], &set->containers[position + 1],
+                (set->count - position - 1) * sizeof(Container));
+        set->count--;
+    }
+    return true;
+}
+
+bool roaring_contains(const Roaring* set, uint32_t value)
+{
+    if (set == NULL)
+    {
+        return false;
+    }
+
+    bool found;
+    const size_t position = find_container(set, (uint16_t)(value >> 16), &found);
+    return found && container_contains(&set->containers[position], (uint16_t)value);
+}
+
+size_t roaring_cardinality(const Roaring* set)
+{
+    size_t total = 0;
+    for (size_t i = 0; set != NULL && i < set->count; i++)
+    {
+        total += set->containers[i].cardinality;
+    }
+    return total;
+}
+
+void roaring_for_each(const Roaring* set, RoaringVisitor visitor, void* context)
+{
+    if (set == NULL || visitor == NULL)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < set->count; i++)
+    {
+        if (!visit_container(&set->containers[i], visitor, context))
+        {
+            return;
+        }
+    }
+}
+
+size_t roaring_for_each_intersection(const Roaring* a, const Roaring* b, RoaringVisitor visitor, void* context)
+{
+    if (a == NULL || b == NULL || visitor == NULL)
+    {
+        return 0;
+    }
+
+    size_t visited = 0;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a->count && j < b->count)
+    {
+        if (a->containers[i].key < b->containers[j].key)
+        {
+            i++;
+        }
+        else if (b->containers[j].key < a->containers[i].key)
+        {
+            j++;
+        }
+        else
+        {
+            if (!intersect_containers(&a->containers[i], &b->containers[j], visitor, context, &visited))
+            {
+                break;
+            }
+            i++;
+            j++;
+        }
+    }
+
+    return visited;
+}
+
+// Serialized form: u32 container count, then per container u16 key, u16 type,
+// u32 cardinality and the payload, array values as u16 or bitmap words as u64.
+size_t roaring_serialized_size(const Roaring* set)
+{
+    size_t size = 4;
+    for (size_t i = 0; set != NULL && i < set->count; i++)
+    {
+        size += 8 + container_payload_size(&set->containers[i]);
+    }
+    return size;
+}
+
+size_t roaring_serialize(const Roaring* set, uint8_t* buffer)
+{
+    const size_t count = set == NULL ? 0 : set->count;
+    uint8_t* cursor = buffer;
+    put_u32(cursor, (uint32_t)count);
+    cursor += 4;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const Container* container = &set->containers[i];
+        put_u16(cursor, container->key);
+        put_u16(cursor + 2, container->type);
+        put_u32(cursor + 4, container->cardinality);
+        cursor += 8;
+
+        if (container->type == CONTAINER_ARRAY)
+        {
+            for (uint32_t v = 0; v < container->cardinality; v++, cursor += 2)
+            {
+                put_u16(cursor, container->data.array[v]);
+            }
+        }
+        else
+        {
+            for (uint32_t w = 0; w < BITMAP_WORDS; w++, cursor += 8)
+            {
+                put_u32(cursor, (uint32_t)container->data.bits[w]);
+                put_u32(cursor + 4, (uint32_t)(container->data.bits[w] >> 32));
+            }
+        }
+    }
+
+    return (size_t)(cursor - buffer);
+}
+
+Roaring* roaring_deserialize(const uint8_t* buffer, size_t size)
+{
+    if (buffer == NULL || size < 4)
+    {
+        return NULL;
+    }
+
+    const uint32_t count = get_u32(buffer);
+    if (count > 65536 || (size - 4) / 8 < count)
+    {
+        return NULL;
+    }
+
+    Roaring* set = roaring_create();
+    if (set == NULL)
+    {
+        return NULL;
+    }
+
+    if (count > 0)
+    {
+        set->containers = calloc(count, sizeof(Container));
+        if (set->containers == NULL)
+        {
+            free(set);
+            return NULL;
+        }
+        set->capacity = count;
+    }
+
+    const uint8_t* cursor = buffer + 4;
+    const uint8_t* end = buffer + size;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (end - cursor < 8)
+        {
+            roaring_destroy(set);
+            return NULL;
+        }
+
+        Container container = {0};
+        container.key = get_u16(cursor);
+        container.type = get_u16(cursor + 2);
+        container.cardinality = get_u32(cursor + 4);
+        cursor += 8;
+
+        const bool ordered = i == 0 || container.key > set->containers[i - 1].key;
+        const bool valid_array = container.type == CONTAINER_ARRAY
+            && container.cardinality > 0 && container.cardinality <= ROARING_ARRAY_MAX;
+        const bool valid_bitmap = container.type == CONTAINER_BITMAP
+            && container.cardinality > 0 && container.cardinality <= 65536;
+        if (!ordered || !(valid_array || valid_bitmap)
+            || (size_t)(end - cursor) < container_payload_size(&container))
+        {
+            roaring_destroy(set);
+            return NULL;
+        }
+
+        bool valid = true;
+        if (container.type == CONTAINER_ARRAY)
+        {
+            container.data.array = malloc(container.cardinality * sizeof(uint16_t));
+            container.capacity = container.cardinality;
+            for (uint32_t v = 0; container.data.array != NULL && v < container.cardinality; v++, cursor += 2)
+            {
+                container.data.array[v] = get_u16(cursor);
+                valid = valid && (v == 0 || container.data.array[v] > container.data.array[v - 1]);
+            }
+        }
+        else
+        {
+            container.data.bits = malloc(BITMAP_WORDS * sizeof(uint64_t));
+            uint32_t cardinality = 0;
+            for (uint32_t w = 0; container.data.bits != NULL && w < BITMAP_WORDS; w++, cursor += 8)
+            {
+                container.data.bits[w] = get_u32(cursor) | ((uint64_t)get_u32(cursor + 4) << 32);
+                cardinality += count_bits(container.data.bits[w]);
+            }
+            valid = cardinality == container.cardinality;
+        }
+
+        // Counted before the checks so a failed container is released with the set.
+        set->containers[set->count++] = container;
+        if (container.data.array == NULL || !valid)
+        {
+            roaring_destroy(set);
+            return NULL;
+        }
+    }
+
+    if (cursor != end)
+    {
+        roaring_destroy(set);
+        return NULL;
+    }
+
+    return set;
+}
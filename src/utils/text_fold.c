@@ -0,0 +1,253 @@
+#include "text_fold.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Base letters of U+00C0..U+00FF and U+0100..U+017F, '*' marks characters handled separately.
+static const char LATIN_1_BASE[] = "aaaaaa*ceeeeiiiidnooooo*ouuuuy**aaaaaa*ceeeeiiiidnooooo*ouuuuy*y";
+static const char LATIN_EXTENDED_A_BASE[] =
+    "aaaaaaccccccccddddeeeeeeeeeegggggggghhhhiiiiiiiiii**jjkkkllllllllllnnnnnnnnnoooooo**rrrrrrssssssssttttttuuuuuuuuuuuuwwyyyzzzzzzs";
+
+typedef struct {
+    char* output;
+    size_t size;
+    size_t length;
+    bool pending_space;
+    bool truncated;
+} FoldWriter;
+
+static void write_bytes(FoldWriter* writer, const char* bytes, size_t count)
+{
+    const size_t separator = writer->pending_space && writer->length > 0 ? 1 : 0;
+    if (writer->truncated || writer->length + separator + count >= writer->size)
+    {
+        // Never emit a character after one that did not fit.
+        writer->truncated = true;
+        return;
+    }
+
+    if (separator > 0)
+    {
+        writer->output[writer->length++] = ' ';
+    }
+    writer->pending_space = false;
+
+    memcpy(writer->output + writer->length, bytes, count);
+    writer->length += count;
+}
+
+static void write_code_point(FoldWriter* writer, uint32_t code_point)
+{
+    char bytes[4];
+    size_t count;
+
+    if (code_point < 0x80)
+    {
+        bytes[0] = (char)code_point;
+        count = 1;
+    }
+    else if (code_point < 0x800)
+    {
+        bytes[0] = (char)(0xC0 | (code_point >> 6));
+        bytes[1] = (char)(0x80 | (code_point & 0x3F));
+        count = 2;
+    }
+    else if (code_point < 0x10000)
+    {
+        bytes[0] = (char)(0xE0 | (code_point >> 12));
+        bytes[1] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+        bytes[2] = (char)(0x80 | (code_point & 0x3F));
+        count = 3;
+    }
+    else
+    {
+        bytes[0] = (char)(0xF0 | (code_point >> 18));
+        bytes[1] = (char)(0x80 | ((code_point >> 12) & 0x3F));
+        bytes[2] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+        bytes[3] = (char)(0x80 | (code_point & 0x3F));
+        count = 4;
+    }
+
+    write_bytes(writer, bytes, count);
+}
+
+/**
+ * Decodes one UTF-8 sequence. Invalid bytes decode as themselves so that
+ * folding never fails on malformed input.
+ */
+static size_t decode_utf8(const unsigned char* input, uint32_t* code_point)
+{
+    const unsigned char lead = input[0];
+    size_t count = 1;
+    uint32_t value = lead;
+
+    if (lead >= 0xF0 && lead < 0xF8)
+    {
+        count = 4;
+        value = lead & 0x07;
+    }
+    else if (lead >= 0xE0)
+    {
+        count = 3;
+        value = lead & 0x0F;
+    }
+    else if (lead >= 0xC0)
+    {
+        count = 2;
+        value = lead & 0x1F;
+    }
+
+    for (size_t i = 1; i < count; i++)
+    {
+        if ((input[i] & 0xC0) != 0x80)
+        {
+            *code_point = lead;
+            return 1;
+        }
+        value = (value << 6) | (input[i] & 0x3F);
+    }
+
+    *code_point = value;
+    return count;
+}
+
+static uint32_t fold_greek(uint32_t code_point)
+{
+    switch (code_point)
+    {
+        case 0x0386: case 0x03AC: return 0x03B1;
+        case 0x0388: case 0x03AD: return 0x03B5;
+        case 0x0389: case 0x03AE: return 0x03B7;
+        case 0x038A: case 0x03AF: case 0x03AA: case 0x03CA: case 0x0390: return 0x03B9;
+        case 0x038C: case 0x03CC: return 0x03BF;
+        case 0x038E: case 0x03CD: case 0x03AB: case 0x03CB: case 0x03B0: return 0x03C5;
+        case 0x038F: case 0x03CE: return 0x03C9;
+        case 0x03C2: return 0x03C3;
+        default: break;
+    }
+
+    if (code_point >= 0x0391 && code_point <= 0x03A9)
+    {
+        return code_point + 0x20;
+    }
+
+    return code_point;
+}
+
+static uint32_t fold_cyrillic(uint32_t code_point)
+{
+    if (code_point == 0x0401 || code_point == 0x0451)
+    {
+        return 0x0435;
+    }
+
+    if (code_point == 0x0419 || code_point == 0x0439)
+    {
+        return 0x0438;
+    }
+
+    if (code_point >= 0x0410 && code_point <= 0x042F)
+    {
+        return code_point + 0x20;
+    }
+
+    if (code_point >= 0x0400 && code_point <= 0x040F)
+    {
+        return code_point + 0x50;
+    }
+
+    return code_point;
+}
+
+static void fold_code_point(FoldWriter* writer, uint32_t code_point)
+{
+    if (code_point < 0x80)
+    {
+        if ((code_point >= 'a' && code_point <= 'z') || (code_point >= '0' && code_point <= '9'))
+        {
+            write_code_point(writer, code_point);
+        }
+        else if (code_point >= 'A' && code_point <= 'Z')
+        {
+            write_code_point(writer, code_point + ('a' - 'A'));
+        }
+        else
+        {
+            writer->pending_space = true;
+        }
+        return;
+    }
+
+    if (code_point >= 0x0300 && code_point <= 0x036F)
+    {
+        return;
+    }
+
+    const char* expansion = NULL;
+    switch (code_point)
+    {
+        case 0x00C6: case 0x00E6: expansion = "ae"; break;
+        case 0x00DE: case 0x00FE: expansion = "th"; break;
+        case 0x00DF: expansion = "ss"; break;
+        case 0x0132: case 0x0133: expansion = "ij"; break;
+        case 0x0152: case 0x0153: expansion = "oe"; break;
+        default: break;
+    }
+
+    if (expansion != NULL)
+    {
+        write_bytes(writer, expansion, strlen(expansion));
+        return;
+    }
+
+    if (code_point >= 0x00C0 && code_point <= 0x00FF && LATIN_1_BASE[code_point - 0x00C0] != '*')
+    {
+        write_bytes(writer, &LATIN_1_BASE[code_point - 0x00C0], 1);
+        return;
+    }
+
+    if (code_point >= 0x0100 && code_point <= 0x017F && LATIN_EXTENDED_A_BASE[code_point - 0x0100] != '*')
+    {
+        write_bytes(writer, &LATIN_EXTENDED_A_BASE[code_point - 0x0100], 1);
+        return;
+    }
+
+    if (code_point >= 0x0370 && code_point <= 0x03FF)
+    {
+        write_code_point(writer, fold_greek(code_point));
+        return;
+    }
+
+    if (code_point >= 0x0400 && code_point <= 0x04FF)
+    {
+        write_code_point(writer, fold_cyrillic(code_point));
+        return;
+    }
+
+    write_code_point(writer, code_point);
+}
+
+size_t text_fold(const char* input, char* output, size_t output_size)
+{
+    if (output == NULL || output_size == 0)
+    {
+        return 0;
+    }
+
+    FoldWriter writer = {output, output_size, 0, false, false};
+
+    if (input != NULL)
+    {
+        const unsigned char* cursor = (const unsigned char*)input;
+        while (*cursor != '\0')
+        {
+            uint32_t code_point;
+            cursor += decode_utf8(cursor, &code_point);
+            fold_code_point(&writer, code_point);
+        }
+    }
+
+    output[writer.length] = '\0';
+    return writer.length;
+}
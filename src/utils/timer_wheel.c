@@ -0,0 +1,236 @@
+#include "timer_wheel.h"
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+#define LEVEL_SHIFT(level) ((level) * TIMER_WHEEL_SLOT_BITS)
+
+static void list_init(TimerNode* head)
+{
+    head->next = head;
+    head->prev = head;
+}
+
+static void list_append(TimerNode* head, TimerNode* node)
+{
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+static void list_unlink(TimerNode* node)
+{
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->next = NULL;
+    node->prev = NULL;
+}
+
+static void list_take(TimerNode* head, TimerNode* into)
+{
+    if (head->next == head)
+    {
+        list_init(into);
+        return;
+    }
+
+    into->next = head->next;
+    into->prev = head->prev;
+    into->next->prev = into;
+    into->prev->next = into;
+    list_init(head);
+}
+
+static void wheel_place(TimerWheel* wheel, TimerNode* node, int64_t when)
+{
+    const int64_t delta = when - wheel->current;
+
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++)
+    {
+        if (delta < ((int64_t)1 << LEVEL_SHIFT(level + 1)))
+        {
+            const size_t slot = (size_t)((when >> LEVEL_SHIFT(level)) & SLOT_MASK);
+            list_append(&wheel->slots[level][slot], node);
+            return;
+        }
+    }
+
+    list_append(&wheel->overflow, node);
+}
+
+static void cascade(TimerWheel* wheel, TimerNode* head)
+{
+    TimerNode pending;
+    list_take(head, &pending);
+
+    while (pending.next != &pending)
+    {
+        TimerNode* node = pending.next;
+        list_unlink(node);
+        wheel_place(wheel, node, node->expires < wheel->current ? wheel->current : node->expires);
+    }
+}
+
+void timer_wheel_init(TimerWheel* wheel, int64_t now)
+{
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++)
+    {
+        for (int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++)
+        {
+            list_init(&wheel->slots[level][slot]);
+        }
+    }
+
+    list_init(&wheel->overflow);
+    wheel->current = now;
+    wheel->count = 0;
+}
+
+void timer_wheel_schedule(TimerWheel* wheel, TimerNode* node, int64_t expires)
+{
+    node->expires = expires;
+    wheel_place(wheel, node, expires > wheel->current ? expires : wheel->current + 1);
+    wheel->count++;
+}
+
+void timer_wheel_cancel(TimerWheel* wheel, TimerNode* node)
+{
+    if (node->next == NULL)
+    {
+        return;
+    }
+
+    list_unlink(node);
+    wheel->count--;
+}
+
+/*
+ * Finds the next tick at which something happens: a level 0 slot fires or
+ * a non-empty slot of a higher level cascades. Every tick before it would
+ * only visit empty slots. A level's first boundary after the current tick
+ * is at least 64^level ticks apart from the next, so levels whose first
+ * boundary lies beyond the best candidate are skipped.
+ */
+static int64_t next_event_tick(const TimerWheel* wheel)
+{
+    int64_t next = INT64_MAX;
+    for (int64_t tick = wheel->current + 1; tick <= wheel->current + TIMER_WHEEL_SLOTS; tick++)
+    {
+        const TimerNode* head = &wheel->slots[0][tick & SLOT_MASK];
+        if (head->next != head)
+        {
+            next = tick;
+            break;
+        }
+    }
+
+    for (int level = 1; level <= TIMER_WHEEL_LEVELS; level++)
+    {
+        const int64_t span = (int64_t)1 << LEVEL_SHIFT(level);
+        const int64_t boundary = (wheel->current / span + 1) * span;
+        if (boundary >= next)
+        {
+            break;
+        }
+
+        if (level == TIMER_WHEEL_LEVELS)
+        {
+            // Overflow timers come back into range at the boundary before the earliest of them.
+            int64_t earliest = INT64_MAX;
+            for (const TimerNode* node = wheel->overflow.next; node != &wheel->overflow; node = node->next)
+            {
+                earliest = node->expires < earliest ? node->expires : earliest;
+            }
+            if (earliest != INT64_MAX)
+            {
+                const int64_t due = earliest / span * span;
+                next = due > boundary ? (due < next ? due : next) : boundary;
+            }
+            break;
+        }
+
+        for (int64_t tick = boundary; tick < next && tick < boundary + TIMER_WHEEL_SLOTS * span; tick += span)
+        {
+            const TimerNode* head = &wheel->slots[level][(tick >> LEVEL_SHIFT(level)) & SLOT_MASK];
+            if (head->next != head)
+            {
+                next = tick;
+                break;
+            }
+        }
+    }
+    return next;
+}
+
+size_t timer_wheel_advance(TimerWheel* wheel, int64_t now, TimerExpiredCallback callback, void* context)
+{
+    size_t fired = 0;
+
+    while (wheel->current < now)
+    {
+        const int64_t next = wheel->count == 0 ? INT64_MAX : next_event_tick(wheel);
+        if (next > now)
+        {
+            wheel->current = now;
+            break;
+        }
+
+        wheel->current = next;
+        const int64_t tick = next;
+
+        // Cascade higher levels whenever the lower level wraps around.
+        for (int level = 1; level <= TIMER_WHEEL_LEVELS; level++)
+        {
+            if (((tick >> LEVEL_SHIFT(level - 1)) & SLOT_MASK) != 0)
+            {
+                break;
+            }
+
+            if (level == TIMER_WHEEL_LEVELS)
+            {
+                cascade(wheel, &wheel->overflow);
+            }
+            else
+            {
+                cascade(wheel, &wheel->slots[level][(tick >> LEVEL_SHIFT(level)) & SLOT_MASK]);
+            }
+        }
+
+        TimerNode expired;
+        list_take(&wheel->slots[0][tick & SLOT_MASK], &expired);
+
+        while (expired.next != &expired)
+        {
+            TimerNode* node = expired.next;
+            list_unlink(node);
+            wheel->count--;
+            fired++;
+            callback(node, context);
+        }
+    }
+
+    return fired;
+}
+
+static void drain_list(TimerWheel* wheel, TimerNode* head, TimerExpiredCallback callback, void* context)
+{
+    while (head->next != head)
+    {
+        TimerNode* node = head->next;
+        list_unlink(node);
+        wheel->count--;
+        callback(node, context);
+    }
+}
+
+void timer_wheel_drain(TimerWheel* wheel, TimerExpiredCallback callback, void* context)
+{
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++)
+    {
+        for (int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++)
+        {
+            drain_list(wheel, &wheel->slots[level][slot], callback, context);
+        }
+    }
+
+    drain_list(wheel, &wheel->overflow, callback, context);
+}
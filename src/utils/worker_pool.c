@@ -0,0 +1,148 @@
+#include "worker_pool.h"
+
+#include <pthread.h>
+
+typedef struct {
+    WorkerTask task;
+    void* argument;
+} QueuedTask;
+
+// Tasks wait in a ring allocated with the pool, head is the oldest one.
+struct WorkerPool {
+    pthread_mutex_t lock;
+    pthread_cond_t available;
+    QueuedTask* queue;
+    size_t queue_capacity;
+    size_t head;
+    size_t count;
+    bool stopping;
+    pthread_t* threads;
+    size_t thread_count;
+};
+
+static void* worker_main(void* argument)
+{
+    WorkerPool* pool = argument;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (pool->count == 0 && !pool->stopping)
+        {
+            pthread_cond_wait(&pool->available, &pool->lock);
+        }
+
+        if (pool->count == 0)
+        {
+            break;
+        }
+
+        const QueuedTask queued = pool->queue[pool->head];
+        pool->head = (pool->head + 1) % pool->queue_capacity;
+        pool->count--;
+
+        pthread_mutex_unlock(&pool->lock);
+        queued.task(queued.argument);
+        pthread_mutex_lock(&pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+static void stop_threads(WorkerPool* pool, size_t started)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->available);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < started; i++)
+    {
+        pthread_join(pool->threads[i], NULL);
+    }
+}
+
+WorkerPool* worker_pool_create(size_t thread_count, size_t queue_capacity)
+{
+    if (thread_count == 0 || queue_capacity == 0)
+    {
+        return NULL;
+    }
+
+    WorkerPool* pool = calloc(1, sizeof(WorkerPool));
+    if (pool == NULL)
+    {
+        return NULL;
+    }
+
+    pool->threads = calloc(thread_count, sizeof(pthread_t));
+    pool->queue = malloc(queue_capacity * sizeof(QueuedTask));
+    if (pool->threads == NULL || pool->queue == NULL)
+    {
+        free(pool->threads);
+        free(pool->queue);
+        free(pool);
+        return NULL;
+    }
+    pool->queue_capacity = queue_capacity;
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->available, NULL);
+
+    for (size_t i = 0; i < thread_count; i++)
+    {
+        if (pthread_create(&pool->threads[i], NULL, worker_main, pool) != 0)
+        {
+            stop_threads(pool, i);
+            pthread_cond_destroy(&pool->available);
+            pthread_mutex_destroy(&pool->lock);
+            free(pool->threads);
+            free(pool->queue);
+            free(pool);
+            return NULL;
+        }
+    }
+
+    pool->thread_count = thread_count;
+    return pool;
+}
+
+void worker_pool_destroy(WorkerPool* pool)
+{
+    if (pool == NULL)
+    {
+        return;
+    }
+
+    stop_threads(pool, pool->thread_count);
+    pthread_cond_destroy(&pool->available);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool->queue);
+    free(pool);
+}
+
+ErrorCode worker_pool_submit(WorkerPool* pool, WorkerTask task, void* argument)
+{
+    if (pool == NULL || task == NULL)
+    {
+        return ERROR_INVALID_PARAMS;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->count == pool->queue_capacity)
+    {
+        pthread_mutex_unlock(&pool->lock);
+        return ERROR_QUEUE_FULL;
+    }
+
+    QueuedTask* queued = &pool->queue[(pool->head + pool->count) % pool->queue_capacity];
+    queued->task = task;
+    queued->argument = argument;
+    pool->count++;
+    pthread_cond_signal(&pool->available);
+    pthread_mutex_unlock(&pool->lock);
+
+    return ERROR_NONE;
+}
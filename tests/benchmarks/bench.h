@@ -0,0 +1,25 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <time.h>
+
+/**
+ * @brief Returns a monotonic time in seconds for measuring intervals.
+ */
+static inline double bench_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Prints one measurement as "name: value unit".
+ */
+static inline void bench_report(const char* name, double value, const char* unit)
+{
+    printf("%-48s %12.2f %s\n", name, value, unit);
+}
+
+#endif //BENCH_H
@@ -0,0 +1,85 @@
+/*
+ * Audio mixer cost per frame: eight 960-sample streams (20 ms at 48 kHz)
+ * mixed with unit gains, which saturates in 16 bits, and with gains and
+ * soft clipping, which mixes in float. Every kernel available is measured.
+ */
+#include "libmessagekit/audio_mixer.h"
+#include "audio_mixer_kernels.h"
+#include "bench.h"
+
+#define STREAM_COUNT 8
+#define FRAME_SAMPLES 960
+#define ITERATIONS 100000
+
+static const struct {
+    AudioMixerKernel kernel;
+    const char* name;
+} KERNELS[] = {
+    {AUDIO_MIXER_KERNEL_SCALAR, "scalar"},
+    {AUDIO_MIXER_KERNEL_SSE2, "SSE2"},
+    {AUDIO_MIXER_KERNEL_AVX2, "AVX2"},
+    {AUDIO_MIXER_KERNEL_NEON, "NEON"},
+};
+
+static double time_mix(const AudioMixInput inputs[], int16_t* output, bool soft_clip)
+{
+    const double start = bench_now();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        audio_mix(inputs, STREAM_COUNT, output, FRAME_SAMPLES, soft_clip);
+    }
+    return (bench_now() - start) / ITERATIONS * 1e6;
+}
+
+int main(void)
+{
+    int16_t* streams[STREAM_COUNT];
+    AudioMixInput unity[STREAM_COUNT];
+    AudioMixInput scaled[STREAM_COUNT];
+    uint32_t noise = 2463534242u;
+    for (size_t j = 0; j < STREAM_COUNT; j++)
+    {
+        streams[j] = audio_frame_alloc(FRAME_SAMPLES);
+        if (streams[j] == NULL)
+        {
+            return 1;
+        }
+        for (size_t i = 0; i < FRAME_SAMPLES; i++)
+        {
+            noise = noise * 1664525u + 1013904223u;
+            streams[j][i] = (int16_t)(noise >> 16);
+        }
+        unity[j].samples = streams[j];
+        unity[j].gain = 1.0f;
+        scaled[j].samples = streams[j];
+        scaled[j].gain = 0.5f;
+    }
+
+    int16_t* output = audio_frame_alloc(FRAME_SAMPLES);
+    if (output == NULL)
+    {
+        return 1;
+    }
+
+    char name[64];
+    for (size_t k = 0; k < sizeof(KERNELS) / sizeof(KERNELS[0]); k++)
+    {
+        if (!audio_mixer_set_kernel(KERNELS[k].kernel))
+        {
+            continue;
+        }
+
+        snprintf(name, sizeof(name), "%s, 8x960 saturating", KERNELS[k].name);
+        bench_report(name, time_mix(unity, output, false), "us/frame");
+        snprintf(name, sizeof(name), "%s, 8x960 gain and soft clip", KERNELS[k].name);
+        bench_report(name, time_mix(scaled, output, true), "us/frame");
+    }
+    audio_mixer_set_kernel(AUDIO_MIXER_KERNEL_AUTO);
+
+    for (size_t j = 0; j < STREAM_COUNT; j++)
+    {
+        audio_frame_free(streams[j]);
+    }
+    audio_frame_free(output);
+    return 0;
+}
@@ -0,0 +1,86 @@
+#ifndef BENCH_CALL_HISTORY_H
+#define BENCH_CALL_HISTORY_H
+
+#include "libmessagekit/call_history.h"
+#include "database.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+// Call history benchmarks start from an empty database in the working directory.
+#define BENCH_DATABASE_FILE "bench_call_history.db"
+
+// Fills start here, late 2023, and spread over the span given.
+#define BENCH_FIRST_TIMESTAMP 1700000000
+
+static ErrorCode bench_last_error;
+
+static inline void bench_store_error(ErrorCode error)
+{
+    bench_last_error = error;
+}
+
+static inline uint32_t bench_random(void)
+{
+    static uint32_t state = 2463534242u;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+/**
+ * @brief Opens a new database with the library's schema, dropping any left by a previous run.
+ */
+static inline bool bench_open_database(void)
+{
+    remove(BENCH_DATABASE_FILE);
+    remove(BENCH_DATABASE_FILE "-wal");
+    remove(BENCH_DATABASE_FILE "-shm");
+    return db_open(".", BENCH_DATABASE_FILE) == SQLITE_OK && db_init_schema(BENCH_SCHEMA_PATH) == SQLITE_OK;
+}
+
+/**
+ * @brief Adds entries with random contacts "contact<n>", types, durations
+ * and read states, in one transaction.
+ *
+ * Entries are added in the order the calls happened, as a device records
+ * them: call n falls at a random time in the n-th slice of span / count
+ * seconds, so a second fill continues after the first.
+ *
+ * @param first_index Number of the first call, so fills add up.
+ * @param count Number of entries to add.
+ * @param contact_count Number of distinct contacts.
+ * @param span Seconds from BENCH_FIRST_TIMESTAMP the count entries spread over.
+ * @return true if every entry was added.
+ */
+static inline bool bench_fill_call_history(size_t first_index, size_t count, uint32_t contact_count, uint32_t span)
+{
+    if (db_begin_transaction() != SQLITE_OK)
+    {
+        return false;
+    }
+
+    const uint32_t slice = count > 0 && span / count > 0 ? (uint32_t)(span / count) : 1;
+    bench_last_error = ERROR_NONE;
+    for (size_t i = 0; i < count && bench_last_error == ERROR_NONE; i++)
+    {
+        CallHistoryEntry entry = {0};
+        snprintf(entry.call_id, sizeof(entry.call_id), "call%zu", first_index + i);
+        snprintf(entry.contact_id, sizeof(entry.contact_id), "contact%u", bench_random() % contact_count);
+        entry.timestamp = BENCH_FIRST_TIMESTAMP + (int64_t)((first_index + i) * slice + bench_random() % slice);
+        entry.type = (CallType)(bench_random() % CALL_TYPE_COUNT);
+        entry.duration = bench_random() % 600;
+        entry.is_read = bench_random() & 1;
+        add_call_history_entry(&entry, bench_store_error);
+    }
+
+    if (bench_last_error != ERROR_NONE)
+    {
+        db_rollback_transaction();
+        return false;
+    }
+    return db_commit_transaction() == SQLITE_OK;
+}
+
+#endif //BENCH_CALL_HISTORY_H
@@ -0,0 +1,52 @@
+/*
+ * Call history export throughput: 1M entries written in each format, with
+ * a progress callback that never cancels.
+ */
+#include "bench_call_history.h"
+#include "bench.h"
+
+#define ENTRY_COUNT 1000000
+#define CONTACT_COUNT 1000
+#define SPAN_SECONDS 30000000
+
+static const struct {
+    const char* format;
+    const char* file;
+} FORMATS[] = {
+    {"csv", "bench_export.csv"},
+    {"json", "bench_export.json"},
+    {"ndjson", "bench_export.ndjson"},
+};
+
+static uint64_t progress_calls;
+
+static bool count_progress(uint64_t exported_count, uint64_t total_count)
+{
+    (void)exported_count;
+    (void)total_count;
+    progress_calls++;
+    return true;
+}
+
+int main(void)
+{
+    if (!bench_open_database() || !bench_fill_call_history(0, ENTRY_COUNT, CONTACT_COUNT, SPAN_SECONDS))
+    {
+        return 1;
+    }
+
+    char name[64];
+    for (size_t f = 0; f < sizeof(FORMATS) / sizeof(FORMATS[0]) && bench_last_error == ERROR_NONE; f++)
+    {
+        const double start = bench_now();
+        export_call_history_with_progress(FORMATS[f].format, FORMATS[f].file, count_progress, bench_store_error);
+        const double elapsed = bench_now() - start;
+
+        snprintf(name, sizeof(name), "%s, 1M entries", FORMATS[f].format);
+        bench_report(name, elapsed, "s");
+        remove(FORMATS[f].file);
+    }
+
+    db_close();
+    return bench_last_error == ERROR_NONE && progress_calls > 0 ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+/*
+ * Call history paging over 100k entries of 200 contacts: walking every
+ * page of 37 for each filter combination, and the first page of 50 with
+ * no filter, which is what a history screen opens with.
+ */
+#include "bench_call_history.h"
+#include "bench.h"
+
+#define ENTRY_COUNT 100000
+#define CONTACT_COUNT 200
+#define SPAN_SECONDS 10000000
+#define WALK_PAGE_SIZE 37
+#define FIRST_PAGE_SIZE 50
+#define FIRST_PAGE_ITERATIONS 1000
+
+static size_t walked;
+static CallHistoryCursor next_cursor;
+static bool has_more;
+
+static void collect_page(const CallHistoryEntry entries[], size_t count, const CallHistoryCursor* cursor,
+                         ErrorCode error)
+{
+    (void)entries;
+    bench_last_error = error;
+    walked += count;
+    has_more = cursor != NULL;
+    if (has_more)
+    {
+        next_cursor = *cursor;
+    }
+}
+
+int main(void)
+{
+    if (!bench_open_database() || !bench_fill_call_history(0, ENTRY_COUNT, CONTACT_COUNT, SPAN_SECONDS))
+    {
+        return 1;
+    }
+
+    // Bit 0 picks one contact, bit 1 missed calls only, bit 2 unread calls only; all within most of the span.
+    char name[64];
+    for (unsigned combination = 0; combination < 8; combination++)
+    {
+        CallHistoryFilter filter = {0};
+        filter.start_date = BENCH_FIRST_TIMESTAMP + SPAN_SECONDS / 10;
+        filter.end_date = BENCH_FIRST_TIMESTAMP + SPAN_SECONDS * 9 / 10;
+        filter.type = combination & 2 ? CALL_TYPE_MISSED : CALL_TYPE_ANY;
+        filter.include_read = !(combination & 4);
+        filter.include_unread = true;
+        if (combination & 1)
+        {
+            snprintf(filter.contact_id, sizeof(filter.contact_id), "contact7");
+        }
+
+        walked = 0;
+        const double start = bench_now();
+        fetch_call_history_page(&filter, NULL, WALK_PAGE_SIZE, collect_page);
+        while (has_more && bench_last_error == ERROR_NONE)
+        {
+            fetch_call_history_page(&filter, &next_cursor, WALK_PAGE_SIZE, collect_page);
+        }
+        const double elapsed = bench_now() - start;
+
+        snprintf(name, sizeof(name), "filter %u, all pages of 37 (%zu entries)", combination, walked);
+        bench_report(name, elapsed * 1e3, "ms");
+    }
+
+    const double start = bench_now();
+    for (int i = 0; i < FIRST_PAGE_ITERATIONS; i++)
+    {
+        fetch_call_history_page(NULL, NULL, FIRST_PAGE_SIZE, collect_page);
+    }
+    bench_report("no filter, first page of 50", (bench_now() - start) / FIRST_PAGE_ITERATIONS * 1e6, "us");
+
+    db_close();
+    return bench_last_error == ERROR_NONE ? 0 : 1;
+}
@@ -0,0 +1,60 @@
+/*
+ * Bulk call history deletes over 300k entries of 50 contacts spread over a
+ * year: delete_all_call_history, and purge_call_history of the older half.
+ * Both include returning the free pages with incremental vacuum.
+ */
+#include "bench_call_history.h"
+#include "bench.h"
+
+#define ENTRY_COUNT 300000
+#define CONTACT_COUNT 50
+#define SPAN_SECONDS 31536000
+
+static sqlite3_int64 count_entries(void)
+{
+    sqlite3_stmt* stmt;
+    sqlite3_int64 count = -1;
+    if (sqlite3_prepare_v2(db_get_handle(), "SELECT COUNT(*) FROM call_history;", -1, &stmt, NULL) == SQLITE_OK)
+    {
+        if (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            count = sqlite3_column_int64(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    return count;
+}
+
+int main(void)
+{
+    if (!bench_open_database() || !bench_fill_call_history(0, ENTRY_COUNT, CONTACT_COUNT, SPAN_SECONDS))
+    {
+        return 1;
+    }
+
+    double start = bench_now();
+    delete_all_call_history(bench_store_error);
+    bench_report("delete all, 300k entries", (bench_now() - start) * 1e3, "ms");
+    if (bench_last_error != ERROR_NONE || count_entries() != 0)
+    {
+        return 1;
+    }
+
+    if (!bench_fill_call_history(0, ENTRY_COUNT, CONTACT_COUNT, SPAN_SECONDS))
+    {
+        return 1;
+    }
+
+    // The cutoff falls inside a day, the entries of that day before it go one chunk at a time.
+    const sqlite3_int64 before = count_entries();
+    start = bench_now();
+    purge_call_history(BENCH_FIRST_TIMESTAMP + SPAN_SECONDS / 2, bench_store_error);
+    const double elapsed = bench_now() - start;
+
+    char name[64];
+    snprintf(name, sizeof(name), "purge older half, %lld entries", (long long)(before - count_entries()));
+    bench_report(name, elapsed * 1e3, "ms");
+
+    db_close();
+    return bench_last_error == ERROR_NONE ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+/*
+ * Call history search over 100k calls of 1000 contacts: the first page of
+ * 50 for queries matching a tenth of the contacts or more, and for queries
+ * matching a few, against a LIKE join on the contacts.
+ */
+#include "bench_call_history.h"
+#include "bench.h"
+#include "live_query_engine.h"
+#include "search_index.h"
+
+#define ENTRY_COUNT 100000
+#define CONTACT_COUNT 1000
+#define SPAN_SECONDS 3000000
+#define PAGE_SIZE 50
+#define ITERATIONS 1000
+
+static const char* const NAMES[] = {"Alice", "Bob", "Carol", "Dave", "Eve", "Frank", "Grace", "Heidi", "Ivan", "Judy"};
+
+static const char* const BROAD_QUERIES[] = {"a", "alice", "e"};
+static const char* const NARROW_QUERIES[] = {"alice bob", "user77"};
+
+static void check_page(const CallHistoryEntry entries[], size_t count, const CallHistoryCursor* cursor,
+                       ErrorCode error)
+{
+    (void)entries;
+    (void)count;
+    (void)cursor;
+    bench_last_error = error;
+}
+
+// Contact n is named after two of the names and its number, "Alice Bob10" for n = 10.
+static bool add_contacts(void)
+{
+    sqlite3* handle = db_get_handle();
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(handle, "INSERT INTO contacts (contact_id, name, user_id) VALUES (?, ?, ?);", -1, &stmt,
+                           NULL) != SQLITE_OK)
+    {
+        return false;
+    }
+
+    bool done = db_begin_transaction() == SQLITE_OK;
+    for (unsigned i = 0; i < CONTACT_COUNT && done; i++)
+    {
+        char contact_id[32];
+        char name[64];
+        char user_id[32];
+        snprintf(contact_id, sizeof(contact_id), "contact%u", i);
+        snprintf(name, sizeof(name), "%s %s%u", NAMES[i % 10], NAMES[i / 10 % 10], i);
+        snprintf(user_id, sizeof(user_id), "user%u", i);
+        sqlite3_bind_text(stmt, 1, contact_id, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, name, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 3, user_id, -1, SQLITE_STATIC);
+        done = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+
+    return done && db_commit_transaction() == SQLITE_OK;
+}
+
+static void report_first_page(const char* query)
+{
+    const double start = bench_now();
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        search_call_history_page(query, NULL, PAGE_SIZE, check_page);
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "\"%s\", first page of 50", query);
+    bench_report(name, (bench_now() - start) / ITERATIONS * 1e3, "ms");
+}
+
+static void report_like_join(const char* pattern)
+{
+    sqlite3_stmt* stmt;
+    if (sqlite3_prepare_v2(db_get_handle(),
+                           "SELECT call_history.* FROM call_history JOIN contacts USING (contact_id) "
+                           "WHERE contacts.name LIKE ?1 OR contacts.user_id LIKE ?1 "
+                           "ORDER BY timestamp DESC, id DESC LIMIT 50;",
+                           -1, &stmt, NULL) != SQLITE_OK)
+    {
+        bench_last_error = DB_ERROR_QUERY;
+        return;
+    }
+
+    sqlite3_bind_text(stmt, 1, pattern, -1, SQLITE_STATIC);
+    const int iterations = ITERATIONS / 10;
+    const double start = bench_now();
+    for (int i = 0; i < iterations; i++)
+    {
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+        }
+        sqlite3_reset(stmt);
+    }
+    const double elapsed = bench_now() - start;
+    sqlite3_finalize(stmt);
+
+    char name[64];
+    snprintf(name, sizeof(name), "LIKE '%s', first 50", pattern);
+    bench_report(name, elapsed / iterations * 1e3, "ms");
+}
+
+int main(void)
+{
+    if (!bench_open_database() || !add_contacts()
+        || !bench_fill_call_history(0, ENTRY_COUNT, CONTACT_COUNT, SPAN_SECONDS)
+        || live_query_init() != ERROR_NONE || contact_search_init() != ERROR_NONE)
+    {
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(BROAD_QUERIES) / sizeof(BROAD_QUERIES[0]); i++)
+    {
+        report_first_page(BROAD_QUERIES[i]);
+    }
+    for (size_t i = 0; i < sizeof(NARROW_QUERIES) / sizeof(NARROW_QUERIES[0]); i++)
+    {
+        report_first_page(NARROW_QUERIES[i]);
+    }
+    report_like_join("%alice bob%");
+
+    contact_search_shutdown();
+    live_query_shutdown();
+    db_close();
+    return bench_last_error == ERROR_NONE ? 0 : 1;
+}
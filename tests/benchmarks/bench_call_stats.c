@@ -0,0 +1,73 @@
+/*
+ * Call statistics from the rollup tables: what the rollup insert trigger
+ * adds to each add_call_history_entry, and get_call_stats over 100k entries
+ * of 20 contacts spread over about 115 days.
+ */
+#include "bench_call_history.h"
+#include "bench.h"
+
+#define TRIGGER_ENTRY_COUNT 20000
+#define ENTRY_COUNT 100000
+#define CONTACT_COUNT 20
+#define SPAN_SECONDS 10000000
+#define SECONDS_PER_WEEK (7 * 86400)
+
+static double time_fill(void)
+{
+    const double start = bench_now();
+    if (!bench_fill_call_history(0, TRIGGER_ENTRY_COUNT, CONTACT_COUNT, SPAN_SECONDS))
+    {
+        return -1;
+    }
+    return (bench_now() - start) / TRIGGER_ENTRY_COUNT * 1e6;
+}
+
+static double time_stats(const char* contact_id, int64_t start_date, int64_t end_date, int iterations)
+{
+    CallStats stats;
+    const double start = bench_now();
+    for (int i = 0; i < iterations; i++)
+    {
+        if (get_call_stats(contact_id, start_date, end_date, &stats) != ERROR_NONE)
+        {
+            bench_last_error = DB_ERROR_QUERY;
+        }
+    }
+    return (bench_now() - start) / iterations * 1e6;
+}
+
+int main(void)
+{
+    if (!bench_open_database())
+    {
+        return 1;
+    }
+    const double with_trigger = time_fill();
+
+    // The same fill again in a new database, without the trigger keeping the rollups.
+    if (!bench_open_database()
+        || sqlite3_exec(db_get_handle(), "DROP TRIGGER trg_call_rollup_insert;", NULL, NULL, NULL) != SQLITE_OK)
+    {
+        return 1;
+    }
+    const double without_trigger = time_fill();
+    if (with_trigger < 0 || without_trigger < 0)
+    {
+        return 1;
+    }
+    bench_report("add entry, with rollup trigger", with_trigger, "us");
+    bench_report("add entry, without rollup trigger", without_trigger, "us");
+
+    if (!bench_open_database() || !bench_fill_call_history(0, ENTRY_COUNT, CONTACT_COUNT, SPAN_SECONDS))
+    {
+        return 1;
+    }
+
+    const int64_t week_start = BENCH_FIRST_TIMESTAMP + SPAN_SECONDS / 2;
+    bench_report("one contact, lifetime", time_stats("contact3", 0, 0, 10000), "us");
+    bench_report("every contact, one week", time_stats(NULL, week_start, week_start + SECONDS_PER_WEEK, 1000), "us");
+    bench_report("every contact, lifetime", time_stats(NULL, 0, 0, 100), "us");
+
+    db_close();
+    return bench_last_error == ERROR_NONE ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+/*
+ * Call state machine throughput: hold/resume transitions on one connected
+ * call with the callbacks disabled, first from one thread and then from
+ * several threads contending for the same call's event queue.
+ */
+#include "libmessagekit/call.h"
+#include "bench.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define SINGLE_THREAD_TRANSITIONS 5000000
+#define CONTENDED_THREADS 4
+#define CONTENDED_TRANSITIONS 400000
+
+static atomic_long completed;
+
+static void count_result(const CallInfo* call_info, ErrorCode error)
+{
+    (void)call_info;
+    (void)error;
+    atomic_fetch_add_explicit(&completed, 1, memory_order_relaxed);
+}
+
+static void* toggle_hold(void* call_id)
+{
+    for (int i = 0; i < CONTENDED_TRANSITIONS; i++)
+    {
+        if (i & 1)
+        {
+            resume_call(call_id, count_result);
+        }
+        else
+        {
+            hold_call(call_id, count_result);
+        }
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    register_call_state_change_callback(NULL);
+
+    receive_call("bench-single", "peer", CALL_TYPE_AUDIO, NULL);
+    answer_call("bench-single", NULL);
+
+    double start = bench_now();
+    for (int i = 0; i < SINGLE_THREAD_TRANSITIONS; i++)
+    {
+        if (i & 1)
+        {
+            resume_call("bench-single", NULL);
+        }
+        else
+        {
+            hold_call("bench-single", NULL);
+        }
+    }
+    double elapsed = bench_now() - start;
+    bench_report("single thread", SINGLE_THREAD_TRANSITIONS / elapsed / 1e6, "M transitions/s");
+    end_call("bench-single", NULL);
+
+    // Half of the contended operations find the call in the wrong state, they still pass through the queue.
+    receive_call("bench-contended", "peer", CALL_TYPE_AUDIO, NULL);
+    answer_call("bench-contended", NULL);
+
+    pthread_t threads[CONTENDED_THREADS];
+    start = bench_now();
+    for (int i = 0; i < CONTENDED_THREADS; i++)
+    {
+        pthread_create(&threads[i], NULL, toggle_hold, "bench-contended");
+    }
+    for (int i = 0; i < CONTENDED_THREADS; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    elapsed = bench_now() - start;
+    bench_report("4 threads, one call", (double)atomic_load(&completed) / elapsed / 1e6, "M operations/s");
+    end_call("bench-contended", NULL);
+
+    return atomic_load(&completed) == (long)CONTENDED_THREADS * CONTENDED_TRANSITIONS ? 0 : 1;
+}
@@ -0,0 +1,46 @@
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+#include <stdio.h>
+
+/*
+ * Minimal checks for the test programs. A failed check is reported and
+ * counted, the test goes on so one run shows every failure. Unlike assert
+ * the checks stay active in release builds.
+ */
+static int test_failures = 0;
+
+#define CHECK(condition)                                                                      \
+    do                                                                                        \
+    {                                                                                         \
+        if (!(condition))                                                                     \
+        {                                                                                     \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);    \
+            test_failures++;                                                                  \
+        }                                                                                     \
+    } while (0)
+
+#define CHECK_EQUAL(expected, actual)                                                         \
+    do                                                                                        \
+    {                                                                                         \
+        const long long expected_value = (long long)(expected);                               \
+        const long long actual_value = (long long)(actual);                                   \
+        if (expected_value != actual_value)                                                   \
+        {                                                                                     \
+            fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, \
+                    actual_value, expected_value);                                            \
+            test_failures++;                                                                  \
+        }                                                                                     \
+    } while (0)
+
+#define RUN_TEST(test)                                                                        \
+    do                                                                                        \
+    {                                                                                         \
+        const int failures_before = test_failures;                                            \
+        test();                                                                               \
+        printf("%s %s\n", test_failures == failures_before ? "PASS" : "FAIL", #test);         \
+    } while (0)
+
+#define TEST_RESULT() (test_failures == 0 ? 0 : 1)
+
+#endif //TEST_SUPPORT_H
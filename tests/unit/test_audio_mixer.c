@@ -0,0 +1,206 @@
+/*
+ * Every vector kernel of the audio mixer against the scalar one. Kernels
+ * the build or the CPU lacks are reported as skipped; the NEON kernel is
+ * covered by ARM builds.
+ */
+#include "libmessagekit/audio_mixer.h"
+#include "audio_mixer_kernels.h"
+#include "test_support.h"
+
+#define MAX_STREAMS 9
+#define MAX_SAMPLES 1027
+
+static const struct {
+    AudioMixerKernel kernel;
+    const char* name;
+} VECTOR_KERNELS[] = {
+    {AUDIO_MIXER_KERNEL_SSE2, "SSE2"},
+    {AUDIO_MIXER_KERNEL_AVX2, "AVX2"},
+    {AUDIO_MIXER_KERNEL_NEON, "NEON"},
+};
+
+static int16_t* streams[MAX_STREAMS];
+static uint32_t random_state = 2463534242u;
+
+static uint32_t next_random()
+{
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+/**
+ * Fills the streams with noise, a tenth of the samples at full scale so
+ * saturation and soft clipping are exercised.
+ */
+static void fill_streams()
+{
+    for (size_t j = 0; j < MAX_STREAMS; j++)
+    {
+        for (size_t i = 0; i < MAX_SAMPLES; i++)
+        {
+            const uint32_t value = next_random();
+            if (value % 10 == 0)
+            {
+                streams[j][i] = value & 0x100 ? INT16_MAX : INT16_MIN;
+            }
+            else
+            {
+                streams[j][i] = (int16_t)(value >> 16);
+            }
+        }
+    }
+}
+
+static void make_inputs(AudioMixInput inputs[], size_t count, size_t offset, bool unity)
+{
+    for (size_t j = 0; j < count; j++)
+    {
+        inputs[j].samples = streams[j] + offset;
+        inputs[j].gain = unity ? 1.0f : 0.15f + 0.35f * (float)j;
+    }
+}
+
+static int max_difference(const int16_t* expected, const int16_t* actual, size_t count)
+{
+    int difference = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        const int current = abs(expected[i] - actual[i]);
+        difference = current > difference ? current : difference;
+    }
+    return difference;
+}
+
+/**
+ * Mixes with the scalar kernel and with the given one, over stream counts
+ * 1 to 9, unaligned starts and lengths that leave a scalar tail. Saturating
+ * mixes must match exactly; float mixes may differ by the rounding of one
+ * LSB, scalar code rounds halves away from zero and vector code to even.
+ */
+static void check_kernel(AudioMixerKernel kernel)
+{
+    static const size_t LENGTHS[] = {1, 7, 8, 15, 16, 17, 960, 1024};
+    int16_t expected[MAX_SAMPLES];
+    int16_t actual[MAX_SAMPLES];
+
+    for (size_t count = 1; count <= MAX_STREAMS; count++)
+    {
+        for (size_t l = 0; l < sizeof(LENGTHS) / sizeof(LENGTHS[0]); l++)
+        {
+            for (size_t offset = 0; offset < 3; offset++)
+            {
+                const size_t length = LENGTHS[l];
+                AudioMixInput inputs[MAX_STREAMS];
+                for (int mode = 0; mode < 3; mode++)
+                {
+                    const bool unity = mode == 0;
+                    const bool soft_clip = mode == 2;
+                    make_inputs(inputs, count, offset, unity);
+
+                    CHECK(audio_mixer_set_kernel(AUDIO_MIXER_KERNEL_SCALAR));
+                    CHECK_EQUAL(ERROR_NONE, audio_mix(inputs, count, expected, length, soft_clip));
+                    CHECK(audio_mixer_set_kernel(kernel));
+                    CHECK_EQUAL(ERROR_NONE, audio_mix(inputs, count, actual, length, soft_clip));
+
+                    const int difference = max_difference(expected, actual, length);
+                    if (difference > (unity ? 0 : 1))
+                    {
+                        fprintf(stderr, "kernel %d, %zu streams, %zu samples at %zu, mode %d: off by %d\n",
+                                (int)kernel, count, length, offset, mode, difference);
+                        test_failures++;
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void test_vector_kernels_match_scalar()
+{
+    for (size_t k = 0; k < sizeof(VECTOR_KERNELS) / sizeof(VECTOR_KERNELS[0]); k++)
+    {
+        if (!audio_mixer_set_kernel(VECTOR_KERNELS[k].kernel))
+        {
+            printf("SKIP %s kernel, not available\n", VECTOR_KERNELS[k].name);
+            continue;
+        }
+        check_kernel(VECTOR_KERNELS[k].kernel);
+    }
+    CHECK(audio_mixer_set_kernel(AUDIO_MIXER_KERNEL_AUTO));
+}
+
+// The output may be one of the inputs, every kernel reads a position before writing it.
+static void test_in_place_mix()
+{
+    int16_t expected[MAX_SAMPLES];
+    int16_t* in_place = audio_frame_alloc(MAX_SAMPLES);
+    CHECK(in_place != NULL);
+
+    AudioMixInput inputs[3];
+    make_inputs(inputs, 3, 0, false);
+    CHECK_EQUAL(ERROR_NONE, audio_mix(inputs, 3, expected, MAX_SAMPLES, true));
+
+    memcpy(in_place, streams[0], MAX_SAMPLES * sizeof(int16_t));
+    inputs[0].samples = in_place;
+    CHECK_EQUAL(ERROR_NONE, audio_mix(inputs, 3, in_place, MAX_SAMPLES, true));
+    CHECK_EQUAL(0, max_difference(expected, in_place, MAX_SAMPLES));
+    audio_frame_free(in_place);
+}
+
+static void test_detected_kernel()
+{
+    CHECK(audio_mixer_set_kernel(AUDIO_MIXER_KERNEL_AUTO));
+    const AudioMixerKernel detected = audio_mixer_get_kernel();
+    CHECK(detected != AUDIO_MIXER_KERNEL_AUTO);
+
+    // A kernel that is not available leaves the current one in place.
+    for (size_t k = 0; k < sizeof(VECTOR_KERNELS) / sizeof(VECTOR_KERNELS[0]); k++)
+    {
+        if (!audio_mixer_set_kernel(VECTOR_KERNELS[k].kernel))
+        {
+            CHECK_EQUAL(detected, audio_mixer_get_kernel());
+        }
+        CHECK(audio_mixer_set_kernel(AUDIO_MIXER_KERNEL_AUTO));
+    }
+    CHECK_EQUAL(detected, audio_mixer_get_kernel());
+}
+
+static void test_invalid_arguments()
+{
+    int16_t output[8];
+    const AudioMixInput missing = {NULL, 1.0f};
+    const AudioMixInput too_loud = {streams[0], AUDIO_MIX_MAX_GAIN * 2};
+    CHECK_EQUAL(ERROR_INVALID_PARAMS, audio_mix(&missing, 1, output, 8, false));
+    CHECK_EQUAL(ERROR_INVALID_PARAMS, audio_mix(&too_loud, 1, output, 8, false));
+    CHECK_EQUAL(ERROR_INVALID_PARAMS, audio_mix(NULL, 1, output, 8, false));
+
+    output[3] = 1;
+    CHECK_EQUAL(ERROR_NONE, audio_mix(NULL, 0, output, 8, false));
+    CHECK_EQUAL(0, output[3]);
+}
+
+int main()
+{
+    for (size_t j = 0; j < MAX_STREAMS; j++)
+    {
+        streams[j] = audio_frame_alloc(MAX_SAMPLES + 2);
+        if (streams[j] == NULL)
+        {
+            return 1;
+        }
+    }
+    fill_streams();
+
+    RUN_TEST(test_vector_kernels_match_scalar);
+    RUN_TEST(test_in_place_mix);
+    RUN_TEST(test_detected_kernel);
+    RUN_TEST(test_invalid_arguments);
+
+    for (size_t j = 0; j < MAX_STREAMS; j++)
+    {
+        audio_frame_free(streams[j]);
+    }
+    return TEST_RESULT();
+}
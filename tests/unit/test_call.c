@@ -0,0 +1,499 @@
+/*
+ * Call state machine: every operation and signal from every state of
+ * incoming and outgoing calls against the expected outcome, events queued
+ * from callbacks, a full event queue, and events of an ended call that
+ * must never reach the next call using its slot.
+ */
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "libmessagekit/call.h"
+#include "test_support.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+#define X -1 // The operation fails with CALL_ERROR_INVALID_STATE
+#define REUSE_CYCLES 20000
+
+typedef enum {
+    OP_ANSWER,
+    OP_REJECT,
+    OP_END,
+    OP_HOLD,
+    OP_RESUME,
+    OP_SWITCH_TYPE,
+    OP_MUTE,
+    OP_UNMUTE,
+    OP_SIGNAL_RINGING,
+    OP_SIGNAL_ANSWERED,
+    OP_SIGNAL_REJECTED,
+    OP_SIGNAL_ENDED,
+    OP_SIGNAL_TIMEOUT,
+    OP_COUNT
+} Operation;
+
+typedef enum {
+    OUTGOING_INITIATING,
+    OUTGOING_RINGING,
+    OUTGOING_CONNECTED,
+    OUTGOING_HOLDING,
+    INCOMING_RINGING,
+    INCOMING_CONNECTED,
+    INCOMING_HOLDING,
+    START_COUNT
+} StartState;
+
+enum {
+    INIT = CALL_STATE_INITIATING,
+    RING = CALL_STATE_RINGING,
+    CONN = CALL_STATE_CONNECTED,
+    HOLD = CALL_STATE_HOLDING,
+    END = CALL_STATE_ENDED
+};
+
+static const char* const OPERATION_NAMES[OP_COUNT] = {
+    "answer", "reject", "end", "hold", "resume", "switch type", "mute", "unmute",
+    "signal ringing", "signal answered", "signal rejected", "signal ended", "signal timeout",
+};
+
+// The state after each operation, written from the call flows rather than copied from call.c.
+static const int EXPECTED[OP_COUNT][START_COUNT] = {
+    //                      out INIT  out RING  out CONN  out HOLD  in RING  in CONN  in HOLD
+    [OP_ANSWER]          = {X,        X,        X,        X,        CONN,    X,       X},
+    [OP_REJECT]          = {X,        X,        X,        X,        END,     X,       X},
+    [OP_END]             = {END,      END,      END,      END,      END,     END,     END},
+    [OP_HOLD]            = {X,        X,        HOLD,     X,        X,       HOLD,    X},
+    [OP_RESUME]          = {X,        X,        X,        CONN,     X,       X,       CONN},
+    [OP_SWITCH_TYPE]     = {X,        X,        CONN,     HOLD,     X,       CONN,    HOLD},
+    [OP_MUTE]            = {INIT,     RING,     CONN,     HOLD,     RING,    CONN,    HOLD},
+    [OP_UNMUTE]          = {INIT,     RING,     CONN,     HOLD,     RING,    CONN,    HOLD},
+    [OP_SIGNAL_RINGING]  = {RING,     X,        X,        X,        X,       X,       X},
+    [OP_SIGNAL_ANSWERED] = {CONN,     CONN,     X,        X,        X,       X,       X},
+    [OP_SIGNAL_REJECTED] = {END,      END,      X,        X,        X,       X,       X},
+    [OP_SIGNAL_ENDED]    = {END,      END,      END,      END,      END,     END,     END},
+    [OP_SIGNAL_TIMEOUT]  = {END,      END,      X,        X,        END,     X,       X},
+};
+
+static ErrorCode last_error;
+static CallInfo last_info;
+static int state_changes;
+
+static void record_result(const CallInfo* call_info, ErrorCode error)
+{
+    last_error = error;
+    if (call_info != NULL)
+    {
+        last_info = *call_info;
+    }
+}
+
+static void count_state_change(const CallInfo* call_info)
+{
+    (void)call_info;
+    state_changes++;
+}
+
+static void apply(const char* call_id, Operation operation, CallOperationCallback callback)
+{
+    switch (operation)
+    {
+        case OP_ANSWER: answer_call(call_id, callback); break;
+        case OP_REJECT: reject_call(call_id, callback); break;
+        case OP_END: end_call(call_id, callback); break;
+        case OP_HOLD: hold_call(call_id, callback); break;
+        case OP_RESUME: resume_call(call_id, callback); break;
+        case OP_SWITCH_TYPE: switch_call_type(call_id, CALL_TYPE_VIDEO, callback); break;
+        case OP_MUTE: mute_call(call_id, callback); break;
+        case OP_UNMUTE: unmute_call(call_id, callback); break;
+        case OP_SIGNAL_RINGING: signal_call(call_id, CALL_SIGNAL_RINGING, callback); break;
+        case OP_SIGNAL_ANSWERED: signal_call(call_id, CALL_SIGNAL_ANSWERED, callback); break;
+        case OP_SIGNAL_REJECTED: signal_call(call_id, CALL_SIGNAL_REJECTED, callback); break;
+        case OP_SIGNAL_ENDED: signal_call(call_id, CALL_SIGNAL_ENDED, callback); break;
+        case OP_SIGNAL_TIMEOUT: signal_call(call_id, CALL_SIGNAL_TIMEOUT, callback); break;
+        default: break;
+    }
+}
+
+static ErrorCode apply_and_wait(const char* call_id, Operation operation)
+{
+    last_error = ERROR_UNKNOWN;
+    apply(call_id, operation, record_result);
+    return last_error;
+}
+
+// Creates a call in the given state, its ID is copied to call_id.
+static void make_call(StartState start, char call_id[CALL_ID_LENGTH])
+{
+    static int call_number = 0;
+    last_error = ERROR_UNKNOWN;
+    if (start >= INCOMING_RINGING)
+    {
+        snprintf(call_id, CALL_ID_LENGTH, "incoming-%d", call_number++);
+        receive_call(call_id, "peer", CALL_TYPE_AUDIO, record_result);
+    }
+    else
+    {
+        start_call("peer", CALL_TYPE_AUDIO, record_result);
+        memcpy(call_id, last_info.call_id, CALL_ID_LENGTH);
+    }
+    CHECK_EQUAL(ERROR_NONE, last_error);
+
+    switch (start)
+    {
+        case OUTGOING_RINGING:
+            CHECK_EQUAL(ERROR_NONE, apply_and_wait(call_id, OP_SIGNAL_RINGING));
+            break;
+        case OUTGOING_HOLDING:
+        case OUTGOING_CONNECTED:
+            CHECK_EQUAL(ERROR_NONE, apply_and_wait(call_id, OP_SIGNAL_ANSWERED));
+            break;
+        case INCOMING_HOLDING:
+        case INCOMING_CONNECTED:
+            CHECK_EQUAL(ERROR_NONE, apply_and_wait(call_id, OP_ANSWER));
+            break;
+        default:
+            break;
+    }
+    if (start == OUTGOING_HOLDING || start == INCOMING_HOLDING)
+    {
+        CHECK_EQUAL(ERROR_NONE, apply_and_wait(call_id, OP_HOLD));
+    }
+}
+
+static void test_transitions()
+{
+    register_call_state_change_callback(count_state_change);
+    static const int START_STATES[START_COUNT] = {INIT, RING, CONN, HOLD, RING, CONN, HOLD};
+
+    for (int start = 0; start < START_COUNT; start++)
+    {
+        for (int operation = 0; operation < OP_COUNT; operation++)
+        {
+            char call_id[CALL_ID_LENGTH];
+            make_call((StartState)start, call_id);
+            CHECK_EQUAL(START_STATES[start], last_info.state);
+            CHECK_EQUAL(start < INCOMING_RINGING, last_info.is_outgoing);
+
+            const int expected = EXPECTED[operation][start];
+            state_changes = 0;
+            const ErrorCode error = apply_and_wait(call_id, (Operation)operation);
+            if (expected == X)
+            {
+                if (error != CALL_ERROR_INVALID_STATE || state_changes != 0)
+                {
+                    fprintf(stderr, "%s from start state %d: error %d\n", OPERATION_NAMES[operation], start, error);
+                }
+                CHECK_EQUAL(CALL_ERROR_INVALID_STATE, error);
+                CHECK_EQUAL(0, state_changes);
+
+                // A rejected event leaves the call as it was.
+                CHECK_EQUAL(ERROR_NONE, apply_and_wait(call_id, OP_UNMUTE));
+                CHECK_EQUAL(START_STATES[start], last_info.state);
+                CHECK_EQUAL(CALL_TYPE_AUDIO, last_info.type);
+            }
+            else
+            {
+                if (error != ERROR_NONE || (int)last_info.state != expected)
+                {
+                    fprintf(stderr, "%s from start state %d: error %d, state %d\n", OPERATION_NAMES[operation], start,
+                            error, last_info.state);
+                }
+                CHECK_EQUAL(ERROR_NONE, error);
+                CHECK_EQUAL(expected, last_info.state);
+                CHECK_EQUAL(operation == OP_SWITCH_TYPE ? CALL_TYPE_VIDEO : CALL_TYPE_AUDIO, last_info.type);
+                CHECK_EQUAL(operation == OP_MUTE, last_info.is_muted);
+            }
+
+            // Ended calls are gone, every later event reports CALL_ERROR_NOT_FOUND.
+            if (expected == END)
+            {
+                for (int later = 0; later < OP_COUNT; later++)
+                {
+                    CHECK_EQUAL(CALL_ERROR_NOT_FOUND, apply_and_wait(call_id, (Operation)later));
+                }
+            }
+            else
+            {
+                CHECK_EQUAL(ERROR_NONE, apply_and_wait(call_id, OP_END));
+            }
+        }
+    }
+    register_call_state_change_callback(NULL);
+}
+
+static void test_creation_errors()
+{
+    last_error = ERROR_NONE;
+    receive_call("", "peer", CALL_TYPE_AUDIO, record_result);
+    CHECK_EQUAL(ERROR_INVALID_PARAMS, last_error);
+    receive_call("call", "peer", (CallType)7, record_result);
+    CHECK_EQUAL(ERROR_INVALID_PARAMS, last_error);
+    CHECK_EQUAL(CALL_ERROR_NOT_FOUND, apply_and_wait("unknown", OP_END));
+    signal_call("unknown", (CallSignal)99, record_result);
+    CHECK_EQUAL(ERROR_INVALID_PARAMS, last_error);
+
+    char call_ids[CALL_MAX_ACTIVE][CALL_ID_LENGTH];
+    for (size_t i = 0; i < CALL_MAX_ACTIVE; i++)
+    {
+        make_call(INCOMING_RINGING, call_ids[i]);
+    }
+
+    receive_call(call_ids[0], "peer", CALL_TYPE_AUDIO, record_result);
+    CHECK_EQUAL(CALL_ERROR_INVALID_STATE, last_error);
+    receive_call("one-too-many", "peer", CALL_TYPE_AUDIO, record_result);
+    CHECK_EQUAL(CALL_ERROR_TOO_MANY_CALLS, last_error);
+
+    for (size_t i = 0; i < CALL_MAX_ACTIVE; i++)
+    {
+        CHECK_EQUAL(ERROR_NONE, apply_and_wait(call_ids[i], OP_REJECT));
+    }
+}
+
+// A callback queueing an event for its own call: it runs after the callback returns, not inside it.
+static int callback_depth;
+static int nested_callbacks;
+static char nested_call_id[CALL_ID_LENGTH];
+
+static void after_hold(const CallInfo* call_info, ErrorCode error)
+{
+    CHECK_EQUAL(ERROR_NONE, error);
+    CHECK_EQUAL(0, callback_depth);
+    CHECK(call_info != NULL && call_info->state == CALL_STATE_HOLDING);
+    nested_callbacks++;
+}
+
+static void answer_then_hold(const CallInfo* call_info, ErrorCode error)
+{
+    CHECK_EQUAL(ERROR_NONE, error);
+    CHECK(call_info != NULL && call_info->state == CALL_STATE_CONNECTED);
+    callback_depth++;
+    hold_call(nested_call_id, after_hold);
+    CHECK_EQUAL(0, nested_callbacks);
+    callback_depth--;
+}
+
+static void test_callback_queues_event()
+{
+    make_call(INCOMING_RINGING, nested_call_id);
+    answer_call(nested_call_id, answer_then_hold);
+    CHECK_EQUAL(1, nested_callbacks);
+    CHECK_EQUAL(ERROR_NONE, apply_and_wait(nested_call_id, OP_RESUME));
+    CHECK_EQUAL(ERROR_NONE, apply_and_wait(nested_call_id, OP_END));
+}
+
+// Events queued while the call's events are being applied fill its queue, the overflow fails at once.
+static int queued_count;
+static int full_count;
+static char flooded_call_id[CALL_ID_LENGTH];
+
+static void count_flood(const CallInfo* call_info, ErrorCode error)
+{
+    (void)call_info;
+    if (error == CALL_ERROR_QUEUE_FULL)
+    {
+        full_count++;
+    }
+    else if (error == ERROR_NONE)
+    {
+        queued_count++;
+    }
+}
+
+static void flood(const CallInfo* call_info, ErrorCode error)
+{
+    (void)call_info;
+    CHECK_EQUAL(ERROR_NONE, error);
+    for (int i = 0; i < CALL_EVENT_QUEUE_SIZE + 3; i++)
+    {
+        unmute_call(flooded_call_id, count_flood);
+    }
+    CHECK_EQUAL(3, full_count);
+    CHECK_EQUAL(0, queued_count);
+}
+
+static void test_queue_full()
+{
+    make_call(INCOMING_RINGING, flooded_call_id);
+    mute_call(flooded_call_id, flood);
+    CHECK_EQUAL(CALL_EVENT_QUEUE_SIZE, queued_count);
+    CHECK_EQUAL(3, full_count);
+    CHECK_EQUAL(ERROR_NONE, apply_and_wait(flooded_call_id, OP_END));
+}
+
+/*
+ * Events queued for a call that ends before they are applied. The first
+ * one starts another call while the ended call's events are still being
+ * applied, so that call may take over the slot.
+ */
+static int leftover_errors[3];
+static int leftover_count;
+static char leftover_call_id[CALL_ID_LENGTH];
+
+static void record_leftover(const CallInfo* call_info, ErrorCode error)
+{
+    (void)call_info;
+    leftover_errors[leftover_count++] = error;
+    if (leftover_count == 1)
+    {
+        receive_call("after-leftovers", "peer", CALL_TYPE_AUDIO, NULL);
+    }
+}
+
+static void end_and_queue(const CallInfo* call_info, ErrorCode error)
+{
+    (void)call_info;
+    CHECK_EQUAL(ERROR_NONE, error);
+    hold_call(leftover_call_id, record_leftover);
+    mute_call(leftover_call_id, record_leftover);
+    end_call(leftover_call_id, record_leftover);
+}
+
+static void test_leftover_events()
+{
+    make_call(INCOMING_CONNECTED, leftover_call_id);
+    end_call(leftover_call_id, end_and_queue);
+
+    CHECK_EQUAL(3, leftover_count);
+    for (int i = 0; i < 3; i++)
+    {
+        CHECK_EQUAL(CALL_ERROR_NOT_FOUND, leftover_errors[i]);
+    }
+
+    CHECK_EQUAL(ERROR_NONE, apply_and_wait("after-leftovers", OP_UNMUTE));
+    CHECK_EQUAL(CALL_STATE_RINGING, last_info.state);
+    CHECK(!last_info.is_muted);
+    CHECK_EQUAL(ERROR_NONE, apply_and_wait("after-leftovers", OP_END));
+}
+
+/*
+ * One slot reused by call after call while other threads mute whichever
+ * call is current. Only even-numbered calls are ever muted, a mute found
+ * on an odd one was queued for a call that had ended in that slot.
+ */
+static atomic_int current_cycle = -1;
+static atomic_int start_error;
+static atomic_bool cycling_done;
+static atomic_int misapplied;
+static atomic_int stale_mutes;
+static atomic_int failed_cycles;
+
+static void check_not_muted_odd(const CallInfo* call_info)
+{
+    int cycle;
+    if (call_info->is_muted && sscanf(call_info->call_id, "cycle-%d", &cycle) == 1 && cycle % 2 == 1)
+    {
+        atomic_fetch_add(&misapplied, 1);
+    }
+}
+
+static void count_stale(const CallInfo* call_info, ErrorCode error)
+{
+    (void)call_info;
+    if (error == CALL_ERROR_NOT_FOUND)
+    {
+        atomic_fetch_add(&stale_mutes, 1);
+    }
+}
+
+static void count_failure(const CallInfo* call_info, ErrorCode error)
+{
+    (void)call_info;
+    if (error != ERROR_NONE)
+    {
+        atomic_fetch_add(&failed_cycles, 1);
+    }
+}
+
+// Creation failures are reported before receive_call returns, a success may be reported later on another thread.
+static void record_start(const CallInfo* call_info, ErrorCode error)
+{
+    (void)call_info;
+    if (error != ERROR_NONE)
+    {
+        atomic_store(&start_error, error);
+    }
+}
+
+static void* mute_current(void* argument)
+{
+    (void)argument;
+    while (!atomic_load(&cycling_done))
+    {
+        const int cycle = atomic_load(&current_cycle);
+        if (cycle >= 0 && cycle % 2 == 0)
+        {
+            char call_id[CALL_ID_LENGTH];
+            snprintf(call_id, sizeof(call_id), "cycle-%d", cycle);
+            mute_call(call_id, count_stale);
+        }
+        sched_yield();
+    }
+    return NULL;
+}
+
+static void test_slot_reuse_across_threads()
+{
+    char parked[CALL_MAX_ACTIVE - 1][CALL_ID_LENGTH];
+    for (size_t i = 0; i < CALL_MAX_ACTIVE - 1; i++)
+    {
+        make_call(INCOMING_RINGING, parked[i]);
+    }
+    register_call_state_change_callback(check_not_muted_odd);
+
+    pthread_t threads[2];
+    for (size_t i = 0; i < 2; i++)
+    {
+        pthread_create(&threads[i], NULL, mute_current, NULL);
+    }
+
+    for (int cycle = 0; cycle < REUSE_CYCLES; cycle++)
+    {
+        char call_id[CALL_ID_LENGTH];
+        snprintf(call_id, sizeof(call_id), "cycle-%d", cycle);
+
+        // The previous end may still be applied by a muting thread, the slot is free once it has been.
+        for (;;)
+        {
+            atomic_store(&start_error, ERROR_NONE);
+            receive_call(call_id, "peer", CALL_TYPE_AUDIO, record_start);
+            if (atomic_load(&start_error) != CALL_ERROR_TOO_MANY_CALLS)
+            {
+                break;
+            }
+            sched_yield();
+        }
+        count_failure(NULL, atomic_load(&start_error));
+
+        atomic_store(&current_cycle, cycle);
+        end_call(call_id, count_failure);
+    }
+
+    atomic_store(&cycling_done, true);
+    for (size_t i = 0; i < 2; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    register_call_state_change_callback(NULL);
+
+    CHECK_EQUAL(0, atomic_load(&failed_cycles));
+    CHECK_EQUAL(0, atomic_load(&misapplied));
+    printf("  %d mutes arrived after their call ended\n", atomic_load(&stale_mutes));
+    for (size_t i = 0; i < CALL_MAX_ACTIVE - 1; i++)
+    {
+        CHECK_EQUAL(ERROR_NONE, apply_and_wait(parked[i], OP_END));
+    }
+}
+
+int main()
+{
+    RUN_TEST(test_transitions);
+    RUN_TEST(test_creation_errors);
+    RUN_TEST(test_callback_queues_event);
+    RUN_TEST(test_queue_full);
+    RUN_TEST(test_leftover_events);
+    RUN_TEST(test_slot_reuse_across_threads);
+    return TEST_RESULT();
+}
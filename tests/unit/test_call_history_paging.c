@@ -0,0 +1,367 @@
+/*
+ * Call history paging against OFFSET paging: for every filter shape and
+ * several page sizes, walking the cursors must return exactly the entries
+ * fetch_call_history returns, page by page, and the last page, full or
+ * not, must come without a cursor. Search pages are checked the same way
+ * against search_call_history.
+ */
+#include "libmessagekit/call_history.h"
+#include "call_history_store.h"
+#include "database.h"
+#include "live_query_engine.h"
+#include "search_index.h"
+#include "test_support.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define DATABASE_FILE "test_call_history_paging.db"
+#define ENTRY_COUNT 600
+#define CONTACT_COUNT 12
+#define FIRST_TIMESTAMP 1700000000
+
+static const char* const NAMES[] = {"Alice", "Bob", "Carol", "Dave"};
+
+typedef struct {
+    CallHistoryEntry* items;
+    size_t count;
+} EntryList;
+
+static EntryList fetched;
+static size_t page_count;
+static bool has_cursor;
+static CallHistoryCursor cursor;
+static ErrorCode last_error;
+
+static uint32_t random_state = 2463534242u;
+
+static uint32_t next_random()
+{
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+static void store_error(ErrorCode error)
+{
+    last_error = error;
+}
+
+static void copy_entries(const CallHistoryEntry* entries, size_t count, ErrorCode error)
+{
+    last_error = error;
+    free(fetched.items);
+    fetched.items = malloc((count + 1) * sizeof(CallHistoryEntry));
+    fetched.count = count;
+    if (count > 0)
+    {
+        memcpy(fetched.items, entries, count * sizeof(CallHistoryEntry));
+    }
+}
+
+static void copy_page(const CallHistoryEntry entries[], size_t count, const CallHistoryCursor* next_cursor,
+                      ErrorCode error)
+{
+    copy_entries(entries, count, error);
+    has_cursor = next_cursor != NULL;
+    if (has_cursor)
+    {
+        cursor = *next_cursor;
+    }
+}
+
+static bool same_entry(const CallHistoryEntry* a, const CallHistoryEntry* b)
+{
+    return strcmp(a->call_id, b->call_id) == 0 && strcmp(a->contact_id, b->contact_id) == 0
+        && a->timestamp == b->timestamp && a->type == b->type && a->duration == b->duration
+        && a->is_read == b->is_read;
+}
+
+static EntryList take_fetched()
+{
+    EntryList list = fetched;
+    fetched.items = NULL;
+    fetched.count = 0;
+    return list;
+}
+
+/**
+ * Timestamps repeat in runs of up to three, so pages often end inside a
+ * group of entries that only the row ID orders.
+ */
+static bool fill_history()
+{
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(db_get_handle(), "INSERT INTO contacts (contact_id, name, user_id) VALUES (?, ?, ?);", -1,
+                           &stmt, NULL) != SQLITE_OK)
+    {
+        return false;
+    }
+    bool inserted = true;
+    for (unsigned i = 0; i < CONTACT_COUNT && inserted; i++)
+    {
+        char contact_id[32];
+        char name[64];
+        char user_id[32];
+        snprintf(contact_id, sizeof(contact_id), "contact%u", i);
+        snprintf(name, sizeof(name), "%s %u", NAMES[i % 4], i);
+        snprintf(user_id, sizeof(user_id), "user%u", i);
+        sqlite3_bind_text(stmt, 1, contact_id, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, name, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 3, user_id, -1, SQLITE_TRANSIENT);
+        inserted = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    if (!inserted)
+    {
+        return false;
+    }
+
+    int64_t timestamp = FIRST_TIMESTAMP;
+    for (unsigned i = 0; i < ENTRY_COUNT; i++)
+    {
+        timestamp += next_random() % 3 == 0 ? 0 : 1 + next_random() % 5000;
+        CallHistoryEntry entry = {0};
+        snprintf(entry.call_id, sizeof(entry.call_id), "call%u", i);
+        snprintf(entry.contact_id, sizeof(entry.contact_id), "contact%u", next_random() % CONTACT_COUNT);
+        entry.timestamp = timestamp;
+        entry.type = (CallType)(next_random() % CALL_TYPE_COUNT);
+        entry.duration = next_random() % 600;
+        entry.is_read = next_random() & 1;
+        add_call_history_entry(&entry, store_error);
+        if (last_error != ERROR_NONE)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Walks every page of limit entries and compares each one with the
+ * OFFSET page at the same position and the walk with the whole list.
+ */
+static void check_walk(const CallHistoryFilter* filter, size_t limit)
+{
+    fetch_call_history(filter, 0, 0, copy_entries);
+    CHECK_EQUAL(ERROR_NONE, last_error);
+    EntryList all = take_fetched();
+
+    size_t walked = 0;
+    int mismatches = 0;
+    page_count = 0;
+    has_cursor = false;
+    do
+    {
+        const CallHistoryCursor current = cursor;
+        fetch_call_history_page(filter, page_count == 0 ? NULL : &current, limit, copy_page);
+        CHECK_EQUAL(ERROR_NONE, last_error);
+        EntryList page = take_fetched();
+        const bool more = has_cursor;
+
+        fetch_call_history(filter, limit, walked, copy_entries);
+        EntryList by_offset = take_fetched();
+
+        CHECK_EQUAL(by_offset.count, page.count);
+        for (size_t i = 0; i < page.count && i < by_offset.count; i++)
+        {
+            mismatches += !same_entry(&page.items[i], &by_offset.items[i]);
+            mismatches += walked + i >= all.count || !same_entry(&page.items[i], &all.items[walked + i]);
+        }
+
+        // Only the last page lacks a cursor, and it is never empty unless the whole result is.
+        CHECK_EQUAL(walked + page.count < all.count, more);
+        CHECK(page.count == limit || !more);
+        CHECK(page.count > 0 || all.count == 0);
+
+        walked += page.count;
+        page_count++;
+        free(page.items);
+        free(by_offset.items);
+        has_cursor = more;
+    } while (has_cursor && page_count <= all.count);
+
+    CHECK_EQUAL(0, mismatches);
+    CHECK_EQUAL(all.count, walked);
+    CHECK_EQUAL(all.count == 0 ? 1 : (all.count + limit - 1) / limit, page_count);
+    free(all.items);
+}
+
+static void check_walks(const CallHistoryFilter* filter)
+{
+    fetch_call_history(filter, 0, 0, copy_entries);
+    const size_t total = fetched.count;
+
+    // A page size of one, and of the whole result, end on a full page.
+    const size_t limits[] = {1, 7, 50, total > 0 ? total : 1, total + 1};
+    for (size_t i = 0; i < sizeof(limits) / sizeof(limits[0]); i++)
+    {
+        check_walk(filter, limits[i]);
+    }
+}
+
+// Every combination of the filter fields, each selecting one of the query shapes or matching nothing.
+static void test_every_filter_shape()
+{
+    const int64_t start_dates[] = {0, FIRST_TIMESTAMP + 200000};
+    const int64_t end_dates[] = {0, FIRST_TIMESTAMP + 1200000};
+    const bool read_states[][2] = {{true, true}, {true, false}, {false, true}, {false, false}};
+
+    for (unsigned combination = 0; combination < 64; combination++)
+    {
+        CallHistoryFilter filter = {0};
+        filter.start_date = start_dates[combination & 1];
+        filter.end_date = end_dates[(combination >> 1) & 1];
+        filter.type = (combination & 4) != 0 ? CALL_TYPE_MISSED : CALL_TYPE_ANY;
+        filter.include_read = read_states[(combination >> 3) & 3][0];
+        filter.include_unread = read_states[(combination >> 3) & 3][1];
+        if ((combination & 32) != 0)
+        {
+            snprintf(filter.contact_id, sizeof(filter.contact_id), "contact5");
+        }
+        check_walks(&filter);
+    }
+    check_walks(NULL);
+}
+
+// Entries added while walking never make the walk repeat or skip one that was there when it started.
+static void test_walk_during_inserts()
+{
+    fetch_call_history(NULL, 0, 0, copy_entries);
+    EntryList before = take_fetched();
+
+    fetch_call_history_page(NULL, NULL, 25, copy_page);
+    free(take_fetched().items);
+    size_t walked = 25;
+    unsigned added = 0;
+    while (has_cursor)
+    {
+        CallHistoryEntry entry = {0};
+        snprintf(entry.call_id, sizeof(entry.call_id), "late%u", added++);
+        snprintf(entry.contact_id, sizeof(entry.contact_id), "contact1");
+        entry.timestamp = FIRST_TIMESTAMP + (int64_t)(next_random() % 4000000);
+        add_call_history_entry(&entry, store_error);
+
+        const CallHistoryCursor current = cursor;
+        fetch_call_history_page(NULL, &current, 25, copy_page);
+        EntryList page = take_fetched();
+        for (size_t i = 0; i < page.count; i++)
+        {
+            // A newer entry lands before the cursor, an older one may be read on a later page.
+            if (strncmp(page.items[i].call_id, "late", 4) != 0)
+            {
+                CHECK(walked < before.count && same_entry(&page.items[i], &before.items[walked]));
+                walked++;
+            }
+        }
+        free(page.items);
+    }
+    CHECK_EQUAL(before.count, walked);
+    free(before.items);
+
+    for (unsigned i = 0; i < added; i++)
+    {
+        char call_id[CALL_ID_LENGTH];
+        snprintf(call_id, sizeof(call_id), "late%u", i);
+        delete_call_history_entry(call_id, store_error);
+    }
+}
+
+static void check_search_walk(const char* query, size_t limit)
+{
+    search_call_history(query, copy_entries);
+    CHECK_EQUAL(ERROR_NONE, last_error);
+    EntryList all = take_fetched();
+
+    size_t walked = 0;
+    int mismatches = 0;
+    page_count = 0;
+    has_cursor = false;
+    do
+    {
+        const CallHistoryCursor current = cursor;
+        search_call_history_page(query, page_count == 0 ? NULL : &current, limit, copy_page);
+        CHECK_EQUAL(ERROR_NONE, last_error);
+        EntryList page = take_fetched();
+
+        for (size_t i = 0; i < page.count; i++)
+        {
+            mismatches += walked + i >= all.count || !same_entry(&page.items[i], &all.items[walked + i]);
+        }
+        CHECK_EQUAL(walked + page.count < all.count, has_cursor);
+        CHECK(page.count > 0 || all.count == 0);
+
+        walked += page.count;
+        page_count++;
+        free(page.items);
+    } while (has_cursor && page_count <= all.count);
+
+    CHECK_EQUAL(0, mismatches);
+    CHECK_EQUAL(all.count, walked);
+    free(all.items);
+}
+
+static void test_search_pages()
+{
+    const char* const queries[] = {"alice", "bob 1", "user", "nobody"};
+    for (size_t q = 0; q < sizeof(queries) / sizeof(queries[0]); q++)
+    {
+        search_call_history(queries[q], copy_entries);
+        const size_t total = fetched.count;
+        CHECK(total > 0 || strcmp(queries[q], "nobody") == 0);
+
+        const size_t limits[] = {1, 9, total > 0 ? total : 1, total + 1};
+        for (size_t i = 0; i < sizeof(limits) / sizeof(limits[0]); i++)
+        {
+            check_search_walk(queries[q], limits[i]);
+        }
+    }
+}
+
+static void test_bad_cursors()
+{
+    CallHistoryCursor bad = {"1:abc"};
+    fetch_call_history_page(NULL, &bad, 10, copy_page);
+    CHECK_EQUAL(ERROR_INVALID_PARAMS, last_error);
+    snprintf(bad.token, sizeof(bad.token), "2:1700000000:5");
+    fetch_call_history_page(NULL, &bad, 10, copy_page);
+    CHECK_EQUAL(ERROR_INVALID_PARAMS, last_error);
+    snprintf(bad.token, sizeof(bad.token), "1:1700000000:5x");
+    search_call_history_page("alice", &bad, 10, copy_page);
+    CHECK_EQUAL(ERROR_INVALID_PARAMS, last_error);
+    fetch_call_history_page(NULL, NULL, 0, copy_page);
+    CHECK_EQUAL(ERROR_INVALID_PARAMS, last_error);
+}
+
+static void test_query_plans()
+{
+    CHECK_EQUAL(ERROR_NONE, call_history_check_query_plans());
+}
+
+int main()
+{
+    remove(DATABASE_FILE);
+    remove(DATABASE_FILE "-wal");
+    remove(DATABASE_FILE "-shm");
+    if (db_open(".", DATABASE_FILE) != SQLITE_OK || db_init_schema(TEST_SCHEMA_PATH) != SQLITE_OK
+        || !fill_history() || live_query_init() != ERROR_NONE || contact_search_init() != ERROR_NONE)
+    {
+        fprintf(stderr, "Test database not set up\n");
+        return 1;
+    }
+
+    RUN_TEST(test_query_plans);
+    RUN_TEST(test_every_filter_shape);
+    RUN_TEST(test_walk_during_inserts);
+    RUN_TEST(test_search_pages);
+    RUN_TEST(test_bad_cursors);
+
+    free(fetched.items);
+    contact_search_shutdown();
+    live_query_shutdown();
+    db_close();
+    remove(DATABASE_FILE);
+    return TEST_RESULT();
+}
@@ -0,0 +1,191 @@
+/*
+ * ID interner against the list of IDs it was given: numbers are handed out
+ * densely in first-seen order, and truncating must leave every remaining ID
+ * reachable however the removed ones sat in its probe sequence, including
+ * runs that wrap around the end of the table.
+ */
+#include "id_interner.h"
+#include "test_support.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CLUSTER_SIZE 100
+#define RANDOM_IDS 5000
+
+static char cluster_ids[CLUSTER_SIZE][ID_INTERNER_MAX_ID_LENGTH];
+static char random_ids[RANDOM_IDS][ID_INTERNER_MAX_ID_LENGTH];
+
+static uint32_t random_state = 2463534242u;
+
+static uint32_t next_random()
+{
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+// The interner's hash, only used to pick IDs that collide.
+static uint32_t fnv1a(const char* id)
+{
+    uint32_t hash = 2166136261u;
+    for (const char* cursor = id; *cursor != '\0'; cursor++)
+    {
+        hash ^= (unsigned char)*cursor;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * IDs homed on the last two slots of every table up to 256 slots, so they
+ * form one run wrapping around the end of the table at each size.
+ */
+static void make_cluster_ids()
+{
+    size_t count = 0;
+    for (unsigned i = 0; count < CLUSTER_SIZE; i++)
+    {
+        char id[ID_INTERNER_MAX_ID_LENGTH];
+        snprintf(id, sizeof(id), "peer-%u", i);
+        if ((fnv1a(id) & 0xFE) == 0xFE)
+        {
+            memcpy(cluster_ids[count++], id, strlen(id) + 1);
+        }
+    }
+}
+
+static void intern_all(IdInterner* interner, char ids[][ID_INTERNER_MAX_ID_LENGTH], size_t first, size_t count)
+{
+    for (size_t i = first; i < count; i++)
+    {
+        uint32_t number = UINT32_MAX;
+        CHECK_EQUAL(ERROR_NONE, id_interner_intern(interner, ids[i], &number));
+        CHECK_EQUAL(i, number);
+    }
+    CHECK_EQUAL(count, id_interner_count(interner));
+}
+
+// The first count IDs are found under their numbers, the rest are gone.
+static void check_interned(const IdInterner* interner, char ids[][ID_INTERNER_MAX_ID_LENGTH], size_t count,
+                           size_t total)
+{
+    int wrong = 0;
+    for (size_t i = 0; i < total; i++)
+    {
+        uint32_t number = UINT32_MAX;
+        const bool found = id_interner_find(interner, ids[i], &number);
+        if (i < count)
+        {
+            const char* name = id_interner_name(interner, (uint32_t)i);
+            wrong += !found || number != i || name == NULL || strcmp(name, ids[i]) != 0;
+        }
+        else
+        {
+            wrong += found;
+        }
+    }
+    CHECK_EQUAL(0, wrong);
+    CHECK_EQUAL(count, id_interner_count(interner));
+    CHECK(id_interner_name(interner, (uint32_t)count) == NULL);
+}
+
+static void test_intern_and_lookup()
+{
+    IdInterner* interner = id_interner_create();
+    CHECK(interner != NULL);
+    CHECK(!id_interner_find(interner, "nobody", NULL));
+
+    intern_all(interner, random_ids, 0, RANDOM_IDS);
+    check_interned(interner, random_ids, RANDOM_IDS, RANDOM_IDS);
+
+    uint32_t number = UINT32_MAX;
+    CHECK_EQUAL(ERROR_NONE, id_interner_intern(interner, random_ids[17], &number));
+    CHECK_EQUAL(17, number);
+    CHECK_EQUAL(RANDOM_IDS, id_interner_count(interner));
+
+    char too_long[ID_INTERNER_MAX_ID_LENGTH + 1];
+    memset(too_long, 'x', sizeof(too_long) - 1);
+    too_long[sizeof(too_long) - 1] = '\0';
+    CHECK_EQUAL(ERROR_INVALID_PARAMS, id_interner_intern(interner, too_long, &number));
+    CHECK_EQUAL(ERROR_INVALID_PARAMS, id_interner_intern(interner, "", &number));
+    CHECK_EQUAL(ERROR_INVALID_PARAMS, id_interner_intern(interner, NULL, &number));
+    CHECK(!id_interner_find(interner, too_long, &number));
+    CHECK_EQUAL(RANDOM_IDS, id_interner_count(interner));
+
+    id_interner_destroy(interner);
+}
+
+// Truncating one ID at a time out of a run that wraps around the table end, at every table size.
+static void test_truncate_wrapping_cluster()
+{
+    IdInterner* interner = id_interner_create();
+    intern_all(interner, cluster_ids, 0, CLUSTER_SIZE);
+
+    for (size_t count = CLUSTER_SIZE; count-- > 0;)
+    {
+        id_interner_truncate(interner, count);
+        check_interned(interner, cluster_ids, count, CLUSTER_SIZE);
+    }
+
+    // Interning again hands out the same numbers, and the table never shrank.
+    intern_all(interner, cluster_ids, 0, CLUSTER_SIZE);
+    check_interned(interner, cluster_ids, CLUSTER_SIZE, CLUSTER_SIZE);
+    id_interner_destroy(interner);
+}
+
+// Cluster IDs mixed with others, so removed slots sit between ones that must shift back and ones that must not.
+static void test_truncate_mixed()
+{
+    char ids[CLUSTER_SIZE * 2][ID_INTERNER_MAX_ID_LENGTH];
+    for (size_t i = 0; i < CLUSTER_SIZE; i++)
+    {
+        memcpy(ids[2 * i], cluster_ids[i], sizeof(cluster_ids[i]));
+        memcpy(ids[2 * i + 1], random_ids[i], sizeof(random_ids[i]));
+    }
+
+    IdInterner* interner = id_interner_create();
+    for (int round = 0; round < 200; round++)
+    {
+        const size_t count = next_random() % (CLUSTER_SIZE * 2 + 1);
+        intern_all(interner, ids, id_interner_count(interner), CLUSTER_SIZE * 2);
+        id_interner_truncate(interner, count);
+        check_interned(interner, ids, count, CLUSTER_SIZE * 2);
+    }
+
+    // Truncating past the end forgets nothing.
+    const size_t count = id_interner_count(interner);
+    id_interner_truncate(interner, CLUSTER_SIZE * 4);
+    check_interned(interner, ids, count, CLUSTER_SIZE * 2);
+    id_interner_destroy(interner);
+}
+
+static void test_truncate_random()
+{
+    IdInterner* interner = id_interner_create();
+    size_t count = 0;
+    for (int round = 0; round < 20; round++)
+    {
+        intern_all(interner, random_ids, count, RANDOM_IDS);
+        count = next_random() % RANDOM_IDS;
+        id_interner_truncate(interner, count);
+        check_interned(interner, random_ids, count, RANDOM_IDS);
+    }
+    id_interner_destroy(interner);
+}
+
+int main()
+{
+    make_cluster_ids();
+    for (size_t i = 0; i < RANDOM_IDS; i++)
+    {
+        snprintf(random_ids[i], sizeof(random_ids[i]), "user-%08x-%zu", next_random(), i);
+    }
+
+    RUN_TEST(test_intern_and_lookup);
+    RUN_TEST(test_truncate_wrapping_cluster);
+    RUN_TEST(test_truncate_mixed);
+    RUN_TEST(test_truncate_random);
+    return TEST_RESULT();
+}
@@ -0,0 +1,448 @@
+/*
+ * Trace-driven tests of the jitter buffer. A trace lists packets in arrival
+ * order; the driver plays it against a 20 ms playout clock, putting every
+ * packet that has arrived by a tick before taking that tick's frame.
+ */
+#include "libmessagekit/jitter_buffer.h"
+#include "test_support.h"
+
+#define FRAME_MS 20
+#define SAMPLES_PER_FRAME 960
+#define MAX_TICKS 64
+
+typedef struct {
+    uint16_t sequence;
+    uint32_t timestamp;
+    int64_t arrival_ms;
+} TracePacket;
+
+typedef struct {
+    JitterFrameKind kind;
+    uint16_t sequence;
+} PlayedFrame;
+
+static JitterBuffer* create_buffer()
+{
+    const JitterBufferConfig config = {
+        .sample_rate = 48000,
+        .frame_duration_ms = FRAME_MS,
+        .max_frame_size = 16,
+        .frame_capacity = 32,
+        .min_delay_ms = 40,
+        .max_delay_ms = 200,
+    };
+    return jitter_buffer_create(&config);
+}
+
+// A packet of a stream starting at first_sequence, sent every frame.
+static TracePacket packet(uint16_t first_sequence, uint16_t index, int64_t arrival_ms)
+{
+    const TracePacket result = {(uint16_t)(first_sequence + index), (uint32_t)index * SAMPLES_PER_FRAME, arrival_ms};
+    return result;
+}
+
+/**
+ * Plays a trace for a number of ticks. Every audio frame must carry the
+ * payload written for its sequence number.
+ */
+static void play_trace(JitterBuffer* buffer, const TracePacket packets[], size_t count, size_t ticks,
+                       PlayedFrame played[])
+{
+    size_t next = 0;
+    for (size_t tick = 0; tick < ticks; tick++)
+    {
+        const int64_t now = (int64_t)tick * FRAME_MS;
+        for (; next < count && packets[next].arrival_ms <= now; next++)
+        {
+            const uint8_t payload[2] = {(uint8_t)(packets[next].sequence >> 8), (uint8_t)packets[next].sequence};
+            CHECK_EQUAL(ERROR_NONE, jitter_buffer_put(buffer, packets[next].sequence, packets[next].timestamp,
+                                                      packets[next].arrival_ms, payload, sizeof(payload)));
+        }
+
+        JitterFrame frame;
+        CHECK_EQUAL(ERROR_NONE, jitter_buffer_get(buffer, &frame));
+        played[tick].kind = frame.kind;
+        played[tick].sequence = frame.sequence;
+        if (frame.kind == JITTER_FRAME_AUDIO)
+        {
+            CHECK(frame.size == 2 && frame.data[0] == (uint8_t)(frame.sequence >> 8)
+                  && frame.data[1] == (uint8_t)frame.sequence);
+        }
+    }
+    CHECK_EQUAL(count, next);
+}
+
+// Collects the sequence numbers of the audio frames played.
+static size_t audio_sequences(const PlayedFrame played[], size_t ticks, uint16_t sequences[])
+{
+    size_t count = 0;
+    for (size_t i = 0; i < ticks; i++)
+    {
+        if (played[i].kind == JITTER_FRAME_AUDIO)
+        {
+            sequences[count++] = played[i].sequence;
+        }
+    }
+    return count;
+}
+
+static void check_consecutive(const uint16_t sequences[], size_t count, uint16_t first_sequence)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        CHECK_EQUAL((uint16_t)(first_sequence + i), sequences[i]);
+    }
+}
+
+static void test_in_order_stream()
+{
+    JitterBuffer* buffer = create_buffer();
+    TracePacket packets[10];
+    for (uint16_t i = 0; i < 10; i++)
+    {
+        packets[i] = packet(100, i, i * FRAME_MS);
+    }
+
+    PlayedFrame played[12];
+    play_trace(buffer, packets, 10, 12, played);
+
+    // Playout starts once the 40 ms minimum delay is buffered.
+    CHECK_EQUAL(JITTER_FRAME_EMPTY, played[0].kind);
+    uint16_t sequences[12];
+    CHECK_EQUAL(10, audio_sequences(&played[1], 10, sequences));
+    check_consecutive(sequences, 10, 100);
+    CHECK_EQUAL(JITTER_FRAME_CONCEALED, played[11].kind);
+
+    JitterBufferStats stats;
+    jitter_buffer_get_stats(buffer, &stats);
+    CHECK_EQUAL(10, stats.received_count);
+    CHECK_EQUAL(0, stats.lost_count);
+    CHECK_EQUAL(1, stats.underrun_count);
+    CHECK_EQUAL(40, stats.target_delay_ms);
+    jitter_buffer_destroy(buffer);
+}
+
+static void test_reordered_packets_play_in_order()
+{
+    JitterBuffer* buffer = create_buffer();
+    // Every other pair of packets swaps places and the second one is 10 ms late.
+    TracePacket packets[16];
+    for (uint16_t i = 0; i < 16; i += 2)
+    {
+        const int64_t sent = i * FRAME_MS;
+        if (i % 4 == 0)
+        {
+            packets[i] = packet(500, i + 1, sent + FRAME_MS);
+            packets[i + 1] = packet(500, i, sent + FRAME_MS + 10);
+        }
+        else
+        {
+            packets[i] = packet(500, i, sent);
+            packets[i + 1] = packet(500, i + 1, sent + FRAME_MS);
+        }
+    }
+
+    PlayedFrame played[24];
+    play_trace(buffer, packets, 16, 24, played);
+
+    uint16_t sequences[24];
+    CHECK_EQUAL(16, audio_sequences(played, 24, sequences));
+    check_consecutive(sequences, 16, 500);
+
+    JitterBufferStats stats;
+    jitter_buffer_get_stats(buffer, &stats);
+    CHECK_EQUAL(16, stats.received_count);
+    CHECK_EQUAL(0, stats.lost_count);
+    CHECK_EQUAL(0, stats.late_count);
+    CHECK(stats.jitter_ms > 0.0);
+    jitter_buffer_destroy(buffer);
+}
+
+static void test_duplicates_are_dropped()
+{
+    JitterBuffer* buffer = create_buffer();
+    // Each packet comes twice, and packet 2 a third time long after it played.
+    TracePacket packets[17];
+    for (uint16_t i = 0; i < 8; i++)
+    {
+        packets[2 * i] = packet(7, i, i * FRAME_MS);
+        packets[2 * i + 1] = packet(7, i, i * FRAME_MS + 5);
+    }
+    packets[16] = packet(7, 2, 8 * FRAME_MS);
+
+    PlayedFrame played[12];
+    play_trace(buffer, packets, 17, 12, played);
+
+    uint16_t sequences[12];
+    CHECK_EQUAL(8, audio_sequences(played, 12, sequences));
+    check_consecutive(sequences, 8, 7);
+
+    JitterBufferStats stats;
+    jitter_buffer_get_stats(buffer, &stats);
+    CHECK_EQUAL(8, stats.received_count);
+    CHECK_EQUAL(8, stats.duplicate_count);
+    CHECK_EQUAL(1, stats.late_count);
+    jitter_buffer_destroy(buffer);
+}
+
+static void test_late_frame_is_concealed_then_dropped()
+{
+    JitterBuffer* buffer = create_buffer();
+    // Packet 3 arrives after packets 4 to 7 have played.
+    TracePacket packets[8];
+    size_t count = 0;
+    for (uint16_t i = 0; i < 8; i++)
+    {
+        if (i != 3)
+        {
+            packets[count++] = packet(1000, i, i * FRAME_MS);
+        }
+    }
+    packets[count++] = packet(1000, 3, 240);
+
+    PlayedFrame played[14];
+    play_trace(buffer, packets, count, 14, played);
+
+    size_t concealed_at = 0;
+    for (size_t i = 0; i < 14; i++)
+    {
+        if (played[i].kind == JITTER_FRAME_CONCEALED && concealed_at == 0)
+        {
+            concealed_at = i;
+        }
+    }
+    CHECK_EQUAL(1003, played[concealed_at].sequence);
+    CHECK_EQUAL(JITTER_FRAME_AUDIO, played[concealed_at - 1].kind);
+    CHECK_EQUAL(1002, played[concealed_at - 1].sequence);
+    CHECK_EQUAL(JITTER_FRAME_AUDIO, played[concealed_at + 1].kind);
+    CHECK_EQUAL(1004, played[concealed_at + 1].sequence);
+
+    uint16_t sequences[14];
+    CHECK_EQUAL(7, audio_sequences(played, 14, sequences));
+
+    JitterBufferStats stats;
+    jitter_buffer_get_stats(buffer, &stats);
+    CHECK_EQUAL(1, stats.lost_count);
+    CHECK_EQUAL(1, stats.late_count);
+    CHECK_EQUAL(7, stats.received_count);
+    jitter_buffer_destroy(buffer);
+}
+
+static size_t conceal_with_marker(uint16_t missing_sequence, const uint8_t* previous_frame, size_t previous_size,
+                                  uint8_t* output, size_t output_capacity)
+{
+    (void)missing_sequence;
+    (void)output_capacity;
+    CHECK(previous_frame != NULL && previous_size == 2);
+    output[0] = 0xFF;
+    return 1;
+}
+
+static void test_concealment_hook_replaces_lost_frame()
+{
+    JitterBuffer* buffer = create_buffer();
+    jitter_buffer_set_concealment_hook(buffer, conceal_with_marker);
+
+    // Packet 2 never arrives.
+    TracePacket packets[5];
+    for (uint16_t i = 0, n = 0; i < 6; i++)
+    {
+        if (i != 2)
+        {
+            packets[n++] = packet(40, i, i * FRAME_MS);
+        }
+    }
+
+    size_t next = 0;
+    bool concealed = false;
+    for (int64_t now = 0; now < 8 * FRAME_MS; now += FRAME_MS)
+    {
+        for (; next < 5 && packets[next].arrival_ms <= now; next++)
+        {
+            const uint8_t payload[2] = {0, (uint8_t)packets[next].sequence};
+            jitter_buffer_put(buffer, packets[next].sequence, packets[next].timestamp, now, payload, 2);
+        }
+
+        JitterFrame frame;
+        jitter_buffer_get(buffer, &frame);
+        if (frame.kind == JITTER_FRAME_CONCEALED && frame.sequence == 42)
+        {
+            CHECK(frame.size == 1 && frame.data[0] == 0xFF);
+            concealed = true;
+        }
+    }
+    CHECK(concealed);
+    jitter_buffer_destroy(buffer);
+}
+
+static void test_sequence_wraparound()
+{
+    JitterBuffer* buffer = create_buffer();
+    // The stream crosses 65535, with 0 arriving before 65535.
+    TracePacket packets[10];
+    for (uint16_t i = 0; i < 10; i++)
+    {
+        packets[i] = packet(65532, i, i * FRAME_MS);
+    }
+    const TracePacket swapped = packets[3];
+    packets[3] = packets[4];
+    packets[3].arrival_ms = swapped.arrival_ms;
+    packets[4] = swapped;
+    packets[4].arrival_ms = swapped.arrival_ms + 5;
+
+    PlayedFrame played[14];
+    play_trace(buffer, packets, 10, 14, played);
+
+    uint16_t sequences[14];
+    CHECK_EQUAL(10, audio_sequences(played, 14, sequences));
+    check_consecutive(sequences, 10, 65532);
+    CHECK_EQUAL(65535, sequences[3]);
+    CHECK_EQUAL(0, sequences[4]);
+
+    JitterBufferStats stats;
+    jitter_buffer_get_stats(buffer, &stats);
+    CHECK_EQUAL(0, stats.reset_count);
+    CHECK_EQUAL(0, stats.lost_count);
+    CHECK_EQUAL(0, stats.late_count);
+    jitter_buffer_destroy(buffer);
+}
+
+static void test_stream_jump_starts_over()
+{
+    JitterBuffer* buffer = create_buffer();
+    TracePacket packets[8];
+    for (uint16_t i = 0; i < 4; i++)
+    {
+        packets[i] = packet(10, i, i * FRAME_MS);
+        packets[4 + i] = packet(20000, i, (4 + i) * FRAME_MS);
+    }
+
+    PlayedFrame played[12];
+    play_trace(buffer, packets, 8, 12, played);
+
+    JitterBufferStats stats;
+    jitter_buffer_get_stats(buffer, &stats);
+    CHECK_EQUAL(1, stats.reset_count);
+
+    uint16_t sequences[12];
+    const size_t count = audio_sequences(played, 12, sequences);
+    CHECK(count >= 4);
+    check_consecutive(&sequences[count - 4], 4, 20000);
+    jitter_buffer_destroy(buffer);
+}
+
+static void test_underrun_keeps_position_then_refills()
+{
+    JitterBuffer* buffer = create_buffer();
+    // Packet 4 is 60 ms late, then the sender goes quiet until packet 5 at 600 ms.
+    TracePacket packets[10];
+    for (uint16_t i = 0; i < 4; i++)
+    {
+        packets[i] = packet(300, i, i * FRAME_MS);
+    }
+    packets[4] = packet(300, 4, 4 * FRAME_MS + 60);
+    for (uint16_t i = 5; i < 10; i++)
+    {
+        packets[i] = packet(300, i, 600 + (i - 5) * FRAME_MS);
+    }
+
+    PlayedFrame played[MAX_TICKS];
+    play_trace(buffer, packets, 10, 40, played);
+
+    // The late packet still plays, right after the intervals it missed.
+    size_t late_at = 0;
+    for (size_t i = 0; i < 40; i++)
+    {
+        if (played[i].kind == JITTER_FRAME_AUDIO && played[i].sequence == 304)
+        {
+            late_at = i;
+        }
+    }
+    CHECK(late_at > 0);
+    CHECK_EQUAL(JITTER_FRAME_CONCEALED, played[late_at - 1].kind);
+    CHECK_EQUAL(304, played[late_at - 1].sequence);
+
+    // After max_delay_ms of underruns the buffer stops and fills up again.
+    size_t underruns = 0;
+    size_t i = late_at + 1;
+    for (; i < 40 && played[i].kind == JITTER_FRAME_CONCEALED; i++)
+    {
+        underruns++;
+    }
+    CHECK_EQUAL(200 / FRAME_MS, underruns);
+    CHECK_EQUAL(JITTER_FRAME_EMPTY, played[i].kind);
+
+    uint16_t sequences[MAX_TICKS];
+    CHECK_EQUAL(10, audio_sequences(played, 40, sequences));
+    check_consecutive(sequences, 10, 300);
+
+    JitterBufferStats stats;
+    jitter_buffer_get_stats(buffer, &stats);
+    CHECK_EQUAL(0, stats.lost_count);
+    CHECK(stats.underrun_count >= underruns);
+    CHECK_EQUAL(stats.underrun_count, stats.concealed_count);
+    jitter_buffer_destroy(buffer);
+}
+
+static void test_burst_is_accelerated()
+{
+    JitterBuffer* buffer = create_buffer();
+    // A stall releases 16 packets at once, then the stream continues on time.
+    TracePacket packets[24];
+    for (uint16_t i = 0; i < 24; i++)
+    {
+        packets[i] = packet(900, i, i < 16 ? 15 * FRAME_MS : i * FRAME_MS);
+    }
+
+    PlayedFrame played[MAX_TICKS];
+    play_trace(buffer, packets, 24, 50, played);
+
+    JitterBufferStats stats;
+    jitter_buffer_get_stats(buffer, &stats);
+    CHECK(stats.accelerated_count > 0);
+    CHECK_EQUAL(0, stats.lost_count);
+
+    // Skipped frames are never played, the rest plays in order.
+    uint16_t sequences[MAX_TICKS];
+    const size_t count = audio_sequences(played, 50, sequences);
+    CHECK_EQUAL(24, count + stats.accelerated_count);
+    for (size_t i = 1; i < count; i++)
+    {
+        CHECK(sequences[i] > sequences[i - 1]);
+    }
+    CHECK_EQUAL(923, sequences[count - 1]);
+    jitter_buffer_destroy(buffer);
+}
+
+static void test_invalid_arguments()
+{
+    const JitterBufferConfig inverted = {48000, FRAME_MS, 16, 32, 200, 40};
+    CHECK(jitter_buffer_create(&inverted) == NULL);
+    CHECK(jitter_buffer_create(NULL) == NULL);
+
+    JitterBuffer* buffer = create_buffer();
+    const uint8_t oversized[17] = {0};
+    CHECK_EQUAL(ERROR_INVALID_PARAMS, jitter_buffer_put(buffer, 1, 0, 0, oversized, sizeof(oversized)));
+    CHECK_EQUAL(ERROR_INVALID_PARAMS, jitter_buffer_put(buffer, 1, 0, 0, NULL, 1));
+    CHECK_EQUAL(ERROR_INVALID_PARAMS, jitter_buffer_get(buffer, NULL));
+
+    JitterFrame frame;
+    CHECK_EQUAL(ERROR_NONE, jitter_buffer_get(buffer, &frame));
+    CHECK_EQUAL(JITTER_FRAME_EMPTY, frame.kind);
+    jitter_buffer_destroy(buffer);
+}
+
+int main()
+{
+    RUN_TEST(test_in_order_stream);
+    RUN_TEST(test_reordered_packets_play_in_order);
+    RUN_TEST(test_duplicates_are_dropped);
+    RUN_TEST(test_late_frame_is_concealed_then_dropped);
+    RUN_TEST(test_concealment_hook_replaces_lost_frame);
+    RUN_TEST(test_sequence_wraparound);
+    RUN_TEST(test_stream_jump_starts_over);
+    RUN_TEST(test_underrun_keeps_position_then_refills);
+    RUN_TEST(test_burst_is_accelerated);
+    RUN_TEST(test_invalid_arguments);
+    return TEST_RESULT();
+}
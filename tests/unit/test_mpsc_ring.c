@@ -0,0 +1,162 @@
+/*
+ * Bounded MPSC ring: first-in first-out order, a push into a full ring
+ * failing without touching it, and several producers pushing while one
+ * consumer drains, with every element arriving once and each producer's
+ * elements in the order it pushed them.
+ */
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "mpsc_ring.h"
+#include "test_support.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#define PRODUCER_COUNT 4
+#define ELEMENTS_PER_PRODUCER 200000
+#define STRESS_CAPACITY 64
+
+typedef struct {
+    uint32_t producer;
+    uint32_t sequence;
+    uint64_t payload;
+} Element;
+
+static MpscRing* stress_ring;
+static atomic_bool start_flag;
+
+static void test_create_rejects_bad_sizes()
+{
+    CHECK(mpsc_ring_create(0, sizeof(int)) == NULL);
+    CHECK(mpsc_ring_create(1, sizeof(int)) == NULL);
+    CHECK(mpsc_ring_create(48, sizeof(int)) == NULL);
+    CHECK(mpsc_ring_create(16, 0) == NULL);
+    mpsc_ring_destroy(NULL);
+}
+
+static void test_fifo_and_full()
+{
+    MpscRing* ring = mpsc_ring_create(8, sizeof(Element));
+    CHECK(ring != NULL);
+    CHECK(mpsc_ring_is_empty(ring));
+
+    Element element;
+    CHECK(!mpsc_ring_pop(ring, &element));
+
+    // Many laps around the ring, filling it completely on every lap.
+    uint32_t pushed = 0;
+    uint32_t popped = 0;
+    for (int lap = 0; lap < 100; lap++)
+    {
+        while (true)
+        {
+            const Element next = {0, pushed, (uint64_t)pushed * 3};
+            if (!mpsc_ring_push(ring, &next))
+            {
+                break;
+            }
+            pushed++;
+        }
+        CHECK_EQUAL(8, pushed - popped);
+        CHECK(!mpsc_ring_is_empty(ring));
+
+        const uint32_t keep = (uint32_t)lap % 5;
+        while (pushed - popped > keep)
+        {
+            CHECK(mpsc_ring_pop(ring, &element));
+            CHECK_EQUAL(popped, element.sequence);
+            CHECK_EQUAL((uint64_t)popped * 3, element.payload);
+            popped++;
+        }
+    }
+
+    while (mpsc_ring_pop(ring, &element))
+    {
+        CHECK_EQUAL(popped, element.sequence);
+        popped++;
+    }
+    CHECK_EQUAL(pushed, popped);
+    CHECK(mpsc_ring_is_empty(ring));
+
+    // Destroying a ring with elements left in it releases them.
+    mpsc_ring_push(ring, &element);
+    mpsc_ring_destroy(ring);
+}
+
+static void* produce(void* argument)
+{
+    const uint32_t producer = (uint32_t)(uintptr_t)argument;
+    while (!atomic_load(&start_flag))
+    {
+        sched_yield();
+    }
+
+    for (uint32_t sequence = 0; sequence < ELEMENTS_PER_PRODUCER; sequence++)
+    {
+        const Element element = {producer, sequence, ((uint64_t)producer << 32) | sequence};
+        while (!mpsc_ring_push(stress_ring, &element))
+        {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void test_concurrent_producers()
+{
+    stress_ring = mpsc_ring_create(STRESS_CAPACITY, sizeof(Element));
+    CHECK(stress_ring != NULL);
+
+    pthread_t threads[PRODUCER_COUNT];
+    for (uintptr_t i = 0; i < PRODUCER_COUNT; i++)
+    {
+        pthread_create(&threads[i], NULL, produce, (void*)i);
+    }
+    atomic_store(&start_flag, true);
+
+    uint32_t next_sequence[PRODUCER_COUNT] = {0};
+    size_t received = 0;
+    int out_of_order = 0;
+    int torn = 0;
+    while (received < (size_t)PRODUCER_COUNT * ELEMENTS_PER_PRODUCER)
+    {
+        Element element;
+        if (!mpsc_ring_pop(stress_ring, &element))
+        {
+            sched_yield();
+            continue;
+        }
+
+        received++;
+        if (element.producer >= PRODUCER_COUNT)
+        {
+            torn++;
+            continue;
+        }
+        out_of_order += element.sequence != next_sequence[element.producer];
+        torn += element.payload != (((uint64_t)element.producer << 32) | element.sequence);
+        next_sequence[element.producer] = element.sequence + 1;
+    }
+
+    for (size_t i = 0; i < PRODUCER_COUNT; i++)
+    {
+        pthread_join(threads[i], NULL);
+        CHECK_EQUAL(ELEMENTS_PER_PRODUCER, next_sequence[i]);
+    }
+    CHECK_EQUAL(0, out_of_order);
+    CHECK_EQUAL(0, torn);
+    CHECK(mpsc_ring_is_empty(stress_ring));
+    mpsc_ring_destroy(stress_ring);
+}
+
+int main()
+{
+    RUN_TEST(test_create_rejects_bad_sizes);
+    RUN_TEST(test_fifo_and_full);
+    RUN_TEST(test_concurrent_producers);
+    return TEST_RESULT();
+}
@@ -0,0 +1,333 @@
+/*
+ * Roaring sets against a plain bitmap of the same values: membership,
+ * intersection, and the serialized form group receipts persist, which must
+ * round-trip exactly and turn away corrupt input without reading past it.
+ */
+#include "roaring.h"
+#include "test_support.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Values of the first four containers, enough for several keys of each kind.
+#define DOMAIN (4u * 65536u)
+
+typedef struct {
+    uint32_t* values;
+    size_t count;
+} ValueList;
+
+static uint32_t random_state = 2463534242u;
+
+static uint32_t next_random()
+{
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+static bool collect_value(uint32_t value, void* context)
+{
+    ValueList* list = context;
+    list->values[list->count++] = value;
+    return true;
+}
+
+static bool stop_after_three(uint32_t value, void* context)
+{
+    (void)value;
+    size_t* seen = context;
+    return ++*seen < 3;
+}
+
+/**
+ * Fills a set and its reference: key 0 sparse, key 1 dense enough for a
+ * bitmap container, key 2 at the array limit and key 3 empty.
+ */
+static Roaring* make_set(bool* reference, uint32_t dense_count)
+{
+    Roaring* set = roaring_create();
+    CHECK(set != NULL);
+    memset(reference, 0, DOMAIN);
+
+    for (uint32_t i = 0; i < 300; i++)
+    {
+        const uint32_t value = next_random() % 65536;
+        CHECK_EQUAL(ERROR_NONE, roaring_add(set, value));
+        reference[value] = true;
+    }
+    for (uint32_t i = 0; i < dense_count; i++)
+    {
+        const uint32_t value = 65536 + next_random() % 65536;
+        CHECK_EQUAL(ERROR_NONE, roaring_add(set, value));
+        reference[value] = true;
+    }
+    for (uint32_t i = 0; i < ROARING_ARRAY_MAX; i++)
+    {
+        const uint32_t value = 2 * 65536 + i * 16;
+        CHECK_EQUAL(ERROR_NONE, roaring_add(set, value));
+        reference[value] = true;
+    }
+    return set;
+}
+
+static void check_matches(const Roaring* set, const bool* reference)
+{
+    size_t expected = 0;
+    int mismatches = 0;
+    for (uint32_t value = 0; value < DOMAIN; value++)
+    {
+        expected += reference[value];
+        mismatches += roaring_contains(set, value) != reference[value];
+    }
+    CHECK_EQUAL(0, mismatches);
+    CHECK_EQUAL(expected, roaring_cardinality(set));
+
+    ValueList list = {malloc((expected + 1) * sizeof(uint32_t)), 0};
+    roaring_for_each(set, collect_value, &list);
+    CHECK_EQUAL(expected, list.count);
+    for (size_t i = 1; i < list.count; i++)
+    {
+        CHECK(list.values[i - 1] < list.values[i]);
+    }
+    free(list.values);
+}
+
+static uint8_t* serialize(const Roaring* set, size_t* size)
+{
+    *size = roaring_serialized_size(set);
+    uint8_t* buffer = malloc(*size);
+    CHECK(buffer != NULL);
+    CHECK_EQUAL(*size, roaring_serialize(set, buffer));
+    return buffer;
+}
+
+static void test_add_remove_against_reference()
+{
+    static bool reference[DOMAIN];
+    Roaring* set = make_set(reference, 20000);
+    check_matches(set, reference);
+
+    // Emptying the bitmap container below half the array limit turns it back into an array.
+    for (uint32_t value = 65536; value < 2 * 65536; value++)
+    {
+        if (reference[value] && next_random() % 8 != 0)
+        {
+            CHECK(roaring_remove(set, value));
+            reference[value] = false;
+        }
+    }
+    CHECK(!roaring_remove(set, 3 * 65536 + 5));
+    check_matches(set, reference);
+
+    Roaring* copy = roaring_clone(set);
+    CHECK(copy != NULL);
+    check_matches(copy, reference);
+    roaring_destroy(copy);
+
+    roaring_add(set, UINT32_MAX);
+    CHECK(roaring_contains(set, UINT32_MAX));
+    CHECK(roaring_remove(set, UINT32_MAX));
+    check_matches(set, reference);
+    roaring_destroy(set);
+}
+
+static void test_round_trip()
+{
+    static bool reference[DOMAIN];
+    const uint32_t dense_counts[] = {0, 5000, 65536 * 4};
+    for (size_t d = 0; d < sizeof(dense_counts) / sizeof(dense_counts[0]); d++)
+    {
+        Roaring* set = make_set(reference, dense_counts[d]);
+        size_t size;
+        uint8_t* buffer = serialize(set, &size);
+
+        Roaring* read = roaring_deserialize(buffer, size);
+        CHECK(read != NULL);
+        check_matches(read, reference);
+
+        size_t read_size;
+        uint8_t* again = serialize(read, &read_size);
+        CHECK_EQUAL(size, read_size);
+        CHECK(memcmp(buffer, again, size) == 0);
+
+        free(again);
+        free(buffer);
+        roaring_destroy(read);
+        roaring_destroy(set);
+    }
+
+    Roaring* empty = roaring_create();
+    size_t size;
+    uint8_t* buffer = serialize(empty, &size);
+    CHECK_EQUAL(4, size);
+    Roaring* read = roaring_deserialize(buffer, size);
+    CHECK(read != NULL);
+    CHECK_EQUAL(0, roaring_cardinality(read));
+    free(buffer);
+    roaring_destroy(read);
+    roaring_destroy(empty);
+}
+
+// The stored form of {1, 65537, 65538}, byte for byte: it is persisted, so it must never change.
+static void test_serialized_layout()
+{
+    static const uint8_t expected[] = {
+        2, 0, 0, 0,
+        0, 0, 0, 0, 1, 0, 0, 0, 1, 0,
+        1, 0, 0, 0, 2, 0, 0, 0, 1, 0, 2, 0,
+    };
+
+    Roaring* set = roaring_create();
+    roaring_add(set, 65538);
+    roaring_add(set, 1);
+    roaring_add(set, 65537);
+
+    size_t size;
+    uint8_t* buffer = serialize(set, &size);
+    CHECK_EQUAL(sizeof(expected), size);
+    CHECK(size == sizeof(expected) && memcmp(buffer, expected, size) == 0);
+
+    free(buffer);
+    roaring_destroy(set);
+}
+
+static void check_rejected(const uint8_t* data, size_t size)
+{
+    // A copy of exactly the given size, so reading past it is caught by the sanitizers.
+    uint8_t* copy = malloc(size == 0 ? 1 : size);
+    if (size > 0)
+    {
+        memcpy(copy, data, size);
+    }
+    Roaring* set = roaring_deserialize(copy, size);
+    CHECK(set == NULL);
+    roaring_destroy(set);
+    free(copy);
+}
+
+static void test_corrupt_input()
+{
+    static bool reference[DOMAIN];
+    Roaring* set = make_set(reference, 8000);
+    size_t size;
+    uint8_t* buffer = serialize(set, &size);
+
+    for (size_t length = 0; length < size; length += length < 64 ? 1 : 997)
+    {
+        check_rejected(buffer, length);
+    }
+
+    uint8_t* longer = malloc(size + 1);
+    memcpy(longer, buffer, size);
+    longer[size] = 0;
+    check_rejected(longer, size + 1);
+    free(longer);
+    CHECK(roaring_deserialize(NULL, 0) == NULL);
+
+    static const uint8_t unordered[] = {2, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0};
+    static const uint8_t duplicate_values[] = {1, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 7, 0, 7, 0};
+    static const uint8_t unsorted_values[] = {1, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 9, 0, 7, 0};
+    static const uint8_t empty_container[] = {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    static const uint8_t unknown_type[] = {1, 0, 0, 0, 0, 0, 2, 0, 1, 0, 0, 0, 7, 0};
+    static const uint8_t huge_count[] = {0xFF, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0, 1, 0, 0, 0, 7, 0};
+    check_rejected(unordered, sizeof(unordered));
+    check_rejected(duplicate_values, sizeof(duplicate_values));
+    check_rejected(unsorted_values, sizeof(unsorted_values));
+    check_rejected(empty_container, sizeof(empty_container));
+    check_rejected(unknown_type, sizeof(unknown_type));
+    check_rejected(huge_count, sizeof(huge_count));
+
+    // A bitmap whose stored cardinality disagrees with its bits.
+    size_t sparse_count = 0;
+    for (uint32_t value = 0; value < 65536; value++)
+    {
+        sparse_count += reference[value];
+    }
+    const size_t bitmap_header = 4 + 8 + sparse_count * 2;
+    CHECK_EQUAL(1, buffer[bitmap_header + 2]);
+    buffer[bitmap_header + 4] ^= 1;
+    check_rejected(buffer, size);
+    buffer[bitmap_header + 4] ^= 1;
+
+    // Random damage either reads back as some valid set or is rejected, never more.
+    for (int round = 0; round < 2000; round++)
+    {
+        const size_t position = next_random() % size;
+        const uint8_t saved = buffer[position];
+        buffer[position] ^= (uint8_t)(1 + next_random() % 255);
+
+        uint8_t* copy = malloc(size);
+        memcpy(copy, buffer, size);
+        Roaring* read = roaring_deserialize(copy, size);
+        if (read != NULL)
+        {
+            size_t read_size;
+            uint8_t* again = serialize(read, &read_size);
+            CHECK_EQUAL(size, read_size);
+            free(again);
+        }
+        roaring_destroy(read);
+        free(copy);
+        buffer[position] = saved;
+    }
+
+    free(buffer);
+    roaring_destroy(set);
+}
+
+static void test_intersection()
+{
+    static bool left_reference[DOMAIN];
+    static bool right_reference[DOMAIN];
+    const uint32_t dense_counts[][2] = {{0, 0}, {20000, 0}, {0, 20000}, {20000, 30000}};
+
+    for (size_t d = 0; d < sizeof(dense_counts) / sizeof(dense_counts[0]); d++)
+    {
+        Roaring* left = make_set(left_reference, dense_counts[d][0]);
+        Roaring* right = make_set(right_reference, dense_counts[d][1]);
+        roaring_add(left, 3 * 65536 + 1);
+
+        size_t expected = 0;
+        for (uint32_t value = 0; value < DOMAIN; value++)
+        {
+            expected += left_reference[value] && right_reference[value];
+        }
+
+        ValueList list = {malloc((expected + 1) * sizeof(uint32_t)), 0};
+        CHECK_EQUAL(expected, roaring_for_each_intersection(left, right, collect_value, &list));
+        CHECK_EQUAL(expected, list.count);
+        for (size_t i = 0; i < list.count; i++)
+        {
+            CHECK(left_reference[list.values[i]] && right_reference[list.values[i]]);
+            CHECK(i == 0 || list.values[i - 1] < list.values[i]);
+        }
+        free(list.values);
+
+        size_t seen = 0;
+        CHECK_EQUAL(3, roaring_for_each_intersection(left, right, stop_after_three, &seen));
+
+        roaring_destroy(left);
+        roaring_destroy(right);
+    }
+
+    Roaring* empty = roaring_create();
+    Roaring* one = roaring_create();
+    roaring_add(one, 42);
+    ValueList list = {NULL, 0};
+    CHECK_EQUAL(0, roaring_for_each_intersection(empty, one, collect_value, &list));
+    CHECK_EQUAL(0, roaring_for_each_intersection(one, NULL, collect_value, &list));
+    roaring_destroy(empty);
+    roaring_destroy(one);
+}
+
+int main()
+{
+    RUN_TEST(test_add_remove_against_reference);
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_serialized_layout);
+    RUN_TEST(test_corrupt_input);
+    RUN_TEST(test_intersection);
+    return TEST_RESULT();
+}
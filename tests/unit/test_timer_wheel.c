@@ -0,0 +1,251 @@
+/*
+ * Timer wheel against the ticks its timers are due: every timer must fire
+ * exactly once, at its own tick, whichever level or the overflow list it
+ * was placed on and however far a single advance jumps.
+ */
+#include "timer_wheel.h"
+#include "test_support.h"
+
+#include <stdlib.h>
+
+#define LEVEL_SPAN(level) ((int64_t)1 << ((level) * TIMER_WHEEL_SLOT_BITS))
+#define WHEEL_RANGE LEVEL_SPAN(TIMER_WHEEL_LEVELS)
+#define RANDOM_TIMERS 20000
+
+typedef struct {
+    TimerNode node;
+    int64_t due;
+    int64_t fired_at;
+    int fire_count;
+} TestTimer;
+
+typedef struct {
+    TimerWheel* wheel;
+    size_t fired;
+} FireLog;
+
+static uint64_t random_state = 88172645463325252ull;
+
+static uint64_t next_random()
+{
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return random_state;
+}
+
+static void record_fire(TimerNode* node, void* context)
+{
+    FireLog* log = context;
+    TestTimer* timer = (TestTimer*)node;
+    timer->fired_at = log->wheel->current;
+    timer->fire_count++;
+    log->fired++;
+}
+
+static void schedule(TimerWheel* wheel, TestTimer* timer, int64_t expires)
+{
+    timer->due = expires > wheel->current ? expires : wheel->current + 1;
+    timer->fired_at = -1;
+    timer->fire_count = 0;
+    timer_wheel_schedule(wheel, &timer->node, expires);
+}
+
+static void check_fired_on_time(const TestTimer* timer)
+{
+    CHECK_EQUAL(1, timer->fire_count);
+    CHECK_EQUAL(timer->due, timer->fired_at);
+}
+
+// Timers placed right before and on the boundary of every level, and a little past it.
+static void test_cascades_between_levels()
+{
+    TimerWheel wheel;
+    const int64_t start = 1000003;
+    timer_wheel_init(&wheel, start);
+
+    TestTimer timers[TIMER_WHEEL_LEVELS * 3];
+    size_t count = 0;
+    for (int level = 1; level <= TIMER_WHEEL_LEVELS; level++)
+    {
+        const int64_t offsets[] = {LEVEL_SPAN(level) - 1, LEVEL_SPAN(level), LEVEL_SPAN(level) + 7};
+        for (size_t i = 0; i < 3; i++)
+        {
+            schedule(&wheel, &timers[count++], start + offsets[i]);
+        }
+    }
+
+    FireLog log = {&wheel, 0};
+    for (int64_t now = start; now < start + 2 * WHEEL_RANGE; now += LEVEL_SPAN(2) + 13)
+    {
+        timer_wheel_advance(&wheel, now, record_fire, &log);
+    }
+    timer_wheel_advance(&wheel, start + 2 * WHEEL_RANGE, record_fire, &log);
+
+    CHECK_EQUAL(count, log.fired);
+    CHECK_EQUAL(0, wheel.count);
+    for (size_t i = 0; i < count; i++)
+    {
+        check_fired_on_time(&timers[i]);
+    }
+}
+
+// Timers beyond the top level wait in the overflow list until the top level wraps close to them.
+static void test_overflow_list()
+{
+    TimerWheel wheel;
+    const int64_t start = 5;
+    timer_wheel_init(&wheel, start);
+
+    TestTimer far;
+    TestTimer farther;
+    TestTimer near;
+    schedule(&wheel, &far, start + WHEEL_RANGE + 17);
+    schedule(&wheel, &farther, start + 3 * WHEEL_RANGE + LEVEL_SPAN(3) + 1);
+    schedule(&wheel, &near, start + 1);
+    CHECK(wheel.overflow.next == &far.node);
+    CHECK(wheel.overflow.prev == &farther.node);
+
+    FireLog log = {&wheel, 0};
+    CHECK_EQUAL(1, timer_wheel_advance(&wheel, start + WHEEL_RANGE, record_fire, &log));
+    check_fired_on_time(&near);
+    CHECK_EQUAL(0, far.fire_count);
+
+    CHECK_EQUAL(1, timer_wheel_advance(&wheel, start + 2 * WHEEL_RANGE, record_fire, &log));
+    check_fired_on_time(&far);
+    CHECK_EQUAL(0, farther.fire_count);
+
+    CHECK_EQUAL(1, timer_wheel_advance(&wheel, start + 4 * WHEEL_RANGE, record_fire, &log));
+    check_fired_on_time(&farther);
+    CHECK(wheel.overflow.next == &wheel.overflow);
+}
+
+// An advance jumps straight to the next tick with work, gaps far longer than the wheel cost nothing.
+static void test_idle_ticks_skipped()
+{
+    TimerWheel wheel;
+    timer_wheel_init(&wheel, 0);
+
+    FireLog log = {&wheel, 0};
+    CHECK_EQUAL(0, timer_wheel_advance(&wheel, INT64_MAX / 4, record_fire, &log));
+    CHECK_EQUAL(INT64_MAX / 4, wheel.current);
+
+    const int64_t start = wheel.current;
+    TestTimer timers[3];
+    schedule(&wheel, &timers[0], start + 1000000000000ll);
+    schedule(&wheel, &timers[1], start + 1000000000001ll);
+    schedule(&wheel, &timers[2], start + 3 * WHEEL_RANGE + 1);
+
+    CHECK_EQUAL(3, timer_wheel_advance(&wheel, start + 2000000000000ll, record_fire, &log));
+    for (size_t i = 0; i < 3; i++)
+    {
+        check_fired_on_time(&timers[i]);
+    }
+    CHECK_EQUAL(start + 2000000000000ll, wheel.current);
+}
+
+// Past timers fire on the next advance, cancelled ones never, and a callback may reschedule its own node.
+static void reschedule_once(TimerNode* node, void* context)
+{
+    FireLog* log = context;
+    TestTimer* timer = (TestTimer*)node;
+    timer->fire_count++;
+    log->fired++;
+    if (timer->fire_count == 1)
+    {
+        timer_wheel_schedule(log->wheel, node, log->wheel->current + 100);
+    }
+}
+
+static void test_past_cancel_and_reschedule()
+{
+    TimerWheel wheel;
+    timer_wheel_init(&wheel, 500);
+
+    TestTimer past;
+    TestTimer cancelled;
+    TestTimer repeating;
+    schedule(&wheel, &past, 10);
+    schedule(&wheel, &cancelled, 600);
+    schedule(&wheel, &repeating, 520);
+    timer_wheel_cancel(&wheel, &cancelled.node);
+    timer_wheel_cancel(&wheel, &cancelled.node);
+    CHECK_EQUAL(2, wheel.count);
+
+    FireLog log = {&wheel, 0};
+    CHECK_EQUAL(1, timer_wheel_advance(&wheel, 501, record_fire, &log));
+    check_fired_on_time(&past);
+
+    CHECK_EQUAL(2, timer_wheel_advance(&wheel, 1000, reschedule_once, &log));
+    CHECK_EQUAL(2, repeating.fire_count);
+    CHECK_EQUAL(0, cancelled.fire_count);
+    CHECK_EQUAL(0, wheel.count);
+}
+
+// Random timers over every level and the overflow list, advanced by random steps, against their due ticks.
+static void test_random_timers()
+{
+    static TestTimer timers[RANDOM_TIMERS];
+    TimerWheel wheel;
+    const int64_t start = 123456789;
+    timer_wheel_init(&wheel, start);
+
+    for (size_t i = 0; i < RANDOM_TIMERS; i++)
+    {
+        const int level = (int)(next_random() % (TIMER_WHEEL_LEVELS + 1));
+        const int64_t delta = (int64_t)(next_random() % (uint64_t)(LEVEL_SPAN(level + 1))) - 10;
+        schedule(&wheel, &timers[i], start + delta);
+    }
+
+    FireLog log = {&wheel, 0};
+    const int64_t end = start + LEVEL_SPAN(TIMER_WHEEL_LEVELS + 1);
+    while (wheel.current < end)
+    {
+        const int64_t step = (int64_t)(next_random() % (uint64_t)LEVEL_SPAN(1 + next_random() % TIMER_WHEEL_LEVELS));
+        const int64_t now = wheel.current + step + 1 < end ? wheel.current + step + 1 : end;
+        timer_wheel_advance(&wheel, now, record_fire, &log);
+
+        for (size_t i = 0; i < RANDOM_TIMERS; i += 97)
+        {
+            CHECK_EQUAL(timers[i].due <= now, timers[i].fire_count);
+        }
+    }
+
+    CHECK_EQUAL(RANDOM_TIMERS, log.fired);
+    int late = 0;
+    for (size_t i = 0; i < RANDOM_TIMERS; i++)
+    {
+        late += timers[i].fire_count != 1 || timers[i].fired_at != timers[i].due;
+    }
+    CHECK_EQUAL(0, late);
+}
+
+static void test_drain()
+{
+    TimerWheel wheel;
+    timer_wheel_init(&wheel, 0);
+
+    TestTimer timers[4];
+    schedule(&wheel, &timers[0], 1);
+    schedule(&wheel, &timers[1], LEVEL_SPAN(2));
+    schedule(&wheel, &timers[2], LEVEL_SPAN(3) + 5);
+    schedule(&wheel, &timers[3], 2 * WHEEL_RANGE);
+
+    FireLog log = {&wheel, 0};
+    timer_wheel_drain(&wheel, record_fire, &log);
+    CHECK_EQUAL(4, log.fired);
+    CHECK_EQUAL(0, wheel.count);
+    CHECK_EQUAL(0, wheel.current);
+    CHECK_EQUAL(0, timer_wheel_advance(&wheel, 4 * WHEEL_RANGE, record_fire, &log));
+}
+
+int main()
+{
+    RUN_TEST(test_cascades_between_levels);
+    RUN_TEST(test_overflow_list);
+    RUN_TEST(test_idle_ticks_skipped);
+    RUN_TEST(test_past_cancel_and_reschedule);
+    RUN_TEST(test_random_timers);
+    RUN_TEST(test_drain);
+    return TEST_RESULT();
+}